@@ -203,6 +203,14 @@ struct l1ctl_fbsb_req {
 struct l1ctl_ccch_mode_req {
 	uint8_t ccch_mode;	/* enum ccch_mode */
 	uint8_t padding[3];
+	/* DRX of the paging channel (3GPP TS 45.002, section 6.5),
+	 * optional: older senders do not include this part */
+	struct {
+		uint8_t bs_pa_mfrms;	/* 2..9, 0 disables DRX */
+		uint8_t bs_ag_blks_res;	/* 0..7 */
+		uint8_t paging_group;	/* PAGING_GROUP (section 6.5.2) */
+		uint8_t padding;
+	} drx;
 } __attribute__((packed));
 
 /*
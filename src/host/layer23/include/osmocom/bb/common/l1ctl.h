@@ -47,6 +47,9 @@ int l1ctl_tx_fbsb_req(struct osmocom_ms *ms, uint16_t arfcn,
 
 /* Transmit CCCH_MODE_REQ */
 int l1ctl_tx_ccch_mode_req(struct osmocom_ms *ms, uint8_t ccch_mode);
+int l1ctl_tx_ccch_mode_req_drx(struct osmocom_ms *ms, uint8_t ccch_mode,
+			       uint8_t bs_pa_mfrms, uint8_t bs_ag_blks_res,
+			       uint8_t paging_group);
 
 /* Transmit TCH_MODE_REQ */
 int l1ctl_tx_tch_mode_req(struct osmocom_ms *ms, uint8_t tch_mode, uint8_t audio_mode, uint8_t tch_flags,
@@ -31,6 +31,8 @@ enum l23_gsmtap_gprs_category {
 	L23_GSMTAP_GPRS_C_UL_DATA_EGPRS	= 9,	/* uplink EGPRS data blocks */
 };
 
+struct gsmtap_export;
+
 struct l23_global_config {
 	struct {
 		char *remote_host;
@@ -39,7 +41,9 @@ struct l23_global_config {
 		uint32_t lchan_acch_mask; /* see l23_gsmtap_gprs_category */
 		bool lchan_acch;
 		uint32_t categ_gprs_mask;
+		char *pcap_file; /* write GSMTAP to a pcap file instead */
 		struct gsmtap_inst *inst;
+		struct gsmtap_export *exp; /* see gsmtap_export.h */
 	} gsmtap;
 };
 extern struct l23_global_config l23_cfg;
@@ -65,6 +65,9 @@ struct rx_meas_stat {
 
 	/* counters loss criterion */
 	int16_t dsc, ds_fail;
+	/* our paging block (DRX): multiframe and first frame of the block,
+	 * pag_mfrms is BS_PA_MFRMS or 0 if the paging block is unknown */
+	uint8_t pag_mfrms, pag_mf, pag_fn;
 	int16_t s, rl_fail;
 };
 
@@ -75,10 +78,27 @@ enum osmobb_ms_shutdown_st {
 	MS_SHUTDOWN_COMPL = 3,
 };
 
+/* Queues of an MS instance, see osmocom_ms_sched() */
+enum osmocom_ms_work {
+	MS_WORK_RSL		= 1 << 0,	/* rr->rsl_upqueue */
+	MS_WORK_RR		= 1 << 1,	/* mm->rr_upqueue */
+	MS_WORK_MMXX		= 1 << 2,	/* mm->mmxx_upqueue */
+	MS_WORK_MMR		= 1 << 3,	/* mm->mmr_downqueue */
+	MS_WORK_MMEVENT		= 1 << 4,	/* mm->event_queue */
+	MS_WORK_PLMN		= 1 << 5,	/* plmn->event_queue */
+	MS_WORK_CS		= 1 << 6,	/* cellsel->event_queue */
+	MS_WORK_SIM		= 1 << 7,	/* sim->jobs */
+	MS_WORK_MNCC		= 1 << 8,	/* cc->mncc_upqueue */
+};
+
 struct osmocom_ms {
 	struct llist_head entity;
+	/* entry in ms_ready_list (if runnable) and queues with pending work */
+	struct llist_head ready_entry;
+	uint32_t work_pending;
 	char *name;
 	struct osmo_wqueue l2_wq, sap_wq;
+	struct l1ctl_framing_rx *l2_rx; /* see layer2_open() */
 	uint16_t test_arfcn;
 	struct osmol1_entity l1_entity;
 
@@ -112,5 +132,9 @@ struct osmocom_ms {
 };
 
 struct osmocom_ms *osmocom_ms_alloc(void *ctx, const char *name);
+void osmocom_ms_sched(struct osmocom_ms *ms, uint32_t work);
+
+/* MS instances which have pending work (or need attention otherwise) */
+extern struct llist_head ms_ready_list;
 
 extern uint16_t cfg_test_arfcn;
@@ -118,9 +118,10 @@ struct gsm_support_scan_max {
 	uint16_t	start;
 	uint16_t	end;
 	uint16_t	max;
-	uint16_t	temp;
 };
-extern struct gsm_support_scan_max gsm_sup_smax[];
+/* number of bands in gsm_sup_smax[] (excluding the terminator) */
+#define GSM_SUP_SMAX_NUM	7
+extern struct gsm_support_scan_max gsm_sup_smax[GSM_SUP_SMAX_NUM + 1];
 
 void gsm_support_init(struct osmocom_ms *ms);
 void gsm_support_dump(struct osmocom_ms *ms,
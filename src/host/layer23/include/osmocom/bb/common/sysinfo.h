@@ -18,6 +18,50 @@
 #define	FREQ_TYPE_REP_5bis	0x40 /* sub channel of SI 5bis */
 #define	FREQ_TYPE_REP_5ter	0x80 /* sub channel of SI 5ter */
 
+/* set of ARFCNs (0..1023), one bit per ARFCN */
+#define ARFCN_SET_WORDS		(1024 / 32)
+
+struct arfcn_set {
+	uint32_t			w[ARFCN_SET_WORDS];
+};
+
+static inline void arfcn_set_add(struct arfcn_set *set, uint16_t arfcn)
+{
+	set->w[(arfcn & 1023) >> 5] |= 1U << (arfcn & 31);
+}
+
+static inline void arfcn_set_del(struct arfcn_set *set, uint16_t arfcn)
+{
+	set->w[(arfcn & 1023) >> 5] &= ~(1U << (arfcn & 31));
+}
+
+static inline bool arfcn_set_has(const struct arfcn_set *set, uint16_t arfcn)
+{
+	return (set->w[(arfcn & 1023) >> 5] >> (arfcn & 31)) & 1;
+}
+
+int arfcn_set_next(const struct arfcn_set *set, int arfcn);
+unsigned int arfcn_set_count(const struct arfcn_set *set);
+void arfcn_set_or(struct arfcn_set *set, const struct arfcn_set *other);
+
+/* iterate over all ARFCNs of a set in ascending order */
+#define arfcn_set_for_each(arfcn, set) \
+	for (arfcn = arfcn_set_next(set, 0); arfcn >= 0; \
+	     arfcn = arfcn_set_next(set, arfcn + 1))
+
+/* frequency lists of a cell, FREQ_TYPE_x is (1 << FREQ_LIST_x) */
+enum gsm48_freq_list {
+	FREQ_LIST_SERV = 0,
+	FREQ_LIST_HOPP,
+	FREQ_LIST_NCELL_2,
+	FREQ_LIST_NCELL_2bis,
+	FREQ_LIST_NCELL_2ter,
+	FREQ_LIST_REP_5,
+	FREQ_LIST_REP_5bis,
+	FREQ_LIST_REP_5ter,
+	FREQ_LIST_NUM
+};
+
 struct si10_cell_info {
 	uint8_t				index; /* frequency index of the frequencies received in SI5* */
 	int16_t				arfcn; /* ARFCN or -1 (if not found in SI5*) */
@@ -54,7 +98,9 @@ struct gsm48_sysinfo {
 	uint8_t				si10_msg[21];
 	uint8_t				si13_msg[23];
 
-	struct	gsm_sysinfo_freq	freq[1024]; /* all frequencies */
+	/* frequencies per list, use gsm48_sysinfo_freq_mask() or
+	 * gsm48_sysinfo_freq_set() to look at several lists at once */
+	struct arfcn_set		freq[FREQ_LIST_NUM];
 	uint16_t			hopping[64]; /* hopping arfcn */
 	uint8_t				hopp_len;
 
@@ -217,9 +263,16 @@ int gsm48_decode_sysinfo10(struct gsm48_sysinfo *s,
 			   const struct gsm48_system_information_type_10 *si, int len);
 int gsm48_decode_sysinfo13(struct gsm48_sysinfo *s,
 			   const struct gsm48_system_information_type_13 *si, int len);
-int gsm48_decode_mobile_alloc(struct gsm_sysinfo_freq *freq,
+int gsm48_decode_freq_set(struct arfcn_set *set, const uint8_t *cd,
+			  uint8_t len, uint8_t mask);
+int gsm48_decode_mobile_alloc(const struct arfcn_set *serv,
+			      struct arfcn_set *hopp,
 			      const uint8_t *ma, uint8_t len,
-			      uint16_t *hopping, uint8_t *hopp_len, int si4);
+			      uint16_t *hopping, uint8_t *hopp_len);
+uint8_t gsm48_sysinfo_freq_mask(const struct gsm48_sysinfo *s, uint16_t arfcn);
+void gsm48_sysinfo_freq_set(const struct gsm48_sysinfo *s, uint8_t types,
+			    struct arfcn_set *set);
 int16_t arfcn_from_freq_index(const struct gsm48_sysinfo *s, uint16_t index);
+int gsm48_sysinfo_paging_group(const struct gsm48_sysinfo *s, const char *imsi);
 
 #endif /* _SYSINFO_H */
@@ -6,6 +6,7 @@
 #include <osmocom/gsm/gsm23003.h>
 
 #include <osmocom/bb/common/sysinfo.h>
+#include <osmocom/bb/common/support.h>
 
 /* 4.3.1.1 List of states for PLMN selection process (automatic mode) */
 #define GSM322_A0_NULL			0
@@ -175,7 +176,12 @@ struct gsm322_cellsel {
 	struct osmo_plmn_id	plmn; /* current network to search for */
 	uint8_t			powerscan; /* currently scanning for power */
 	uint8_t			ccch_state; /* special state of current ccch */
-	uint32_t		scan_state; /* special state of current scan */
+	int			pm_next; /* list index to continue power scan */
+	uint16_t		scan_heap[1024+299];
+				/* frequencies to scan, strongest first */
+	int			scan_heap_len;
+	uint16_t		scan_smax_cnt[GSM_SUP_SMAX_NUM];
+				/* frequencies scanned per band (3.2.1) */
 	uint16_t		arfcn; /* current tuned idle mode arfcn */
 	int			arfci; /* list index of frequency above */
 	uint8_t			ccch_mode; /* curren CCCH_MODE_* */
@@ -207,6 +213,62 @@ struct gsm322_cellsel {
 	uint8_t			prio_low;
 };
 
+/* weight depends on the power level, if it is the same, it depends on arfcn */
+static inline uint32_t gsm322_cs_weight(const struct gsm322_cellsel *cs,
+					int i)
+{
+	return ((uint32_t)(cs->list[i].rxlev + 1) << 16) | i;
+}
+
+/* add a frequency to the max-heap of frequencies to scan */
+static inline void gsm322_cs_heap_push(struct gsm322_cellsel *cs, int i)
+{
+	uint32_t weight = gsm322_cs_weight(cs, i);
+	int pos = cs->scan_heap_len++;
+
+	while (pos > 0) {
+		int parent = (pos - 1) / 2;
+
+		if (gsm322_cs_weight(cs, cs->scan_heap[parent]) >= weight)
+			break;
+		cs->scan_heap[pos] = cs->scan_heap[parent];
+		pos = parent;
+	}
+	cs->scan_heap[pos] = i;
+}
+
+/* remove the strongest frequency from the max-heap, -1 if empty */
+static inline int gsm322_cs_heap_pop(struct gsm322_cellsel *cs)
+{
+	int top, last, pos = 0;
+	uint32_t weight;
+
+	if (cs->scan_heap_len == 0)
+		return -1;
+
+	top = cs->scan_heap[0];
+	last = cs->scan_heap[--cs->scan_heap_len];
+	weight = gsm322_cs_weight(cs, last);
+
+	while (1) {
+		int child = 2 * pos + 1;
+
+		if (child >= cs->scan_heap_len)
+			break;
+		if (child + 1 < cs->scan_heap_len
+		 && gsm322_cs_weight(cs, cs->scan_heap[child + 1])
+				> gsm322_cs_weight(cs, cs->scan_heap[child]))
+			child++;
+		if (weight >= gsm322_cs_weight(cs, cs->scan_heap[child]))
+			break;
+		cs->scan_heap[pos] = cs->scan_heap[child];
+		pos = child;
+	}
+	cs->scan_heap[pos] = last;
+
+	return top;
+}
+
 /* GSM 03.22 message */
 struct gsm322_msg {
 	int			msg_type;
@@ -222,6 +284,9 @@ struct gsm322_msg {
 
 uint16_t index2arfcn(int index);
 int arfcn2index(uint16_t arfcn);
+void gsm322_cs_si_replace(struct gsm322_cellsel *cs, struct gsm48_sysinfo *s);
+struct gsm48_sysinfo *gsm322_cs_si_intern(struct gsm322_cellsel *cs);
+struct gsm48_sysinfo *gsm322_cs_si_writable(struct gsm322_cellsel *cs);
 int gsm322_init(struct osmocom_ms *ms);
 int gsm322_exit(struct osmocom_ms *ms);
 struct msgb *gsm322_msgb_alloc(int msg_type);
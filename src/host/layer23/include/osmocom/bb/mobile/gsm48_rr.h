@@ -245,6 +245,7 @@ struct msgb *gsm48_rr_msgb_alloc(int msg_type);
 int gsm48_rr_enc_cm2(struct osmocom_ms *ms, struct gsm48_classmark2 *cm,
 	uint16_t arfcn);
 int gsm48_rr_tx_rand_acc(struct osmocom_ms *ms, struct msgb *msg);
+int gsm48_rr_tx_ccch_mode(struct osmocom_ms *ms);
 int gsm48_rr_los(struct osmocom_ms *ms);
 int gsm48_rr_rach_conf(struct osmocom_ms *ms, uint32_t fn);
 extern const char *gsm48_rr_state_names[];
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <osmocom/bb/common/sysinfo.h>
+
+/* System information of cells, shared by all MS instances of the process.
+ *
+ * Each 'struct gsm48_sysinfo' of the cell selection list is a reference
+ * counted object of this cache.  Once interned (see si_cache_intern()), an
+ * object is read-only and may be shared by any number of MS instances
+ * which received the same system information on the same ARFCN.  It must
+ * be copied by si_cache_unshare() before it is modified (copy-on-write).
+ *
+ * Additionally, the cache remembers which object results from applying a
+ * SYSTEM INFORMATION message to an interned object, so that the decoding
+ * is done once only, no matter how many MS instances receive the message.
+ * The raw message is part of the key, as well as the object it is applied
+ * to: SI messages update the system information collected so far (e.g.
+ * SI 4 refers to the cell allocation of SI 1). */
+
+/* max length of a SYSTEM INFORMATION message (key of a transition) */
+#define SI_CACHE_MSG_MAX	23
+/* max number of transitions (least recently used ones are dropped) */
+#define SI_CACHE_TRANS_MAX	4096
+
+void si_cache_init(void *ctx);
+
+struct gsm48_sysinfo *si_cache_alloc(uint16_t arfcn);
+struct gsm48_sysinfo *si_cache_get(struct gsm48_sysinfo *s);
+void si_cache_put(struct gsm48_sysinfo *s);
+uint16_t si_cache_arfcn(const struct gsm48_sysinfo *s);
+
+struct gsm48_sysinfo *si_cache_intern(struct gsm48_sysinfo *s);
+struct gsm48_sysinfo *si_cache_unshare(struct gsm48_sysinfo *s);
+
+struct gsm48_sysinfo *si_cache_lookup(const struct gsm48_sysinfo *from,
+				      uint8_t type, const uint8_t *msg,
+				      unsigned int len);
+struct gsm48_sysinfo *si_cache_store(struct gsm48_sysinfo *from,
+				     uint8_t type, const uint8_t *msg,
+				     unsigned int len, struct gsm48_sysinfo *to);
+void si_cache_flush(void);
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <osmocom/core/utils.h>
+
+/* The state machines of the mobile use lists of state transitions like
+ *
+ *	static struct xxxstate {
+ *		uint32_t states;
+ *		int type;
+ *		int (*rout) (...);
+ *	} xxxstatelist[] = { ... };
+ *
+ * where the first entry matching the message type and the current state
+ * (bit in 'states') is used.  Instead of searching such a list for each
+ * message, an index mapping [type][state] to that entry is built once.
+ * The list itself remains the source of truth. */
+
+#define STATELIST_NUM_STATES	32
+
+struct statelist_row {
+	/* first entry of this type (in any state), -1 if none */
+	int16_t		any;
+	/* first entry of this type per state, -1 if none */
+	int16_t		state[STATELIST_NUM_STATES];
+};
+
+struct statelist_idx {
+	/* lowest message type in the list, rows[0] */
+	int			type_min;
+	unsigned int		num_types;
+	struct statelist_row	*rows;
+	/* per entry: states, next entry of the same type (-1 if none) */
+	uint32_t		*states;
+	int16_t			*next;
+};
+
+void statelist_idx_init(void *ctx, struct statelist_idx *idx, const char *name,
+			const void *list, unsigned int num, size_t size,
+			size_t states_off, size_t type_off);
+void statelist_idx_free(struct statelist_idx *idx);
+
+/* build the index of a list (only once, subsequent calls are no-ops) */
+#define STATELIST_IDX_INIT(ctx, idx, list) \
+	statelist_idx_init(ctx, idx, #list, list, ARRAY_SIZE(list), sizeof((list)[0]), \
+			   offsetof(__typeof__((list)[0]), states), \
+			   offsetof(__typeof__((list)[0]), type))
+
+/*! Find the first entry of a list for the given message type and state.
+ *  \returns index of the entry in the list; -1 if there is none. */
+static inline int statelist_idx_find(const struct statelist_idx *idx,
+				     int type, int state)
+{
+	unsigned int row = (unsigned int)(type - idx->type_min);
+
+	if (row >= idx->num_types || (unsigned int)state >= STATELIST_NUM_STATES)
+		return -1;
+	return idx->rows[row].state[state];
+}
+
+/*! Find the next entry after the given one for the same type and state.
+ *  (To be used for lists which need to match further criteria.)
+ *  \returns index of the entry in the list; -1 if there is none. */
+static inline int statelist_idx_find_next(const struct statelist_idx *idx,
+					  int i, int state)
+{
+	for (i = idx->next[i]; i >= 0; i = idx->next[i]) {
+		if (idx->states[i] & (1U << state))
+			break;
+	}
+	return i;
+}
+
+/*! Check if the given message type is handled in any state at all. */
+static inline bool statelist_idx_type_known(const struct statelist_idx *idx,
+					    int type)
+{
+	unsigned int row = (unsigned int)(type - idx->type_min);
+
+	return row < idx->num_types && idx->rows[row].any >= 0;
+}
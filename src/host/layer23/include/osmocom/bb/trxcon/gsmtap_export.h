@@ -0,0 +1 @@
+../../../../../trxcon/include/osmocom/bb/trxcon/gsmtap_export.h
\ No newline at end of file
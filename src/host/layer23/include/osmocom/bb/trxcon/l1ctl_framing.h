@@ -0,0 +1 @@
+../../../../../trxcon/include/osmocom/bb/trxcon/l1ctl_framing.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../trxcon/src/gsmtap_export.c
\ No newline at end of file
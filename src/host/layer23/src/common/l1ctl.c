@@ -46,6 +46,7 @@
 #include <osmocom/bb/common/ms.h>
 #include <osmocom/bb/common/l1l2_interface.h>
 #include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/trxcon/gsmtap_export.h>
 
 /* determine the CCCH block number based on the frame number */
 static unsigned int fn2ccch_block(uint32_t fn)
@@ -67,6 +68,17 @@ static uint8_t chantype_rsl2gsmtap_ext(uint8_t rsl_chantype, uint8_t link_id, ui
 	return GSMTAP_CHANNEL_AGCH;
 }
 
+/* GSMTAP messages are handed over to the asynchronous exporter (if any) */
+static inline void l23_gsmtap_send(uint16_t arfcn, uint8_t ts, uint8_t chan_type,
+				   uint8_t ss, uint32_t fn, int8_t signal_dbm,
+				   int8_t snr, const uint8_t *data, unsigned int len)
+{
+	if (l23_cfg.gsmtap.exp == NULL)
+		return;
+	gsmtap_export_send(l23_cfg.gsmtap.exp, arfcn, ts, chan_type, ss, fn,
+			   signal_dbm, snr, data, len);
+}
+
 static const uint8_t fill_frame[GSM_MACBLOCK_LEN] = {
         0x03, 0x03, 0x01, 0x2B, 0x2B, 0x2B, 0x2B, 0x2B, 0x2B, 0x2B,
         0x2B, 0x2B, 0x2B, 0x2B, 0x2B, 0x2B, 0x2B, 0x2B, 0x2B, 0x2B,
@@ -227,12 +239,13 @@ static int rx_ph_data_ind(struct osmocom_ms *ms, struct msgb *msg)
 	if (!(dl->link_id & 0x40)) {
 		switch (chan_type) {
 		case RSL_CHAN_PCH_AGCH:
-			/* only look at one CCCH frame in each 51 multiframe.
-			 * FIXME: implement DRX
-			 * - select correct paging block that is for us.
-			 * - initialize ds_fail according to BS_PA_MFRMS.
-			 */
-			if ((meas->last_fn % 51) != 6)
+			/* only look at our paging block (DRX) or, if it is
+			 * not known, at one CCCH block in each 51 multiframe */
+			if (meas->pag_mfrms) {
+				if ((meas->last_fn / 51) % meas->pag_mfrms != meas->pag_mf
+				 || (meas->last_fn % 51) != meas->pag_fn)
+					break;
+			} else if ((meas->last_fn % 51) != 6)
 				break;
 			if (!meas->ds_fail)
 				break;
@@ -292,9 +305,9 @@ static int rx_ph_data_ind(struct osmocom_ms *ms, struct msgb *msg)
 	 * to clog up your logs */
 	if (!is_fill_frame(gsmtap_chan_type, ccch->data)) {
 		/* send CCCH data via GSMTAP */
-		gsmtap_send(l23_cfg.gsmtap.inst, ntohs(dl->band_arfcn), chan_ts,
-			    gsmtap_chan_type, chan_ss, tm.fn, dl->rx_level-110,
-			    dl->snr, ccch->data, sizeof(ccch->data));
+		l23_gsmtap_send(ntohs(dl->band_arfcn), chan_ts,
+				gsmtap_chan_type, chan_ss, tm.fn, dl->rx_level-110,
+				dl->snr, ccch->data, sizeof(ccch->data));
 	}
 
 	/* Do not pass PDCH and CBCH frames to LAPDm */
@@ -370,9 +383,9 @@ int l1ctl_tx_data_req(struct osmocom_ms *ms, struct msgb *msg,
 	/* send copy via GSMTAP */
 	if (rsl_dec_chan_nr(chan_nr, &chan_type, &chan_ss, &chan_ts) == 0) {
 		uint8_t gsmtap_chan_type = chantype_rsl2gsmtap2(chan_type, link_id, false);
-		gsmtap_send(l23_cfg.gsmtap.inst, ms->rrlayer.cd_now.arfcn | GSMTAP_ARFCN_F_UPLINK,
-			    chan_ts, gsmtap_chan_type, chan_ss, 0, 127, 0,
-			    msg->l2h, msgb_l2len(msg));
+		l23_gsmtap_send(ms->rrlayer.cd_now.arfcn | GSMTAP_ARFCN_F_UPLINK,
+				chan_ts, gsmtap_chan_type, chan_ss, 0, 127, 0,
+				msg->l2h, msgb_l2len(msg));
 	} else {
 		LOGP(DL1C, LOGL_ERROR,
 		     "%s(): rsl_dec_chan_nr(chan_nr=0x%02x) failed\n",
@@ -426,18 +439,30 @@ int l1ctl_tx_fbsb_req(struct osmocom_ms *ms, uint16_t arfcn,
 
 /* Transmit L1CTL_CCCH_MODE_REQ */
 int l1ctl_tx_ccch_mode_req(struct osmocom_ms *ms, uint8_t ccch_mode)
+{
+	return l1ctl_tx_ccch_mode_req_drx(ms, ccch_mode, 0, 0, 0);
+}
+
+/* Transmit L1CTL_CCCH_MODE_REQ, receive only our paging block (DRX) */
+int l1ctl_tx_ccch_mode_req_drx(struct osmocom_ms *ms, uint8_t ccch_mode,
+			       uint8_t bs_pa_mfrms, uint8_t bs_ag_blks_res,
+			       uint8_t paging_group)
 {
 	struct msgb *msg;
 	struct l1ctl_ccch_mode_req *req;
 
-	LOGP(DL1C, LOGL_INFO, "CCCH Mode Req\n");
+	LOGP(DL1C, LOGL_INFO, "CCCH Mode Req (DRX %s)\n", bs_pa_mfrms ? "on" : "off");
 
 	msg = osmo_l1_alloc(L1CTL_CCCH_MODE_REQ);
 	if (!msg)
 		return -1;
 
 	req = (struct l1ctl_ccch_mode_req *) msgb_put(msg, sizeof(*req));
+	memset(req, 0, sizeof(*req));
 	req->ccch_mode = ccch_mode;
+	req->drx.bs_pa_mfrms = bs_pa_mfrms;
+	req->drx.bs_ag_blks_res = bs_ag_blks_res;
+	req->drx.paging_group = paging_group;
 
 	return osmo_send_l1(ms, msg);
 }
@@ -1007,11 +1032,10 @@ static int rx_l1_gprs_dl_block_ind(struct osmocom_ms *ms, struct msgb *msg)
 	else
 		gsmtap_chan = GSMTAP_CHANNEL_PDTCH;
 
-	gsmtap_send(l23_cfg.gsmtap.inst,
-		    ms->rrlayer.cd_now.arfcn,
-		    ind->hdr.tn, gsmtap_chan, 0, fn,
-		    rxlev2dbm(ind->meas.rx_lev), 0,
-		    msgb_l2(msg), msgb_l2len(msg));
+	l23_gsmtap_send(ms->rrlayer.cd_now.arfcn,
+			ind->hdr.tn, gsmtap_chan, 0, fn,
+			rxlev2dbm(ind->meas.rx_lev), 0,
+			msgb_l2(msg), msgb_l2len(msg));
 
 	DEBUGP(DL1C, "Rx GPRS DL BLOCK.ind (fn=%u, tn=%u, len=%u): %s\n",
 	       fn, ind->hdr.tn, msgb_l2len(msg), msgb_hexdump_l2(msg));
@@ -1073,10 +1097,9 @@ int l1ctl_tx_gprs_ul_block_req(struct osmocom_ms *ms, uint32_t fn, uint8_t tn,
 	DEBUGP(DL1C, "Tx GPRS UL block (fn=%u, tn=%u, len=%zu): %s\n",
 	       fn, tn, data_len, osmo_hexdump(data, data_len));
 
-	gsmtap_send(l23_cfg.gsmtap.inst,
-		    ms->rrlayer.cd_now.arfcn | GSMTAP_ARFCN_F_UPLINK,
-		    tn, GSMTAP_CHANNEL_PDTCH, 0, fn, 127, 0,
-		    data, data_len);
+	l23_gsmtap_send(ms->rrlayer.cd_now.arfcn | GSMTAP_ARFCN_F_UPLINK,
+			tn, GSMTAP_CHANNEL_PDTCH, 0, fn, 127, 0,
+			data, data_len);
 
 	return osmo_send_l1(ms, msg);
 }
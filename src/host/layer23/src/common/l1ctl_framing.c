@@ -0,0 +1 @@
+../../../trxcon/src/l1ctl_framing.c
\ No newline at end of file
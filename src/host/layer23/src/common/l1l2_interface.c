@@ -22,8 +22,10 @@
 #include <osmocom/bb/common/l1ctl.h>
 #include <osmocom/bb/common/logging.h>
 #include <osmocom/bb/common/l1l2_interface.h>
+#include <osmocom/bb/trxcon/l1ctl_framing.h>
 
 #include <osmocom/core/utils.h>
+#include <osmocom/core/talloc.h>
 #include <osmocom/core/socket.h>
 #include <osmocom/core/select.h>
 
@@ -43,59 +45,57 @@
 
 static int layer2_read(struct osmo_fd *fd)
 {
+	struct osmocom_ms *ms = (struct osmocom_ms *) fd->data;
+	const uint8_t *data;
 	struct msgb *msg;
-	uint16_t len;
 	int rc;
 
-	msg = msgb_alloc_headroom(GSM_L2_LENGTH+GSM_L2_HEADROOM, GSM_L2_HEADROOM, "Layer2");
-	if (!msg) {
-		LOGP(DL1C, LOGL_ERROR, "Failed to allocate msg.\n");
-		return -ENOMEM;
-	}
-
-	rc = read(fd->fd, &len, sizeof(len));
-	if (rc < sizeof(len)) {
+	/* Read whatever is available, there may be several messages */
+	rc = l1ctl_framing_rx_fill(ms->l2_rx, fd->fd);
+	if (rc == -EAGAIN)
+		return 0;
+	if (rc <= 0) {
 		fprintf(stderr, "Layer2 socket failed\n");
-		msgb_free(msg);
-		if (rc >= 0)
-			rc = -EIO;
-		layer2_close((struct osmocom_ms *) fd->data);
+		layer2_close(ms);
 		exit(102);
 		return rc;
 	}
 
-	len = ntohs(len);
-	if (len > GSM_L2_LENGTH) {
-		LOGP(DL1C, LOGL_ERROR, "Length is too big: %u\n", len);
-		msgb_free(msg);
-		return -EINVAL;
-	}
+	while ((rc = l1ctl_framing_rx_pop(ms->l2_rx, &data)) >= 0) {
+		msg = msgb_alloc_headroom(GSM_L2_LENGTH+GSM_L2_HEADROOM, GSM_L2_HEADROOM, "Layer2");
+		if (!msg) {
+			LOGP(DL1C, LOGL_ERROR, "Failed to allocate msg.\n");
+			continue;
+		}
 
+		msg->l1h = msgb_put(msg, rc);
+		memcpy(msg->l1h, data, rc);
 
-	msg->l1h = msgb_put(msg, len);
-	rc = read(fd->fd, msg->l1h, msgb_l1len(msg));
-	if (rc != msgb_l1len(msg)) {
-		LOGP(DL1C, LOGL_ERROR, "Can not read data: len=%d rc=%d "
-		     "errno=%d\n", len, rc, errno);
-		msgb_free(msg);
-		return rc;
+		l1ctl_recv(ms, msg);
 	}
 
-	l1ctl_recv((struct osmocom_ms *) fd->data, msg);
+	/* The length prefix is garbage, the stream cannot be recovered */
+	if (rc == -EMSGSIZE) {
+		fprintf(stderr, "Layer2 socket failed: message is too long\n");
+		layer2_close(ms);
+		exit(102);
+	}
 
 	return 0;
 }
 
 static int layer2_write(struct osmo_fd *fd, struct msgb *msg)
 {
+	struct osmocom_ms *ms = (struct osmocom_ms *) fd->data;
 	int rc;
 
 	if (fd->fd <= 0)
 		return -EINVAL;
 
-	rc = write(fd->fd, msg->data, msg->len);
-	if (rc != msg->len) {
-		LOGP(DL1C, LOGL_ERROR, "Failed to write data: rc: %d\n", rc);
+	/* Pending messages are coalesced into a single writev() call */
+	rc = l1ctl_framing_tx(&ms->l2_wq, msg);
+	if (rc != 0) {
+		LOGP(DL1C, LOGL_ERROR, "Failed to write data: %s\n", strerror(-rc));
 		return rc;
 	}
 
@@ -113,6 +113,10 @@ int layer2_open(struct osmocom_ms *ms, const char *socket_path)
 		return rc;
 	}
 
+	ms->l2_rx = talloc_zero(ms, struct l1ctl_framing_rx);
+	OSMO_ASSERT(ms->l2_rx != NULL);
+	l1ctl_framing_rx_init(ms->l2_rx, GSM_L2_LENGTH);
+
 	osmo_wqueue_init(&ms->l2_wq, 100);
 	ms->l2_wq.bfd.data = ms;
 	ms->l2_wq.read_cb = layer2_read;
@@ -130,6 +134,7 @@ int layer2_close(struct osmocom_ms *ms)
 	close(ms->l2_wq.bfd.fd);
 	ms->l2_wq.bfd.fd = -1;
 	osmo_wqueue_clear(&ms->l2_wq);
+	TALLOC_FREE(ms->l2_rx);
 
 	return 0;
 }
@@ -26,6 +26,7 @@
 #include <osmocom/bb/common/logging.h>
 #include <osmocom/bb/common/l23_app.h>
 #include <osmocom/bb/common/vty.h>
+#include <osmocom/bb/trxcon/gsmtap_export.h>
 
 #include <osmocom/core/msgb.h>
 #include <osmocom/core/talloc.h>
@@ -190,8 +191,9 @@ void sighandler(int sigset)
 	if (l23_app_info.opt_supported & L23_OPT_VTY)
 		telnet_exit();
 
+	/* Leave the main loop, cleanup is not async-signal-safe */
 	if (rc != -EBUSY)
-		exit (0);
+		quit = 1;
 }
 
 static void print_copyright(void)
@@ -295,6 +297,19 @@ int main(int argc, char **argv)
 			}
 			gsmtap_source_add_sink(l23_cfg.gsmtap.inst);
 		}
+
+		if (l23_cfg.gsmtap.inst || l23_cfg.gsmtap.pcap_file) {
+			const struct gsmtap_export_cfg cfg = {
+				.fd = l23_cfg.gsmtap.inst ? gsmtap_inst_fd2(l23_cfg.gsmtap.inst) : -1,
+				.pcap_path = l23_cfg.gsmtap.pcap_file,
+			};
+
+			l23_cfg.gsmtap.exp = gsmtap_export_alloc(l23_ctx, &cfg);
+			if (!l23_cfg.gsmtap.exp) {
+				fprintf(stderr, "Failed to set up GSMTAP export\n");
+				exit(1);
+			}
+		}
 	}
 
 	if (l23_app_start) {
@@ -316,5 +331,8 @@ int main(int argc, char **argv)
 		osmo_select_main(0);
 	}
 
+	/* Flush the remaining GSMTAP messages */
+	gsmtap_export_free(l23_cfg.gsmtap.exp);
+
 	return 0;
 }
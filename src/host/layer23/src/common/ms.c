@@ -21,12 +21,15 @@
 #include <osmocom/bb/common/ms.h>
 
 extern struct llist_head ms_list;
+LLIST_HEAD(ms_ready_list);
 
 /* Default value be configured by cmdline arg: */
 uint16_t cfg_test_arfcn = 871;
 
 static int osmocom_ms_talloc_destructor(struct osmocom_ms *ms)
 {
+	if (!llist_empty(&ms->ready_entry))
+		llist_del(&ms->ready_entry);
 
 	if (ms->sap_wq.bfd.fd > -1) {
 		sap_close(ms);
@@ -47,6 +50,7 @@ struct osmocom_ms *osmocom_ms_alloc(void *ctx, const char *name)
 	if (!ms)
 		return NULL;
 	talloc_set_name(ms, "ms_%s", name);
+	INIT_LLIST_HEAD(&ms->ready_entry);
 	talloc_set_destructor(ms, osmocom_ms_talloc_destructor);
 
 	ms->name = talloc_strdup(ms, name);
@@ -78,3 +82,15 @@ struct osmocom_ms *osmocom_ms_alloc(void *ctx, const char *name)
 
 	return ms;
 }
+
+/*! Mark an MS instance as runnable, so that the application services it.
+ *  To be called whenever a message is enqueued to one of its queues.
+ *  \param[in] ms    MS instance.
+ *  \param[in] work  queues with pending messages (enum osmocom_ms_work),
+ *                   0 if the instance only needs attention otherwise. */
+void osmocom_ms_sched(struct osmocom_ms *ms, uint32_t work)
+{
+	ms->work_pending |= work;
+	if (llist_empty(&ms->ready_entry))
+		llist_add_tail(&ms->ready_entry, &ms_ready_list);
+}
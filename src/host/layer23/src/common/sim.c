@@ -156,6 +156,8 @@ void gsm_sim_reply(struct osmocom_ms *ms, uint8_t result_type, uint8_t *result,
 		msgb_free(sim->job_msg);
 		sim->job_msg = NULL;
 		sim->job_state = SIM_JST_IDLE;
+		/* the next job (if any) may be started */
+		osmocom_ms_sched(ms, MS_WORK_SIM);
 		return;
 	}
 
@@ -170,6 +172,7 @@ void gsm_sim_reply(struct osmocom_ms *ms, uint8_t result_type, uint8_t *result,
 	/* callback */
 	sim->job_state = SIM_JST_IDLE;
 	sim->job_msg = NULL;
+	osmocom_ms_sched(ms, MS_WORK_SIM);
 	handler->cb(ms, msg);
 }
 
@@ -1229,6 +1232,7 @@ void sim_job(struct osmocom_ms *ms, struct msgb *msg)
 	struct gsm_sim *sim = &ms->sim;
 
 	msgb_enqueue(&sim->jobs, msg);
+	osmocom_ms_sched(ms, MS_WORK_SIM);
 }
 
 /*
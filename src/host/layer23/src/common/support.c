@@ -108,15 +108,15 @@ void gsm_support_init(struct osmocom_ms *ms)
 }
 
 /* (3.2.1) maximum channels to scan within each band */
-struct gsm_support_scan_max gsm_sup_smax[] = {
-	{ 259, 293, 15, 0 }, /* GSM 450 */
-	{ 306, 340, 15, 0 }, /* GSM 480 */
-	{ 438, 511, 25, 0 },
-	{ 128, 251, 30, 0 }, /* GSM 850 */
-	{ 955, 124, 30, 0 }, /* P,E,R GSM */
-	{ 512, 885, 40, 0 }, /* DCS 1800 */
-	{ 1024, 1322, 40, 0 }, /* PCS 1900 */
-	{ 0, 0, 0, 0 }
+struct gsm_support_scan_max gsm_sup_smax[GSM_SUP_SMAX_NUM + 1] = {
+	{ 259, 293, 15 }, /* GSM 450 */
+	{ 306, 340, 15 }, /* GSM 480 */
+	{ 438, 511, 25 },
+	{ 128, 251, 30 }, /* GSM 850 */
+	{ 955, 124, 30 }, /* P,E,R GSM */
+	{ 512, 885, 40 }, /* DCS 1800 */
+	{ 1024, 1322, 40 }, /* PCS 1900 */
+	{ 0, 0, 0 }
 };
 
 #define SUP_SET(item) \
@@ -17,6 +17,8 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
 #include <string.h>
 #include <arpa/inet.h>
 
@@ -88,6 +90,7 @@ int gsm48_sysinfo_dump(const struct gsm48_sysinfo *s, uint16_t arfcn,
 	char buffer[82];
 	int i, j, k, index;
 	int refer_pcs = gsm_refer_pcs(arfcn, s);
+	struct arfcn_set ncell, rep;
 	int rc;
 
 	/* available sysinfos */
@@ -118,70 +121,67 @@ int gsm48_sysinfo_dump(const struct gsm48_sysinfo *s, uint16_t arfcn,
 	print(priv, "\n");
 	print(priv, "\n");
 
+	gsm48_sysinfo_freq_set(s, FREQ_TYPE_NCELL, &ncell);
+	gsm48_sysinfo_freq_set(s, FREQ_TYPE_REP, &rep);
+
 	/* frequency list */
 	j = 0; k = 0;
-	for (i = 0; i < 1024; i++) {
-		if ((s->freq[i].mask & FREQ_TYPE_SERV)) {
-			if (!k) {
-				sprintf(buffer, "serv. cell  : ");
-				j = strlen(buffer);
-			}
-			if (j >= 75) {
-				buffer[j - 1] = '\0';
-				print(priv, "%s\n", buffer);
-				sprintf(buffer, "              ");
-				j = strlen(buffer);
-			}
-			sprintf(buffer + j, "%d,", i);
+	arfcn_set_for_each(i, &s->freq[FREQ_LIST_SERV]) {
+		if (!k) {
+			sprintf(buffer, "serv. cell  : ");
 			j = strlen(buffer);
-			k++;
 		}
+		if (j >= 75) {
+			buffer[j - 1] = '\0';
+			print(priv, "%s\n", buffer);
+			sprintf(buffer, "              ");
+			j = strlen(buffer);
+		}
+		sprintf(buffer + j, "%d,", i);
+		j = strlen(buffer);
+		k++;
 	}
 	if (j) {
 		buffer[j - 1] = '\0';
 		print(priv, "%s\n", buffer);
 	}
 	j = 0; k = 0;
-	for (i = 0; i < 1024; i++) {
-		if ((s->freq[i].mask & FREQ_TYPE_NCELL)) {
-			if (!k) {
-				sprintf(buffer, "SI2 (neigh.) BA=%d: ",
-					s->nb_ba_ind_si2);
-				j = strlen(buffer);
-			}
-			if (j >= 70) {
-				buffer[j - 1] = '\0';
-				print(priv, "%s\n", buffer);
-				sprintf(buffer, "                   ");
-				j = strlen(buffer);
-			}
-			sprintf(buffer + j, "%d,", i);
+	arfcn_set_for_each(i, &ncell) {
+		if (!k) {
+			sprintf(buffer, "SI2 (neigh.) BA=%d: ",
+				s->nb_ba_ind_si2);
+			j = strlen(buffer);
+		}
+		if (j >= 70) {
+			buffer[j - 1] = '\0';
+			print(priv, "%s\n", buffer);
+			sprintf(buffer, "                   ");
 			j = strlen(buffer);
-			k++;
 		}
+		sprintf(buffer + j, "%d,", i);
+		j = strlen(buffer);
+		k++;
 	}
 	if (j) {
 		buffer[j - 1] = '\0';
 		print(priv, "%s\n", buffer);
 	}
 	j = 0; k = 0;
-	for (i = 0; i < 1024; i++) {
-		if ((s->freq[i].mask & FREQ_TYPE_REP)) {
-			if (!k) {
-				sprintf(buffer, "SI5 (report) BA=%d: ",
-					s->nb_ba_ind_si5);
-				j = strlen(buffer);
-			}
-			if (j >= 70) {
-				buffer[j - 1] = '\0';
-				print(priv, "%s\n", buffer);
-				sprintf(buffer, "                   ");
-				j = strlen(buffer);
-			}
-			sprintf(buffer + j, "%d,", i);
+	arfcn_set_for_each(i, &rep) {
+		if (!k) {
+			sprintf(buffer, "SI5 (report) BA=%d: ",
+				s->nb_ba_ind_si5);
 			j = strlen(buffer);
-			k++;
 		}
+		if (j >= 70) {
+			buffer[j - 1] = '\0';
+			print(priv, "%s\n", buffer);
+			sprintf(buffer, "                   ");
+			j = strlen(buffer);
+		}
+		sprintf(buffer + j, "%d,", i);
+		j = strlen(buffer);
+		k++;
 	}
 	if (j) {
 		buffer[j - 1] = '\0';
@@ -196,14 +196,14 @@ int gsm48_sysinfo_dump(const struct gsm48_sysinfo *s, uint16_t arfcn,
 			index = i+j;
 			if (refer_pcs && index >= 512 && index <= 885)
 				index = index-512+1024;
-			if ((s->freq[i+j].mask & FREQ_TYPE_SERV))
+			if (arfcn_set_has(&s->freq[FREQ_LIST_SERV], i + j))
 				buffer[j + 5] = 'S';
-			else if ((s->freq[i+j].mask & FREQ_TYPE_NCELL)
-			      && (s->freq[i+j].mask & FREQ_TYPE_REP))
+			else if (arfcn_set_has(&ncell, i + j)
+			      && arfcn_set_has(&rep, i + j))
 				buffer[j + 5] = 'b';
-			else if ((s->freq[i+j].mask & FREQ_TYPE_NCELL))
+			else if (arfcn_set_has(&ncell, i + j))
 				buffer[j + 5] = 'n';
-			else if ((s->freq[i+j].mask & FREQ_TYPE_REP))
+			else if (arfcn_set_has(&rep, i + j))
 				buffer[j + 5] = 'r';
 			else if (!freq_map || (freq_map[index >> 3]
 						& (1 << (index & 7))))
@@ -391,11 +391,91 @@ int gsm48_decode_chan_h1(const struct gsm48_chan_desc *cd,
 	return 0;
 }
 
-/* decode "Cell Channel Description" (10.5.2.1b) and other frequency lists */
-static int decode_freq_list(struct gsm_sysinfo_freq *f,
-			    const uint8_t *cd, uint8_t len,
-			    uint8_t mask, uint8_t frqt)
+/*! Find the next ARFCN of a set.
+ *  \param[in] set    set of ARFCNs.
+ *  \param[in] arfcn  ARFCN to start searching at.
+ *  \returns lowest ARFCN of the set >= arfcn; -1 if there is none. */
+int arfcn_set_next(const struct arfcn_set *set, int arfcn)
+{
+	unsigned int i;
+	uint32_t w;
+
+	if (arfcn < 0 || arfcn > 1023)
+		return -1;
+
+	i = arfcn >> 5;
+	w = set->w[i] & (0xffffffffU << (arfcn & 31));
+	while (!w) {
+		if (++i == ARFCN_SET_WORDS)
+			return -1;
+		w = set->w[i];
+	}
+
+	return (i << 5) + __builtin_ctz(w);
+}
+
+/*! Count the ARFCNs of a set. */
+unsigned int arfcn_set_count(const struct arfcn_set *set)
+{
+	unsigned int i, count = 0;
+
+	for (i = 0; i < ARFCN_SET_WORDS; i++)
+		count += __builtin_popcount(set->w[i]);
+
+	return count;
+}
+
+/*! Add all ARFCNs of another set to a set. */
+void arfcn_set_or(struct arfcn_set *set, const struct arfcn_set *other)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARFCN_SET_WORDS; i++)
+		set->w[i] |= other->w[i];
+}
+
+/*! Get the frequency type flags (FREQ_TYPE_*) of an ARFCN. */
+uint8_t gsm48_sysinfo_freq_mask(const struct gsm48_sysinfo *s, uint16_t arfcn)
 {
+	uint8_t mask = 0;
+	int i;
+
+	for (i = 0; i < FREQ_LIST_NUM; i++) {
+		if (arfcn_set_has(&s->freq[i], arfcn))
+			mask |= 1 << i;
+	}
+
+	return mask;
+}
+
+/*! Get all ARFCNs of the given frequency types.
+ *  \param[in]  s      system information.
+ *  \param[in]  types  frequency type flags (FREQ_TYPE_*).
+ *  \param[out] set    ARFCNs which are in any of the given lists. */
+void gsm48_sysinfo_freq_set(const struct gsm48_sysinfo *s, uint8_t types,
+			    struct arfcn_set *set)
+{
+	int i;
+
+	memset(set, 0, sizeof(*set));
+	for (i = 0; i < FREQ_LIST_NUM; i++) {
+		if ((types & (1 << i)))
+			arfcn_set_or(set, &s->freq[i]);
+	}
+}
+
+/*! Decode "Cell Channel Description" (10.5.2.1b) and other frequency lists.
+ *  \param[out] set   set of ARFCNs (previous content is replaced).
+ *  \param[in]  cd    frequency list IE (value part).
+ *  \param[in]  len   length of the IE.
+ *  \param[in]  mask  formats to be accepted, see gsm48_decode_freq_list().
+ *  \returns 0 on success; non-zero on error. */
+int gsm48_decode_freq_set(struct arfcn_set *set, const uint8_t *cd,
+			  uint8_t len, uint8_t mask)
+{
+	struct gsm_sysinfo_freq f[1024];
+	int i, rc;
+
 #if 0
 	/* only Bit map 0 format for P-GSM */
 	if ((cd[0] & 0xc0 & mask) != 0x00 &&
@@ -403,7 +483,14 @@ static int decode_freq_list(struct gsm_sysinfo_freq *f,
 		return 0;
 #endif
 
-	return gsm48_decode_freq_list(f, cd, len, mask, frqt);
+	/* the list is cleared there, before anything is decoded */
+	rc = gsm48_decode_freq_list(f, (uint8_t *)cd, len, mask, 0x01);
+
+	memset(set, 0, sizeof(*set));
+	for (i = 0; i < 1024; i++)
+		set->w[i >> 5] |= (uint32_t)(f[i].mask & 0x01) << (i & 31);
+
+	return rc;
 }
 
 /* decode "Cell Selection Parameters" (10.5.2.4) */
@@ -454,12 +541,20 @@ static int gsm48_decode_ccd(struct gsm48_sysinfo *s,
 	return 0;
 }
 
-/* decode "Mobile Allocation" (10.5.2.21) */
-int gsm48_decode_mobile_alloc(struct gsm_sysinfo_freq *freq,
+/*! Decode "Mobile Allocation" (10.5.2.21).
+ *  \param[in]  serv      ARFCNs of the cell (cell allocation).
+ *  \param[out] hopp      ARFCNs used for hopping (optional, may be NULL).
+ *  \param[in]  ma        mobile allocation IE (value part).
+ *  \param[in]  len       length of the IE.
+ *  \param[out] hopping   ARFCNs used for hopping, in the order of the MA.
+ *  \param[out] hopp_len  number of entries in hopping[].
+ *  \returns 0 on success; negative errno on error. */
+int gsm48_decode_mobile_alloc(const struct arfcn_set *serv,
+			      struct arfcn_set *hopp,
 			      const uint8_t *ma, uint8_t len,
-			      uint16_t *hopping, uint8_t *hopp_len, int si4)
+			      uint16_t *hopping, uint8_t *hopp_len)
 {
-	int i, j = 0;
+	int i, j = 0, arfcn;
 	uint16_t f[len << 3];
 
 	/* not more than 64 hopping indexes allowed in IE */
@@ -468,20 +563,19 @@ int gsm48_decode_mobile_alloc(struct gsm_sysinfo_freq *freq,
 
 	/* tabula rasa */
 	*hopp_len = 0;
-	if (si4) {
-		for (i = 0; i < 1024; i++)
-			freq[i].mask &= ~FREQ_TYPE_HOPP;
-	}
+	if (hopp)
+		memset(hopp, 0, sizeof(*hopp));
 
 	/* generating list of all frequencies (1..1023,0) */
-	for (i = 1; i <= 1024; i++) {
-		if ((freq[i & 1023].mask & FREQ_TYPE_SERV)) {
-			LOGP(DRR, LOGL_INFO, "Serving cell ARFCN #%d: %d\n",
-				j, i & 1023);
-			f[j++] = i & 1023;
-			if (j == (len << 3))
-				break;
-		}
+	for (arfcn = arfcn_set_next(serv, 1); arfcn > 0 && j < (len << 3);
+	     arfcn = arfcn_set_next(serv, arfcn + 1)) {
+		LOGP(DRR, LOGL_INFO, "Serving cell ARFCN #%d: %d\n",
+			j, arfcn);
+		f[j++] = arfcn;
+	}
+	if (arfcn_set_has(serv, 0) && j < (len << 3)) {
+		LOGP(DRR, LOGL_INFO, "Serving cell ARFCN #%d: %d\n", j, 0);
+		f[j++] = 0;
 	}
 
 	/* fill hopping table with frequency index given by IE
@@ -501,8 +595,8 @@ int gsm48_decode_mobile_alloc(struct gsm_sysinfo_freq *freq,
 				break;
 			}
 			hopping[(*hopp_len)++] = f[i];
-			if (si4)
-				freq[f[i]].mask |= FREQ_TYPE_HOPP;
+			if (hopp)
+				arfcn_set_add(hopp, f[i]);
 		}
 	}
 
@@ -844,9 +938,9 @@ int gsm48_decode_sysinfo1(struct gsm48_sysinfo *s,
 	memcpy(s->si1_msg, si, OSMO_MIN(len, sizeof(s->si1_msg)));
 
 	/* Cell Channel Description */
-	decode_freq_list(s->freq, si->cell_channel_description,
-			 sizeof(si->cell_channel_description),
-			 0xce, FREQ_TYPE_SERV);
+	gsm48_decode_freq_set(&s->freq[FREQ_LIST_SERV],
+			      si->cell_channel_description,
+			      sizeof(si->cell_channel_description), 0xce);
 	/* RACH Control Parameter */
 	gsm48_decode_rach_ctl_param(s, &si->rach_control);
 	/* SI 1 Rest Octets */
@@ -873,9 +967,9 @@ int gsm48_decode_sysinfo2(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_ext_ind_si2 = (si->bcch_frequency_list[0] >> 5) & 1;
 	s->nb_ba_ind_si2 = (si->bcch_frequency_list[0] >> 4) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-			 sizeof(si->bcch_frequency_list),
-			 0xce, FREQ_TYPE_NCELL_2);
+	gsm48_decode_freq_set(&s->freq[FREQ_LIST_NCELL_2],
+			      si->bcch_frequency_list,
+			      sizeof(si->bcch_frequency_list), 0xce);
 	/* NCC Permitted */
 	s->nb_ncc_permitted_si2 = si->ncc_permitted;
 	/* RACH Control Parameter */
@@ -894,8 +988,9 @@ int gsm48_decode_sysinfo2bis(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_ext_ind_si2bis = (si->bcch_frequency_list[0] >> 5) & 1;
 	s->nb_ba_ind_si2bis = (si->bcch_frequency_list[0] >> 4) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-		sizeof(si->bcch_frequency_list), 0xce, FREQ_TYPE_NCELL_2bis);
+	gsm48_decode_freq_set(&s->freq[FREQ_LIST_NCELL_2bis],
+			      si->bcch_frequency_list,
+			      sizeof(si->bcch_frequency_list), 0xce);
 	/* RACH Control Parameter */
 	gsm48_decode_rach_ctl_neigh(s, &si->rach_control);
 
@@ -912,9 +1007,9 @@ int gsm48_decode_sysinfo2ter(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description 2 */
 	s->nb_multi_rep_si2ter = (si->ext_bcch_frequency_list[0] >> 5) & 3;
 	s->nb_ba_ind_si2ter = (si->ext_bcch_frequency_list[0] >> 4) & 1;
-	decode_freq_list(s->freq, si->ext_bcch_frequency_list,
-		sizeof(si->ext_bcch_frequency_list), 0x8e,
-			FREQ_TYPE_NCELL_2ter);
+	gsm48_decode_freq_set(&s->freq[FREQ_LIST_NCELL_2ter],
+			      si->ext_bcch_frequency_list,
+			      sizeof(si->ext_bcch_frequency_list), 0x8e);
 
 	s->si2ter = 1;
 
@@ -994,8 +1089,10 @@ short_read:
 			LOGP(DRR, LOGL_NOTICE, "Ignoring CBCH allocation of "
 			     "SYSTEM INFORMATION 4 until SI 1 is received.\n");
 		} else {
-			gsm48_decode_mobile_alloc(s->freq, data + 2, data[1],
-						  s->hopping, &s->hopp_len, 1);
+			gsm48_decode_mobile_alloc(&s->freq[FREQ_LIST_SERV],
+						  &s->freq[FREQ_LIST_HOPP],
+						  data + 2, data[1],
+						  s->hopping, &s->hopp_len);
 		}
 		payload_len -= 2 + data[1];
 		data += 2 + data[1];
@@ -1017,9 +1114,9 @@ int gsm48_decode_sysinfo5(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_ext_ind_si5 = (si->bcch_frequency_list[0] >> 5) & 1;
 	s->nb_ba_ind_si5 = (si->bcch_frequency_list[0] >> 4) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-			 sizeof(si->bcch_frequency_list),
-			 0xce, FREQ_TYPE_REP_5);
+	gsm48_decode_freq_set(&s->freq[FREQ_LIST_REP_5],
+			      si->bcch_frequency_list,
+			      sizeof(si->bcch_frequency_list), 0xce);
 
 	s->si5 = 1;
 	s->si10 = false;
@@ -1035,9 +1132,9 @@ int gsm48_decode_sysinfo5bis(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_ext_ind_si5bis = (si->bcch_frequency_list[0] >> 5) & 1;
 	s->nb_ba_ind_si5bis = (si->bcch_frequency_list[0] >> 4) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-			 sizeof(si->bcch_frequency_list),
-			 0xce, FREQ_TYPE_REP_5bis);
+	gsm48_decode_freq_set(&s->freq[FREQ_LIST_REP_5bis],
+			      si->bcch_frequency_list,
+			      sizeof(si->bcch_frequency_list), 0xce);
 
 	s->si5bis = 1;
 	s->si10 = false;
@@ -1053,9 +1150,9 @@ int gsm48_decode_sysinfo5ter(struct gsm48_sysinfo *s,
 	/* Neighbor Cell Description */
 	s->nb_multi_rep_si5ter = (si->bcch_frequency_list[0] >> 5) & 3;
 	s->nb_ba_ind_si5ter = (si->bcch_frequency_list[0] >> 4) & 1;
-	decode_freq_list(s->freq, si->bcch_frequency_list,
-			 sizeof(si->bcch_frequency_list),
-			 0x8e, FREQ_TYPE_REP_5ter);
+	gsm48_decode_freq_set(&s->freq[FREQ_LIST_REP_5ter],
+			      si->bcch_frequency_list,
+			      sizeof(si->bcch_frequency_list), 0x8e);
 
 	s->si5ter = 1;
 	s->si10 = false;
@@ -1090,31 +1187,104 @@ int gsm48_decode_sysinfo6(struct gsm48_sysinfo *s,
 	return 0;
 }
 
+/* get the ARFCN with the given index of a sub list (1..1023,0), -1 if none */
+static int arfcn_from_sub_list(const struct arfcn_set *set, unsigned int index)
+{
+	unsigned int i, n;
+	uint32_t w;
+
+	for (i = 0; i < ARFCN_SET_WORDS; i++) {
+		w = set->w[i];
+		/* ARFCN 0 is the last one of the list */
+		if (i == 0)
+			w &= ~1U;
+		n = __builtin_popcount(w);
+		if (index < n) {
+			/* remove the lowest bits up to the wanted one */
+			while (index--)
+				w &= w - 1;
+			return (i << 5) + __builtin_ctz(w);
+		}
+		index -= n;
+	}
+	if (index == 0 && arfcn_set_has(set, 0))
+		return 0;
+
+	return -1;
+}
+
 /* Get ARFCN from BCCH allocation found in SI5/SI5bis an SI5ter. See TS 44.018 §10.5.2.20. */
 int16_t arfcn_from_freq_index(const struct gsm48_sysinfo *s, uint16_t index)
 {
-	uint16_t arfcn, i = 0;
+	struct arfcn_set sub;
+	int arfcn;
 
 	/* Search for ARFCN found in SI5 or SI5bis. (first sub list) */
-	for (arfcn = 1; arfcn <= 1024; arfcn++) {
-		if (!(s->freq[arfcn & 1023].mask & (FREQ_TYPE_REP_5 | FREQ_TYPE_REP_5bis)))
-			continue;
-		if (index == i++)
-			return arfcn & 1023;
-	}
+	gsm48_sysinfo_freq_set(s, FREQ_TYPE_REP_5 | FREQ_TYPE_REP_5bis, &sub);
+	arfcn = arfcn_from_sub_list(&sub, index);
+	if (arfcn >= 0)
+		return arfcn;
 
 	/* Search for ARFCN found in SI5ter. (second sub list) */
-	for (arfcn = 1; arfcn <= 1024; arfcn++) {
-		if (!(s->freq[arfcn & 1023].mask & FREQ_TYPE_REP_5ter))
-			continue;
-		if (index == i++)
-			return arfcn & 1023;
-	}
+	arfcn = arfcn_from_sub_list(&s->freq[FREQ_LIST_REP_5ter],
+				    index - arfcn_set_count(&sub));
+	if (arfcn >= 0)
+		return arfcn;
 
 	/* If not found, return EOF (-1) as idicator. */
 	return EOF;
 }
 
+/* Get PAGING_GROUP of the given IMSI on the CCCH of timeslot 0. See TS 45.002 §6.5.2.
+ * A negative value is returned, if the CCCH_GROUP of the IMSI is on another timeslot. */
+int gsm48_sysinfo_paging_group(const struct gsm48_sysinfo *s, const char *imsi)
+{
+	unsigned int bs_cc_chans, n, imsi_mod;
+	size_t len = strlen(imsi);
+
+	if (!s->si3 || len < 3)
+		return -EINVAL;
+	/* IMSI mod 1000 */
+	imsi_mod = atoi(imsi + len - 3);
+
+	/* number of CCCH blocks in a 51-multiframe */
+	switch (s->ccch_conf) {
+	case 0:
+		bs_cc_chans = 1;
+		n = 9;
+		break;
+	case 1:
+		bs_cc_chans = 1;
+		n = 3;
+		break;
+	case 2:
+		bs_cc_chans = 2;
+		n = 9;
+		break;
+	case 4:
+		bs_cc_chans = 3;
+		n = 9;
+		break;
+	case 6:
+		bs_cc_chans = 4;
+		n = 9;
+		break;
+	default:
+		return -EINVAL;
+	}
+	if (s->bs_ag_blks_res >= n)
+		return -EINVAL;
+
+	/* N: number of paging blocks "available" on one CCCH */
+	n = (n - s->bs_ag_blks_res) * s->pag_mf_periods;
+
+	/* CCCH_GROUP 0 is the only one on timeslot 0 */
+	if ((imsi_mod % (bs_cc_chans * n)) / n != 0)
+		return -ENOTSUP;
+
+	return (imsi_mod % (bs_cc_chans * n)) % n;
+}
+
 int gsm48_decode_sysinfo10(struct gsm48_sysinfo *s,
 			   const struct gsm48_system_information_type_10 *si, int len)
 {
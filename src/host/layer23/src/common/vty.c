@@ -350,6 +350,32 @@ DEFUN(cfg_gsmtap_no_gsmtap_local_host,
 	return CMD_SUCCESS;
 }
 
+DEFUN(cfg_gsmtap_gsmtap_pcap_file,
+      cfg_gsmtap_gsmtap_pcap_file_cmd,
+      "pcap-file PATH",
+      "Write GSMTAP Um messages to a pcap file instead of sending them\n"
+      "Path to the pcap file\n")
+{
+	osmo_talloc_replace_string(l23_ctx, &l23_cfg.gsmtap.pcap_file, argv[0]);
+
+	if (vty->type != VTY_FILE)
+		vty_out(vty, "%% This command requires restart%s", VTY_NEWLINE);
+
+	return CMD_SUCCESS;
+}
+
+DEFUN(cfg_gsmtap_no_gsmtap_pcap_file,
+      cfg_gsmtap_no_gsmtap_pcap_file_cmd,
+      "no pcap-file",
+      NO_STR "Disable writing GSMTAP Um messages to a pcap file\n")
+{
+	TALLOC_FREE(l23_cfg.gsmtap.pcap_file);
+	if (vty->type != VTY_FILE)
+		vty_out(vty, "%% This command requires restart%s", VTY_NEWLINE);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN(cfg_gsmtap_gsmtap_lchan_all, cfg_gsmtap_gsmtap_lchan_all_cmd,
 	"lchan (enable-all|disable-all)",
 	"Enable/disable sending of UL/DL messages over GSMTAP\n"
@@ -1234,6 +1260,9 @@ static int l23_vty_config_write_gsmtap_node(struct vty *vty)
 	else
 		vty_out(vty, " no local-host%s", VTY_NEWLINE);
 
+	if (l23_cfg.gsmtap.pcap_file)
+		vty_out(vty, " pcap-file %s%s", l23_cfg.gsmtap.pcap_file, VTY_NEWLINE);
+
 	if (l23_cfg.gsmtap.lchan_acch)
 		vty_out(vty, " lchan sacch%s", VTY_NEWLINE);
 
@@ -1429,6 +1458,8 @@ static void l23_vty_init_gsmtap(void)
 	install_element(GSMTAP_NODE, &cfg_gsmtap_no_gsmtap_remote_host_cmd);
 	install_element(GSMTAP_NODE, &cfg_gsmtap_gsmtap_local_host_cmd);
 	install_element(GSMTAP_NODE, &cfg_gsmtap_no_gsmtap_local_host_cmd);
+	install_element(GSMTAP_NODE, &cfg_gsmtap_gsmtap_pcap_file_cmd);
+	install_element(GSMTAP_NODE, &cfg_gsmtap_no_gsmtap_pcap_file_cmd);
 	install_element(GSMTAP_NODE, &cfg_gsmtap_gsmtap_lchan_all_cmd);
 	install_element(GSMTAP_NODE, &cfg_gsmtap_gsmtap_lchan_cmd);
 	install_element(GSMTAP_NODE, &cfg_gsmtap_no_gsmtap_lchan_cmd);
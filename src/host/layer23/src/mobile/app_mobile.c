@@ -43,6 +43,7 @@
 #include <osmocom/bb/mobile/mncc.h>
 #include <osmocom/bb/mobile/tch.h>
 #include <osmocom/bb/mobile/primitives.h>
+#include <osmocom/bb/mobile/si_cache.h>
 
 #include <osmocom/vty/vty.h>
 #include <osmocom/vty/telnet_interface.h>
@@ -68,22 +69,31 @@ extern int quit; /* l23 main */
 /* handle ms instance */
 int mobile_work(struct osmocom_ms *ms)
 {
-	int work = 0, w;
-
-	do {
-		w = 0;
-		w |= gsm48_rsl_dequeue(ms);
-		w |= gsm48_rr_dequeue(ms);
-		w |= gsm48_mmxx_dequeue(ms);
-		w |= gsm48_mmr_dequeue(ms);
-		w |= gsm48_mmevent_dequeue(ms);
-		w |= gsm322_plmn_dequeue(ms);
-		w |= gsm322_cs_dequeue(ms);
-		w |= gsm_sim_job_dequeue(ms);
-		w |= mncc_dequeue(ms);
-		if (w)
-			work = 1;
-	} while (w);
+	uint32_t pending;
+	int work = 0;
+
+	/* only service queues with pending messages, see osmocom_ms_sched() */
+	while ((pending = ms->work_pending)) {
+		ms->work_pending = 0;
+		if (pending & MS_WORK_RSL)
+			work |= gsm48_rsl_dequeue(ms);
+		if (pending & MS_WORK_RR)
+			work |= gsm48_rr_dequeue(ms);
+		if (pending & MS_WORK_MMXX)
+			work |= gsm48_mmxx_dequeue(ms);
+		if (pending & MS_WORK_MMR)
+			work |= gsm48_mmr_dequeue(ms);
+		if (pending & MS_WORK_MMEVENT)
+			work |= gsm48_mmevent_dequeue(ms);
+		if (pending & MS_WORK_PLMN)
+			work |= gsm322_plmn_dequeue(ms);
+		if (pending & MS_WORK_CS)
+			work |= gsm322_cs_dequeue(ms);
+		if (pending & MS_WORK_SIM)
+			work |= gsm_sim_job_dequeue(ms);
+		if (pending & MS_WORK_MNCC)
+			work |= mncc_dequeue(ms);
+	}
 	return work;
 }
 
@@ -148,6 +158,7 @@ static int mobile_signal_cb(unsigned int subsys, unsigned int signal,
 		if (ms->shutdown == MS_SHUTDOWN_WAIT_RESET) {
 			LOGP(DMOB, LOGL_NOTICE, "MS '%s' has been reset\n", ms->name);
 			ms->shutdown = MS_SHUTDOWN_COMPL;
+			osmocom_ms_sched(ms, 0);
 			break;
 		}
 
@@ -370,6 +381,7 @@ int mobile_delete(struct osmocom_ms *ms, int force)
 	int rc;
 
 	ms->deleting = true;
+	osmocom_ms_sched(ms, 0);
 
 	if (ms->settings.mncc_handler == MNCC_HANDLER_EXTERNAL) {
 		mncc_sock_exit(ms->mncc_entity.sock_state);
@@ -413,12 +425,15 @@ static int global_signal_cb(unsigned int subsys, unsigned int signal,
 /* global work handler */
 static int _mobile_app_work(void)
 {
-	struct osmocom_ms *ms, *ms2;
+	struct osmocom_ms *ms;
 	int work = 0;
 
-	llist_for_each_entry_safe(ms, ms2, &ms_list, entity) {
+	/* only runnable instances, see osmocom_ms_sched() */
+	while (!llist_empty(&ms_ready_list)) {
+		ms = llist_entry(ms_ready_list.next, struct osmocom_ms, ready_entry);
 		if (ms->shutdown != MS_SHUTDOWN_COMPL)
 			work |= mobile_work(ms);
+		llist_del_init(&ms->ready_entry);
 		if (ms->shutdown == MS_SHUTDOWN_COMPL) {
 			if (ms->l2_wq.bfd.fd > -1) {
 				layer2_close(ms);
@@ -449,6 +464,9 @@ static int _mobile_app_exit(void)
 
 	osmo_gps_close();
 
+	/* all MS are gone, release the cached system information */
+	si_cache_flush();
+
 	return 0;
 }
 
@@ -520,6 +538,8 @@ void mobile_set_shutdown(struct osmocom_ms *ms, int state)
 {
 	int old_state = ms->shutdown;
 	ms->shutdown = state;
+	/* have the application look at the instance (closing layer 2, ...) */
+	osmocom_ms_sched(ms, 0);
 
 	mobile_prim_ntfy_shutdown(ms, old_state, state);
 }
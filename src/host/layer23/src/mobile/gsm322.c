@@ -38,11 +38,15 @@
 #include <osmocom/bb/common/settings.h>
 #include <osmocom/bb/mobile/vty.h>
 #include <osmocom/bb/mobile/app_mobile.h>
+#include <osmocom/bb/mobile/si_cache.h>
 #include <osmocom/bb/mobile/gsm322.h>
 #include <osmocom/bb/mobile/gsm48_mm.h>
+#include <osmocom/bb/mobile/statelist.h>
 
 #include <l1ctl_proto.h>
 
+extern void *l23_ctx;
+
 const char *ba_version = "osmocom BA V1\n";
 
 static void gsm322_cs_timeout(void *arg);
@@ -272,6 +276,7 @@ int gsm322_plmn_sendmsg(struct osmocom_ms *ms, struct msgb *msg)
 	struct gsm322_plmn *plmn = &ms->plmn;
 
 	msgb_enqueue(&plmn->event_queue, msg);
+	osmocom_ms_sched(ms, MS_WORK_PLMN);
 
 	return 0;
 }
@@ -282,6 +287,7 @@ int gsm322_cs_sendmsg(struct osmocom_ms *ms, struct msgb *msg)
 	struct gsm322_cellsel *cs = &ms->cellsel;
 
 	msgb_enqueue(&cs->event_queue, msg);
+	osmocom_ms_sched(ms, MS_WORK_CS);
 
 	return 0;
 }
@@ -306,6 +312,56 @@ int arfcn2index(uint16_t arfcn)
 	return arfcn & 1023;
 }
 
+/* The sysinfo of the cell selection list is shared with other MS instances
+ * (see si_cache.c), so cs->si and its entry in cs->list[] are replaced
+ * whenever the sysinfo of the tuned cell is interned or modified. */
+
+/* list entry of the sysinfo of the tuned cell */
+static struct gsm322_cs_list *gsm322_cs_si_entry(struct gsm322_cellsel *cs)
+{
+	struct gsm322_cs_list *entry;
+
+	entry = &cs->list[arfcn2index(si_cache_arfcn(cs->si))];
+	OSMO_ASSERT(entry->sysinfo == cs->si);
+
+	return entry;
+}
+
+/* replace the sysinfo of the tuned cell, the reference of 's' is taken over */
+void gsm322_cs_si_replace(struct gsm322_cellsel *cs, struct gsm48_sysinfo *s)
+{
+	struct gsm322_cs_list *entry = gsm322_cs_si_entry(cs);
+
+	si_cache_put(cs->si);
+	entry->sysinfo = cs->si = s;
+}
+
+/* make the sysinfo of the tuned cell shared (read-only) */
+struct gsm48_sysinfo *gsm322_cs_si_intern(struct gsm322_cellsel *cs)
+{
+	struct gsm322_cs_list *entry = gsm322_cs_si_entry(cs);
+
+	/* the reference of the list entry is taken over */
+	entry->sysinfo = cs->si = si_cache_intern(cs->si);
+
+	return cs->si;
+}
+
+/* get a writable sysinfo of the tuned cell (copy it, if shared) */
+struct gsm48_sysinfo *gsm322_cs_si_writable(struct gsm322_cellsel *cs)
+{
+	struct gsm322_cs_list *entry = gsm322_cs_si_entry(cs);
+	struct gsm48_sysinfo *s;
+
+	/* the reference of the list entry is taken over, unless it fails */
+	s = si_cache_unshare(cs->si);
+	if (!s)
+		return NULL;
+	entry->sysinfo = cs->si = s;
+
+	return s;
+}
+
 
 static char *bargraph(int value, int min, int max)
 {
@@ -508,7 +564,7 @@ static void gsm322_unselect_cell(struct gsm322_cellsel *cs)
 	LOGP(DCS, LOGL_INFO, "Unselecting serving cell.\n");
 
 	cs->selected = 0;
-	if (cs->si)
+	if (cs->si && gsm322_cs_si_writable(cs))
 		cs->si->si5 = 0; /* unset SI5* */
 	cs->si = NULL;
 	memset(&cs->sel_si, 0, sizeof(cs->sel_si));
@@ -2116,14 +2172,14 @@ static int gsm322_search_end(struct osmocom_ms *ms)
 		cs->arfcn = cs->sel_arfcn;
 		cs->arfci = arfcn2index(cs->arfcn);
 		if (!cs->list[cs->arfci].sysinfo)
-			cs->list[cs->arfci].sysinfo = talloc_zero(ms,
-							struct gsm48_sysinfo);
+			cs->list[cs->arfci].sysinfo = si_cache_alloc(cs->arfcn);
 		if (!cs->list[cs->arfci].sysinfo)
 			exit(-ENOMEM);
 		cs->list[cs->arfci].flags |= GSM322_CS_FLAG_SYSINFO;
-		memcpy(cs->list[cs->arfci].sysinfo, &cs->sel_si,
-			sizeof(struct gsm48_sysinfo));
 		cs->si = cs->list[cs->arfci].sysinfo;
+		if (!gsm322_cs_si_writable(cs))
+			exit(-ENOMEM);
+		memcpy(cs->si, &cs->sel_si, sizeof(struct gsm48_sysinfo));
 		cs->sel_cgi.lai = cs->si->lai;
 		cs->sel_cgi.cell_identity = cs->si->cell_id;
 		LOGP(DCS, LOGL_INFO, "Tuning back to frequency %s after full "
@@ -2136,14 +2192,41 @@ static int gsm322_search_end(struct osmocom_ms *ms)
 }
 
 
+/* band (index to gsm_sup_smax[]) of each list index, -1 if none */
+static int8_t gsm322_smax_band[1024+299];
+
+static void gsm322_smax_band_init(void)
+{
+	int i, j;
+
+	for (i = 0; i <= 1023+299; i++) {
+		gsm322_smax_band[i] = -1;
+		for (j = 0; gsm_sup_smax[j].max; j++) {
+			if (gsm_sup_smax[j].end > gsm_sup_smax[j].start) {
+				if (gsm_sup_smax[j].start <= i
+				 && gsm_sup_smax[j].end >= i)
+					break;
+			} else {
+				if (gsm_sup_smax[j].start <= i
+				 && 1023 >= i)
+					break;
+				if (0 <= i
+				 && gsm_sup_smax[j].end >= i)
+					break;
+			}
+		}
+		if (gsm_sup_smax[j].max)
+			gsm322_smax_band[i] = j;
+	}
+}
+
 /* tune to first/next unscanned frequency and search for PLMN */
 static int gsm322_cs_scan(struct osmocom_ms *ms)
 {
 	struct gsm322_cellsel *cs = &ms->cellsel;
 	int i;
-	int j, band = 0;
+	int band = -1;
 	uint8_t mask, flags;
-	uint32_t weight = 0, test = cs->scan_state;
 
 	/* search for strongest unscanned cell */
 	mask = GSM322_CS_FLAG_SUPPORT | GSM322_CS_FLAG_POWER
@@ -2152,51 +2235,21 @@ static int gsm322_cs_scan(struct osmocom_ms *ms)
 	 || cs->state == GSM322_C5_CHOOSE_CELL)
 		mask |= GSM322_CS_FLAG_BA;
 	flags = mask; /* all masked flags are required */
-	for (i = 0; i <= 1023+299; i++) {
-		j = 0; /* make gcc happy */
+	while ((i = gsm322_cs_heap_pop(cs)) >= 0) {
+		if ((cs->list[i].flags & mask) != flags)
+			continue;
 		if (!ms->settings.skip_max_per_band) {
 			/* skip if band has enough freqs. scanned (3.2.1) */
-			for (j = 0; gsm_sup_smax[j].max; j++) {
-				if (gsm_sup_smax[j].end >
-						gsm_sup_smax[j].start) {
-					if (gsm_sup_smax[j].start <= i
-					 && gsm_sup_smax[j].end >= i)
-						break;
-				} else {
-					if (gsm_sup_smax[j].start <= i
-					 && 1023 >= i)
-						break;
-					if (0 <= i
-					 && gsm_sup_smax[j].end >= i)
-						break;
-				}
-			}
-			if (gsm_sup_smax[j].max) {
-				if (gsm_sup_smax[j].temp == gsm_sup_smax[j].max)
-					continue;
-			}
-		}
-
-		/* search for unscanned frequency */
-		if ((cs->list[i].flags & mask) == flags) {
-			/* weight depends on the power level
-			 * if it is the same, it depends on arfcn
-			 */
-			test = cs->list[i].rxlev + 1;
-			test = (test << 16) | i;
-			if (test >= cs->scan_state)
+			band = gsm322_smax_band[i];
+			if (band >= 0 && cs->scan_smax_cnt[band]
+						== gsm_sup_smax[band].max)
 				continue;
-			if (test > weight) {
-				weight = test;
-				band = j;
-			}
-
 		}
+		break;
 	}
-	cs->scan_state = weight;
 
 	/* if all frequencies have been searched */
-	if (!weight) {
+	if (i < 0) {
 		gsm322_dump_cs_list(cs, GSM322_CS_FLAG_SYSINFO, print_dcs,
 			NULL);
 
@@ -2209,7 +2262,7 @@ static int gsm322_cs_scan(struct osmocom_ms *ms)
 	 */
 
 	/* Tune to frequency for a while, to receive broadcasts. */
-	cs->arfci = weight & 0xffff;
+	cs->arfci = i;
 	cs->arfcn = index2arfcn(cs->arfci);
 	LOGP(DCS, LOGL_DEBUG, "Scanning frequency %s (rxlev %s).\n",
 		gsm_print_arfcn(cs->arfcn),
@@ -2217,12 +2270,8 @@ static int gsm322_cs_scan(struct osmocom_ms *ms)
 
 	/* Allocate/clean system information. */
 	cs->list[cs->arfci].flags &= ~GSM322_CS_FLAG_SYSINFO;
-	if (cs->list[cs->arfci].sysinfo)
-		memset(cs->list[cs->arfci].sysinfo, 0,
-			sizeof(struct gsm48_sysinfo));
-	else
-		cs->list[cs->arfci].sysinfo = talloc_zero(ms,
-						struct gsm48_sysinfo);
+	si_cache_put(cs->list[cs->arfci].sysinfo);
+	cs->list[cs->arfci].sysinfo = si_cache_alloc(cs->arfcn);
 	if (!cs->list[cs->arfci].sysinfo)
 		exit(-ENOMEM);
 	cs->si = cs->list[cs->arfci].sysinfo;
@@ -2230,11 +2279,11 @@ static int gsm322_cs_scan(struct osmocom_ms *ms)
 	gsm322_sync_to_cell(cs, NULL, 0);
 
 	/* increase scan counter for each maximum scan range */
-	if (!ms->settings.skip_max_per_band && gsm_sup_smax[band].max) {
+	if (!ms->settings.skip_max_per_band && band >= 0) {
 		LOGP(DCS, LOGL_DEBUG, "%d frequencies left in band %d..%d\n",
-			gsm_sup_smax[band].max - gsm_sup_smax[band].temp,
+			gsm_sup_smax[band].max - cs->scan_smax_cnt[band],
 			gsm_sup_smax[band].start, gsm_sup_smax[band].end);
-		gsm_sup_smax[band].temp++;
+		cs->scan_smax_cnt[band]++;
 	}
 
 	return 0;
@@ -2419,6 +2468,7 @@ struct gsm322_ba_list *gsm322_cs_sysinfo_sacch(struct osmocom_ms *ms)
 	struct gsm322_cellsel *cs = &ms->cellsel;
 	struct gsm48_sysinfo *s;
 	struct gsm322_ba_list *ba = NULL;
+	struct arfcn_set set;
 	int i;
 	bool refer_pcs;
 	uint8_t freq[128+38];
@@ -2447,14 +2497,13 @@ struct gsm322_ba_list *gsm322_cs_sysinfo_sacch(struct osmocom_ms *ms)
 		/* update (add) ba list */
 		refer_pcs = gsm_refer_pcs(cs->arfcn, s);
 		memset(freq, 0, sizeof(freq));
-		for (i = 0; i <= 1023; i++) {
-			if ((s->freq[i].mask & (FREQ_TYPE_SERV
-				| FREQ_TYPE_NCELL | FREQ_TYPE_REP))) {
-				if (refer_pcs && i >= 512 && i <= 810)
-					freq[(i-512+1024) >> 3] |= (1 << (i&7));
-				else
-					freq[i >> 3] |= (1 << (i & 7));
-			}
+		gsm48_sysinfo_freq_set(s, FREQ_TYPE_SERV | FREQ_TYPE_NCELL
+			| FREQ_TYPE_REP, &set);
+		arfcn_set_for_each(i, &set) {
+			if (refer_pcs && i >= 512 && i <= 810)
+				freq[(i-512+1024) >> 3] |= (1 << (i&7));
+			else
+				freq[i >> 3] |= (1 << (i & 7));
 		}
 		if (!!memcmp(freq, ba->freq, sizeof(freq))) {
 			LOGP(DCS, LOGL_INFO, "New BA list (mcc-mnc=%s  %s, %s).\n",
@@ -2473,6 +2522,7 @@ static int gsm322_store_ba_list(struct gsm322_cellsel *cs,
 	struct gsm48_sysinfo *s)
 {
 	struct gsm322_ba_list *ba;
+	struct arfcn_set set;
 	int i;
 	bool refer_pcs;
 	uint8_t freq[128+38];
@@ -2490,14 +2540,13 @@ static int gsm322_store_ba_list(struct gsm322_cellsel *cs,
 	refer_pcs = gsm_refer_pcs(cs->arfcn, s);
 	memset(freq, 0, sizeof(freq));
 	freq[(cs->arfci) >> 3] |= (1 << (cs->arfci & 7));
-	for (i = 0; i <= 1023; i++) {
-		if ((s->freq[i].mask &
-		    (FREQ_TYPE_SERV | FREQ_TYPE_NCELL | FREQ_TYPE_REP))) {
-			if (refer_pcs && i >= 512 && i <= 810)
-				freq[(i-512+1024) >> 3] |= (1 << (i & 7));
-			else
-				freq[i >> 3] |= (1 << (i & 7));
-		}
+	gsm48_sysinfo_freq_set(s, FREQ_TYPE_SERV | FREQ_TYPE_NCELL
+		| FREQ_TYPE_REP, &set);
+	arfcn_set_for_each(i, &set) {
+		if (refer_pcs && i >= 512 && i <= 810)
+			freq[(i-512+1024) >> 3] |= (1 << (i & 7));
+		else
+			freq[i >> 3] |= (1 << (i & 7));
 	}
 	if (!!memcmp(freq, ba->freq, sizeof(freq))) {
 		LOGP(DCS, LOGL_INFO, "New BA list (mcc-mnc=%s  %s, %s).\n",
@@ -2588,7 +2637,7 @@ static int gsm322_c_camp_sysinfo_bcch(struct osmocom_ms *ms, struct msgb *msg)
 					gsm_print_arfcn(cs->arfcn));
 				if (cs->si == cs->list[cs->arfci].sysinfo)
 					cs->si = NULL;
-				talloc_free(cs->list[cs->arfci].sysinfo);
+				si_cache_put(cs->list[cs->arfci].sysinfo);
 				cs->list[cs->arfci].sysinfo = NULL;
 			}
 			/* trigger reselection without queueing,
@@ -2706,7 +2755,7 @@ static void gsm322_cs_timeout(void *arg)
 			gsm_print_arfcn(cs->arfcn));
 		if (cs->si == cs->list[cs->arfci].sysinfo)
 			cs->si = NULL;
-		talloc_free(cs->list[cs->arfci].sysinfo);
+		si_cache_put(cs->list[cs->arfci].sysinfo);
 		cs->list[cs->arfci].sysinfo = NULL;
 	}
 
@@ -2724,8 +2773,9 @@ static void gsm322_cs_timeout(void *arg)
  * power scan process
  */
 
-/* search for block of unscanned frequencies and start scanning */
-static int gsm322_cs_powerscan(struct osmocom_ms *ms)
+/* search for block of unscanned frequencies and continue scanning
+ * NOTE: Frequencies below cs->pm_next have been scanned already. */
+static int gsm322_cs_powerscan_next(struct osmocom_ms *ms)
 {
 	struct gsm322_cellsel *cs = &ms->cellsel;
 	struct gsm_settings *set = &ms->settings;
@@ -2755,7 +2805,7 @@ static int gsm322_cs_powerscan(struct osmocom_ms *ms)
 		} else
 			LOGP(DCS, LOGL_DEBUG, "Scanning power for all "
 				"frequencies.\n");
-		for (i = 0; i <= 1023+299; i++) {
+		for (i = cs->pm_next; i <= 1023+299; i++) {
 			if ((cs->list[i].flags & mask) == flags) {
 				s = e = i;
 				break;
@@ -2770,10 +2820,14 @@ static int gsm322_cs_powerscan(struct osmocom_ms *ms)
 		/* stop power level scanning */
 		cs->powerscan = 0;
 
-		/* check if no signal is found */
+		/* check if no signal is found, queue frequencies to scan */
+		cs->scan_heap_len = 0;
 		for (i = 0; i <= 1023+299; i++) {
-			if ((cs->list[i].flags & GSM322_CS_FLAG_SIGNAL))
+			if ((cs->list[i].flags & GSM322_CS_FLAG_SIGNAL)) {
 				found++;
+				if ((cs->list[i].flags & GSM322_CS_FLAG_POWER))
+					gsm322_cs_heap_push(cs, i);
+			}
 		}
 		if (!found) {
 			LOGP(DCS, LOGL_INFO, "Found no frequency.\n");
@@ -2786,6 +2840,7 @@ static int gsm322_cs_powerscan(struct osmocom_ms *ms)
 						| GSM322_CS_FLAG_SIGNAL
 						| GSM322_CS_FLAG_SYSINFO);
 				}
+				cs->pm_next = 0;
 				goto again;
 			}
 
@@ -2793,13 +2848,14 @@ static int gsm322_cs_powerscan(struct osmocom_ms *ms)
 			return gsm322_search_end(ms);
 		}
 		LOGP(DCS, LOGL_INFO, "Found %d frequencies.\n", found);
-		cs->scan_state = 0xffffffff; /* higher than high */
 		/* clear counter of scanned frequencies of each range */
-		for (i = 0; gsm_sup_smax[i].max; i++)
-			gsm_sup_smax[i].temp = 0;
+		memset(cs->scan_smax_cnt, 0, sizeof(cs->scan_smax_cnt));
 		return gsm322_cs_scan(ms);
 	}
 
+	/* continue with this block, frequencies may have been skipped */
+	cs->pm_next = s;
+
 	/* search last frequency to scan (en block) */
 	e = i;
 	if (!set->stick) {
@@ -2828,6 +2884,13 @@ static int gsm322_cs_powerscan(struct osmocom_ms *ms)
 	return l1ctl_tx_pm_req_range(ms, index2arfcn(s), index2arfcn(e));
 }
 
+/* start scanning all (unscanned) frequencies */
+static int gsm322_cs_powerscan(struct osmocom_ms *ms)
+{
+	ms->cellsel.pm_next = 0;
+	return gsm322_cs_powerscan_next(ms);
+}
+
 int gsm322_l1_signal(unsigned int subsys, unsigned int signal,
 		     void *handler_data, void *signal_data)
 {
@@ -2875,7 +2938,7 @@ int gsm322_l1_signal(unsigned int subsys, unsigned int signal,
 				gsm_print_arfcn(index2arfcn(i)));
 			if (cs->si == cs->list[i].sysinfo)
 				cs->si = NULL;
-			talloc_free(cs->list[i].sysinfo);
+			si_cache_put(cs->list[i].sysinfo);
 			cs->list[i].sysinfo = NULL;
 		}
 		break;
@@ -2885,7 +2948,7 @@ int gsm322_l1_signal(unsigned int subsys, unsigned int signal,
 		cs = &ms->cellsel;
 		if (!cs->powerscan)
 			return -EINVAL;
-		gsm322_cs_powerscan(ms);
+		gsm322_cs_powerscan_next(ms);
 		break;
 	case S_L1CTL_FBSB_RESP:
 		fr = signal_data;
@@ -2907,7 +2970,7 @@ int gsm322_l1_signal(unsigned int subsys, unsigned int signal,
 				"snr=%u, BSIC=%u)\n",
 				gsm_print_arfcn(cs->arfcn), fr->snr, fr->bsic);
 			cs->ccch_state = GSM322_CCCH_ST_SYNC;
-			if (cs->si)
+			if (cs->si && gsm322_cs_si_writable(cs))
 				cs->si->bsic = fr->bsic;
 
 			/* set timer for reading BCCH */
@@ -2926,8 +2989,13 @@ int gsm322_l1_signal(unsigned int subsys, unsigned int signal,
 
 			/* set downlink signalling failure criterion */
 			ms->meas.ds_fail = ms->meas.dsc = ms->settings.dsc_max;
+			ms->meas.pag_mfrms = 0;
 			LOGP(DRR, LOGL_INFO, "using DSC of %d\n", ms->meas.dsc);
 
+			/* layer 1 was reset, so enable DRX again (if SI3 is known) */
+			if (cs->ccch_mode != CCCH_MODE_NONE)
+				gsm48_rr_tx_ccch_mode(ms);
+
 			/* start in case we are camping on serving/neighbour
 			 * cell */
 			if (cs->state == GSM322_C3_CAMPED_NORMALLY
@@ -2969,7 +3037,7 @@ int gsm322_l1_signal(unsigned int subsys, unsigned int signal,
 				gsm_print_arfcn(index2arfcn(cs->arfci)));
 			if (cs->si == cs->list[cs->arfci].sysinfo)
 				cs->si = NULL;
-			talloc_free(cs->list[cs->arfci].sysinfo);
+			si_cache_put(cs->list[cs->arfci].sysinfo);
 			cs->list[cs->arfci].sysinfo = NULL;
 
 		}
@@ -3760,8 +3828,7 @@ static struct plmnastatelist {
 	 GSM322_EVENT_NO_CELL_FOUND, gsm322_am_no_cell_found},
 };
 
-#define PLMNASLLEN \
-	(sizeof(plmnastatelist) / sizeof(struct plmnastatelist))
+static struct statelist_idx plmnastate_idx;
 
 static int gsm322_a_event(struct osmocom_ms *ms, struct msgb *msg)
 {
@@ -3775,11 +3842,8 @@ static int gsm322_a_event(struct osmocom_ms *ms, struct msgb *msg)
 		"selection in state '%s'\n", ms->name, get_event_name(msg_type),
 		get_a_state_name(plmn->state));
 	/* find function for current state and message */
-	for (i = 0; i < PLMNASLLEN; i++)
-		if ((msg_type == plmnastatelist[i].type)
-		 && ((1 << plmn->state) & plmnastatelist[i].states))
-			break;
-	if (i == PLMNASLLEN) {
+	i = statelist_idx_find(&plmnastate_idx, msg_type, plmn->state);
+	if (i < 0) {
 		LOGP(DPLMN, LOGL_NOTICE, "Event %s unhandled in state %s.\n",
 		     get_event_name(msg_type), get_a_state_name(plmn->state));
 		return 0;
@@ -3872,8 +3936,7 @@ static struct plmnmstatelist {
 	 GSM322_EVENT_NO_CELL_FOUND, gsm322_am_no_cell_found},
 };
 
-#define PLMNMSLLEN \
-	(sizeof(plmnmstatelist) / sizeof(struct plmnmstatelist))
+static struct statelist_idx plmnmstate_idx;
 
 static int gsm322_m_event(struct osmocom_ms *ms, struct msgb *msg)
 {
@@ -3887,11 +3950,8 @@ static int gsm322_m_event(struct osmocom_ms *ms, struct msgb *msg)
 		"in state '%s'\n", ms->name, get_event_name(msg_type),
 		get_m_state_name(plmn->state));
 	/* find function for current state and message */
-	for (i = 0; i < PLMNMSLLEN; i++)
-		if ((msg_type == plmnmstatelist[i].type)
-		 && ((1 << plmn->state) & plmnmstatelist[i].states))
-			break;
-	if (i == PLMNMSLLEN) {
+	i = statelist_idx_find(&plmnmstate_idx, msg_type, plmn->state);
+	if (i < 0) {
 		LOGP(DPLMN, LOGL_NOTICE, "Event unhandled at this state.\n");
 		return 0;
 	}
@@ -3991,8 +4051,7 @@ static struct cellselstatelist {
 	 GSM322_EVENT_HPLMN_SEARCH, gsm322_c_hplmn_search},
 };
 
-#define CELLSELSLLEN \
-	(sizeof(cellselstatelist) / sizeof(struct cellselstatelist))
+static struct statelist_idx cellselstate_idx;
 
 int gsm322_c_event(struct osmocom_ms *ms, struct msgb *msg)
 {
@@ -4007,11 +4066,8 @@ int gsm322_c_event(struct osmocom_ms *ms, struct msgb *msg)
 			"in state '%s'\n", ms->name, get_event_name(msg_type),
 			get_cs_state_name(cs->state));
 	/* find function for current state and message */
-	for (i = 0; i < CELLSELSLLEN; i++)
-		if ((msg_type == cellselstatelist[i].type)
-		 && ((1 << cs->state) & cellselstatelist[i].states))
-			break;
-	if (i == CELLSELSLLEN) {
+	i = statelist_idx_find(&cellselstate_idx, msg_type, cs->state);
+	if (i < 0) {
 		if (msg_type != GSM322_EVENT_SYSINFO)
 			LOGP(DCS, LOGL_NOTICE, "Event unhandled at this state."
 				"\n");
@@ -4380,12 +4436,8 @@ no_cell_found:
 		"cell during cell reselection.\n", gsm_print_arfcn(cs->arfcn));
 	/* Allocate/clean system information. */
 	cs->list[cs->arfci].flags &= ~GSM322_CS_FLAG_SYSINFO;
-	if (cs->list[cs->arfci].sysinfo)
-		memset(cs->list[cs->arfci].sysinfo, 0,
-			sizeof(struct gsm48_sysinfo));
-	else
-		cs->list[cs->arfci].sysinfo = talloc_zero(ms,
-			struct gsm48_sysinfo);
+	si_cache_put(cs->list[cs->arfci].sysinfo);
+	cs->list[cs->arfci].sysinfo = si_cache_alloc(cs->arfcn);
 	if (!cs->list[cs->arfci].sysinfo)
 		exit(-ENOMEM);
 	cs->si = cs->list[cs->arfci].sysinfo;
@@ -4401,7 +4453,7 @@ static int gsm322_nb_start(struct osmocom_ms *ms, int synced)
 	struct gsm48_sysinfo *s = &cs->sel_si;
 	struct gsm322_neighbour *nb, *nb2;
 	int i, num;
-	uint8_t map[128];
+	struct arfcn_set map, ncell;
 	uint16_t nc[32];
 	uint8_t changed = 0;
 	bool refer_pcs;
@@ -4416,16 +4468,18 @@ static int gsm322_nb_start(struct osmocom_ms *ms, int synced)
 
 	refer_pcs = gsm_refer_pcs(cs->sel_arfcn, s);
 
-	/* remove all neighbours that are not in list anymore */
-	memset(map, 0, sizeof(map));
-	llist_for_each_entry_safe(nb, nb2, &cs->nb_list, entry) {
-		i = nb->arfcn & 1023;
-		map[i >> 3] |= (1 << (i & 7));
 #ifndef TEST_INCLUDE_SERV
-		if (!(s->freq[i].mask & FREQ_TYPE_NCELL)) {
+	gsm48_sysinfo_freq_set(s, FREQ_TYPE_NCELL, &ncell);
 #else
-		if (!(s->freq[i].mask & (FREQ_TYPE_NCELL | FREQ_TYPE_SERV))) {
+	gsm48_sysinfo_freq_set(s, FREQ_TYPE_NCELL | FREQ_TYPE_SERV, &ncell);
 #endif
+
+	/* remove all neighbours that are not in list anymore */
+	memset(&map, 0, sizeof(map));
+	llist_for_each_entry_safe(nb, nb2, &cs->nb_list, entry) {
+		i = nb->arfcn & 1023;
+		arfcn_set_add(&map, i);
+		if (!arfcn_set_has(&ncell, i)) {
 			LOGP(DNB, LOGL_INFO, "Removing neighbour cell %s from "
 				"list.\n", gsm_print_arfcn(nb->arfcn));
 			gsm322_nb_free(nb);
@@ -4445,14 +4499,8 @@ static int gsm322_nb_start(struct osmocom_ms *ms, int synced)
 	}
 
 	/* add missing entries to list */
-	for (i = 0; i <= 1023; i++) {
-#ifndef TEST_INCLUDE_SERV
-		if ((s->freq[i].mask & FREQ_TYPE_NCELL) &&
-		  !(map[i >> 3] & (1 << (i & 7)))) {
-#else
-		if ((s->freq[i].mask & (FREQ_TYPE_NCELL | FREQ_TYPE_SERV)) &&
-		  !(map[i >> 3] & (1 << (i & 7)))) {
-#endif
+	arfcn_set_for_each(i, &ncell) {
+		if (!arfcn_set_has(&map, i)) {
 			index = i;
 			if (refer_pcs && i >= 512 && i <= 810)
 				index = i-512+1024;
@@ -4553,12 +4601,8 @@ printf("%d time to sync again: %u\n", nb->arfcn, now + GSM58_READ_AGAIN - nb->wh
 		}
 		/* Allocate/clean system information. */
 		cs->list[cs->arfci].flags &= ~GSM322_CS_FLAG_SYSINFO;
-		if (cs->list[cs->arfci].sysinfo)
-			memset(cs->list[cs->arfci].sysinfo, 0,
-				sizeof(struct gsm48_sysinfo));
-		else
-			cs->list[cs->arfci].sysinfo = talloc_zero(ms,
-							struct gsm48_sysinfo);
+		si_cache_put(cs->list[cs->arfci].sysinfo);
+		cs->list[cs->arfci].sysinfo = si_cache_alloc(cs->arfcn);
 		if (!cs->list[cs->arfci].sysinfo)
 			exit(-ENOMEM);
 		cs->si = cs->list[cs->arfci].sysinfo;
@@ -5022,6 +5066,15 @@ int gsm322_init(struct osmocom_ms *ms)
 	INIT_LLIST_HEAD(&cs->ba_list);
 	INIT_LLIST_HEAD(&cs->nb_list);
 
+	gsm322_smax_band_init();
+
+	si_cache_init(l23_ctx);
+
+	/* index state transition lists */
+	STATELIST_IDX_INIT(l23_ctx, &plmnastate_idx, plmnastatelist);
+	STATELIST_IDX_INIT(l23_ctx, &plmnmstate_idx, plmnmstatelist);
+	STATELIST_IDX_INIT(l23_ctx, &cellselstate_idx, cellselstatelist);
+
 	/* set supported frequencies in cell selection list */
 	for (i = 0; i <= 1023+299; i++)
 		if ((ms->settings.freq_map[i >> 3] & (1 << (i & 7))))
@@ -5160,7 +5213,7 @@ int gsm322_exit(struct osmocom_ms *ms)
 		if (cs->list[i].sysinfo) {
 			LOGP(DCS, LOGL_DEBUG, "free sysinfo ARFCN=%s\n",
 				gsm_print_arfcn(index2arfcn(i)));
-			talloc_free(cs->list[i].sysinfo);
+			si_cache_put(cs->list[i].sysinfo);
 			cs->list[i].sysinfo = NULL;
 			cs->si = NULL;
 		}
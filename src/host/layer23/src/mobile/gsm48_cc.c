@@ -35,10 +35,14 @@
 #include <osmocom/bb/mobile/gsm48_cc.h>
 #include <osmocom/bb/mobile/gsm44068_gcc_bcc.h>
 #include <osmocom/bb/mobile/tch.h>
+#include <osmocom/bb/mobile/statelist.h>
 #include <l1ctl_proto.h>
 
+extern void *l23_ctx;
+
 static int gsm48_cc_tx_release(struct gsm_trans *trans, void *arg);
 static int gsm48_rel_null_free(struct gsm_trans *trans);
+static void gsm48_cc_statelist_init(void);
 int mncc_release_ind(struct osmocom_ms *ms, struct gsm_trans *trans,
 		     uint32_t callref, int location, int value);
 static int gsm48_cc_tx_disconnect(struct gsm_trans *trans, void *arg);
@@ -61,6 +65,8 @@ int gsm48_cc_init(struct osmocom_ms *ms)
 
 	LOGP(DCC, LOGL_INFO, "init Call Control\n");
 
+	gsm48_cc_statelist_init();
+
 	INIT_LLIST_HEAD(&cc->mncc_upqueue);
 
 	return 0;
@@ -206,6 +212,7 @@ static int mncc_recvmsg(struct osmocom_ms *ms, struct gsm_trans *trans,
 		return -ENOMEM;
 	memcpy(msg->data, mncc, sizeof(struct gsm_mncc));
 	msgb_enqueue(&cc->mncc_upqueue, msg);
+	osmocom_ms_sched(ms, MS_WORK_MNCC);
 
 	return 0;
 }
@@ -1976,8 +1983,7 @@ static struct downstate {
 	 MNCC_MODIFY_REJ, gsm48_cc_tx_modify_reject},
 };
 
-#define DOWNSLLEN \
-	(sizeof(downstatelist) / sizeof(struct downstate))
+static struct statelist_idx downstate_idx;
 
 int mncc_tx_to_cc(void *inst, int msg_type, void *arg)
 {
@@ -2061,11 +2067,8 @@ int mncc_tx_to_cc(void *inst, int msg_type, void *arg)
 	}
 
 	/* Find function for current state and message */
-	for (i = 0; i < DOWNSLLEN; i++)
-		if ((msg_type == downstatelist[i].type)
-		 && ((1 << trans->cc.state) & downstatelist[i].states))
-			break;
-	if (i == DOWNSLLEN) {
+	i = statelist_idx_find(&downstate_idx, msg_type, trans->cc.state);
+	if (i < 0) {
 		LOGP(DCC, LOGL_NOTICE, "Message %d unhandled at state %d\n",
 			msg_type, trans->cc.state);
 		return 0;
@@ -2164,14 +2167,12 @@ static struct datastate {
 	 GSM48_MT_CC_MODIFY_REJECT, gsm48_cc_rx_modify_reject},
 };
 
-#define DATASLLEN \
-	(sizeof(datastatelist) / sizeof(struct datastate))
+static struct statelist_idx datastate_idx;
 
 static int gsm48_cc_data_ind(struct gsm_trans *trans, struct msgb *msg)
 {
 	struct osmocom_ms *ms = trans->ms;
 	const struct gsm48_hdr *gh = msgb_l3(msg);
-	int msg_supported = 0; /* determine, if message is supported at all */
 	uint8_t msg_type;
 	int i, rc;
 
@@ -2194,15 +2195,10 @@ static int gsm48_cc_data_ind(struct gsm_trans *trans, struct msgb *msg)
 		gsm48_cc_state_name(trans->cc.state));
 
 	/* find function for current state and message */
-	for (i = 0; i < DATASLLEN; i++) {
-		if (msg_type == datastatelist[i].type)
-			msg_supported = 1;
-		if ((msg_type == datastatelist[i].type)
-		 && ((1 << trans->cc.state) & datastatelist[i].states))
-			break;
-	}
-	if (i == DATASLLEN) {
-		if (msg_supported) {
+	i = statelist_idx_find(&datastate_idx, msg_type, trans->cc.state);
+	if (i < 0) {
+		/* determine, if message is supported at all */
+		if (statelist_idx_type_known(&datastate_idx, msg_type)) {
 			LOGP(DCC, LOGL_NOTICE, "Message unhandled at this "
 				"state.\n");
 			return gsm48_cc_tx_status(trans,
@@ -2219,6 +2215,13 @@ static int gsm48_cc_data_ind(struct gsm_trans *trans, struct msgb *msg)
 	return rc;
 }
 
+/* index state transition lists */
+static void gsm48_cc_statelist_init(void)
+{
+	STATELIST_IDX_INIT(l23_ctx, &downstate_idx, downstatelist);
+	STATELIST_IDX_INIT(l23_ctx, &datastate_idx, datastatelist);
+}
+
 /* receive message from MM layer */
 int gsm48_rcv_cc(struct osmocom_ms *ms, struct msgb *msg)
 {
@@ -44,6 +44,7 @@
 #include <osmocom/bb/mobile/vty.h>
 #include <osmocom/bb/mobile/gsm48_rr.h>
 #include <osmocom/bb/mobile/gsm322.h>
+#include <osmocom/bb/mobile/statelist.h>
 
 extern void *l23_ctx;
 
@@ -51,6 +52,7 @@ void mm_conn_free(struct gsm48_mm_conn *conn);
 static int gsm48_rcv_rr(struct osmocom_ms *ms, struct msgb *msg);
 static int gsm48_rcv_mmr(struct osmocom_ms *ms, struct msgb *msg);
 static int gsm48_mm_ev(struct osmocom_ms *ms, int msg_type, struct msgb *msg);
+static void gsm48_mm_statelist_init(void);
 static int gsm48_mm_tx_id_rsp(struct osmocom_ms *ms, uint8_t mi_type);
 static int gsm48_mm_tx_loc_upd_req(struct osmocom_ms *ms);
 static int gsm48_mm_loc_upd_failed(struct osmocom_ms *ms, struct msgb *msg);
@@ -862,6 +864,7 @@ int gsm48_mmxx_upmsg(struct osmocom_ms *ms, struct msgb *msg)
 	struct gsm48_mmlayer *mm = &ms->mmlayer;
 
 	msgb_enqueue(&mm->mmxx_upqueue, msg);
+	osmocom_ms_sched(ms, MS_WORK_MMXX);
 
 	return 0;
 }
@@ -872,6 +875,7 @@ int gsm48_mmr_downmsg(struct osmocom_ms *ms, struct msgb *msg)
 	struct gsm48_mmlayer *mm = &ms->mmlayer;
 
 	msgb_enqueue(&mm->mmr_downqueue, msg);
+	osmocom_ms_sched(ms, MS_WORK_MMR);
 
 	return 0;
 }
@@ -882,6 +886,7 @@ int gsm48_mmevent_msg(struct osmocom_ms *ms, struct msgb *msg)
 	struct gsm48_mmlayer *mm = &ms->mmlayer;
 
 	msgb_enqueue(&mm->event_queue, msg);
+	osmocom_ms_sched(ms, MS_WORK_MMEVENT);
 
 	return 0;
 }
@@ -1479,6 +1484,8 @@ int gsm48_mm_init(struct osmocom_ms *ms)
 
 	LOGP(DMM, LOGL_INFO, "init Mobility Management process\n");
 
+	gsm48_mm_statelist_init();
+
 	/* 4.2.1.1 */
 	mm->state = GSM48_MM_ST_MM_IDLE;
 	mm->substate = gsm48_mm_set_plmn_search(ms);
@@ -4441,8 +4448,7 @@ static struct downstate {
 	 GSM48_MMBCC_DATA_REQ, gsm48_mm_data},
 };
 
-#define DOWNSLLEN \
-	(sizeof(downstatelist) / sizeof(struct downstate))
+static struct statelist_idx downstate_idx;
 
 int gsm48_mmxx_downmsg(struct osmocom_ms *ms, struct msgb *msg)
 {
@@ -4467,12 +4473,10 @@ int gsm48_mmxx_downmsg(struct osmocom_ms *ms, struct msgb *msg)
 		mmh->ref, mmh->transaction_id);
 
 	/* Find function for current state and message */
-	for (i = 0; i < DOWNSLLEN; i++)
-		if ((msg_type == downstatelist[i].type)
-		 && ((1 << mm->state) & downstatelist[i].states)
-		 && ((1 << mm->substate) & downstatelist[i].substates))
-			break;
-	if (i == DOWNSLLEN) {
+	i = statelist_idx_find(&downstate_idx, msg_type, mm->state);
+	while (i >= 0 && !((1 << mm->substate) & downstatelist[i].substates))
+		i = statelist_idx_find_next(&downstate_idx, i, mm->state);
+	if (i < 0) {
 		LOGP(DMM, LOGL_NOTICE, "Message unhandled at this state.\n");
 		msgb_free(msg);
 		return 0;
@@ -4591,8 +4595,7 @@ static struct rrdatastate {
 	 GSM48_RR_ABORT_IND, gsm48_mm_rel_other},
 };
 
-#define RRDATASLLEN \
-	(sizeof(rrdatastatelist) / sizeof(struct rrdatastate))
+static struct statelist_idx rrdatastate_idx;
 
 static int gsm48_rcv_rr(struct osmocom_ms *ms, struct msgb *msg)
 {
@@ -4610,11 +4613,8 @@ static int gsm48_rcv_rr(struct osmocom_ms *ms, struct msgb *msg)
 		return gsm48_rcv_rr_sapi3(ms, msg, msg_type, sapi);
 
 	/* find function for current state and message */
-	for (i = 0; i < RRDATASLLEN; i++)
-		if ((msg_type == rrdatastatelist[i].type)
-		 && ((1 << mm->state) & rrdatastatelist[i].states))
-			break;
-	if (i == RRDATASLLEN) {
+	i = statelist_idx_find(&rrdatastate_idx, msg_type, mm->state);
+	if (i < 0) {
 		LOGP(DMM, LOGL_NOTICE, "Message unhandled at this state.\n");
 		msgb_free(msg);
 		return 0;
@@ -4665,8 +4665,7 @@ static struct mmdatastate {
 	 GSM48_MT_MM_CM_SERV_REJ, gsm48_mm_rx_cm_service_rej},
 };
 
-#define MMDATASLLEN \
-	(sizeof(mmdatastatelist) / sizeof(struct mmdatastate))
+static struct statelist_idx mmdatastate_idx;
 
 static int create_conn_and_push_mm_hdr(struct gsm48_mmlayer *mm, struct msgb *msg, int rr_est, int rr_prim,
 				       uint8_t sapi)
@@ -4733,7 +4732,6 @@ static int gsm48_mm_data_ind(struct osmocom_ms *ms, struct msgb *msg)
 	uint8_t sapi = rrh->sapi;
 	const struct gsm48_hdr *gh = msgb_l3(msg);
 	uint8_t pdisc, msg_type;
-	int msg_supported = 0; /* determine, if message is supported at all */
 	uint8_t skip_ind;
 	int i, rc;
 
@@ -4827,16 +4825,11 @@ static int gsm48_mm_data_ind(struct osmocom_ms *ms, struct msgb *msg)
 	}
 
 	/* find function for current state and message */
-	for (i = 0; i < MMDATASLLEN; i++) {
-		if (msg_type == mmdatastatelist[i].type)
-			msg_supported = 1;
-		if ((msg_type == mmdatastatelist[i].type)
-		 && ((1 << mm->state) & mmdatastatelist[i].states))
-			break;
-	}
-	if (i == MMDATASLLEN) {
+	i = statelist_idx_find(&mmdatastate_idx, msg_type, mm->state);
+	if (i < 0) {
 		msgb_free(msg);
-		if (msg_supported) {
+		/* determine, if message is supported at all */
+		if (statelist_idx_type_known(&mmdatastate_idx, msg_type)) {
 			LOGP(DMM, LOGL_NOTICE, "Message unhandled at this "
 				"state.\n");
 			return gsm48_mm_tx_mm_status(ms,
@@ -5045,8 +5038,7 @@ static struct eventstate {
 	 GSM48_MM_EVENT_UPLINK_FREE, gsm48_mm_uplink_free},
 };
 
-#define EVENTSLLEN \
-	(sizeof(eventstatelist) / sizeof(struct eventstate))
+static struct statelist_idx eventstate_idx;
 
 static int gsm48_mm_ev(struct osmocom_ms *ms, int msg_type, struct msgb *msg)
 {
@@ -5065,12 +5057,10 @@ static int gsm48_mm_ev(struct osmocom_ms *ms, int msg_type, struct msgb *msg)
 		gsm48_mm_state_names[mm->state]);
 
 	/* Find function for current state and message */
-	for (i = 0; i < EVENTSLLEN; i++)
-		if ((msg_type == eventstatelist[i].type)
-		 && ((1 << mm->state) & eventstatelist[i].states)
-		 && ((1 << mm->substate) & eventstatelist[i].substates))
-			break;
-	if (i == EVENTSLLEN) {
+	i = statelist_idx_find(&eventstate_idx, msg_type, mm->state);
+	while (i >= 0 && !((1 << mm->substate) & eventstatelist[i].substates))
+		i = statelist_idx_find_next(&eventstate_idx, i, mm->state);
+	if (i < 0) {
 		LOGP(DMM, LOGL_NOTICE, "Message %s unhandled in state %s.\n",
 		     get_mmevent_name(msg_type), gsm48_mm_state_names[mm->state]);
 		return 0;
@@ -5081,6 +5071,15 @@ static int gsm48_mm_ev(struct osmocom_ms *ms, int msg_type, struct msgb *msg)
 	return rc;
 }
 
+/* index state transition lists */
+static void gsm48_mm_statelist_init(void)
+{
+	STATELIST_IDX_INIT(l23_ctx, &downstate_idx, downstatelist);
+	STATELIST_IDX_INIT(l23_ctx, &rrdatastate_idx, rrdatastatelist);
+	STATELIST_IDX_INIT(l23_ctx, &mmdatastate_idx, mmdatastatelist);
+	STATELIST_IDX_INIT(l23_ctx, &eventstate_idx, eventstatelist);
+}
+
 /*
  * MM Register (SIM insert and remove)
  */
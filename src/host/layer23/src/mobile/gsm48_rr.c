@@ -127,6 +127,8 @@
 
 #include <osmocom/bb/mobile/vty.h>
 #include <osmocom/bb/mobile/gsm48_rr.h>
+#include <osmocom/bb/mobile/statelist.h>
+#include <osmocom/bb/mobile/si_cache.h>
 
 #include <l1ctl_proto.h>
 
@@ -676,6 +678,7 @@ int gsm48_rr_upmsg(struct osmocom_ms *ms, struct msgb *msg)
 	struct gsm48_mmlayer *mm = &ms->mmlayer;
 
 	msgb_enqueue(&mm->rr_upqueue, msg);
+	osmocom_ms_sched(ms, MS_WORK_RR);
 
 	return 0;
 }
@@ -714,6 +717,7 @@ static int rcv_rsl(struct msgb *msg, struct lapdm_entity *le, void *l3ctx)
 	struct gsm48_rrlayer *rr = &ms->rrlayer;
 
 	msgb_enqueue(&rr->rsl_upqueue, msg);
+	osmocom_ms_sched(ms, MS_WORK_RSL);
 
 	return 0;
 }
@@ -2641,6 +2645,88 @@ static int gsm48_new_sysinfo(struct osmocom_ms *ms, uint8_t type)
 	return 0;
 }
 
+/* Apply a new SYSTEM INFORMATION message to the sysinfo of the tuned cell.
+ * If another MS instance already applied the same message to the same
+ * (shared) sysinfo, its result is used instead of decoding again. */
+static struct gsm48_sysinfo *gsm48_rr_apply_sysinfo(struct osmocom_ms *ms,
+	uint8_t type, struct msgb *msg)
+{
+	struct gsm322_cellsel *cs = &ms->cellsel;
+	struct gsm48_sysinfo *from, *s;
+	const void *si = msgb_l3(msg);
+	int len = msgb_l3len(msg), key_len = len;
+
+	/* NOTE: pseudo length is not in these structures, so we skip */
+	switch (type) {
+	case GSM48_MT_RR_SYSINFO_5:
+	case GSM48_MT_RR_SYSINFO_5bis:
+	case GSM48_MT_RR_SYSINFO_5ter:
+	case GSM48_MT_RR_SYSINFO_6:
+		si = msgb_l3(msg) + 1;
+		key_len = len - 1;
+		break;
+	}
+
+	from = gsm322_cs_si_intern(cs);
+	s = si_cache_lookup(from, type, si, key_len);
+	if (s) {
+		LOGP(DRR, LOGL_DEBUG, "Using cached SYSTEM INFORMATION\n");
+		gsm322_cs_si_replace(cs, s);
+		return s;
+	}
+
+	/* keep 'from', it is replaced by a copy below */
+	si_cache_get(from);
+	s = gsm322_cs_si_writable(cs);
+	if (!s) {
+		si_cache_put(from);
+		return NULL;
+	}
+
+	switch (type) {
+	case GSM48_MT_RR_SYSINFO_1:
+		gsm48_decode_sysinfo1(s, si, len);
+		break;
+	case GSM48_MT_RR_SYSINFO_2:
+		gsm48_decode_sysinfo2(s, si, len);
+		break;
+	case GSM48_MT_RR_SYSINFO_2bis:
+		gsm48_decode_sysinfo2bis(s, si, len);
+		break;
+	case GSM48_MT_RR_SYSINFO_2ter:
+		gsm48_decode_sysinfo2ter(s, si, len);
+		break;
+	case GSM48_MT_RR_SYSINFO_3:
+		gsm48_decode_sysinfo3(s, si, len);
+		break;
+	case GSM48_MT_RR_SYSINFO_4:
+		gsm48_decode_sysinfo4(s, si, len);
+		break;
+	case GSM48_MT_RR_SYSINFO_5:
+		gsm48_decode_sysinfo5(s, si, len);
+		break;
+	case GSM48_MT_RR_SYSINFO_5bis:
+		gsm48_decode_sysinfo5bis(s, si, len);
+		break;
+	case GSM48_MT_RR_SYSINFO_5ter:
+		gsm48_decode_sysinfo5ter(s, si, len);
+		break;
+	case GSM48_MT_RR_SYSINFO_6:
+		gsm48_decode_sysinfo6(s, si, len);
+		break;
+	case GSM48_MT_RR_SYSINFO_13:
+		gsm48_decode_sysinfo13(s, si, len);
+		break;
+	}
+
+	/* share the result with other MS instances */
+	s = si_cache_store(from, type, si, key_len, si_cache_get(s));
+	gsm322_cs_si_replace(cs, s);
+	si_cache_put(from);
+
+	return s;
+}
+
 /* receive "SYSTEM INFORMATION 1" message (9.1.31) */
 static int gsm48_rr_rx_sysinfo1(struct osmocom_ms *ms, struct msgb *msg)
 {
@@ -2663,7 +2749,9 @@ static int gsm48_rr_rx_sysinfo1(struct osmocom_ms *ms, struct msgb *msg)
 	if (!memcmp(si, s->si1_msg, OSMO_MIN(msgb_l3len(msg), sizeof(s->si1_msg))))
 		return 0;
 
-	gsm48_decode_sysinfo1(s, si, msgb_l3len(msg));
+	s = gsm48_rr_apply_sysinfo(ms, GSM48_MT_RR_SYSINFO_1, msg);
+	if (!s)
+		return -ENOMEM;
 
 	LOGP(DRR, LOGL_INFO, "New SYSTEM INFORMATION 1\n");
 
@@ -2692,7 +2780,9 @@ static int gsm48_rr_rx_sysinfo2(struct osmocom_ms *ms, struct msgb *msg)
 	if (!memcmp(si, s->si2_msg, OSMO_MIN(msgb_l3len(msg), sizeof(s->si2_msg))))
 		return 0;
 
-	gsm48_decode_sysinfo2(s, si, msgb_l3len(msg));
+	s = gsm48_rr_apply_sysinfo(ms, GSM48_MT_RR_SYSINFO_2, msg);
+	if (!s)
+		return -ENOMEM;
 
 	LOGP(DRR, LOGL_INFO, "New SYSTEM INFORMATION 2\n");
 
@@ -2721,7 +2811,9 @@ static int gsm48_rr_rx_sysinfo2bis(struct osmocom_ms *ms, struct msgb *msg)
 	if (!memcmp(si, s->si2b_msg, OSMO_MIN(msgb_l3len(msg), sizeof(s->si2b_msg))))
 		return 0;
 
-	gsm48_decode_sysinfo2bis(s, si, msgb_l3len(msg));
+	s = gsm48_rr_apply_sysinfo(ms, GSM48_MT_RR_SYSINFO_2bis, msg);
+	if (!s)
+		return -ENOMEM;
 
 	LOGP(DRR, LOGL_INFO, "New SYSTEM INFORMATION 2bis\n");
 
@@ -2750,13 +2842,57 @@ static int gsm48_rr_rx_sysinfo2ter(struct osmocom_ms *ms, struct msgb *msg)
 	if (!memcmp(si, s->si2t_msg, OSMO_MIN(msgb_l3len(msg), sizeof(s->si2t_msg))))
 		return 0;
 
-	gsm48_decode_sysinfo2ter(s, si, msgb_l3len(msg));
+	s = gsm48_rr_apply_sysinfo(ms, GSM48_MT_RR_SYSINFO_2ter, msg);
+	if (!s)
+		return -ENOMEM;
 
 	LOGP(DRR, LOGL_INFO, "New SYSTEM INFORMATION 2ter\n");
 
 	return gsm48_new_sysinfo(ms, si->header.system_information);
 }
 
+/* send CCCH mode to layer 1, with DRX parameters if our paging group is known */
+int gsm48_rr_tx_ccch_mode(struct osmocom_ms *ms)
+{
+	/* first frame of each CCCH block in a 51-multiframe (TS 45.002 §7 table 5) */
+	static const uint8_t ccch_blk_fn[] = { 6, 12, 16, 22, 26, 32, 36, 42, 46 };
+	struct gsm322_cellsel *cs = &ms->cellsel;
+	struct gsm48_sysinfo *s = cs->si;
+	struct gsm_subscriber *subscr = &ms->subscr;
+	struct rx_meas_stat *meas = &ms->meas;
+	int pg = -EINVAL;
+	uint8_t n;
+
+	if (cs->ccch_mode == CCCH_MODE_NONE)
+		return -EINVAL;
+
+	if (s && s->si3 && subscr->sim_valid)
+		pg = gsm48_sysinfo_paging_group(s, subscr->imsi);
+	if (pg < 0) {
+		meas->pag_mfrms = 0;
+		return l1ctl_tx_ccch_mode_req(ms, cs->ccch_mode);
+	}
+
+	/* paging blocks per 51-multiframe */
+	n = ((cs->ccch_mode == CCCH_MODE_COMBINED) ? 3 : 9) - s->bs_ag_blks_res;
+	meas->pag_mfrms = s->pag_mf_periods;
+	meas->pag_mf = pg / n;
+	meas->pag_fn = ccch_blk_fn[pg % n + s->bs_ag_blks_res];
+
+	/* downlink signalling failure counter is initialized to 90/BS_PA_MFRMS
+	 * (TS 45.008 §6.5), because only our paging block is counted */
+	if (meas->ds_fail) {
+		meas->ds_fail = meas->dsc = (ms->settings.dsc_max
+			+ s->pag_mf_periods / 2) / s->pag_mf_periods;
+	}
+
+	LOGP(DRR, LOGL_INFO, "Using DRX (PAGING_GROUP=%d BS_PA_MFRMS=%d DSC=%d)\n",
+		pg, s->pag_mf_periods, meas->ds_fail);
+
+	return l1ctl_tx_ccch_mode_req_drx(ms, cs->ccch_mode, s->pag_mf_periods,
+		s->bs_ag_blks_res, pg);
+}
+
 /* receive "SYSTEM INFORMATION 3" message (9.1.35) */
 static int gsm48_rr_rx_sysinfo3(struct osmocom_ms *ms, struct msgb *msg)
 {
@@ -2780,15 +2916,18 @@ static int gsm48_rr_rx_sysinfo3(struct osmocom_ms *ms, struct msgb *msg)
 	if (!memcmp(si, s->si3_msg, OSMO_MIN(msgb_l3len(msg), sizeof(s->si3_msg))))
 		return 0;
 
-	gsm48_decode_sysinfo3(s, si, msgb_l3len(msg));
+	s = gsm48_rr_apply_sysinfo(ms, GSM48_MT_RR_SYSINFO_3, msg);
+	if (!s)
+		return -ENOMEM;
 
 	if (cs->ccch_mode == CCCH_MODE_NONE) {
 		cs->ccch_mode = (s->ccch_conf == 1) ? CCCH_MODE_COMBINED :
 			CCCH_MODE_NON_COMBINED;
 		LOGP(DRR, LOGL_NOTICE, "Changing CCCH_MODE to %d\n",
 			cs->ccch_mode);
-		l1ctl_tx_ccch_mode_req(ms, cs->ccch_mode);
 	}
+	/* (new) control channel description may change our paging group */
+	gsm48_rr_tx_ccch_mode(ms);
 
 	return gsm48_new_sysinfo(ms, si->header.system_information);
 }
@@ -2815,7 +2954,9 @@ static int gsm48_rr_rx_sysinfo4(struct osmocom_ms *ms, struct msgb *msg)
 	if (!memcmp(si, s->si4_msg, OSMO_MIN(msgb_l3len(msg), sizeof(s->si4_msg))))
 		return 0;
 
-	gsm48_decode_sysinfo4(s, si, msgb_l3len(msg));
+	s = gsm48_rr_apply_sysinfo(ms, GSM48_MT_RR_SYSINFO_4, msg);
+	if (!s)
+		return -ENOMEM;
 
 	LOGP(DRR, LOGL_INFO, "New SYSTEM INFORMATION 4 (lai=%s)\n", osmo_lai_name(&s->lai));
 
@@ -2845,7 +2986,9 @@ static int gsm48_rr_rx_sysinfo5(struct osmocom_ms *ms, struct msgb *msg)
 	if (!memcmp(si, s->si5_msg, OSMO_MIN(msgb_l3len(msg), sizeof(s->si5_msg))))
 		return 0;
 
-	gsm48_decode_sysinfo5(s, si, msgb_l3len(msg));
+	s = gsm48_rr_apply_sysinfo(ms, GSM48_MT_RR_SYSINFO_5, msg);
+	if (!s)
+		return -ENOMEM;
 
 	LOGP(DRR, LOGL_INFO, "New SYSTEM INFORMATION 5\n");
 
@@ -2876,7 +3019,9 @@ static int gsm48_rr_rx_sysinfo5bis(struct osmocom_ms *ms, struct msgb *msg)
 			sizeof(s->si5b_msg))))
 		return 0;
 
-	gsm48_decode_sysinfo5bis(s, si, msgb_l3len(msg));
+	s = gsm48_rr_apply_sysinfo(ms, GSM48_MT_RR_SYSINFO_5bis, msg);
+	if (!s)
+		return -ENOMEM;
 
 	LOGP(DRR, LOGL_INFO, "New SYSTEM INFORMATION 5bis\n");
 
@@ -2907,7 +3052,9 @@ static int gsm48_rr_rx_sysinfo5ter(struct osmocom_ms *ms, struct msgb *msg)
 			sizeof(s->si5t_msg))))
 		return 0;
 
-	gsm48_decode_sysinfo5ter(s, si, msgb_l3len(msg));
+	s = gsm48_rr_apply_sysinfo(ms, GSM48_MT_RR_SYSINFO_5ter, msg);
+	if (!s)
+		return -ENOMEM;
 
 	LOGP(DRR, LOGL_INFO, "New SYSTEM INFORMATION 5ter\n");
 
@@ -2938,7 +3085,9 @@ static int gsm48_rr_rx_sysinfo6(struct osmocom_ms *ms, struct msgb *msg)
 	if (!memcmp(si, s->si6_msg, OSMO_MIN(msgb_l3len(msg), sizeof(s->si6_msg))))
 		return 0;
 
-	gsm48_decode_sysinfo6(s, si, msgb_l3len(msg));
+	s = gsm48_rr_apply_sysinfo(ms, GSM48_MT_RR_SYSINFO_6, msg);
+	if (!s)
+		return -ENOMEM;
 
 	LOGP(DRR, LOGL_INFO, "New SYSTEM INFORMATION 6 (lai=%s SACCH-timeout %d)\n",
 	     osmo_lai_name(&s->lai), s->sacch_radio_link_timeout);
@@ -2977,6 +3126,9 @@ static int gsm48_rr_rx_sysinfo_10(struct osmocom_ms *ms, struct msgb *msg)
 
 	LOGP(DRR, LOGL_INFO, "New SYSTEM INFORMATION 10\n");
 
+	s = gsm322_cs_si_writable(&ms->cellsel);
+	if (!s)
+		return -ENOMEM;
 	gsm48_decode_sysinfo10(s, si, msgb_l3len(msg));
 
 	/* We cannot call gsm48_new_sysinfo, because it requires regular message types. */
@@ -3005,7 +3157,9 @@ static int gsm48_rr_rx_sysinfo13(struct osmocom_ms *ms, struct msgb *msg)
 	if (!memcmp(si, s->si13_msg, OSMO_MIN(msgb_l3len(msg), sizeof(s->si6_msg))))
 		return 0;
 
-	gsm48_decode_sysinfo13(s, si, msgb_l3len(msg));
+	s = gsm48_rr_apply_sysinfo(ms, GSM48_MT_RR_SYSINFO_13, msg);
+	if (!s)
+		return -ENOMEM;
 
 	LOGP(DRR, LOGL_INFO,
 	     "New SYSTEM INFORMATION 13 (%s, RAC 0x%02x, NCO %u, MNO %u)\n",
@@ -3920,6 +4074,13 @@ static int gsm48_rr_activate_channel(struct osmocom_ms *ms,
 	}
 	meas->rl_fail = meas->s = timeout;
 
+	/* the system information may be shared with other MS, get a copy */
+	if (s) {
+		s = gsm322_cs_si_writable(&ms->cellsel);
+		if (!s)
+			LOGP(DRR, LOGL_ERROR, "No memory, not resetting SI5*\n");
+	}
+
 	/* setting initial (invalid) measurement report, resetting SI5* */
 	if (s) {
 		memset(s->si5_msg, 0, sizeof(s->si5_msg));
@@ -3952,7 +4113,8 @@ static int gsm48_rr_activate_channel(struct osmocom_ms *ms,
 	rr->dm_est = 1;
 
 	/* old SI 5/6 are not valid on a new dedicated channel */
-	s->si5 = s->si5bis = s->si5ter = s->si6 = 0;
+	if (s)
+		s->si5 = s->si5bis = s->si5ter = s->si6 = 0;
 
 	if (rr->cipher_on)
 		l1ctl_tx_crypto_req(ms, rr->cd_now.chan_nr,
@@ -4003,8 +4165,6 @@ static int gsm48_rr_render_ma(struct osmocom_ms *ms, struct gsm48_rr_cd *cd,
 
 	/* decode mobile allocation */
 	if (cd->mob_alloc_lv[0]) {
-		struct gsm_sysinfo_freq *freq = s->freq;
-
 		LOGP(DRR, LOGL_INFO, "decoding mobile allocation\n");
 
 		if (cd->cell_desc_lv[0]) {
@@ -4014,12 +4174,15 @@ static int gsm48_rr_render_ma(struct osmocom_ms *ms, struct gsm48_rr_cd *cd,
 					"has invalid length\n");
 				return GSM48_RR_CAUSE_ABNORMAL_UNSPEC;
 			}
-			gsm48_decode_freq_list(freq, cd->cell_desc_lv + 1, 16,
-				0xce, FREQ_TYPE_SERV);
+			s = gsm322_cs_si_writable(cs);
+			if (!s)
+				return GSM48_RR_CAUSE_ABNORMAL_UNSPEC;
+			gsm48_decode_freq_set(&s->freq[FREQ_LIST_SERV],
+				cd->cell_desc_lv + 1, 16, 0xce);
 		}
 
-		gsm48_decode_mobile_alloc(freq, cd->mob_alloc_lv + 1,
-			cd->mob_alloc_lv[0], ma, ma_len, 0);
+		gsm48_decode_mobile_alloc(&s->freq[FREQ_LIST_SERV], NULL,
+			cd->mob_alloc_lv + 1, cd->mob_alloc_lv[0], ma, ma_len);
 		if (*ma_len < 1) {
 			LOGP(DRR, LOGL_NOTICE, "mobile allocation with no "
 				"frequency available\n");
@@ -4029,21 +4192,21 @@ static int gsm48_rr_render_ma(struct osmocom_ms *ms, struct gsm48_rr_cd *cd,
 	} else
 	/* decode frequency list */
 	if (cd->freq_list_lv[0]) {
-		struct gsm_sysinfo_freq f[1024];
+		struct arfcn_set f;
 		int j = 0;
 
 		LOGP(DRR, LOGL_INFO, "decoding frequency list\n");
 
 		/* get bitmap */
-		if (gsm48_decode_freq_list(f, cd->freq_list_lv + 1,
-			cd->freq_list_lv[0], 0xce, FREQ_TYPE_SERV)) {
+		if (gsm48_decode_freq_set(&f, cd->freq_list_lv + 1,
+			cd->freq_list_lv[0], 0xce)) {
 			LOGP(DRR, LOGL_NOTICE, "frequency list invalid\n");
 			return GSM48_RR_CAUSE_ABNORMAL_UNSPEC;
 		}
 
 		/* collect channels from bitmap (1..1023,0) */
 		for (i = 1; i <= 1024; i++) {
-			if ((f[i & 1023].mask & FREQ_TYPE_SERV)) {
+			if (arfcn_set_has(&f, i)) {
 				LOGP(DRR, LOGL_INFO, "Listed ARFCN #%d: %s\n",
 					j, gsm_print_arfcn((i & 1023) | pcs));
 				if (j == 64) {
@@ -6727,8 +6890,7 @@ static struct dldatastate {
 	 RSL_MT_ERROR_IND, gsm48_rr_mdl_error_ind},
 };
 
-#define DLDATASLLEN \
-	(sizeof(dldatastatelist) / sizeof(struct dldatastate))
+static struct statelist_idx dldatastate_idx;
 
 static struct dldatastate dldatastatelists3[] = {
 	/* SAPI 3 on DCCH */
@@ -6753,8 +6915,7 @@ static struct dldatastate dldatastatelists3[] = {
 	 RSL_MT_ERROR_IND, gsm48_rr_mdl_error_ind},
 };
 
-#define DLDATASLLENS3 \
-	(sizeof(dldatastatelists3) / sizeof(struct dldatastate))
+static struct statelist_idx dldatastates3_idx;
 
 static int gsm48_rcv_rll(struct osmocom_ms *ms, struct msgb *msg)
 {
@@ -6772,11 +6933,8 @@ static int gsm48_rcv_rll(struct osmocom_ms *ms, struct msgb *msg)
 	/* find function for current state and message */
 	if (!(link_id & 7)) {
 		/* SAPI 0 */
-		for (i = 0; i < DLDATASLLEN; i++)
-			if ((msg_type == dldatastatelist[i].type)
-			 && ((1 << rr->state) & dldatastatelist[i].states))
-				break;
-		if (i == DLDATASLLEN) {
+		i = statelist_idx_find(&dldatastate_idx, msg_type, rr->state);
+		if (i < 0) {
 			LOGP(DRSL, LOGL_NOTICE, "RSLms message '%s' "
 				"unhandled\n", rsl_msg_name(msg_type));
 			msgb_free(msg);
@@ -6786,12 +6944,9 @@ static int gsm48_rcv_rll(struct osmocom_ms *ms, struct msgb *msg)
 		rc = dldatastatelist[i].rout(ms, msg);
 	} else {
 		/* SAPI 3 */
-		for (i = 0; i < DLDATASLLENS3; i++)
-			if ((msg_type == dldatastatelists3[i].type)
-			 && ((1 << rr->sapi3_state) &
-			     dldatastatelists3[i].states))
-				break;
-		if (i == DLDATASLLENS3) {
+		i = statelist_idx_find(&dldatastates3_idx, msg_type,
+				       rr->sapi3_state);
+		if (i < 0) {
 			LOGP(DRSL, LOGL_NOTICE, "RSLms message '%s' "
 				"unhandled\n", rsl_msg_name(msg_type));
 			msgb_free(msg);
@@ -6904,8 +7059,7 @@ static struct rrdownstate {
 	 GSM48_RR_UPLINK_REL_REQ, gsm48_rr_uplink_rel_req},
 };
 
-#define RRDOWNSLLEN \
-	(sizeof(rrdownstatelist) / sizeof(struct rrdownstate))
+static struct statelist_idx rrdownstate_idx;
 
 /* state trasitions for RR-SAP messages from up with (SAPI 3) */
 static struct rrdownstate rrdownstatelists3[] = {
@@ -6921,8 +7075,7 @@ static struct rrdownstate rrdownstatelists3[] = {
 	 GSM48_RR_DATA_REQ, gsm48_rr_data_req}, /* handles SAPI 3 too */
 };
 
-#define RRDOWNSLLENS3 \
-	(sizeof(rrdownstatelists3) / sizeof(struct rrdownstate))
+static struct statelist_idx rrdownstates3_idx;
 
 int gsm48_rr_downmsg(struct osmocom_ms *ms, struct msgb *msg)
 {
@@ -6939,11 +7092,8 @@ int gsm48_rr_downmsg(struct osmocom_ms *ms, struct msgb *msg)
 
 	if (!sapi) {
 		/* SAPI 0: find function for current state and message */
-		for (i = 0; i < RRDOWNSLLEN; i++)
-			if ((msg_type == rrdownstatelist[i].type)
-			 && ((1 << rr->state) & rrdownstatelist[i].states))
-				break;
-		if (i == RRDOWNSLLEN) {
+		i = statelist_idx_find(&rrdownstate_idx, msg_type, rr->state);
+		if (i < 0) {
 			LOGP(DRR, LOGL_NOTICE, "Message unhandled at this "
 				"state.\n");
 			msgb_free(msg);
@@ -6953,12 +7103,9 @@ int gsm48_rr_downmsg(struct osmocom_ms *ms, struct msgb *msg)
 		rc = rrdownstatelist[i].rout(ms, msg);
 	} else {
 		/* SAPI 3: find function for current state and message */
-		for (i = 0; i < RRDOWNSLLENS3; i++)
-			if ((msg_type == rrdownstatelists3[i].type)
-			 && ((1 << rr->sapi3_state)
-			     & rrdownstatelists3[i].states))
-				break;
-		if (i == RRDOWNSLLENS3) {
+		i = statelist_idx_find(&rrdownstates3_idx, msg_type,
+				       rr->sapi3_state);
+		if (i < 0) {
 			LOGP(DRR, LOGL_NOTICE, "Message unhandled at this "
 				"state.\n");
 			msgb_free(msg);
@@ -6988,6 +7135,12 @@ int gsm48_rr_init(struct osmocom_ms *ms)
 
 	LOGP(DRR, LOGL_INFO, "init Radio Ressource process\n");
 
+	/* index state transition lists */
+	STATELIST_IDX_INIT(l23_ctx, &dldatastate_idx, dldatastatelist);
+	STATELIST_IDX_INIT(l23_ctx, &dldatastates3_idx, dldatastatelists3);
+	STATELIST_IDX_INIT(l23_ctx, &rrdownstate_idx, rrdownstatelist);
+	STATELIST_IDX_INIT(l23_ctx, &rrdownstates3_idx, rrdownstatelists3);
+
 	INIT_LLIST_HEAD(&rr->rsl_upqueue);
 	INIT_LLIST_HEAD(&rr->downqueue);
 	/* downqueue is handled here, so don't add_work */
@@ -21,6 +21,7 @@
 #include <osmocom/bb/common/logging.h>
 #include <osmocom/bb/common/l23_app.h>
 #include <osmocom/bb/common/vty.h>
+#include <osmocom/bb/trxcon/gsmtap_export.h>
 #include <osmocom/bb/mobile/app_mobile.h>
 
 #include <osmocom/core/talloc.h>
@@ -312,6 +313,19 @@ int main(int argc, char **argv)
 		gsmtap_source_add_sink(l23_cfg.gsmtap.inst);
 	}
 
+	if (l23_cfg.gsmtap.inst || l23_cfg.gsmtap.pcap_file) {
+		const struct gsmtap_export_cfg cfg = {
+			.fd = l23_cfg.gsmtap.inst ? gsmtap_inst_fd2(l23_cfg.gsmtap.inst) : -1,
+			.pcap_path = l23_cfg.gsmtap.pcap_file,
+		};
+
+		l23_cfg.gsmtap.exp = gsmtap_export_alloc(l23_ctx, &cfg);
+		if (!l23_cfg.gsmtap.exp) {
+			fprintf(stderr, "Failed to set up GSMTAP export\n");
+			exit(1);
+		}
+	}
+
 	if (l23_app_start) {
 		rc = l23_app_start();
 		if (rc < 0) {
@@ -349,6 +363,7 @@ int main(int argc, char **argv)
 	if (l23_app_info.opt_supported & L23_OPT_VTY)
 		telnet_exit();
 
+	gsmtap_export_free(l23_cfg.gsmtap.exp);
 	log_fini();
 
 	talloc_free(config_file);
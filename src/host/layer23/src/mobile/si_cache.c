@@ -0,0 +1,298 @@
+/* System information cache, shared by all MS instances */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/linuxlist.h>
+
+#include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/mobile/si_cache.h>
+
+/* number of hash buckets (power of 2) */
+#define SI_CACHE_OBJ_BUCKETS	256
+#define SI_CACHE_TRANS_BUCKETS	1024
+
+/* reference counted system information */
+struct si_cache_obj {
+	/* entry in obj_hash[], if interned */
+	struct llist_head	entry;
+	uint32_t		hash;
+	bool			interned;
+	unsigned int		refcnt;
+	uint16_t		arfcn;
+	struct gsm48_sysinfo	si;
+};
+
+/* result of applying a SYSTEM INFORMATION message to an interned object */
+struct si_cache_trans {
+	/* entry in trans_hash[] */
+	struct llist_head	entry;
+	/* entry in trans_lru, least recently used first */
+	struct llist_head	lru;
+	uint32_t		hash;
+	struct si_cache_obj	*from, *to;
+	uint8_t			type;
+	uint8_t			len;
+	uint8_t			msg[SI_CACHE_MSG_MAX];
+};
+
+static void *tall_si_cache_ctx;
+static struct llist_head obj_hash[SI_CACHE_OBJ_BUCKETS];
+static struct llist_head trans_hash[SI_CACHE_TRANS_BUCKETS];
+static LLIST_HEAD(trans_lru);
+static unsigned int trans_num;
+
+#define OBJ(s)	container_of(s, struct si_cache_obj, si)
+
+/* FNV-1a */
+static uint32_t si_cache_hash(uint32_t hash, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+
+	while (len--) {
+		hash ^= *p++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static uint32_t si_cache_trans_hash(const struct si_cache_obj *from,
+				    uint8_t type, const uint8_t *msg,
+				    unsigned int len)
+{
+	uint32_t hash = 2166136261U;
+
+	hash = si_cache_hash(hash, &from, sizeof(from));
+	hash = si_cache_hash(hash, &type, sizeof(type));
+	return si_cache_hash(hash, msg, len);
+}
+
+/*! Initialize the cache (only once, subsequent calls are no-ops).
+ *  \param[in] ctx  talloc context to allocate the cache from. */
+void si_cache_init(void *ctx)
+{
+	int i;
+
+	if (tall_si_cache_ctx)
+		return;
+
+	tall_si_cache_ctx = talloc_named_const(ctx, 0, "si_cache");
+	for (i = 0; i < SI_CACHE_OBJ_BUCKETS; i++)
+		INIT_LLIST_HEAD(&obj_hash[i]);
+	for (i = 0; i < SI_CACHE_TRANS_BUCKETS; i++)
+		INIT_LLIST_HEAD(&trans_hash[i]);
+}
+
+/*! Allocate empty (private) system information.
+ *  \param[in] arfcn  ARFCN of the cell (with ARFCN_PCS flag, if PCS).
+ *  \returns system information with a reference count of 1; NULL on error. */
+struct gsm48_sysinfo *si_cache_alloc(uint16_t arfcn)
+{
+	struct si_cache_obj *obj;
+
+	obj = talloc_zero(tall_si_cache_ctx, struct si_cache_obj);
+	if (!obj)
+		return NULL;
+	obj->refcnt = 1;
+	obj->arfcn = arfcn;
+
+	return &obj->si;
+}
+
+/*! Get another reference to system information. */
+struct gsm48_sysinfo *si_cache_get(struct gsm48_sysinfo *s)
+{
+	OBJ(s)->refcnt++;
+
+	return s;
+}
+
+/*! Drop a reference to system information (NULL is ignored). */
+void si_cache_put(struct gsm48_sysinfo *s)
+{
+	struct si_cache_obj *obj;
+
+	if (!s)
+		return;
+
+	obj = OBJ(s);
+	if (--obj->refcnt > 0)
+		return;
+	if (obj->interned)
+		llist_del(&obj->entry);
+	talloc_free(obj);
+}
+
+/*! Get the ARFCN given to si_cache_alloc(). */
+uint16_t si_cache_arfcn(const struct gsm48_sysinfo *s)
+{
+	return OBJ(s)->arfcn;
+}
+
+/*! Make system information shared (read-only).
+ *  If there is an interned object of the same ARFCN with the same content,
+ *  the caller's reference is moved to that object.
+ *  \param[in] s  system information (caller's reference is consumed).
+ *  \returns interned system information (new reference). */
+struct gsm48_sysinfo *si_cache_intern(struct gsm48_sysinfo *s)
+{
+	struct si_cache_obj *obj = OBJ(s), *o;
+	struct llist_head *bucket;
+	uint32_t hash = 2166136261U;
+
+	if (obj->interned)
+		return s;
+
+	hash = si_cache_hash(hash, &obj->arfcn, sizeof(obj->arfcn));
+	hash = si_cache_hash(hash, s, sizeof(*s));
+	bucket = &obj_hash[hash & (SI_CACHE_OBJ_BUCKETS - 1)];
+
+	llist_for_each_entry(o, bucket, entry) {
+		if (o->hash != hash || o->arfcn != obj->arfcn
+		 || memcmp(&o->si, s, sizeof(*s)))
+			continue;
+		si_cache_get(&o->si);
+		si_cache_put(s);
+		return &o->si;
+	}
+
+	obj->hash = hash;
+	obj->interned = true;
+	llist_add(&obj->entry, bucket);
+
+	return s;
+}
+
+/*! Get system information which may be modified (copy-on-write).
+ *  \param[in] s  system information (caller's reference is consumed,
+ *                unless NULL is returned).
+ *  \returns private system information (new reference); NULL on error. */
+struct gsm48_sysinfo *si_cache_unshare(struct gsm48_sysinfo *s)
+{
+	struct si_cache_obj *obj = OBJ(s), *copy;
+
+	if (!obj->interned && obj->refcnt == 1)
+		return s;
+
+	copy = talloc(tall_si_cache_ctx, struct si_cache_obj);
+	if (!copy)
+		return NULL;
+	memcpy(copy, obj, sizeof(*copy));
+	INIT_LLIST_HEAD(&copy->entry);
+	copy->interned = false;
+	copy->refcnt = 1;
+	si_cache_put(s);
+
+	return &copy->si;
+}
+
+/*! Find the result of applying a SYSTEM INFORMATION message.
+ *  \param[in] from  interned system information the message is applied to.
+ *  \param[in] type  message type (GSM48_MT_RR_SYSINFO_*).
+ *  \param[in] msg   raw message.
+ *  \param[in] len   length of the message.
+ *  \returns resulting system information (new reference); NULL if unknown. */
+struct gsm48_sysinfo *si_cache_lookup(const struct gsm48_sysinfo *from,
+				      uint8_t type, const uint8_t *msg,
+				      unsigned int len)
+{
+	struct si_cache_obj *obj = OBJ(from);
+	struct si_cache_trans *t;
+	uint32_t hash;
+
+	if (!obj->interned || len > SI_CACHE_MSG_MAX)
+		return NULL;
+
+	hash = si_cache_trans_hash(obj, type, msg, len);
+	llist_for_each_entry(t, &trans_hash[hash & (SI_CACHE_TRANS_BUCKETS - 1)], entry) {
+		if (t->hash != hash || t->from != obj || t->type != type
+		 || t->len != len || memcmp(t->msg, msg, len))
+			continue;
+		llist_del(&t->lru);
+		llist_add_tail(&t->lru, &trans_lru);
+		return si_cache_get(&t->to->si);
+	}
+
+	return NULL;
+}
+
+static void si_cache_trans_free(struct si_cache_trans *t)
+{
+	llist_del(&t->entry);
+	llist_del(&t->lru);
+	si_cache_put(&t->from->si);
+	si_cache_put(&t->to->si);
+	talloc_free(t);
+	trans_num--;
+}
+
+/*! Store the result of applying a SYSTEM INFORMATION message.
+ *  \param[in] from  interned system information the message was applied to.
+ *  \param[in] type  message type (GSM48_MT_RR_SYSINFO_*).
+ *  \param[in] msg   raw message.
+ *  \param[in] len   length of the message.
+ *  \param[in] to    resulting system information (caller's reference is
+ *                   consumed, it is interned here).
+ *  \returns interned resulting system information (new reference). */
+struct gsm48_sysinfo *si_cache_store(struct gsm48_sysinfo *from,
+				     uint8_t type, const uint8_t *msg,
+				     unsigned int len, struct gsm48_sysinfo *to)
+{
+	struct si_cache_trans *t;
+
+	to = si_cache_intern(to);
+
+	if (!OBJ(from)->interned || len > SI_CACHE_MSG_MAX)
+		return to;
+
+	if (trans_num >= SI_CACHE_TRANS_MAX)
+		si_cache_trans_free(llist_entry(trans_lru.next,
+					struct si_cache_trans, lru));
+
+	t = talloc_zero(tall_si_cache_ctx, struct si_cache_trans);
+	if (!t)
+		return to;
+	t->from = OBJ(si_cache_get(from));
+	t->to = OBJ(si_cache_get(to));
+	t->type = type;
+	t->len = len;
+	memcpy(t->msg, msg, len);
+	t->hash = si_cache_trans_hash(t->from, type, msg, len);
+	llist_add(&t->entry, &trans_hash[t->hash & (SI_CACHE_TRANS_BUCKETS - 1)]);
+	llist_add_tail(&t->lru, &trans_lru);
+	trans_num++;
+
+	LOGP(DCS, LOGL_DEBUG, "Cached SYSTEM INFORMATION (type 0x%02x) "
+		"of ARFCN %s, %u entries\n", type,
+		gsm_print_arfcn(OBJ(to)->arfcn), trans_num);
+
+	return to;
+}
+
+/*! Drop all cached transitions (and the references they hold). */
+void si_cache_flush(void)
+{
+	struct si_cache_trans *t, *t2;
+
+	llist_for_each_entry_safe(t, t2, &trans_lru, lru)
+		si_cache_trans_free(t);
+}
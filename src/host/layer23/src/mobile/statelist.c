@@ -0,0 +1,135 @@
+/* Index of state transition lists */
+
+/* (C) 2026 by agent <agent@local>
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/mobile/statelist.h>
+
+#define ENTRY_STATES(list, size, off, i) \
+	(*(const uint32_t *)((const uint8_t *)(list) + (i) * (size) + (off)))
+#define ENTRY_TYPE(list, size, off, i) \
+	(*(const int *)((const uint8_t *)(list) + (i) * (size) + (off)))
+
+/* cross-check the index against a plain search of the list */
+static void statelist_idx_check(const struct statelist_idx *idx,
+				const char *name, const void *list,
+				unsigned int num, size_t size,
+				size_t states_off, size_t type_off)
+{
+	unsigned int row;
+	int state, i;
+
+	for (row = 0; row < idx->num_types; row++) {
+		int type = idx->type_min + row;
+
+		for (state = 0; state < STATELIST_NUM_STATES; state++) {
+			for (i = 0; i < num; i++) {
+				if (ENTRY_TYPE(list, size, type_off, i) == type
+				 && (ENTRY_STATES(list, size, states_off, i)
+							& (1U << state)))
+					break;
+			}
+			if (i == num)
+				i = -1;
+			if (statelist_idx_find(idx, type, state) != i) {
+				LOGP(DMOB, LOGL_FATAL, "Index of %s does not "
+					"match (type %d state %d), please "
+					"fix!\n", name, type, state);
+				OSMO_ASSERT(0);
+			}
+		}
+	}
+}
+
+/*! Build the index of a state transition list (see statelist.h).
+ *  \param[in]  ctx         talloc context to allocate the index from.
+ *  \param[out] idx         index to be built (no-op if already built).
+ *  \param[in]  name        name of the list (for logging).
+ *  \param[in]  list        the list of state transitions.
+ *  \param[in]  num         number of entries in the list.
+ *  \param[in]  size        size of an entry.
+ *  \param[in]  states_off  offset of 'uint32_t states' in an entry.
+ *  \param[in]  type_off    offset of 'int type' in an entry. */
+void statelist_idx_init(void *ctx, struct statelist_idx *idx, const char *name,
+			const void *list, unsigned int num, size_t size,
+			size_t states_off, size_t type_off)
+{
+	int type_min = INT_MAX, type_max = INT_MIN;
+	int i, state;
+
+	if (idx->rows != NULL)
+		return;
+
+	OSMO_ASSERT(num > 0 && num <= INT16_MAX);
+
+	for (i = 0; i < num; i++) {
+		int type = ENTRY_TYPE(list, size, type_off, i);
+
+		type_min = OSMO_MIN(type_min, type);
+		type_max = OSMO_MAX(type_max, type);
+	}
+
+	idx->type_min = type_min;
+	idx->num_types = type_max - type_min + 1;
+	idx->rows = talloc_array(ctx, struct statelist_row, idx->num_types);
+	OSMO_ASSERT(idx->rows);
+	talloc_set_name_const(idx->rows, name);
+	idx->states = talloc_array(idx->rows, uint32_t, num);
+	idx->next = talloc_array(idx->rows, int16_t, num);
+	OSMO_ASSERT(idx->states && idx->next);
+
+	for (i = 0; i < idx->num_types; i++) {
+		idx->rows[i].any = -1;
+		for (state = 0; state < STATELIST_NUM_STATES; state++)
+			idx->rows[i].state[state] = -1;
+	}
+
+	/* walk backwards, so that the first matching entry wins */
+	for (i = num - 1; i >= 0; i--) {
+		struct statelist_row *row;
+		uint32_t states;
+
+		row = &idx->rows[ENTRY_TYPE(list, size, type_off, i) - type_min];
+		states = ENTRY_STATES(list, size, states_off, i);
+
+		idx->states[i] = states;
+		idx->next[i] = row->any;
+		row->any = i;
+		for (state = 0; state < STATELIST_NUM_STATES; state++) {
+			if (states & (1U << state))
+				row->state[state] = i;
+		}
+	}
+
+	statelist_idx_check(idx, name, list, num, size, states_off, type_off);
+
+	LOGP(DMOB, LOGL_DEBUG, "Indexed %s (%u entries, %u types)\n",
+		name, num, idx->num_types);
+}
+
+/*! Free the index of a state transition list (it may be built again). */
+void statelist_idx_free(struct statelist_idx *idx)
+{
+	talloc_free(idx->rows);
+	memset(idx, 0, sizeof(*idx));
+}
@@ -501,7 +501,7 @@ static void handle_pdch_establish_req(struct osmo_fsm_inst *fi,
 			unsigned int arfcn = i & 1023;
 			unsigned int k;
 
-			if (~ms->cellsel.sel_si.freq[arfcn].mask & 0x01)
+			if (!arfcn_set_has(&ms->cellsel.sel_si.freq[FREQ_LIST_SERV], arfcn))
 				continue;
 
 			k = lp->pdch_est_req.fhp.ma_len - (j >> 3) - 1;
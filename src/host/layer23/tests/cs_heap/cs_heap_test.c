@@ -0,0 +1,115 @@
+/*
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <osmocom/gsm/gsm48.h>
+
+#include <osmocom/bb/mobile/gsm322.h>
+
+#define CS_LIST_LEN	(1023 + 299 + 1)
+
+static struct gsm322_cellsel *cs;
+
+/* Reproducible on any libc, unlike rand() */
+static uint32_t prng_state = 0x322;
+
+static unsigned int prng(void)
+{
+	prng_state = prng_state * 1103515245 + 12345;
+	return (prng_state >> 16) & 0x7fff;
+}
+
+/* The strongest frequency not yet taken, the way gsm322_cs_scan()
+ * used to search the whole list; -1 if there is none */
+static int linear_scan(const uint8_t *queued)
+{
+	uint32_t weight = 0;
+	int i, found = -1;
+
+	for (i = 0; i < CS_LIST_LEN; i++) {
+		if (!queued[i])
+			continue;
+		if (found < 0 || gsm322_cs_weight(cs, i) > weight) {
+			weight = gsm322_cs_weight(cs, i);
+			found = i;
+		}
+	}
+
+	return found;
+}
+
+/* Queue a random subset of frequencies with random levels, compare the
+ * order in which they are popped from the heap with a linear scan */
+static void test_cs_heap(unsigned int num_levels, unsigned int percent)
+{
+	uint8_t queued[CS_LIST_LEN];
+	unsigned int num = 0, ok = 0;
+	int i, exp;
+
+	memset(queued, 0, sizeof(queued));
+	cs->scan_heap_len = 0;
+
+	for (i = 0; i < CS_LIST_LEN; i++) {
+		cs->list[i].rxlev = prng() % num_levels;
+		if (prng() % 100 >= percent)
+			continue;
+		gsm322_cs_heap_push(cs, i);
+		queued[i] = 1;
+		num++;
+	}
+
+	while ((i = gsm322_cs_heap_pop(cs)) >= 0) {
+		exp = linear_scan(queued);
+		if (i != exp) {
+			printf("  popped %d (rxlev %u), expected %d (rxlev %u)\n",
+			       i, cs->list[i].rxlev, exp, exp >= 0 ? cs->list[exp].rxlev : 0);
+			break;
+		}
+		queued[i] = 0;
+		ok++;
+	}
+
+	printf("%s(levels=%u, %u%%): %u/%u frequencies in order, %s\n",
+	       __func__, num_levels, percent, ok, num,
+	       linear_scan(queued) < 0 && cs->scan_heap_len == 0 ? "empty" : "NOT empty");
+}
+
+int main(int argc, char **argv)
+{
+	cs = calloc(1, sizeof(*cs));
+
+	/* Empty heap */
+	printf("pop from an empty heap: %d\n", gsm322_cs_heap_pop(cs));
+
+	/* A single level: ordered by index only */
+	test_cs_heap(1, 100);
+	/* Few levels, many equal weights apart from the index */
+	test_cs_heap(4, 50);
+	/* Full rxlev range, all or only some frequencies with signal */
+	test_cs_heap(64, 100);
+	test_cs_heap(64, 10);
+	test_cs_heap(64, 1);
+
+	free(cs);
+
+	return EXIT_SUCCESS;
+}
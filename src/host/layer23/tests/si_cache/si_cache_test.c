@@ -0,0 +1,250 @@
+/*
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <osmocom/core/logging.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/protocol/gsm_04_08.h>
+
+#include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/common/sysinfo.h>
+#include <osmocom/bb/mobile/si_cache.h>
+
+#define ARFCN		871
+
+/* The part of an MS the cache is concerned with */
+struct test_ms {
+	const char *name;
+	/* sysinfo of the tuned cell (one reference) */
+	struct gsm48_sysinfo *si;
+	/* number of messages actually decoded */
+	unsigned int decoded;
+};
+
+/* SYSTEM INFORMATION messages of a cell (content does not matter) */
+static const struct {
+	uint8_t type;
+	uint8_t msg[SI_CACHE_MSG_MAX];
+} si_seq[] = {
+	{ GSM48_MT_RR_SYSINFO_1, { 0x55, 0x06, 0x19, 0x8f, 0xb3, 0x00 } },
+	{ GSM48_MT_RR_SYSINFO_2, { 0x59, 0x06, 0x1a, 0x00, 0x00, 0x01 } },
+	{ GSM48_MT_RR_SYSINFO_3, { 0x49, 0x06, 0x1b, 0x00, 0x01, 0x00 } },
+	{ GSM48_MT_RR_SYSINFO_4, { 0x31, 0x06, 0x1c, 0x00, 0xf1, 0x10 } },
+};
+
+static void *si_ctx;
+
+/* Number of talloc blocks (sysinfo objects and transitions) in use */
+static size_t blocks_used(void)
+{
+	/* the context and the one of the cache */
+	return talloc_total_blocks(si_ctx) - 2;
+}
+
+/* Stands in for gsm48_decode_sysinfoN() */
+static void decode(struct gsm48_sysinfo *s, uint8_t type, const uint8_t *msg)
+{
+	switch (type) {
+	case GSM48_MT_RR_SYSINFO_1:
+		s->si1 = 1;
+		memcpy(s->si1_msg, msg, sizeof(s->si1_msg));
+		break;
+	case GSM48_MT_RR_SYSINFO_2:
+		s->si2 = 1;
+		memcpy(s->si2_msg, msg, sizeof(s->si2_msg));
+		break;
+	case GSM48_MT_RR_SYSINFO_3:
+		s->si3 = 1;
+		memcpy(s->si3_msg, msg, sizeof(s->si3_msg));
+		break;
+	case GSM48_MT_RR_SYSINFO_4:
+		s->si4 = 1;
+		memcpy(s->si4_msg, msg, sizeof(s->si4_msg));
+		break;
+	}
+}
+
+/* Same steps as gsm48_rr_apply_sysinfo() */
+static void ms_apply(struct test_ms *ms, uint8_t type, const uint8_t *msg)
+{
+	struct gsm48_sysinfo *from, *s;
+
+	from = ms->si = si_cache_intern(ms->si);
+	s = si_cache_lookup(from, type, msg, SI_CACHE_MSG_MAX);
+	if (s) {
+		si_cache_put(ms->si);
+		ms->si = s;
+		return;
+	}
+
+	si_cache_get(from);
+	s = ms->si = si_cache_unshare(ms->si);
+	OSMO_ASSERT(s != NULL);
+	decode(s, type, msg);
+	ms->decoded++;
+
+	s = si_cache_store(from, type, msg, SI_CACHE_MSG_MAX, si_cache_get(s));
+	si_cache_put(ms->si);
+	ms->si = s;
+	si_cache_put(from);
+}
+
+static void ms_apply_seq(struct test_ms *ms)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(si_seq); i++)
+		ms_apply(ms, si_seq[i].type, si_seq[i].msg);
+}
+
+/* Two MS receiving the same SI sequence of a cell share the result,
+ * the second one does not decode anything */
+static void test_shared_seq(void)
+{
+	struct test_ms a = { .name = "A" }, b = { .name = "B" };
+
+	printf("Running %s()\n", __func__);
+
+	a.si = si_cache_alloc(ARFCN);
+	b.si = si_cache_alloc(ARFCN);
+	ms_apply_seq(&a);
+	ms_apply_seq(&b);
+
+	printf("  MS A decoded %u, MS B decoded %u messages\n", a.decoded, b.decoded);
+	printf("  same sysinfo: %s\n", a.si == b.si ? "yes" : "no");
+	printf("  sysinfo complete: %s\n",
+	       a.si->si1 && a.si->si2 && a.si->si3 && a.si->si4 ? "yes" : "no");
+	/* 5 sysinfo objects (empty, SI1, +SI2, +SI3, +SI4), 4 transitions */
+	printf("  blocks used: %zu\n", blocks_used());
+
+	/* Copy-on-write: a change by MS B does not affect MS A */
+	b.si = si_cache_unshare(b.si);
+	b.si->si3_msg[3] ^= 0xff;
+	printf("  after unshare: same sysinfo: %s, MS A unchanged: %s\n",
+	       a.si == b.si ? "yes" : "no",
+	       a.si->si3_msg[3] == si_seq[2].msg[3] ? "yes" : "no");
+
+	si_cache_put(a.si);
+	si_cache_put(b.si);
+
+	/* the transitions still hold their sysinfo objects */
+	printf("  blocks used (MS gone): %zu\n", blocks_used());
+	si_cache_flush();
+	printf("  blocks used (flushed): %zu\n", blocks_used());
+}
+
+/* A transition holds a reference to the sysinfo it is applied to: once
+ * all MS moved on, a new MS (empty sysinfo) still finds the transition */
+static void test_trans_holds_from(void)
+{
+	struct test_ms a = { .name = "A" }, c = { .name = "C" };
+
+	printf("Running %s()\n", __func__);
+
+	a.si = si_cache_alloc(ARFCN);
+	ms_apply_seq(&a);
+	si_cache_put(a.si);
+
+	c.si = si_cache_alloc(ARFCN);
+	ms_apply_seq(&c);
+	printf("  MS A decoded %u, MS C decoded %u messages\n", a.decoded, c.decoded);
+
+	/* another ARFCN is not shared */
+	a.si = si_cache_alloc(ARFCN + 1);
+	a.decoded = 0;
+	ms_apply_seq(&a);
+	printf("  other ARFCN: MS A decoded %u messages, same sysinfo: %s\n",
+	       a.decoded, a.si == c.si ? "yes" : "no");
+
+	si_cache_put(a.si);
+	si_cache_put(c.si);
+	si_cache_flush();
+	printf("  blocks used (flushed): %zu\n", blocks_used());
+}
+
+/* The least recently used transitions are dropped */
+static void test_lru(void)
+{
+	static const unsigned int check[] = { 0, 1, 2, SI_CACHE_TRANS_MAX };
+	struct gsm48_sysinfo *from, *s;
+	uint8_t msg[SI_CACHE_MSG_MAX] = { 0 };
+	unsigned int i;
+
+	printf("Running %s()\n", __func__);
+
+	from = si_cache_intern(si_cache_alloc(ARFCN));
+
+	/* SI_CACHE_TRANS_MAX + 1 different messages applied to 'from' */
+	for (i = 0; i <= SI_CACHE_TRANS_MAX; i++) {
+		/* use transition #0, so that #1 is the least recently used */
+		if (i == SI_CACHE_TRANS_MAX) {
+			msg[0] = 0;
+			msg[1] = 0;
+			s = si_cache_lookup(from, GSM48_MT_RR_SYSINFO_1, msg, sizeof(msg));
+			OSMO_ASSERT(s != NULL);
+			si_cache_put(s);
+		}
+
+		msg[0] = i & 0xff;
+		msg[1] = i >> 8;
+		s = si_cache_unshare(si_cache_get(from));
+		decode(s, GSM48_MT_RR_SYSINFO_1, msg);
+		s = si_cache_store(from, GSM48_MT_RR_SYSINFO_1, msg, sizeof(msg), s);
+		si_cache_put(s);
+	}
+
+	/* from + SI_CACHE_TRANS_MAX transitions and their results */
+	printf("  blocks used: %zu (max %u transitions)\n", blocks_used(),
+	       SI_CACHE_TRANS_MAX);
+
+	for (i = 0; i < ARRAY_SIZE(check); i++) {
+		msg[0] = check[i] & 0xff;
+		msg[1] = check[i] >> 8;
+		s = si_cache_lookup(from, GSM48_MT_RR_SYSINFO_1, msg, sizeof(msg));
+		printf("  transition #%u: %s\n", check[i], s ? "cached" : "dropped");
+		si_cache_put(s);
+	}
+
+	si_cache_put(from);
+	si_cache_flush();
+	printf("  blocks used (flushed): %zu\n", blocks_used());
+}
+
+int main(int argc, char **argv)
+{
+	void *ctx = talloc_named_const(NULL, 0, "si_cache_test");
+
+	osmo_init_logging2(ctx, &log_info);
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	si_ctx = talloc_named_const(ctx, 0, "si_cache_test_si");
+	si_cache_init(si_ctx);
+
+	test_shared_seq();
+	test_trans_holds_from();
+	test_lru();
+
+	talloc_free(ctx);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+/*
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <osmocom/core/logging.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bb/common/logging.h>
+#include <osmocom/bb/mobile/statelist.h>
+
+#define SBIT(a) (1U << (a))
+#define ALL_STATES 0xffffffff
+
+/* Same layout as the state transition lists of the mobile */
+struct teststate {
+	uint32_t	states;
+	int		type;
+	int		id;
+};
+
+/* Several entries per type, overlapping states, a catch-all entry */
+static struct teststate fixedlist[] = {
+	{ SBIT(0) | SBIT(1),	5,	100 },
+	{ SBIT(1),		5,	101 },
+	{ ALL_STATES,		7,	102 },
+	{ SBIT(2),		5,	103 },
+	{ SBIT(31),		-3,	104 },
+	{ SBIT(0),		5,	105 },
+	{ ALL_STATES,		5,	106 },
+	{ SBIT(4) | SBIT(5),	9,	107 },
+};
+
+static struct teststate randlist[200];
+
+/* Reproducible on any libc, unlike rand() */
+static uint32_t prng_state = 0x5ade;
+
+static unsigned int prng(void)
+{
+	prng_state = prng_state * 1103515245 + 12345;
+	return (prng_state >> 16) & 0x7fff;
+}
+
+/* The first entry after 'from' matching type and state, by a plain
+ * search of the list, the way the state machines used to do it */
+static int linear_find(const struct teststate *list, unsigned int num,
+		       int from, int type, int state)
+{
+	int i;
+
+	if (state < 0 || state >= STATELIST_NUM_STATES)
+		return -1;
+
+	for (i = from + 1; i < num; i++) {
+		if (list[i].type == type && (list[i].states & SBIT(state)))
+			return i;
+	}
+
+	return -1;
+}
+
+static bool linear_type_known(const struct teststate *list, unsigned int num,
+			      int type)
+{
+	int i;
+
+	for (i = 0; i < num; i++) {
+		if (list[i].type == type)
+			return true;
+	}
+
+	return false;
+}
+
+/* Compare all lookups (including types and states out of range) */
+static void check_idx(const char *name, const struct statelist_idx *idx,
+		      const struct teststate *list, unsigned int num)
+{
+	unsigned int lookups = 0, errors = 0;
+	int type_min = INT32_MAX, type_max = INT32_MIN;
+	int type, state, i, exp;
+
+	for (i = 0; i < num; i++) {
+		type_min = OSMO_MIN(type_min, list[i].type);
+		type_max = OSMO_MAX(type_max, list[i].type);
+	}
+
+	for (type = type_min - 2; type <= type_max + 2; type++) {
+		if (statelist_idx_type_known(idx, type) != linear_type_known(list, num, type))
+			errors++;
+
+		for (state = -1; state <= STATELIST_NUM_STATES; state++) {
+			/* first entry and all further ones */
+			i = statelist_idx_find(idx, type, state);
+			exp = linear_find(list, num, -1, type, state);
+			while (1) {
+				lookups++;
+				if (i != exp) {
+					printf("  type %d state %d: found %d, expected %d\n",
+					       type, state, i, exp);
+					errors++;
+					break;
+				}
+				if (i < 0)
+					break;
+				i = statelist_idx_find_next(idx, i, state);
+				exp = linear_find(list, num, exp, type, state);
+			}
+		}
+	}
+
+	printf("%s: %u types, %u lookups, %u errors\n",
+	       name, idx->num_types, lookups, errors);
+}
+
+static void test_fixed(void *ctx)
+{
+	struct statelist_idx idx = { 0 };
+
+	STATELIST_IDX_INIT(ctx, &idx, fixedlist);
+	check_idx(__func__, &idx, fixedlist, ARRAY_SIZE(fixedlist));
+
+	printf("%s: first entry of type 5 in state 0: id %d\n", __func__,
+	       fixedlist[statelist_idx_find(&idx, 5, 0)].id);
+	printf("%s: first entry of type 7 in state 31: id %d\n", __func__,
+	       fixedlist[statelist_idx_find(&idx, 7, 31)].id);
+
+	statelist_idx_free(&idx);
+}
+
+static void test_random(void *ctx)
+{
+	struct statelist_idx idx = { 0 };
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(randlist); i++) {
+		randlist[i].type = prng() % 64 - 16;
+		randlist[i].states = (uint32_t)prng() << 17 ^ prng() << 2 ^ prng();
+		/* sparse states for some entries */
+		if (i % 3 == 0)
+			randlist[i].states &= randlist[i].states >> 7;
+		randlist[i].id = i;
+	}
+
+	STATELIST_IDX_INIT(ctx, &idx, randlist);
+	check_idx(__func__, &idx, randlist, ARRAY_SIZE(randlist));
+	statelist_idx_free(&idx);
+}
+
+/* Building twice is a no-op, the index can be built again after free */
+static void test_init_free(void *ctx)
+{
+	struct statelist_idx idx = { 0 };
+	struct statelist_row *rows;
+
+	STATELIST_IDX_INIT(ctx, &idx, fixedlist);
+	rows = idx.rows;
+	STATELIST_IDX_INIT(ctx, &idx, fixedlist);
+	printf("%s: second init is a no-op: %s\n", __func__,
+	       idx.rows == rows ? "yes" : "no");
+
+	statelist_idx_free(&idx);
+	printf("%s: blocks after free: %zu\n", __func__, talloc_total_blocks(ctx) - 1);
+
+	STATELIST_IDX_INIT(ctx, &idx, fixedlist);
+	check_idx(__func__, &idx, fixedlist, ARRAY_SIZE(fixedlist));
+	statelist_idx_free(&idx);
+}
+
+int main(int argc, char **argv)
+{
+	void *ctx = talloc_named_const(NULL, 0, "statelist_test");
+	void *idx_ctx = talloc_named_const(ctx, 0, "statelist_idx");
+
+	osmo_init_logging2(ctx, &log_info);
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	test_fixed(idx_ctx);
+	test_random(idx_ctx);
+	test_init_free(idx_ctx);
+
+	printf("blocks at exit: %zu\n", talloc_total_blocks(idx_ctx) - 1);
+	talloc_free(ctx);
+
+	return EXIT_SUCCESS;
+}
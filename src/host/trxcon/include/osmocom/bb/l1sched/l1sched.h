@@ -3,6 +3,7 @@
 #include <time.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include <arpa/inet.h>
 
@@ -13,6 +14,7 @@
 #include <osmocom/gsm/gsm0502.h>
 #include <osmocom/core/linuxlist.h>
 #include <osmocom/core/timer.h>
+#include <osmocom/core/rate_ctr.h>
 
 #include <osmocom/bb/l1sched/prim.h>
 
@@ -30,14 +32,24 @@
 #define L1SCHED_CH_FLAG_PDCH	(1 << 0)
 /* Should a channel be activated automatically */
 #define L1SCHED_CH_FLAG_AUTO	(1 << 1)
+/* Are Rx bursts stored in a ring buffer (see l1sched_lchan_rx_ring_*()) */
+#define L1SCHED_CH_FLAG_RX_RING	(1 << 2)
+
+/* Number of bursts kept in the Rx ring buffer of TCH/F and TCH/H */
+#define L1SCHED_RX_RING_LEN	24
 
 #define MAX_A5_KEY_LEN		(128 / 8)
+
+/* Max number of soft-bits in a decoding job (4 GMSK bursts) */
+#define L1SCHED_DEC_BURSTS_MAX	(4 * GSM_NBITS_NB_GMSK_PAYLOAD)
 #define TRX_TS_COUNT		8
 
 struct l1sched_lchan_state;
 struct l1sched_meas_set;
 struct l1sched_state;
 struct l1sched_ts;
+struct l1sched_decoder;
+struct l1sched_a5_cache;
 
 enum l1sched_burst_type {
 	L1SCHED_BURST_GMSK,
@@ -218,6 +230,10 @@ struct l1sched_lchan_state {
 	uint32_t tx_burst_mask;
 	/*! Burst buffer for RX */
 	sbit_t *rx_bursts;
+	/*! Index of the oldest burst in the Rx ring buffer */
+	uint8_t rx_bursts_head;
+	/*! Unique number assigned on activation (see l1sched_decoder_submit()) */
+	uint32_t gen;
 	/*! Burst buffer for TX */
 	ubit_t *tx_bursts;
 
@@ -296,12 +312,31 @@ struct l1sched_lchan_state {
 	struct l1sched_ts *ts;
 };
 
+/* Resolved lchan handlers for a TDMA frame of a timeslot */
+struct l1sched_ts_frame {
+	/*! Downlink lchan state (NULL if not active) */
+	struct l1sched_lchan_state *dl_lchan;
+	/*! Downlink handler (NULL if none) */
+	l1sched_lchan_rx_func *dl_handler;
+	/*! Downlink block ID */
+	uint8_t dl_bid;
+	/*! Uplink lchan state (NULL if not active) */
+	struct l1sched_lchan_state *ul_lchan;
+	/*! Uplink handler (NULL if none) */
+	l1sched_lchan_tx_func *ul_handler;
+	/*! Uplink block ID */
+	uint8_t ul_bid;
+};
+
 struct l1sched_ts {
 	/*! Timeslot index within a frame (0..7) */
 	uint8_t index;
 
 	/*! Pointer to multiframe layout */
 	const struct l1sched_tdma_multiframe *mf_layout;
+	/*! Frame dispatch table (indexed by fn % mf_layout->period),
+	 * rebuilt on lchan (de)activation by l1sched_ts_update_ftab() */
+	struct l1sched_ts_frame *ftab;
 	/*! Channel states for logical channels */
 	struct llist_head lchans;
 	/*! Backpointer to the scheduler */
@@ -312,6 +347,40 @@ struct l1sched_ts {
 struct l1sched_cfg {
 	/*! Logging context (used as prefix for messages) */
 	const char *log_prefix;
+	/*! Index of the rate counter group */
+	unsigned int ctr_idx;
+};
+
+/*! Rate counters of a scheduler instance */
+enum l1sched_ctr {
+	/*! Rx bursts older than the last processed one (dropped) */
+	L1SCHED_CTR_RX_BURST_LATE,
+	/*! Too many TDMA frames lost to substitute them */
+	L1SCHED_CTR_RX_FRAME_GAP,
+	/*! Lost TDMA frames substituted by dummy bursts */
+	L1SCHED_CTR_RX_FRAME_SUBST,
+	/*! CCCH blocks not received due to DRX */
+	L1SCHED_CTR_RX_DRX_SKIP,
+	/*! Decoding failures, one counter per lchan type */
+	L1SCHED_CTR_RX_DEC_FAIL,
+	_L1SCHED_CTR_MAX = L1SCHED_CTR_RX_DEC_FAIL + _L1SCHED_CHAN_MAX,
+};
+
+/*! Receive all CCCH blocks for this many TDMA frames after a RACH
+ * (26 multiframes of 51 frames, longer than T3126 which is at most 5 s) */
+#define L1SCHED_DRX_HOLD_FNS	(26 * 51)
+
+/*! DRX of the paging channel (see 3GPP TS 45.002, section 6.5) */
+struct l1sched_drx {
+	/*! BS_PA_MFRMS (2..9), 0 if DRX is disabled */
+	uint8_t bs_pa_mfrms;
+	/*! 51-multiframe containing the own paging block (0..BS_PA_MFRMS-1) */
+	uint8_t mf;
+	/*! Index of the own paging block within the CCCH blocks of TS0 */
+	uint8_t blk;
+	/*! Whether all CCCH blocks shall be received until hold_fn */
+	bool hold;
+	uint32_t hold_fn;
 };
 
 /*! One scheduler instance */
@@ -324,19 +393,61 @@ struct l1sched_state {
 	uint8_t bsic;
 	/*! Logging context (used as prefix for messages) */
 	const char *log_prefix;
+	/*! Decoder threads (optional, see l1sched_decoder_start()) */
+	struct l1sched_decoder *decoder;
+	/*! Generator of l1sched_lchan_state.gen */
+	uint32_t lchan_gen;
+	/*! Rate counters (see enum l1sched_ctr) */
+	struct rate_ctr_group *ctrs;
+	/*! A5/x keystream cache (see l1sched_a5_keystream()) */
+	struct l1sched_a5_cache *a5_cache;
+	/*! DRX state of the CCCH (see l1sched_set_drx()) */
+	struct l1sched_drx drx;
 	/*! Some private data */
 	void *priv;
 };
 
+/*! Increment a rate counter of the given scheduler instance */
+static inline void l1sched_ctr_inc(struct l1sched_state *sched, unsigned int idx)
+{
+	if (sched->ctrs != NULL)
+		rate_ctr_inc2(sched->ctrs, idx);
+}
+
 extern const struct l1sched_lchan_desc l1sched_lchan_desc[_L1SCHED_CHAN_MAX];
 const struct l1sched_tdma_multiframe *
 l1sched_mframe_layout(enum gsm_phys_chan_config config, uint8_t tn);
 
-/* Scheduler management functions */
+/* Scheduler management functions (alloc/free are not thread-safe, as they
+ * register/unregister rate counters in the libosmocore's global list) */
 struct l1sched_state *l1sched_alloc(void *ctx, const struct l1sched_cfg *cfg, void *priv);
 void l1sched_reset(struct l1sched_state *sched, bool reset_clock);
 void l1sched_free(struct l1sched_state *sched);
 
+/* DRX of the paging channel on TS0 */
+int l1sched_set_drx(struct l1sched_state *sched, uint8_t bs_pa_mfrms,
+		    uint8_t bs_ag_blks_res, uint8_t paging_group);
+void l1sched_drx_hold(struct l1sched_state *sched, uint32_t fn);
+
+/* A5/x keystream generation */
+const ubit_t *l1sched_a5_keystream(struct l1sched_lchan_state *lchan,
+				   uint32_t fn, bool ul);
+void l1sched_a5_cache_flush(struct l1sched_state *sched);
+
+/* Asynchronous channel decoding */
+enum l1sched_dec_kind {
+	L1SCHED_DEC_XCCH,
+	L1SCHED_DEC_PDTCH,
+};
+
+int l1sched_decoder_start(struct l1sched_state *sched, unsigned int num);
+void l1sched_decoder_stop(struct l1sched_state *sched);
+void l1sched_decoder_poll(struct l1sched_state *sched);
+void l1sched_decoder_flush(struct l1sched_state *sched);
+int l1sched_decoder_submit(struct l1sched_lchan_state *lchan,
+			   enum l1sched_dec_kind kind,
+			   const sbit_t *bursts, size_t len);
+
 /* Timeslot management functions */
 struct l1sched_ts *l1sched_add_ts(struct l1sched_state *sched, int tn);
 void l1sched_del_ts(struct l1sched_state *sched, int tn);
@@ -349,6 +460,7 @@ int l1sched_start_ciphering(struct l1sched_ts *ts, uint8_t algo,
 /* Logical channel management functions */
 enum gsm_phys_chan_config l1sched_chan_nr2pchan_config(uint8_t chan_nr);
 
+void l1sched_ts_update_ftab(struct l1sched_ts *ts);
 void l1sched_deactivate_all_lchans(struct l1sched_ts *ts);
 int l1sched_set_lchans(struct l1sched_ts *ts, uint8_t chan_nr,
 		       int active, uint8_t tch_mode, uint8_t tsc);
@@ -388,8 +500,29 @@ int l1sched_handle_burst_req(struct l1sched_state *sched,
 /* Shared declarations for lchan handlers */
 extern const uint8_t l1sched_nb_training_bits[8][26];
 
+void l1sched_sch_burst_encode(sbit_t *burst, uint32_t fn, uint8_t bsic);
+
 const char *l1sched_burst_mask2str(const uint32_t *mask, int bits);
 
+/*! Copy 116 payload bits of a GMSK Normal Burst, skipping tail bits,
+ *  stealing flags and the training sequence.  Kept inline, so that
+ *  the fixed-size copies are expanded into a few vector moves. */
+static inline void l1sched_nb_payload_copy(sbit_t *dst, const sbit_t *burst)
+{
+	memcpy(&dst[0], &burst[3], 58);
+	memcpy(&dst[58], &burst[87], 58);
+}
+
+/* Rx ring buffer of TCH/F and TCH/H */
+sbit_t *l1sched_lchan_rx_ring_pos(const struct l1sched_lchan_state *lchan,
+				  unsigned int n);
+void l1sched_lchan_rx_ring_advance(struct l1sched_lchan_state *lchan,
+				   unsigned int n);
+void l1sched_lchan_rx_ring_store(struct l1sched_lchan_state *lchan,
+				 unsigned int n, const sbit_t *burst);
+void l1sched_lchan_rx_ring_erase(struct l1sched_lchan_state *lchan,
+				 unsigned int n);
+
 /* Measurement history */
 void l1sched_lchan_meas_push(struct l1sched_lchan_state *lchan,
 			     const struct l1sched_burst_ind *bi);
@@ -108,6 +108,15 @@ struct l1sched_prim {
 
 struct l1sched_state;
 struct l1sched_lchan_state;
+struct l1sched_meas_set;
+
+/* Size of msgbs kept in the pool, see l1sched_msgb_alloc().  The headroom
+ * of primitives is large enough to hold an L1CTL header in front of the
+ * L2 payload, so that a DATA.ind can be turned into L1CTL in-place. */
+#define L1SCHED_MSGB_SIZE	576
+
+struct msgb *l1sched_msgb_alloc(uint16_t size, uint16_t headroom, const char *name);
+void l1sched_msgb_pool_drain(void);
 
 void l1sched_prim_init(struct msgb *msg,
 		       enum l1sched_prim_type type,
@@ -125,6 +134,10 @@ struct msgb *l1sched_lchan_prim_dummy_lapdm(const struct l1sched_lchan_state *lc
 int l1sched_lchan_emit_data_ind(struct l1sched_lchan_state *lchan,
 				const uint8_t *data, size_t data_len,
 				int n_errors, int n_bits_total, bool traffic);
+int l1sched_lchan_emit_data_ind_meas(struct l1sched_lchan_state *lchan,
+				     const struct l1sched_meas_set *meas,
+				     const uint8_t *data, size_t data_len,
+				     int n_errors, int n_bits_total, bool traffic);
 int l1sched_lchan_emit_data_cnf(struct l1sched_lchan_state *lchan,
 				struct msgb *msg, uint32_t fn);
 
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <osmocom/core/gsmtap.h>
+
+/* Asynchronous GSMTAP export: messages are copied to a bounded ring buffer
+ * and sent (or written to a pcap file) by a separate thread, so that the
+ * caller never blocks on a syscall.  If the ring buffer is full, new
+ * messages are dropped (and counted).  Any thread may send messages.
+ *
+ * Also used by layer23, see src/common/Makefile.am there. */
+
+/* Default number of messages in the ring buffer */
+#define GSMTAP_EXPORT_RING_SIZE		2048
+/* Max length of the payload of a message (larger ones are dropped) */
+#define GSMTAP_EXPORT_PAYLOAD_MAX	512
+
+struct gsmtap_export;
+
+struct gsmtap_export_cfg {
+	/* UDP socket to send messages to, e.g. gsmtap_inst_fd2(), or -1 */
+	int fd;
+	/* pcap file to write messages to instead (optional) */
+	const char *pcap_path;
+	/* number of messages in the ring buffer (rounded up to a power of 2) */
+	unsigned int ring_size;
+};
+
+struct gsmtap_export *gsmtap_export_alloc(void *ctx, const struct gsmtap_export_cfg *cfg);
+void gsmtap_export_free(struct gsmtap_export *exp);
+
+int gsmtap_export_send_ex(struct gsmtap_export *exp, uint8_t type,
+			  uint16_t arfcn, uint8_t ts, uint8_t chan_type,
+			  uint8_t ss, uint32_t fn, int8_t signal_dbm,
+			  int8_t snr, const uint8_t *data, unsigned int len);
+
+/*! Same as gsmtap_send(), but asynchronous (see above) */
+static inline int gsmtap_export_send(struct gsmtap_export *exp,
+				     uint16_t arfcn, uint8_t ts, uint8_t chan_type,
+				     uint8_t ss, uint32_t fn, int8_t signal_dbm,
+				     int8_t snr, const uint8_t *data, unsigned int len)
+{
+	return gsmtap_export_send_ex(exp, GSMTAP_TYPE_UM, arfcn, ts,
+				     chan_type, ss, fn, signal_dbm, snr, data, len);
+}
+
+void gsmtap_export_dump(struct gsmtap_export *exp, FILE *out);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <osmocom/core/write_queue.h>
+#include <osmocom/core/msgb.h>
+
+/* L1CTL messages are sent over a stream socket, each one prefixed
+ * by its length (2 octets, big endian).  The reader below fetches as
+ * much as is available with a single read() call and then extracts all
+ * complete messages, keeping a partial one (if any) for the next call.
+ *
+ * Also used by layer23, see src/common/Makefile.am there. */
+
+/* Length of the length prefix */
+#define L1CTL_FRAMING_LEN_FIELD		2
+/* Size of the receive buffer (must fit at least one message) */
+#define L1CTL_FRAMING_BUF_SIZE		4096
+/* Max number of messages written with a single writev() call */
+#define L1CTL_FRAMING_TX_BATCH		16
+
+struct l1ctl_framing_rx {
+	/* max length of a message (excluding the length prefix) */
+	uint16_t max_len;
+	/* offset of the first unprocessed octet in buf[] */
+	unsigned int pos;
+	/* number of octets in buf[] */
+	unsigned int len;
+	uint8_t buf[L1CTL_FRAMING_BUF_SIZE];
+};
+
+void l1ctl_framing_rx_init(struct l1ctl_framing_rx *rx, uint16_t max_len);
+int l1ctl_framing_rx_fill(struct l1ctl_framing_rx *rx, int fd);
+int l1ctl_framing_rx_pop(struct l1ctl_framing_rx *rx, const uint8_t **data);
+
+int l1ctl_framing_tx(struct osmo_wqueue *wq, struct msgb *msg);
@@ -1,12 +1,16 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
 
 #include <osmocom/core/write_queue.h>
 #include <osmocom/core/select.h>
 #include <osmocom/core/timer.h>
 #include <osmocom/core/msgb.h>
 
+#include <osmocom/bb/trxcon/l1ctl_framing.h>
+
 #define L1CTL_LENGTH 512
 #define L1CTL_HEADROOM 32
 
@@ -14,12 +18,15 @@
  * Each L1CTL message gets its own length pushed
  * as two bytes in front before sending.
  */
-#define L1CTL_MSG_LEN_FIELD 2
+#define L1CTL_MSG_LEN_FIELD L1CTL_FRAMING_LEN_FIELD
 
+struct l1ctl_server;
 struct l1ctl_client;
+struct osmo_stat_item_group;
 
 typedef int l1ctl_conn_data_func(struct l1ctl_client *, struct msgb *);
 typedef void l1ctl_conn_state_func(struct l1ctl_client *);
+typedef int l1ctl_conn_fd_func(struct l1ctl_server *, int fd);
 
 struct l1ctl_server_cfg {
 	/* UNIX socket path to listen on */
@@ -30,6 +37,9 @@ struct l1ctl_server_cfg {
 	l1ctl_conn_data_func *conn_read_cb;	/* mandatory */
 	l1ctl_conn_state_func *conn_accept_cb;	/* optional */
 	l1ctl_conn_state_func *conn_close_cb;	/* optional */
+	/* hand over an accepted connection to another thread, which shall
+	 * then call l1ctl_server_conn_open() on its own (optional) */
+	l1ctl_conn_fd_func *conn_dispatch_cb;
 };
 
 struct l1ctl_server {
@@ -43,6 +53,8 @@ struct l1ctl_server {
 	struct osmo_fd ofd;
 	/* server configuration */
 	const struct l1ctl_server_cfg *cfg;
+	/* protects the list of clients and counters above */
+	pthread_mutex_t lock;
 };
 
 struct l1ctl_client {
@@ -52,16 +64,25 @@ struct l1ctl_client {
 	struct l1ctl_server *server;
 	/* client's write queue */
 	struct osmo_wqueue wq;
+	/* client's receive buffer */
+	struct l1ctl_framing_rx rx;
+	/* set (if not NULL) when the connection gets closed */
+	bool *closed;
+	/* stat items (may be NULL), see enum l1ctl_client_stat */
+	struct osmo_stat_item_group *statg;
 	/* logging context (used as prefix for messages) */
 	const char *log_prefix;
 	/* unique client ID */
 	unsigned int id;
+	/* thread serving this client */
+	pthread_t thread;
 	/* some private data */
 	void *priv;
 };
 
 struct l1ctl_server *l1ctl_server_alloc(void *ctx, const struct l1ctl_server_cfg *cfg);
 void l1ctl_server_free(struct l1ctl_server *server);
+int l1ctl_server_conn_open(struct l1ctl_server *server, void *ctx, int fd);
 
 int l1ctl_client_send(struct l1ctl_client *client, struct msgb *msg);
 void l1ctl_client_conn_close(struct l1ctl_client *client);
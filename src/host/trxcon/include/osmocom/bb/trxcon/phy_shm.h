@@ -0,0 +1,222 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include <osmocom/core/select.h>
+#include <osmocom/core/fsm.h>
+
+#include <osmocom/bb/trxcon/phyif.h>
+
+/* Shared memory PHY interface for a transceiver running on the same host.
+ *
+ * The transceiver listens on a UNIX domain socket (SOCK_SEQPACKET).  For each
+ * connection it sends a struct phy_shm_hello together with three descriptors
+ * (SCM_RIGHTS): a memfd holding struct phy_shm_seg, and two eventfds used for
+ * wakeups in both directions.  The connection is kept open for the lifetime of
+ * the session, so that either side notices when the other one goes away.
+ *
+ * Bursts and commands are passed through single-producer single-consumer
+ * rings in the shared segment.  The producer writes an eventfd after filling
+ * a batch of slots, the consumer drains its rings on wakeup. */
+
+#define PHY_SHM_MAGIC		0x4f534d50 /* "OSMP" */
+#define PHY_SHM_VERSION		1
+
+/* Default path of the transceiver's socket */
+#define PHY_SHM_SOCK_PATH	"/tmp/osmocom_phy_shm"
+
+/* Number of slots in a burst ring (power of 2): 16 frames of 8 timeslots */
+#define PHY_SHM_BURST_RING_LEN	128
+/* Number of slots in a control ring (power of 2) */
+#define PHY_SHM_CTRL_RING_LEN	16
+
+/* Max length of a burst (8-PSK), in bits */
+#define PHY_SHM_BURST_LEN_MAX	444
+/* Max length of a Mobile Allocation */
+#define PHY_SHM_MA_LEN_MAX	64
+/* Max number of ARFCNs in a measurement response */
+#define PHY_SHM_MEAS_MAX	64
+
+/* The cacheline size assumed for the ring indices */
+#define PHY_SHM_CACHELINE	64
+
+/*! Single-producer single-consumer ring.  The indices are free-running,
+ *  the producer owns 'head' and the consumer owns 'tail'. */
+struct phy_shm_ring {
+	_Alignas(PHY_SHM_CACHELINE) _Atomic uint32_t head;
+	_Alignas(PHY_SHM_CACHELINE) _Atomic uint32_t tail;
+};
+
+/* BURST.ind (transceiver -> trxcon) or BURST.req (trxcon -> transceiver) */
+struct phy_shm_burst {
+	uint32_t fn;
+	uint8_t tn;
+	/* BURST.req: Tx power attenuation */
+	uint8_t pwr;
+	/* BURST.ind: see TRXCON_PHYIF_BI_F_* and enum trxcon_phyif_mod_type */
+	uint8_t flags;
+	uint8_t mod;
+	uint8_t tsc_set;
+	uint8_t tsc;
+	int8_t rssi;
+	int16_t toa256;
+	int16_t ci_cb;
+	/* 0 means NOPE.ind / NOPE.req */
+	uint16_t burst_len;
+	/* BURST.ind: soft-bits (sbit_t), BURST.req: hard-bits (ubit_t) */
+	int8_t burst[PHY_SHM_BURST_LEN_MAX];
+};
+
+/* Command (trxcon -> transceiver) or response (transceiver -> trxcon) */
+struct phy_shm_ctrl {
+	uint8_t type; /* enum trxcon_phyif_cmd_type */
+	/* response: 0 on success, negative errno otherwise */
+	int8_t status;
+	union {
+		struct {
+			uint16_t band_arfcn;
+		} setfreq_h0;
+		struct {
+			uint8_t hsn;
+			uint8_t maio;
+			uint16_t ma_len;
+			uint16_t ma[PHY_SHM_MA_LEN_MAX];
+		} setfreq_h1;
+		struct {
+			uint8_t tn;
+			uint8_t pchan;
+		} setslot;
+		struct {
+			int8_t ta;
+		} setta;
+		struct {
+			uint16_t band_arfcn;
+			uint16_t band_arfcn_stop;
+		} measure;
+		/* response: the first ARFCN, the others follow in ascending
+		 * order; a range may be reported in several responses */
+		struct {
+			uint16_t band_arfcn;
+			uint16_t num;
+			int16_t dbm[PHY_SHM_MEAS_MAX];
+		} measure_rsp;
+	} param;
+};
+
+/*! Layout of the shared memory segment */
+struct phy_shm_seg {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+
+	struct phy_shm_ring dl; /* BURST.ind */
+	struct phy_shm_ring ul; /* BURST.req */
+	struct phy_shm_ring cmd;
+	struct phy_shm_ring rsp;
+
+	struct phy_shm_burst dl_slots[PHY_SHM_BURST_RING_LEN];
+	struct phy_shm_burst ul_slots[PHY_SHM_BURST_RING_LEN];
+	struct phy_shm_ctrl cmd_slots[PHY_SHM_CTRL_RING_LEN];
+	struct phy_shm_ctrl rsp_slots[PHY_SHM_CTRL_RING_LEN];
+};
+
+/* Sent by the transceiver along with the descriptors */
+struct phy_shm_hello {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t seg_size;
+};
+
+/* Order of the descriptors passed with struct phy_shm_hello */
+enum phy_shm_hello_fd {
+	PHY_SHM_FD_SEG,
+	PHY_SHM_FD_TO_TRXCON,	/* written by the transceiver */
+	PHY_SHM_FD_TO_PHY,	/* written by trxcon */
+	_PHY_SHM_FD_NUM
+};
+
+/*! Get the index of a free slot in a ring.
+ *  \param[in] r  the ring (producer side).
+ *  \param[in] len  number of slots in the ring (power of 2).
+ *  \returns index of the slot, or -1 if the ring is full. */
+static inline int phy_shm_ring_write_idx(struct phy_shm_ring *r, uint32_t len)
+{
+	uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+	if (head - tail >= len)
+		return -1;
+	return head & (len - 1);
+}
+
+/*! Publish the slot returned by phy_shm_ring_write_idx() */
+static inline void phy_shm_ring_write_done(struct phy_shm_ring *r)
+{
+	uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+	atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+/*! Get the index of the oldest filled slot in a ring.
+ *  \param[in] r  the ring (consumer side).
+ *  \param[in] len  number of slots in the ring (power of 2).
+ *  \returns index of the slot, or -1 if the ring is empty. */
+static inline int phy_shm_ring_read_idx(struct phy_shm_ring *r, uint32_t len)
+{
+	uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+
+	if (head == tail)
+		return -1;
+	return tail & (len - 1);
+}
+
+/*! Release the slot returned by phy_shm_ring_read_idx() */
+static inline void phy_shm_ring_read_done(struct phy_shm_ring *r)
+{
+	uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+	atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+}
+
+struct phy_shm {
+	/* connection to the transceiver (liveness only) */
+	struct osmo_fd sock_ofd;
+	/* wakeups from the transceiver */
+	struct osmo_fd efd_ofd;
+	/* wakeups to the transceiver */
+	int efd_tx;
+	/* something was queued for the transceiver */
+	bool tx_pending;
+	/* the rings are being drained (wakeups are deferred) */
+	bool rx_active;
+
+	struct phy_shm_seg *seg;
+	uint32_t seg_size;
+
+	uint32_t fn_advance;
+	bool powered_up;
+
+	struct osmo_fsm_inst *parent_fi;
+	uint32_t parent_term_event;
+	/* Some private data */
+	void *priv;
+};
+
+struct phy_shm_params {
+	const char *sock_path;
+	uint32_t fn_advance;
+	uint8_t instance;
+
+	struct osmo_fsm_inst *parent_fi;
+	uint32_t parent_term_event;
+	void *priv;
+};
+
+struct phy_shm *phy_shm_open(const struct phy_shm_params *params);
+void phy_shm_close(struct phy_shm *shm);
+
+int phy_shm_handle_phyif_burst_req(struct phy_shm *shm, const struct trxcon_phyif_burst_req *br);
+int phy_shm_handle_phyif_cmd(struct phy_shm *shm, const struct trxcon_phyif_cmd *cmd);
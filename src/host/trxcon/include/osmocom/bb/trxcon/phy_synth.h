@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/fsm.h>
+
+#include <osmocom/bb/trxcon/phyif.h>
+
+/* Synthetic PHY: a built-in cell for testing trxcon without a transceiver.
+ *
+ * Timeslot 0 of the cell carries FCCH, SCH, BCCH and CCCH (not combined),
+ * the BCCH carries the configured System Information, the CCCH carries
+ * empty Paging Requests.  Optionally, Uplink bursts on timeslots 1..7 are
+ * looped back as Downlink bursts of the same TDMA frame (SDCCH/TCH echo).
+ *
+ * All instances share one cell and one clock, each instance (MS) is clocked
+ * by a timer in the thread serving it. */
+
+/* Max number of ARFCNs in a measurement response */
+#define PHY_SYNTH_MEAS_MAX	64
+/* Uplink bursts are kept for this many TDMA frames ahead (power of 2) */
+#define PHY_SYNTH_ECHO_FRAMES	16
+
+struct phy_synth_echo {
+	uint32_t fn;
+	bool valid;
+	sbit_t burst[148];
+};
+
+struct phy_synth {
+	/* TDMA clock, see phy_synth_clock_cb() */
+	struct osmo_timer_list clock_timer;
+	/* number of TDMA frames generated since the clock's epoch */
+	uint64_t frame;
+	bool powered_up;
+	/* tuned to the cell's ARFCN */
+	bool tuned;
+
+	/* Power measurement of a range of ARFCNs */
+	struct {
+		struct osmo_timer_list timer;
+		uint16_t band_arfcn;
+		uint16_t band_arfcn_stop;
+	} meas;
+
+	/* Uplink bursts to be looped back (optional) */
+	struct phy_synth_echo (*echo)[PHY_SYNTH_ECHO_FRAMES];
+
+	uint32_t fn_advance;
+	/* 1 is real-time, N is N times faster, 0 is as fast as possible */
+	unsigned int speed;
+
+	/* Statistics, reported on close */
+	uint64_t num_frames;
+	uint64_t num_frames_skipped;
+	uint64_t num_ul_bursts;
+	uint64_t num_ul_late;
+	uint32_t max_lag;
+
+	struct osmo_fsm_inst *parent_fi;
+	/* Some private data */
+	void *priv;
+};
+
+struct phy_synth_params {
+	uint16_t band_arfcn;
+	uint8_t bsic;
+	/* 1 is real-time, N is N times faster, 0 is as fast as possible */
+	unsigned int speed;
+	/* loop Uplink bursts on timeslots 1..7 back */
+	bool echo;
+	/* System Information: hex-encoded messages, one per line (optional) */
+	const char *si_path;
+
+	uint32_t fn_advance;
+	uint8_t instance;
+
+	struct osmo_fsm_inst *parent_fi;
+	void *priv;
+};
+
+struct phy_synth *phy_synth_open(const struct phy_synth_params *params);
+void phy_synth_close(struct phy_synth *syn);
+
+int phy_synth_handle_phyif_burst_req(struct phy_synth *syn, const struct trxcon_phyif_burst_req *br);
+int phy_synth_handle_phyif_cmd(struct phy_synth *syn, const struct trxcon_phyif_cmd *cmd);
@@ -43,12 +43,17 @@ struct trxcon_phyif_cmdp_setta {
 /* param of TRXCON_PHYIF_CMDT_MEASURE (command) */
 struct trxcon_phyif_cmdp_measure {
 	uint16_t band_arfcn;
+	/* the last ARFCN of a range to measure (optional, inclusive) */
+	uint16_t band_arfcn_stop;
 };
 
 /* param of TRXCON_PHYIF_CMDT_MEASURE (response) */
 struct trxcon_phyif_rspp_measure {
+	/* the first ARFCN, the others follow in ascending order */
 	uint16_t band_arfcn;
-	int dbm;
+	/* measurement results, one per ARFCN */
+	const int *dbm;
+	unsigned int num;
 };
 
 struct trxcon_phyif_cmd {
@@ -98,12 +103,32 @@ struct trxcon_phyif_burst_req {
 	unsigned int burst_len;
 };
 
+/* Modulation type of a received burst (see 3GPP TS 45.002) */
+enum trxcon_phyif_mod_type {
+	TRXCON_PHYIF_MOD_GMSK,
+	TRXCON_PHYIF_MOD_8PSK,
+	TRXCON_PHYIF_MOD_GMSK_AB,
+	TRXCON_PHYIF_MOD_AQPSK,
+	TRXCON_PHYIF_MOD_16QAM,
+	TRXCON_PHYIF_MOD_32QAM,
+};
+
+/* Modulation, TSC set and TSC are present */
+#define TRXCON_PHYIF_BI_F_MTS		(1 << 0)
+/* C/I (Carrier-to-Interference ratio) is present */
+#define TRXCON_PHYIF_BI_F_CI_CB		(1 << 1)
+
 /* BURST.ind - a received burst */
 struct trxcon_phyif_burst_ind {
 	uint32_t fn;
 	uint8_t tn;
 	int16_t toa256;
 	int8_t rssi;
+	uint32_t flags; /* see TRXCON_PHYIF_BI_F_* above */
+	enum trxcon_phyif_mod_type mod;
+	uint8_t tsc_set;
+	uint8_t tsc;
+	int16_t ci_cb; /* in centiBels */
 	const sbit_t *burst;
 	unsigned int burst_len;
 };
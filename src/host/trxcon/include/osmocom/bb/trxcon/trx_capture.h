@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* Capture file format (all integers are big endian):
+ *
+ *   File header (8 bytes):
+ *     6 bytes magic "TRXCAP", 1 byte format version, 1 byte spare
+ *
+ *   Record header (8 bytes), followed by the raw message:
+ *     1 byte record type (see enum trx_capture_rec_type)
+ *     1 byte spare
+ *     2 bytes message length
+ *     4 bytes time elapsed since the previous record, in us
+ */
+#define TRX_CAPTURE_MAGIC	"TRXCAP"
+#define TRX_CAPTURE_VERSION	0
+
+/* Max length of a captured message */
+#define TRX_CAPTURE_MSG_MAX	4096
+
+enum trx_capture_rec_type {
+	TRX_CAPTURE_TRXC_TX	= 0,	/* CMD sent to the transceiver */
+	TRX_CAPTURE_TRXC_RX	= 1,	/* RSP/IND received from the transceiver */
+	TRX_CAPTURE_TRXD_TX	= 2,	/* Uplink TRXD message */
+	TRX_CAPTURE_TRXD_RX	= 3,	/* Downlink TRXD message (raw soft-bits) */
+};
+
+struct trx_capture_rec {
+	enum trx_capture_rec_type type;
+	/* time elapsed since the beginning of capture, in us */
+	uint64_t time_us;
+	size_t len;
+	uint8_t buf[TRX_CAPTURE_MSG_MAX];
+};
+
+struct trx_capture;
+
+struct trx_capture *trx_capture_open(void *ctx, const char *path, bool write);
+void trx_capture_close(struct trx_capture *cap);
+
+int trx_capture_write(struct trx_capture *cap, enum trx_capture_rec_type type,
+		      const uint8_t *buf, size_t len);
+int trx_capture_read(struct trx_capture *cap, struct trx_capture_rec *rec);
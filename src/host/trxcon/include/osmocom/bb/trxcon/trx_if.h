@@ -8,7 +8,24 @@
 #include <osmocom/bb/trxcon/phyif.h>
 
 #define TRXC_BUF_SIZE	1024
-#define TRXD_BUF_SIZE	512
+/* Enough to hold a TRXDv2 batch of 8 (8-PSK) bursts */
+#define TRXD_BUF_SIZE	4096
+
+/* Max number of TRXD messages per recvmmsg() / sendmmsg() call */
+#define TRXD_MMSG_VLEN		16
+
+/* Highest TRXD PDU version we support */
+#define TRXD_PDU_VER_MAX	2
+
+/* Default max number of TRXC commands waiting for response */
+#define TRXC_WINDOW_DEFAULT	4
+
+/* Max number of ARFCNs measured by one MEASRANGE command */
+#define TRXC_MEASRANGE_MAX	64
+
+struct trx_data_mmsg;
+struct trx_capture;
+struct rate_ctr_group;
 
 enum trx_fsm_states {
 	TRX_STATE_OFFLINE = 0,
@@ -21,11 +38,77 @@ struct trx_instance {
 	struct osmo_fd trx_ofd_ctrl;
 	struct osmo_fd trx_ofd_data;
 
-	struct osmo_timer_list trx_ctrl_timer;
+	/* TRXC commands: sent ones (waiting for response) come first */
 	struct llist_head trx_ctrl_list;
+	/* max number of sent commands waiting for response */
+	unsigned int trx_ctrl_window;
 	struct osmo_fsm_inst *fi;
 	uint32_t fn_advance;
 
+	/* TRXD PDU version: the highest one we ask for, the negotiated one */
+	uint8_t trxd_pdu_ver_req;
+	uint8_t trxd_pdu_ver_use;
+
+	/* TRXDv2: Tx PDUs for the same TDMA frame are batched together */
+	struct {
+		uint8_t buf[TRXD_BUF_SIZE];
+		/* offset of the last PDU in buf[] (to set its BATCH flag) */
+		size_t last_pdu;
+		size_t len;
+		uint32_t fn;
+		bool active;
+	} tx_batch;
+
+	/* Batched TRXD I/O state (optional) */
+	struct trx_data_mmsg *mmsg;
+	/* Capturing of TRXC/TRXD messages (optional) */
+	struct trx_capture *capture;
+
+	/* Power measurement of a range of ARFCNs (see trx_if_cmd_measure()) */
+	struct {
+		/* the next ARFCN to be measured, the last one */
+		uint16_t band_arfcn;
+		uint16_t band_arfcn_stop;
+		bool active;
+		/* the transceiver does not support MEASRANGE */
+		bool range_unsupported;
+	} meas;
+
+	/* Rate counters (may be NULL), see enum trx_if_ctr */
+	struct rate_ctr_group *ctrs;
+	/* CLOCK_MONOTONIC time of reception of the TRXD message being handled */
+	uint64_t rx_time_ns;
+	/* Tx latency is measured while handling an RTS.ind */
+	bool rts_pending;
+
+	/* Adaptive TDMA frame advance (optional), see trx_fn_adv_rx() */
+	struct {
+		bool enabled;
+		/* bounds of trx->fn_advance */
+		uint32_t min;
+		uint32_t max;
+		/* reference point of the transceiver's clock */
+		uint32_t ref_fn;
+		uint64_t ref_ns;
+		bool ref_valid;
+		/* earliest delivery of a DL burst: in the previous window,
+		 * and in the current one (ns, relative to the reference) */
+		int64_t base_ns;
+		int64_t win_min_ns;
+		/* delivery delay of the DL burst being handled */
+		uint64_t late_ns;
+		/* current window: start, max consumption of the budget */
+		uint64_t win_start_ns;
+		uint64_t win_max_ns;
+		/* number of windows in a row allowing a smaller advance */
+		unsigned int calm_windows;
+		/* time of the last increase */
+		uint64_t inc_ns;
+		/* the last TDMA frame an RTS.ind was sent for (per timeslot) */
+		uint32_t rts_fn[8];
+		uint8_t rts_valid;
+	} fn_adv;
+
 	/* HACK: we need proper state machines */
 	uint32_t prev_state;
 	bool powered_up;
@@ -36,10 +119,16 @@ struct trx_instance {
 
 struct trx_ctrl_msg {
 	struct llist_head list;
+	struct trx_instance *trx;
+	/* response timeout (per command) */
+	struct osmo_timer_list timer;
 	char cmd[TRXC_BUF_SIZE];
 	int retry_cnt;
 	int critical;
 	int cmd_len;
+	/* nothing else is sent while this command is waiting for response */
+	bool barrier;
+	bool sent;
 };
 
 struct trx_if_params {
@@ -47,7 +136,15 @@ struct trx_if_params {
 	const char *remote_host;
 	uint16_t base_port;
 	uint32_t fn_advance;
+	/* adaptive fn_advance within these bounds (disabled if equal) */
+	uint32_t fn_advance_min;
+	uint32_t fn_advance_max;
+	uint8_t trxd_pdu_ver;
+	bool trxd_mmsg;
+	unsigned int trxc_window;
 	uint8_t instance;
+	/* capture TRXC/TRXD messages to this file (optional) */
+	const char *capture_path;
 
 	struct osmo_fsm_inst *parent_fi;
 	uint32_t parent_term_event;
@@ -55,7 +152,10 @@ struct trx_if_params {
 };
 
 struct trx_instance *trx_if_open(const struct trx_if_params *params);
+void trx_if_thread_init(void);
 void trx_if_close(struct trx_instance *trx);
 
 int trx_if_handle_phyif_burst_req(struct trx_instance *trx, const struct trxcon_phyif_burst_req *br);
 int trx_if_handle_phyif_cmd(struct trx_instance *trx, const struct trxcon_phyif_cmd *cmd);
+
+void trx_if_conv_soft_bits(sbit_t *out, const uint8_t *in, size_t len);
@@ -14,8 +14,8 @@ struct trxcon_inst {
 	/* Logging context for sched and l1c */
 	const char *log_prefix;
 
-	/* GSMTAP instance (optional) */
-	struct gsmtap_inst *gsmtap;
+	/* GSMTAP export (optional) */
+	struct gsmtap_export *gsmtap;
 
 	/* The L1 scheduler */
 	struct l1sched_state *sched;
@@ -5,7 +5,9 @@
 
 #include <osmocom/core/fsm.h>
 
-extern struct osmo_fsm trxcon_fsm_def;
+extern __thread struct osmo_fsm trxcon_fsm_def;
+
+void trxcon_fsm_thread_init(void);
 
 enum trxcon_fsm_states {
 	TRXCON_ST_RESET,
@@ -50,8 +52,10 @@ struct trxcon_param_full_power_scan_req {
 
 /* param of TRXCON_EV_FULL_POWER_SCAN_RES */
 struct trxcon_param_full_power_scan_res {
+	/* the first ARFCN, the others follow in ascending order */
 	uint16_t band_arfcn;
-	int dbm;
+	const int *dbm;
+	unsigned int num;
 };
 
 /* param of TRXCON_EV_FBSB_SEARCH_REQ */
@@ -68,6 +72,12 @@ struct trxcon_param_set_ccch_tch_mode_req {
 		uint8_t start_codec;
 		uint8_t codecs_bitmask;
 	} amr;
+	/* CCCH only: DRX parameters (bs_pa_mfrms=0 disables DRX) */
+	struct {
+		uint8_t bs_pa_mfrms;
+		uint8_t bs_ag_blks_res;
+		uint8_t paging_group;
+	} drx;
 	bool applied;
 };
 
@@ -122,6 +132,9 @@ struct trxcon_param_rx_data_ind {
 	int n_bits_total;
 	size_t data_len;
 	const uint8_t *data;
+	/* (optional) msgb holding the data at l2h, which may be reused in order
+	 * to avoid copying; a consumer taking its ownership sets this to NULL */
+	struct msgb *msg;
 };
 
 /* param of TRXCON_EV_TX_ACCESS_BURST_REQ */
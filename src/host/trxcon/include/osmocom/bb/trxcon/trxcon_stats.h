@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdio.h>
+
+/* Rate counter and stat item groups are kept by libosmocore in global lists,
+ * which are not thread-safe.  Allocation and freeing of groups (as well as
+ * iterating over them) shall be done with this lock held. */
+void trxcon_stats_lock(void);
+void trxcon_stats_unlock(void);
+
+void trxcon_stats_dump(FILE *out);
@@ -0,0 +1,15 @@
+#pragma once
+
+struct l1ctl_server;
+
+struct trxcon_worker_cfg {
+	/* number of worker threads */
+	unsigned int num_workers;
+	/* the L1CTL server accepting connections in the main thread */
+	struct l1ctl_server *server;
+};
+
+int trxcon_workers_start(void *ctx, const struct trxcon_worker_cfg *cfg);
+void trxcon_workers_stop(void);
+
+int trxcon_workers_dispatch(struct l1ctl_server *server, int fd);
@@ -0,0 +1,448 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * Asynchronous GSMTAP export (UDP or pcap file)
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/gsmtap.h>
+
+#include <osmocom/bb/trxcon/gsmtap_export.h>
+
+/* Max number of messages sent by one sendmmsg() call */
+#define GSMTAP_EXPORT_BATCH	64
+
+/* pcap file format, messages are wrapped into IPv4/UDP headers,
+ * so that Wireshark dissects them as GSMTAP (by the UDP port) */
+#define PCAP_MAGIC		0xa1b2c3d4
+#define PCAP_LINKTYPE_IPV4	228
+
+struct pcap_file_hdr {
+	uint32_t magic;
+	uint16_t version_major;
+	uint16_t version_minor;
+	int32_t thiszone;
+	uint32_t sigfigs;
+	uint32_t snaplen;
+	uint32_t linktype;
+} __attribute__((packed));
+
+struct pcap_rec_hdr {
+	uint32_t ts_sec;
+	uint32_t ts_usec;
+	uint32_t incl_len;
+	uint32_t orig_len;
+	/* IPv4 header */
+	uint8_t ip_vhl;
+	uint8_t ip_tos;
+	uint16_t ip_len;
+	uint16_t ip_id;
+	uint16_t ip_off;
+	uint8_t ip_ttl;
+	uint8_t ip_proto;
+	uint16_t ip_sum;
+	uint32_t ip_src;
+	uint32_t ip_dst;
+	/* UDP header */
+	uint16_t udp_sport;
+	uint16_t udp_dport;
+	uint16_t udp_len;
+	uint16_t udp_sum;
+} __attribute__((packed));
+
+#define PCAP_REC_IP_OFFSET	16
+
+struct gsmtap_export_msg {
+	/* wall clock time of the message (pcap only) */
+	struct timespec time;
+	/* length of the GSMTAP header and the payload */
+	uint16_t len;
+	uint8_t buf[sizeof(struct gsmtap_hdr) + GSMTAP_EXPORT_PAYLOAD_MAX];
+};
+
+struct gsmtap_export {
+	/* Ring buffer of messages (mask + 1 entries) */
+	struct gsmtap_export_msg *ring;
+	unsigned int mask;
+	/* Written by senders (with the lock held), read by the thread */
+	atomic_uint head;
+	/* Written by the thread, read by senders */
+	atomic_uint tail;
+	/* Serializes senders, the thread does not need it */
+	pthread_mutex_t lock;
+
+	pthread_t thread;
+	atomic_bool stop;
+	/* The thread waits on 'wakeup' if the ring buffer is empty,
+	 * senders signal it only if 'waiting' is set */
+	pthread_mutex_t wakeup_lock;
+	pthread_cond_t wakeup;
+	atomic_bool waiting;
+
+	/* Destination: either a UDP socket or a pcap file */
+	int fd;
+	FILE *pcap;
+
+	/* Statistics */
+	atomic_uint_fast64_t num_queued;
+	atomic_uint_fast64_t num_sent;
+	atomic_uint_fast64_t num_dropped;
+	atomic_uint_fast64_t num_oversize;
+	atomic_uint_fast64_t num_errors;
+};
+
+#define STAT_INC(exp, name, val) \
+	atomic_fetch_add_explicit(&(exp)->name, val, memory_order_relaxed)
+#define STAT_GET(exp, name) \
+	atomic_load_explicit(&(exp)->name, memory_order_relaxed)
+
+static unsigned int send_udp(struct gsmtap_export *exp,
+			     unsigned int tail, unsigned int n)
+{
+	struct mmsghdr mmsg[GSMTAP_EXPORT_BATCH];
+	struct iovec iov[GSMTAP_EXPORT_BATCH];
+	unsigned int i;
+	int rc;
+
+	for (i = 0; i < n; i++) {
+		struct gsmtap_export_msg *msg = &exp->ring[(tail + i) & exp->mask];
+
+		iov[i] = (struct iovec) {
+			.iov_base = &msg->buf[0],
+			.iov_len = msg->len,
+		};
+		mmsg[i] = (struct mmsghdr) {
+			.msg_hdr = {
+				.msg_iov = &iov[i],
+				.msg_iovlen = 1,
+			},
+		};
+	}
+
+	for (i = 0; i < n; ) {
+		rc = sendmmsg(exp->fd, &mmsg[i], n - i, 0);
+		if (rc <= 0) {
+			/* e.g. ECONNREFUSED (ICMP port unreachable), skip this message */
+			STAT_INC(exp, num_errors, 1);
+			i++;
+			continue;
+		}
+		STAT_INC(exp, num_sent, rc);
+		i += rc;
+	}
+
+	return n;
+}
+
+static uint16_t ip_checksum(const void *data, size_t len)
+{
+	const uint16_t *p = data;
+	uint32_t sum = 0;
+
+	for (; len > 1; len -= 2)
+		sum += *p++;
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return ~sum;
+}
+
+static unsigned int write_pcap(struct gsmtap_export *exp,
+			       unsigned int tail, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		const struct gsmtap_export_msg *msg = &exp->ring[(tail + i) & exp->mask];
+		const uint16_t ip_len = sizeof(struct pcap_rec_hdr) - PCAP_REC_IP_OFFSET + msg->len;
+		struct pcap_rec_hdr rh = {
+			.ts_sec = msg->time.tv_sec,
+			.ts_usec = msg->time.tv_nsec / 1000,
+			.incl_len = ip_len,
+			.orig_len = ip_len,
+			.ip_vhl = 0x45,
+			.ip_len = htons(ip_len),
+			.ip_ttl = 64,
+			.ip_proto = IPPROTO_UDP,
+			.ip_src = htonl(INADDR_LOOPBACK),
+			.ip_dst = htonl(INADDR_LOOPBACK),
+			.udp_sport = htons(GSMTAP_UDP_PORT),
+			.udp_dport = htons(GSMTAP_UDP_PORT),
+			.udp_len = htons(ip_len - 20),
+		};
+
+		rh.ip_sum = ip_checksum((uint8_t *)&rh + PCAP_REC_IP_OFFSET, 20);
+
+		if (fwrite(&rh, sizeof(rh), 1, exp->pcap) != 1 ||
+		    fwrite(&msg->buf[0], msg->len, 1, exp->pcap) != 1) {
+			STAT_INC(exp, num_errors, 1);
+			continue;
+		}
+		STAT_INC(exp, num_sent, 1);
+	}
+
+	return n;
+}
+
+/* Send (or write) up to GSMTAP_EXPORT_BATCH messages, return their number */
+static unsigned int gsmtap_export_drain(struct gsmtap_export *exp)
+{
+	unsigned int tail = atomic_load_explicit(&exp->tail, memory_order_relaxed);
+	unsigned int head = atomic_load_explicit(&exp->head, memory_order_acquire);
+	unsigned int n = OSMO_MIN(head - tail, GSMTAP_EXPORT_BATCH);
+
+	if (n == 0)
+		return 0;
+
+	if (exp->pcap != NULL)
+		write_pcap(exp, tail, n);
+	else
+		send_udp(exp, tail, n);
+
+	atomic_store_explicit(&exp->tail, tail + n, memory_order_release);
+	return n;
+}
+
+/* Wait until a message is queued (or the thread shall stop) */
+static void gsmtap_export_wait(struct gsmtap_export *exp)
+{
+	pthread_mutex_lock(&exp->wakeup_lock);
+
+	/* Announce that we are going to wait, then check again: a sender
+	 * either sees 'waiting' set (and signals) or we see its message */
+	atomic_store(&exp->waiting, true);
+	while (!atomic_load(&exp->stop) &&
+	       atomic_load(&exp->head) == atomic_load(&exp->tail))
+		pthread_cond_wait(&exp->wakeup, &exp->wakeup_lock);
+	atomic_store(&exp->waiting, false);
+
+	pthread_mutex_unlock(&exp->wakeup_lock);
+}
+
+static void gsmtap_export_wake(struct gsmtap_export *exp)
+{
+	pthread_mutex_lock(&exp->wakeup_lock);
+	pthread_cond_signal(&exp->wakeup);
+	pthread_mutex_unlock(&exp->wakeup_lock);
+}
+
+static void *gsmtap_export_thread(void *data)
+{
+	struct gsmtap_export *exp = data;
+
+	pthread_setname_np(pthread_self(), "gsmtap_export");
+
+	while (!atomic_load(&exp->stop)) {
+		if (gsmtap_export_drain(exp) > 0)
+			continue;
+		if (exp->pcap != NULL)
+			fflush(exp->pcap);
+		gsmtap_export_wait(exp);
+	}
+
+	/* Flush the remaining messages */
+	while (gsmtap_export_drain(exp) > 0)
+		;
+
+	return NULL;
+}
+
+static int pcap_open(struct gsmtap_export *exp, const char *path)
+{
+	const struct pcap_file_hdr fh = {
+		.magic = PCAP_MAGIC,
+		.version_major = 2,
+		.version_minor = 4,
+		.snaplen = 65535,
+		.linktype = PCAP_LINKTYPE_IPV4,
+	};
+
+	exp->pcap = fopen(path, "wb");
+	if (exp->pcap == NULL) {
+		LOGP(DLGLOBAL, LOGL_ERROR, "Failed to open GSMTAP pcap file '%s': %s\n",
+		     path, strerror(errno));
+		return -errno;
+	}
+
+	if (fwrite(&fh, sizeof(fh), 1, exp->pcap) != 1) {
+		LOGP(DLGLOBAL, LOGL_ERROR, "Failed to write GSMTAP pcap file '%s'\n", path);
+		fclose(exp->pcap);
+		exp->pcap = NULL;
+		return -EIO;
+	}
+
+	return 0;
+}
+
+struct gsmtap_export *gsmtap_export_alloc(void *ctx, const struct gsmtap_export_cfg *cfg)
+{
+	struct gsmtap_export *exp;
+	unsigned int size = 1;
+	int rc;
+
+	if (cfg->fd < 0 && cfg->pcap_path == NULL)
+		return NULL;
+
+	/* Round up to a power of 2 */
+	while (size < (cfg->ring_size ? cfg->ring_size : GSMTAP_EXPORT_RING_SIZE))
+		size <<= 1;
+
+	exp = talloc_zero(ctx, struct gsmtap_export);
+	if (exp == NULL)
+		return NULL;
+
+	exp->ring = talloc_zero_array(exp, struct gsmtap_export_msg, size);
+	if (exp->ring == NULL)
+		goto err_free;
+	exp->mask = size - 1;
+	exp->fd = cfg->fd;
+
+	if (cfg->pcap_path != NULL && pcap_open(exp, cfg->pcap_path) != 0)
+		goto err_free;
+
+	pthread_mutex_init(&exp->lock, NULL);
+	pthread_mutex_init(&exp->wakeup_lock, NULL);
+	pthread_cond_init(&exp->wakeup, NULL);
+
+	rc = pthread_create(&exp->thread, NULL, &gsmtap_export_thread, exp);
+	if (rc != 0) {
+		LOGP(DLGLOBAL, LOGL_ERROR, "Failed to start GSMTAP export thread: %s\n",
+		     strerror(rc));
+		pthread_cond_destroy(&exp->wakeup);
+		pthread_mutex_destroy(&exp->wakeup_lock);
+		pthread_mutex_destroy(&exp->lock);
+		goto err_free;
+	}
+
+	LOGP(DLGLOBAL, LOGL_NOTICE, "GSMTAP export to %s (%u messages buffered)\n",
+	     cfg->pcap_path != NULL ? cfg->pcap_path : "UDP", size);
+
+	return exp;
+
+err_free:
+	if (exp->pcap != NULL)
+		fclose(exp->pcap);
+	talloc_free(exp);
+	return NULL;
+}
+
+void gsmtap_export_free(struct gsmtap_export *exp)
+{
+	if (exp == NULL)
+		return;
+
+	atomic_store(&exp->stop, true);
+	gsmtap_export_wake(exp);
+	pthread_join(exp->thread, NULL);
+	pthread_cond_destroy(&exp->wakeup);
+	pthread_mutex_destroy(&exp->wakeup_lock);
+	pthread_mutex_destroy(&exp->lock);
+
+	LOGP(DLGLOBAL, LOGL_NOTICE, "GSMTAP export: %" PRIu64 " queued, %" PRIu64 " sent, "
+	     "%" PRIu64 " dropped (%" PRIu64 " too long), %" PRIu64 " errors\n",
+	     (uint64_t)STAT_GET(exp, num_queued), (uint64_t)STAT_GET(exp, num_sent),
+	     (uint64_t)STAT_GET(exp, num_dropped), (uint64_t)STAT_GET(exp, num_oversize),
+	     (uint64_t)STAT_GET(exp, num_errors));
+
+	if (exp->pcap != NULL)
+		fclose(exp->pcap);
+	talloc_free(exp);
+}
+
+/*! Queue a GSMTAP message for sending, never blocks on I/O.
+ * \returns 0 on success, -ENOSPC if the ring buffer is full,
+ *	    -EMSGSIZE if the payload is too long. */
+int gsmtap_export_send_ex(struct gsmtap_export *exp, uint8_t type,
+			  uint16_t arfcn, uint8_t ts, uint8_t chan_type,
+			  uint8_t ss, uint32_t fn, int8_t signal_dbm,
+			  int8_t snr, const uint8_t *data, unsigned int len)
+{
+	struct gsmtap_export_msg *msg;
+	struct gsmtap_hdr *gh;
+	unsigned int head;
+
+	if (len > GSMTAP_EXPORT_PAYLOAD_MAX) {
+		STAT_INC(exp, num_dropped, 1);
+		STAT_INC(exp, num_oversize, 1);
+		return -EMSGSIZE;
+	}
+
+	pthread_mutex_lock(&exp->lock);
+
+	head = atomic_load_explicit(&exp->head, memory_order_relaxed);
+	if (head - atomic_load_explicit(&exp->tail, memory_order_acquire) > exp->mask) {
+		pthread_mutex_unlock(&exp->lock);
+		STAT_INC(exp, num_dropped, 1);
+		return -ENOSPC;
+	}
+
+	msg = &exp->ring[head & exp->mask];
+	if (exp->pcap != NULL)
+		clock_gettime(CLOCK_REALTIME, &msg->time);
+	msg->len = sizeof(*gh) + len;
+
+	gh = (struct gsmtap_hdr *)&msg->buf[0];
+	*gh = (struct gsmtap_hdr) {
+		.version = GSMTAP_VERSION,
+		.hdr_len = sizeof(*gh) / 4,
+		.type = type,
+		.timeslot = ts,
+		.arfcn = htons(arfcn),
+		.signal_dbm = signal_dbm,
+		.snr_db = snr,
+		.frame_number = htonl(fn),
+		.sub_type = chan_type,
+		.sub_slot = ss,
+	};
+	memcpy(&msg->buf[sizeof(*gh)], data, len);
+
+	/* Sequentially consistent, pairs with gsmtap_export_wait() */
+	atomic_store(&exp->head, head + 1);
+	pthread_mutex_unlock(&exp->lock);
+
+	/* The thread only waits if the ring buffer was empty */
+	if (atomic_load(&exp->waiting))
+		gsmtap_export_wake(exp);
+
+	STAT_INC(exp, num_queued, 1);
+	return 0;
+}
+
+/*! Print the statistics of the given exporter */
+void gsmtap_export_dump(struct gsmtap_export *exp, FILE *out)
+{
+	fprintf(out, "  gsmtap_export.queued: %" PRIu64 "\n", (uint64_t)STAT_GET(exp, num_queued));
+	fprintf(out, "  gsmtap_export.sent: %" PRIu64 "\n", (uint64_t)STAT_GET(exp, num_sent));
+	fprintf(out, "  gsmtap_export.dropped: %" PRIu64 "\n", (uint64_t)STAT_GET(exp, num_dropped));
+	fprintf(out, "  gsmtap_export.oversize: %" PRIu64 "\n", (uint64_t)STAT_GET(exp, num_oversize));
+	fprintf(out, "  gsmtap_export.errors: %" PRIu64 "\n", (uint64_t)STAT_GET(exp, num_errors));
+}
@@ -25,6 +25,7 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 
 #include <arpa/inet.h>
@@ -40,6 +41,7 @@
 #include <osmocom/gsm/protocol/gsm_08_58.h>
 
 #include <osmocom/bb/l1ctl_proto.h>
+#include <osmocom/bb/l1sched/l1sched.h>
 #include <osmocom/bb/trxcon/logging.h>
 #include <osmocom/bb/trxcon/trxcon.h>
 #include <osmocom/bb/trxcon/trxcon_fsm.h>
@@ -85,8 +87,8 @@ static struct msgb *l1ctl_alloc_msg(uint8_t msg_type)
 	 * Each L1CTL message gets its own length pushed in front
 	 * before sending. This is why we need this small headroom.
 	 */
-	msg = msgb_alloc_headroom(L1CTL_LENGTH + L1CTL_HEADROOM,
-				  L1CTL_HEADROOM, "l1ctl_tx_msg");
+	msg = l1sched_msgb_alloc(L1CTL_LENGTH + L1CTL_HEADROOM,
+				 L1CTL_HEADROOM, "l1ctl_tx_msg");
 	if (!msg) {
 		LOGP(g_logc_l1c, LOGL_ERROR, "Failed to allocate memory\n");
 		return NULL;
@@ -99,25 +101,37 @@ static struct msgb *l1ctl_alloc_msg(uint8_t msg_type)
 	return msg;
 }
 
-int l1ctl_tx_pm_conf(struct trxcon_inst *trxcon, uint16_t band_arfcn, int dbm, int last)
+/* Send measurement results for consecutive ARFCNs in a single message */
+int l1ctl_tx_pm_conf(struct trxcon_inst *trxcon, uint16_t band_arfcn,
+		     const int *dbm, unsigned int num, int last)
 {
 	struct osmo_fsm_inst *fi = trxcon->fi;
 	struct l1ctl_pm_conf *pmc;
 	struct msgb *msg;
+	unsigned int i;
 
 	msg = l1ctl_alloc_msg(L1CTL_PM_CONF);
 	if (!msg)
 		return -ENOMEM;
 
-	LOGPFSMSL(fi, g_logc_l1c, LOGL_DEBUG,
-		  "Send PM Conf (%s %d = %d dBm)\n",
-		  arfcn2band_name(band_arfcn),
-		  band_arfcn & ~ARFCN_FLAG_MASK, dbm);
+	if (msgb_tailroom(msg) < num * sizeof(*pmc)) {
+		LOGPFSMSL(fi, g_logc_l1c, LOGL_ERROR,
+			  "Too many PM results (%u) for one message\n", num);
+		msgb_free(msg);
+		return -EMSGSIZE;
+	}
+
+	for (i = 0; i < num; i++, band_arfcn++) {
+		LOGPFSMSL(fi, g_logc_l1c, LOGL_DEBUG,
+			  "Send PM Conf (%s %d = %d dBm)\n",
+			  arfcn2band_name(band_arfcn),
+			  band_arfcn & ~ARFCN_FLAG_MASK, dbm[i]);
 
-	pmc = (struct l1ctl_pm_conf *) msgb_put(msg, sizeof(*pmc));
-	pmc->band_arfcn = htons(band_arfcn);
-	pmc->pm[0] = dbm2rxlev(dbm);
-	pmc->pm[1] = 0;
+		pmc = (struct l1ctl_pm_conf *) msgb_put(msg, sizeof(*pmc));
+		pmc->band_arfcn = htons(band_arfcn);
+		pmc->pm[0] = dbm2rxlev(dbm[i]);
+		pmc->pm[1] = 0;
+	}
 
 	if (last) {
 		struct l1ctl_hdr *l1h = (struct l1ctl_hdr *) msg->l1h;
@@ -254,18 +268,39 @@ int l1ctl_tx_ccch_mode_conf(struct trxcon_inst *trxcon, uint8_t mode)
 	return trxcon_l1ctl_send(trxcon, msg);
 }
 
+/* Turn a msgb holding the L2 payload at l2h into an L1CTL message with
+ * the given header, reusing the headroom (e.g. the primitive's header). */
+static struct msgb *l1ctl_reuse_msg(struct msgb *msg, uint8_t msg_type,
+				    const struct l1ctl_info_dl *dl_info)
+{
+	struct l1ctl_hdr *l1h;
+	size_t hdr_len;
+
+	hdr_len = sizeof(*l1h) + sizeof(*dl_info);
+	if ((size_t)(msg->l2h - msg->head) < L1CTL_HEADROOM + hdr_len)
+		return NULL;
+
+	/* Drop everything in front of the payload */
+	msgb_pull(msg, msg->l2h - msg->data);
+
+	memcpy(msgb_push(msg, sizeof(*dl_info)), dl_info, sizeof(*dl_info));
+	msg->l1h = msgb_push(msg, sizeof(*l1h));
+	l1h = (struct l1ctl_hdr *) msg->l1h;
+	memset(l1h, 0x00, sizeof(*l1h));
+	l1h->msg_type = msg_type;
+
+	return msg;
+}
+
 /**
  * Handles both L1CTL_DATA_IND and L1CTL_TRAFFIC_IND.
  */
 int l1ctl_tx_dt_ind(struct trxcon_inst *trxcon,
-		    const struct trxcon_param_rx_data_ind *ind)
+		    struct trxcon_param_rx_data_ind *ind)
 {
+	uint8_t msg_type = ind->traffic ? L1CTL_TRAFFIC_IND : L1CTL_DATA_IND;
 	struct msgb *msg;
 
-	msg = l1ctl_alloc_msg(ind->traffic ? L1CTL_TRAFFIC_IND : L1CTL_DATA_IND);
-	if (msg == NULL)
-		return -ENOMEM;
-
 	const struct l1ctl_info_dl dl_hdr = {
 		.chan_nr = ind->chan_nr,
 		.link_id = ind->link_id,
@@ -277,6 +312,18 @@ int l1ctl_tx_dt_ind(struct trxcon_inst *trxcon,
 		/* TODO: set proper .snr */
 	};
 
+	/* Build the message in front of the payload, avoiding a copy */
+	if (ind->msg != NULL && ind->data == msgb_l2(ind->msg) &&
+	    l1ctl_reuse_msg(ind->msg, msg_type, &dl_hdr) != NULL) {
+		msg = ind->msg;
+		ind->msg = NULL;
+		return trxcon_l1ctl_send(trxcon, msg);
+	}
+
+	msg = l1ctl_alloc_msg(msg_type);
+	if (msg == NULL)
+		return -ENOMEM;
+
 	put_dl_info_hdr(msg, &dl_hdr);
 
 	/* Copy the L2 payload if preset */
@@ -482,7 +529,7 @@ static int l1ctl_rx_ccch_mode_req(struct trxcon_inst *trxcon, struct msgb *msg)
 	int rc;
 
 	mode_req = (const struct l1ctl_ccch_mode_req *)msg->l1h;
-	if (msgb_l1len(msg) < sizeof(*mode_req)) {
+	if (msgb_l1len(msg) < offsetof(struct l1ctl_ccch_mode_req, drx)) {
 		LOGPFSMSL(fi, g_logc_l1c, LOGL_ERROR,
 			  "MSG too short Reset Req: %u\n",
 			  msgb_l1len(msg));
@@ -498,6 +545,13 @@ static int l1ctl_rx_ccch_mode_req(struct trxcon_inst *trxcon, struct msgb *msg)
 		.mode = l1ctl_ccch_mode2pchan_config(mode_req->ccch_mode),
 	};
 
+	/* DRX parameters are optional */
+	if (msgb_l1len(msg) >= sizeof(*mode_req)) {
+		req.drx.bs_pa_mfrms = mode_req->drx.bs_pa_mfrms;
+		req.drx.bs_ag_blks_res = mode_req->drx.bs_ag_blks_res;
+		req.drx.paging_group = mode_req->drx.paging_group;
+	}
+
 	rc = osmo_fsm_inst_dispatch(fi, TRXCON_EV_SET_CCCH_MODE_REQ, &req);
 	if (rc == 0 && req.applied)
 		l1ctl_tx_ccch_mode_conf(trxcon, mode_req->ccch_mode);
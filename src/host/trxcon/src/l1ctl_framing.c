@@ -0,0 +1,155 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * Length-prefixed framing of L1CTL messages over stream sockets
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/core/bits.h>
+#include <osmocom/core/linuxlist.h>
+#include <osmocom/core/write_queue.h>
+#include <osmocom/core/msgb.h>
+
+#include <osmocom/bb/trxcon/l1ctl_framing.h>
+
+/*! Initialize a receive buffer.
+ *  \param[out] rx       receive buffer to be initialized.
+ *  \param[in]  max_len  max length of a message (excluding the prefix). */
+void l1ctl_framing_rx_init(struct l1ctl_framing_rx *rx, uint16_t max_len)
+{
+	OSMO_ASSERT(max_len + L1CTL_FRAMING_LEN_FIELD <= sizeof(rx->buf));
+
+	rx->max_len = max_len;
+	rx->pos = 0;
+	rx->len = 0;
+}
+
+/*! Read as much as is available from a socket (single read() call).
+ *  \param[in] rx  receive buffer.
+ *  \param[in] fd  file descriptor to read from.
+ *  \returns number of octets read; 0 on EOF; negative errno on error. */
+int l1ctl_framing_rx_fill(struct l1ctl_framing_rx *rx, int fd)
+{
+	ssize_t rc;
+
+	/* Move the remainder (a partial message) to the beginning */
+	if (rx->pos > 0) {
+		memmove(&rx->buf[0], &rx->buf[rx->pos], rx->len - rx->pos);
+		rx->len -= rx->pos;
+		rx->pos = 0;
+	}
+
+	/* Cannot happen, max_len is checked by l1ctl_framing_rx_pop() */
+	if (rx->len == sizeof(rx->buf))
+		return -ENOBUFS;
+
+	do {
+		rc = read(fd, &rx->buf[rx->len], sizeof(rx->buf) - rx->len);
+	} while (rc < 0 && errno == EINTR);
+	if (rc < 0)
+		return -errno;
+
+	rx->len += rc;
+	return rc;
+}
+
+/*! Extract the next complete message from a receive buffer.
+ *  \param[in]  rx    receive buffer.
+ *  \param[out] data  pointer to the message (valid until the next fill).
+ *  \returns length of the message; -EAGAIN if there is no complete message;
+ *           -EMSGSIZE if the message is too long (the stream is unusable). */
+int l1ctl_framing_rx_pop(struct l1ctl_framing_rx *rx, const uint8_t **data)
+{
+	unsigned int avail = rx->len - rx->pos;
+	uint16_t len;
+
+	if (avail < L1CTL_FRAMING_LEN_FIELD)
+		return -EAGAIN;
+
+	len = osmo_load16be(&rx->buf[rx->pos]);
+	if (len > rx->max_len)
+		return -EMSGSIZE;
+	if (avail < L1CTL_FRAMING_LEN_FIELD + len)
+		return -EAGAIN;
+
+	*data = &rx->buf[rx->pos + L1CTL_FRAMING_LEN_FIELD];
+	rx->pos += L1CTL_FRAMING_LEN_FIELD + len;
+
+	return len;
+}
+
+/*! Write a message together with further pending messages (if any).
+ *  To be called from the write_cb of an osmo_wqueue: the given message
+ *  has already been dequeued (and will be free()d by the caller), up to
+ *  L1CTL_FRAMING_TX_BATCH - 1 further messages are dequeued (and free()d)
+ *  here, and all of them are written with a single writev() call.
+ *  Messages shall already be prefixed by their length.
+ *  \param[in] wq   write queue of a (blocking) stream socket.
+ *  \param[in] msg  message dequeued by the caller.
+ *  \returns 0 on success; negative errno on error. */
+int l1ctl_framing_tx(struct osmo_wqueue *wq, struct msgb *msg)
+{
+	struct msgb *msgs[L1CTL_FRAMING_TX_BATCH];
+	struct iovec iov[L1CTL_FRAMING_TX_BATCH];
+	struct iovec *cur = &iov[0];
+	unsigned int num = 0, i;
+	int cnt, rc = 0;
+
+	msgs[num++] = msg;
+	while (num < ARRAY_SIZE(msgs) && !llist_empty(&wq->msg_queue)) {
+		msgs[num++] = msgb_dequeue(&wq->msg_queue);
+		wq->current_length--;
+	}
+
+	for (i = 0; i < num; i++) {
+		iov[i] = (struct iovec) {
+			.iov_base = msgb_data(msgs[i]),
+			.iov_len = msgb_length(msgs[i]),
+		};
+	}
+
+	for (cnt = num; cnt > 0; ) {
+		ssize_t len = writev(wq->bfd.fd, cur, cnt);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0) {
+			rc = len < 0 ? -errno : -EIO;
+			break;
+		}
+
+		/* Skip what has been written (short writes are possible) */
+		while (cnt > 0 && (size_t)len >= cur->iov_len) {
+			len -= cur->iov_len;
+			cur++;
+			cnt--;
+		}
+		if (cnt > 0) {
+			cur->iov_base = (uint8_t *)cur->iov_base + len;
+			cur->iov_len -= len;
+		}
+	}
+
+	for (i = 1; i < num; i++)
+		msgb_free(msgs[i]);
+
+	return rc;
+}
@@ -34,66 +34,95 @@
 #include <osmocom/core/select.h>
 #include <osmocom/core/socket.h>
 #include <osmocom/core/write_queue.h>
+#include <osmocom/core/stat_item.h>
 
+#include <osmocom/bb/l1sched/l1sched.h>
 #include <osmocom/bb/trxcon/logging.h>
 #include <osmocom/bb/trxcon/l1ctl_server.h>
+#include <osmocom/bb/trxcon/trxcon_stats.h>
 
 #define LOGP_CLI(cli, cat, level, fmt, args...) \
 	LOGP(cat, level, "%s" fmt, (cli)->log_prefix, ## args)
 
+enum l1ctl_client_stat {
+	L1CTL_CLIENT_STAT_WQUEUE_DEPTH,
+};
+
+static const struct osmo_stat_item_desc l1ctl_client_stat_desc[] = {
+	[L1CTL_CLIENT_STAT_WQUEUE_DEPTH] = {
+		"wqueue:depth", "Number of messages in the write queue", "msgs", 16, 0 },
+};
+
+static const struct osmo_stat_item_group_desc l1ctl_client_statg_desc = {
+	.group_name_prefix = "l1ctl_client",
+	.group_description = "L1CTL client connection",
+	.num_items = ARRAY_SIZE(l1ctl_client_stat_desc),
+	.item_desc = l1ctl_client_stat_desc,
+};
+
+static inline void l1ctl_client_wqueue_depth_upd(struct l1ctl_client *client)
+{
+	struct osmo_stat_item *item;
+
+	if (client->statg == NULL)
+		return;
+	item = osmo_stat_item_group_get_item(client->statg, L1CTL_CLIENT_STAT_WQUEUE_DEPTH);
+	osmo_stat_item_set(item, client->wq.current_length);
+}
+
 static int l1ctl_client_read_cb(struct osmo_fd *ofd)
 {
 	struct l1ctl_client *client = (struct l1ctl_client *)ofd->data;
+	const uint8_t *data;
+	bool closed = false;
 	struct msgb *msg;
-	uint16_t len;
 	int rc;
 
-	/* Attempt to read from socket */
-	rc = read(ofd->fd, &len, L1CTL_MSG_LEN_FIELD);
-	if (rc != L1CTL_MSG_LEN_FIELD) {
-		if (rc <= 0) {
-			LOGP_CLI(client, DL1D, LOGL_NOTICE,
-				 "L1CTL connection error: read() failed (rc=%d): %s\n",
-				 rc, strerror(errno));
-		} else {
-			LOGP_CLI(client, DL1D, LOGL_NOTICE,
-				 "L1CTL connection error: short read\n");
-			rc = -EIO;
-		}
+	/* Read whatever is available, there may be several messages */
+	rc = l1ctl_framing_rx_fill(&client->rx, ofd->fd);
+	if (rc == -EAGAIN)
+		return 0;
+	if (rc <= 0) {
+		LOGP_CLI(client, DL1D, LOGL_NOTICE,
+			 "L1CTL connection error: read() failed (rc=%d): %s\n",
+			 rc, rc < 0 ? strerror(-rc) : "EOF");
 		l1ctl_client_conn_close(client);
 		return -EBADF; /* client fd is gone, avoid processing any other events. */
 	}
 
-	/* Check message length */
-	len = ntohs(len);
-	if (len > L1CTL_LENGTH) {
-		LOGP_CLI(client, DL1D, LOGL_ERROR, "Length is too big: %u\n", len);
-		return -EINVAL;
-	}
+	/* The handler may close the connection, see l1ctl_client_conn_close() */
+	client->closed = &closed;
 
-	/* Allocate a new msg */
-	msg = msgb_alloc_headroom(L1CTL_LENGTH + L1CTL_HEADROOM,
-		L1CTL_HEADROOM, "l1ctl_rx_msg");
-	if (!msg) {
-		LOGP_CLI(client, DL1D, LOGL_ERROR, "Failed to allocate msg\n");
-		return -ENOMEM;
-	}
+	while ((rc = l1ctl_framing_rx_pop(&client->rx, &data)) >= 0) {
+		/* Allocate a new msg */
+		msg = l1sched_msgb_alloc(L1CTL_LENGTH + L1CTL_HEADROOM,
+			L1CTL_HEADROOM, "l1ctl_rx_msg");
+		if (!msg) {
+			LOGP_CLI(client, DL1D, LOGL_ERROR, "Failed to allocate msg\n");
+			continue;
+		}
 
-	msg->l1h = msgb_put(msg, len);
-	rc = read(ofd->fd, msg->l1h, msgb_l1len(msg));
-	if (rc != len) {
-		LOGP_CLI(client, DL1D, LOGL_ERROR,
-			 "Can not read data: len=%d < rc=%d: %s\n",
-			 len, rc, strerror(errno));
-		msgb_free(msg);
-		return rc;
+		msg->l1h = msgb_put(msg, rc);
+		memcpy(msg->l1h, data, rc);
+
+		/* Debug print */
+		LOGP_CLI(client, DL1D, LOGL_DEBUG, "RX: '%s'\n", osmo_hexdump(msg->data, msg->len));
+
+		/* Call L1CTL handler */
+		client->server->cfg->conn_read_cb(client, msg);
+		if (closed)
+			return -EBADF;
 	}
 
-	/* Debug print */
-	LOGP_CLI(client, DL1D, LOGL_DEBUG, "RX: '%s'\n", osmo_hexdump(msg->data, msg->len));
+	client->closed = NULL;
 
-	/* Call L1CTL handler */
-	client->server->cfg->conn_read_cb(client, msg);
+	/* The length prefix is garbage, the stream cannot be recovered */
+	if (rc == -EMSGSIZE) {
+		LOGP_CLI(client, DL1D, LOGL_ERROR,
+			 "L1CTL connection error: message is too long\n");
+		l1ctl_client_conn_close(client);
+		return -EBADF;
+	}
 
 	return 0;
 }
@@ -101,72 +130,71 @@ static int l1ctl_client_read_cb(struct osmo_fd *ofd)
 static int l1ctl_client_write_cb(struct osmo_fd *ofd, struct msgb *msg)
 {
 	struct l1ctl_client *client = (struct l1ctl_client *)ofd->data;
-	int len;
+	int rc;
 
 	if (ofd->fd <= 0)
 		return -EINVAL;
 
-	len = write(ofd->fd, msg->data, msg->len);
-	if (len != msg->len) {
+	/* Pending messages are coalesced into a single writev() call */
+	rc = l1ctl_framing_tx(&client->wq, msg);
+
+	/* The message(s) have already been dequeued at this point */
+	l1ctl_client_wqueue_depth_upd(client);
+
+	if (rc != 0) {
 		LOGP_CLI(client, DL1D, LOGL_ERROR,
-			 "Failed to write data: written (%d) < msg_len (%d)\n",
-			 len, msg->len);
-		return -1;
+			 "Failed to write data: %s\n", strerror(-rc));
+		return rc;
 	}
 
 	return 0;
 }
 
-/* Connection handler */
-static int l1ctl_server_conn_cb(struct osmo_fd *sfd, unsigned int flags)
+/*! Serve an accepted connection in the calling thread.
+ *  \param[in] server  L1CTL server the connection was accepted by.
+ *  \param[in] ctx     talloc context to allocate the client from.
+ *  \param[in] fd      file descriptor of the accepted connection.
+ *  \returns 0 on success; negative on error (fd is closed). */
+int l1ctl_server_conn_open(struct l1ctl_server *server, void *ctx, int fd)
 {
-	struct l1ctl_server *server = (struct l1ctl_server *)sfd->data;
 	struct l1ctl_client *client;
-	int rc, client_fd;
-
-	client_fd = accept(sfd->fd, NULL, NULL);
-	if (client_fd < 0) {
-		LOGP(DL1C, LOGL_ERROR, "Failed to accept() a new connection: "
-		     "%s\n", strerror(errno));
-		return client_fd;
-	}
-
-	if (server->cfg->num_clients_max > 0 /* 0 means unlimited */ &&
-	    server->num_clients >= server->cfg->num_clients_max) {
-		LOGP(DL1C, LOGL_NOTICE, "L1CTL server cannot accept more "
-		     "than %u connection(s)\n", server->cfg->num_clients_max);
-		close(client_fd);
-		return -ENOMEM;
-	}
+	int rc;
 
-	client = talloc_zero(server, struct l1ctl_client);
+	client = talloc_zero(ctx, struct l1ctl_client);
 	if (client == NULL) {
 		LOGP(DL1C, LOGL_ERROR, "Failed to allocate an L1CTL client\n");
-		close(client_fd);
-		return -ENOMEM;
+		rc = -ENOMEM;
+		goto error;
 	}
 
 	/* Init the client's write queue */
 	osmo_wqueue_init(&client->wq, 100);
 	INIT_LLIST_HEAD(&client->wq.bfd.list);
+	l1ctl_framing_rx_init(&client->rx, L1CTL_LENGTH);
 
 	client->wq.write_cb = &l1ctl_client_write_cb;
 	client->wq.read_cb = &l1ctl_client_read_cb;
-	osmo_fd_setup(&client->wq.bfd, client_fd, OSMO_FD_READ, &osmo_wqueue_bfd_cb, client, 0);
+	osmo_fd_setup(&client->wq.bfd, fd, OSMO_FD_READ, &osmo_wqueue_bfd_cb, client, 0);
 
 	/* Register the client's write queue */
 	rc = osmo_fd_register(&client->wq.bfd);
 	if (rc != 0) {
 		LOGP(DL1C, LOGL_ERROR, "Failed to register a new connection fd\n");
-		close(client->wq.bfd.fd);
 		talloc_free(client);
-		return rc;
+		goto error;
 	}
 
+	client->server = server;
+	client->thread = pthread_self();
+
+	pthread_mutex_lock(&server->lock);
 	llist_add_tail(&client->list, &server->clients);
 	client->id = server->next_client_id++;
-	client->server = server;
-	server->num_clients++;
+	pthread_mutex_unlock(&server->lock);
+
+	trxcon_stats_lock();
+	client->statg = osmo_stat_item_group_alloc(client, &l1ctl_client_statg_desc, client->id);
+	trxcon_stats_unlock();
 
 	LOGP(DL1C, LOGL_NOTICE, "L1CTL server got a new connection (id=%u)\n", client->id);
 
@@ -174,6 +202,49 @@ static int l1ctl_server_conn_cb(struct osmo_fd *sfd, unsigned int flags)
 		client->server->cfg->conn_accept_cb(client);
 
 	return 0;
+
+error:
+	close(fd);
+	pthread_mutex_lock(&server->lock);
+	server->num_clients--;
+	pthread_mutex_unlock(&server->lock);
+	return rc;
+}
+
+/* Connection handler */
+static int l1ctl_server_conn_cb(struct osmo_fd *sfd, unsigned int flags)
+{
+	struct l1ctl_server *server = (struct l1ctl_server *)sfd->data;
+	int client_fd;
+
+	client_fd = accept(sfd->fd, NULL, NULL);
+	if (client_fd < 0) {
+		LOGP(DL1C, LOGL_ERROR, "Failed to accept() a new connection: "
+		     "%s\n", strerror(errno));
+		return client_fd;
+	}
+
+	/* Count the connection right away, it may be served by another thread */
+	pthread_mutex_lock(&server->lock);
+	if (server->cfg->num_clients_max > 0 /* 0 means unlimited */ &&
+	    server->num_clients >= server->cfg->num_clients_max) {
+		pthread_mutex_unlock(&server->lock);
+		LOGP(DL1C, LOGL_NOTICE, "L1CTL server cannot accept more "
+		     "than %u connection(s)\n", server->cfg->num_clients_max);
+		close(client_fd);
+		return -ENOMEM;
+	}
+	server->num_clients++;
+	pthread_mutex_unlock(&server->lock);
+
+	if (server->cfg->conn_dispatch_cb != NULL) {
+		if (server->cfg->conn_dispatch_cb(server, client_fd) == 0)
+			return 0;
+		LOGP(DL1C, LOGL_NOTICE, "Failed to dispatch a new connection, "
+		     "serving it in the main thread\n");
+	}
+
+	return l1ctl_server_conn_open(server, server, client_fd);
 }
 
 int l1ctl_client_send(struct l1ctl_client *client, struct msgb *msg)
@@ -196,6 +267,8 @@ int l1ctl_client_send(struct l1ctl_client *client, struct msgb *msg)
 		return -EIO;
 	}
 
+	l1ctl_client_wqueue_depth_upd(client);
+
 	return 0;
 }
 
@@ -208,6 +281,10 @@ void l1ctl_client_conn_close(struct l1ctl_client *client)
 	if (server->cfg->conn_close_cb != NULL)
 		server->cfg->conn_close_cb(client);
 
+	/* Let l1ctl_client_read_cb() know that the client is gone */
+	if (client->closed != NULL)
+		*client->closed = true;
+
 	/* Close connection socket */
 	osmo_fd_unregister(&client->wq.bfd);
 	close(client->wq.bfd.fd);
@@ -216,14 +293,21 @@ void l1ctl_client_conn_close(struct l1ctl_client *client)
 	/* Clear pending messages */
 	osmo_wqueue_clear(&client->wq);
 
-	client->server->num_clients--;
+	trxcon_stats_lock();
+	osmo_stat_item_group_free(client->statg);
+	trxcon_stats_unlock();
+
+	pthread_mutex_lock(&server->lock);
+	server->num_clients--;
 	llist_del(&client->list);
-	talloc_free(client);
 
 	/* If this was the last client, reset the client IDs generator to 0.
 	 * This way avoid assigning huge unreadable client IDs like 26545. */
 	if (llist_empty(&server->clients))
 		server->next_client_id = 0;
+	pthread_mutex_unlock(&server->lock);
+
+	talloc_free(client);
 }
 
 struct l1ctl_server *l1ctl_server_alloc(void *ctx, const struct l1ctl_server_cfg *cfg)
@@ -241,6 +325,8 @@ struct l1ctl_server *l1ctl_server_alloc(void *ctx, const struct l1ctl_server_cfg
 		.cfg = cfg,
 	};
 
+	pthread_mutex_init(&server->lock, NULL);
+
 	/* conn_read_cb shall not be NULL */
 	OSMO_ASSERT(cfg->conn_read_cb != NULL);
 
@@ -252,6 +338,7 @@ struct l1ctl_server *l1ctl_server_alloc(void *ctx, const struct l1ctl_server_cfg
 	if (rc < 0) {
 		LOGP(DL1C, LOGL_ERROR, "Could not create UNIX socket: %s\n",
 			strerror(errno));
+		pthread_mutex_destroy(&server->lock);
 		talloc_free(server);
 		return NULL;
 	}
@@ -278,5 +365,6 @@ void l1ctl_server_free(struct l1ctl_server *server)
 		server->ofd.fd = -1;
 	}
 
+	pthread_mutex_destroy(&server->lock);
 	talloc_free(server);
 }
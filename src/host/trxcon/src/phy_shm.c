@@ -0,0 +1,478 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * Shared memory interface to a co-located transceiver
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include <osmocom/core/logging.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/fsm.h>
+
+#include <osmocom/gsm/gsm0502.h>
+
+#include <osmocom/bb/trxcon/phy_shm.h>
+#include <osmocom/bb/trxcon/logging.h>
+
+#define LOGPSHM(shm, cat, level, fmt, args...) \
+	LOGPFSMSL((shm)->parent_fi, cat, level, fmt, ## args)
+
+/* How long to wait for the transceiver's hello message */
+#define PHY_SHM_HELLO_TIMEOUT_MS	1000
+
+static void phy_shm_wake(struct phy_shm *shm)
+{
+	const uint64_t val = 1;
+
+	shm->tx_pending = false;
+	if (write(shm->efd_tx, &val, sizeof(val)) != sizeof(val) && errno != EAGAIN)
+		LOGPSHM(shm, DTRXD, LOGL_ERROR, "Failed to wake up the transceiver: %s\n",
+			strerror(errno));
+}
+
+/* Release all resources, but do not notify the parent */
+static void phy_shm_free(struct phy_shm *shm)
+{
+	if (osmo_fd_is_registered(&shm->efd_ofd))
+		osmo_fd_unregister(&shm->efd_ofd);
+	if (shm->efd_ofd.fd >= 0)
+		close(shm->efd_ofd.fd);
+	if (osmo_fd_is_registered(&shm->sock_ofd))
+		osmo_fd_unregister(&shm->sock_ofd);
+	if (shm->sock_ofd.fd >= 0)
+		close(shm->sock_ofd.fd);
+	if (shm->efd_tx >= 0)
+		close(shm->efd_tx);
+	if (shm->seg != NULL)
+		munmap(shm->seg, shm->seg_size);
+	talloc_free(shm);
+}
+
+/* The transceiver went away: tear down and let the parent know */
+static void phy_shm_failure(struct phy_shm *shm)
+{
+	struct osmo_fsm_inst *parent_fi = shm->parent_fi;
+	uint32_t event = shm->parent_term_event;
+
+	LOGPSHM(shm, DTRXC, LOGL_ERROR, "Lost connection to the transceiver\n");
+	phy_shm_free(shm);
+	osmo_fsm_inst_dispatch(parent_fi, event, NULL);
+}
+
+static void phy_shm_handle_rsp(struct phy_shm *shm, const struct phy_shm_ctrl *ctrl)
+{
+	int dbm[PHY_SHM_MEAS_MAX];
+	unsigned int i;
+
+	if (ctrl->status != 0) {
+		LOGPSHM(shm, DTRXC, LOGL_ERROR, "Transceiver rejected a command (type=%u): %s\n",
+			ctrl->type, strerror(-ctrl->status));
+		return;
+	}
+
+	if (ctrl->type != TRXCON_PHYIF_CMDT_MEASURE)
+		return;
+
+	const unsigned int num = OSMO_MIN(ctrl->param.measure_rsp.num, PHY_SHM_MEAS_MAX);
+
+	for (i = 0; i < num; i++)
+		dbm[i] = ctrl->param.measure_rsp.dbm[i];
+
+	const struct trxcon_phyif_rsp rsp = {
+		.type = TRXCON_PHYIF_CMDT_MEASURE,
+		.param.measure = {
+			.band_arfcn = ctrl->param.measure_rsp.band_arfcn,
+			.dbm = &dbm[0],
+			.num = num,
+		},
+	};
+
+	trxcon_phyif_handle_rsp(shm->priv, &rsp);
+}
+
+static void phy_shm_handle_burst_ind(struct phy_shm *shm, const struct phy_shm_burst *b)
+{
+	if (b->fn >= GSM_TDMA_HYPERFRAME || b->tn >= 8) {
+		LOGPSHM(shm, DTRXD, LOGL_ERROR, "Illegal FN %u or TN %u\n", b->fn, b->tn);
+		return;
+	}
+
+	/* NOPE.ind carries no burst, but still drives the clock */
+	if (b->burst_len > 0) {
+		const struct trxcon_phyif_burst_ind bi = {
+			.fn = b->fn,
+			.tn = b->tn,
+			.toa256 = b->toa256,
+			.rssi = b->rssi,
+			.flags = b->flags,
+			.mod = b->mod,
+			.tsc_set = b->tsc_set,
+			.tsc = b->tsc,
+			.ci_cb = b->ci_cb,
+			/* soft-bits are passed in place, without copying */
+			.burst = (const sbit_t *)&b->burst[0],
+			.burst_len = OSMO_MIN(b->burst_len, PHY_SHM_BURST_LEN_MAX),
+		};
+
+		trxcon_phyif_handle_burst_ind(shm->priv, &bi);
+	}
+
+	const struct trxcon_phyif_rts_ind rts = {
+		.fn = GSM_TDMA_FN_SUM(b->fn, shm->fn_advance),
+		.tn = b->tn,
+	};
+
+	trxcon_phyif_handle_rts_ind(shm->priv, &rts);
+}
+
+static int phy_shm_efd_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct phy_shm *shm = ofd->data;
+	struct phy_shm_seg *seg = shm->seg;
+	uint64_t val;
+	int idx;
+
+	/* Reset the counter, a wakeup may cover any number of slots */
+	if (read(ofd->fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		return -errno;
+
+	/* Bursts queued while draining are announced at once, see below */
+	shm->rx_active = true;
+
+	while ((idx = phy_shm_ring_read_idx(&seg->rsp, PHY_SHM_CTRL_RING_LEN)) >= 0) {
+		phy_shm_handle_rsp(shm, &seg->rsp_slots[idx]);
+		phy_shm_ring_read_done(&seg->rsp);
+	}
+
+	while ((idx = phy_shm_ring_read_idx(&seg->dl, PHY_SHM_BURST_RING_LEN)) >= 0) {
+		phy_shm_handle_burst_ind(shm, &seg->dl_slots[idx]);
+		phy_shm_ring_read_done(&seg->dl);
+	}
+
+	shm->rx_active = false;
+	if (shm->tx_pending)
+		phy_shm_wake(shm);
+
+	return 0;
+}
+
+static int phy_shm_sock_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct phy_shm *shm = ofd->data;
+	uint8_t buf[64];
+	ssize_t rc;
+
+	/* Nothing is expected here, except for the end of the session */
+	rc = recv(ofd->fd, buf, sizeof(buf), MSG_DONTWAIT);
+	if (rc > 0 || (rc < 0 && errno == EAGAIN))
+		return 0;
+
+	phy_shm_failure(shm);
+	return -EBADF;
+}
+
+int phy_shm_handle_phyif_burst_req(struct phy_shm *shm, const struct trxcon_phyif_burst_req *br)
+{
+	struct phy_shm_seg *seg = shm->seg;
+	struct phy_shm_burst *b;
+	int idx;
+
+	if (br->burst_len > PHY_SHM_BURST_LEN_MAX)
+		return -EINVAL;
+
+	idx = phy_shm_ring_write_idx(&seg->ul, PHY_SHM_BURST_RING_LEN);
+	if (idx < 0) {
+		LOGPSHM(shm, DTRXD, LOGL_ERROR,
+			"UL ring is full, dropping burst fn=%u tn=%u\n", br->fn, br->tn);
+		return -ENOBUFS;
+	}
+
+	b = &seg->ul_slots[idx];
+	b->fn = br->fn;
+	b->tn = br->tn;
+	b->pwr = br->pwr;
+	b->burst_len = br->burst_len;
+	if (br->burst_len > 0)
+		memcpy(&b->burst[0], br->burst, br->burst_len);
+	phy_shm_ring_write_done(&seg->ul);
+
+	/* Bursts sent in response to RTS.ind are announced in one go */
+	shm->tx_pending = true;
+	if (!shm->rx_active)
+		phy_shm_wake(shm);
+
+	return 0;
+}
+
+int phy_shm_handle_phyif_cmd(struct phy_shm *shm, const struct trxcon_phyif_cmd *cmd)
+{
+	struct phy_shm_seg *seg = shm->seg;
+	struct phy_shm_ctrl *ctrl;
+	int idx;
+
+	idx = phy_shm_ring_write_idx(&seg->cmd, PHY_SHM_CTRL_RING_LEN);
+	if (idx < 0) {
+		LOGPSHM(shm, DTRXC, LOGL_ERROR, "Control ring is full\n");
+		return -ENOBUFS;
+	}
+
+	ctrl = &seg->cmd_slots[idx];
+	memset(ctrl, 0, sizeof(*ctrl));
+	ctrl->type = cmd->type;
+
+	switch (cmd->type) {
+	case TRXCON_PHYIF_CMDT_RESET:
+	case TRXCON_PHYIF_CMDT_POWEROFF:
+		shm->powered_up = false;
+		break;
+	case TRXCON_PHYIF_CMDT_POWERON:
+		shm->powered_up = true;
+		break;
+	case TRXCON_PHYIF_CMDT_MEASURE:
+		ctrl->param.measure.band_arfcn = cmd->param.measure.band_arfcn;
+		/* band_arfcn_stop is optional */
+		ctrl->param.measure.band_arfcn_stop = OSMO_MAX(cmd->param.measure.band_arfcn_stop,
+							       cmd->param.measure.band_arfcn);
+		break;
+	case TRXCON_PHYIF_CMDT_SETFREQ_H0:
+		ctrl->param.setfreq_h0.band_arfcn = cmd->param.setfreq_h0.band_arfcn;
+		break;
+	case TRXCON_PHYIF_CMDT_SETFREQ_H1:
+		if (cmd->param.setfreq_h1.ma_len > PHY_SHM_MA_LEN_MAX)
+			return -EINVAL;
+		ctrl->param.setfreq_h1.hsn = cmd->param.setfreq_h1.hsn;
+		ctrl->param.setfreq_h1.maio = cmd->param.setfreq_h1.maio;
+		ctrl->param.setfreq_h1.ma_len = cmd->param.setfreq_h1.ma_len;
+		memcpy(&ctrl->param.setfreq_h1.ma[0], cmd->param.setfreq_h1.ma,
+		       cmd->param.setfreq_h1.ma_len * sizeof(uint16_t));
+		break;
+	case TRXCON_PHYIF_CMDT_SETSLOT:
+		ctrl->param.setslot.tn = cmd->param.setslot.tn;
+		ctrl->param.setslot.pchan = cmd->param.setslot.pchan;
+		break;
+	case TRXCON_PHYIF_CMDT_SETTA:
+		ctrl->param.setta.ta = cmd->param.setta.ta;
+		break;
+	default:
+		LOGPSHM(shm, DTRXC, LOGL_ERROR, "Unhandled PHYIF command type=0x%02x\n", cmd->type);
+		return -ENODEV;
+	}
+
+	phy_shm_ring_write_done(&seg->cmd);
+
+	/* Commands are rare, no point in deferring the wakeup */
+	phy_shm_wake(shm);
+
+	return 0;
+}
+
+/* Close all descriptors received along with a message */
+static void phy_shm_close_fds(struct msghdr *msg)
+{
+	struct cmsghdr *cmsg;
+	unsigned int i, num;
+	int fd;
+
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+		num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		for (i = 0; i < num; i++) {
+			memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+			close(fd);
+		}
+	}
+}
+
+/* Receive the hello message and the descriptors from the transceiver.
+ * On error, the received descriptors (if any) are closed. */
+static int phy_shm_recv_hello(struct phy_shm *shm, int sock, int *fds)
+{
+	union {
+		char buf[CMSG_SPACE(sizeof(int) * _PHY_SHM_FD_NUM)];
+		struct cmsghdr align;
+	} cbuf;
+	struct phy_shm_hello hello;
+	struct iovec iov = {
+		.iov_base = &hello,
+		.iov_len = sizeof(hello),
+	};
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf.buf,
+		.msg_controllen = sizeof(cbuf.buf),
+	};
+	struct cmsghdr *cmsg;
+	ssize_t rc;
+
+	rc = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+	if (rc < 0)
+		return -errno;
+
+	/* The descriptors are installed by now, even if the message is bad */
+	if (rc != sizeof(hello) || (msg.msg_flags & MSG_CTRUNC)) {
+		rc = -EBADMSG;
+		goto error;
+	}
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+	    cmsg->cmsg_len != CMSG_LEN(sizeof(int) * _PHY_SHM_FD_NUM)) {
+		rc = -EBADMSG;
+		goto error;
+	}
+
+	if (hello.magic != PHY_SHM_MAGIC || hello.version != PHY_SHM_VERSION ||
+	    hello.seg_size < sizeof(struct phy_shm_seg)) {
+		LOGPSHM(shm, DTRXC, LOGL_ERROR,
+			"Unexpected hello (magic=0x%08x, version=%u, size=%u)\n",
+			hello.magic, hello.version, hello.seg_size);
+		rc = -EPROTO;
+		goto error;
+	}
+
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(int) * _PHY_SHM_FD_NUM);
+	shm->seg_size = hello.seg_size;
+	return 0;
+
+error:
+	phy_shm_close_fds(&msg);
+	return rc;
+}
+
+/* Connect to the transceiver and map the shared segment */
+static int phy_shm_connect(struct phy_shm *shm, const char *path)
+{
+	const struct timeval tv = {
+		.tv_sec = PHY_SHM_HELLO_TIMEOUT_MS / 1000,
+		.tv_usec = (PHY_SHM_HELLO_TIMEOUT_MS % 1000) * 1000,
+	};
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int fds[_PHY_SHM_FD_NUM];
+	int sock, rc;
+
+	if (osmo_strlcpy(addr.sun_path, path, sizeof(addr.sun_path)) >= sizeof(addr.sun_path))
+		return -ENAMETOOLONG;
+
+	sock = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (sock < 0)
+		return -errno;
+	shm->sock_ofd.fd = sock;
+
+	if (connect(sock, (const struct sockaddr *)&addr, sizeof(addr)) != 0)
+		return -errno;
+	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	rc = phy_shm_recv_hello(shm, sock, &fds[0]);
+	if (rc != 0)
+		return rc;
+
+	shm->efd_ofd.fd = fds[PHY_SHM_FD_TO_TRXCON];
+	shm->efd_tx = fds[PHY_SHM_FD_TO_PHY];
+
+	shm->seg = mmap(NULL, shm->seg_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, fds[PHY_SHM_FD_SEG], 0);
+	close(fds[PHY_SHM_FD_SEG]);
+	if (shm->seg == MAP_FAILED) {
+		shm->seg = NULL;
+		return -errno;
+	}
+
+	if (shm->seg->magic != PHY_SHM_MAGIC || shm->seg->version != PHY_SHM_VERSION)
+		return -EPROTO;
+
+	return 0;
+}
+
+/* Init shared memory interface to the transceiver */
+struct phy_shm *phy_shm_open(const struct phy_shm_params *params)
+{
+	struct phy_shm *shm;
+	char *path;
+	int rc;
+
+	shm = talloc_zero(params->parent_fi, struct phy_shm);
+	if (shm == NULL)
+		return NULL;
+
+	osmo_fd_setup(&shm->sock_ofd, -1, OSMO_FD_READ, &phy_shm_sock_cb, shm, 0);
+	osmo_fd_setup(&shm->efd_ofd, -1, OSMO_FD_READ, &phy_shm_efd_cb, shm, 0);
+	shm->efd_tx = -1;
+
+	shm->fn_advance = params->fn_advance;
+	shm->parent_fi = params->parent_fi;
+	shm->parent_term_event = params->parent_term_event;
+	shm->priv = params->priv;
+
+	/* Each transceiver instance gets its own socket */
+	if (params->instance > 0)
+		path = talloc_asprintf(shm, "%s.%u", params->sock_path, params->instance);
+	else
+		path = talloc_strdup(shm, params->sock_path);
+
+	LOGPSHM(shm, DTRXC, LOGL_NOTICE,
+		"Init shared memory transceiver interface (%s)\n", path);
+
+	rc = phy_shm_connect(shm, path);
+	if (rc != 0) {
+		LOGPSHM(shm, DTRXC, LOGL_ERROR,
+			"Couldn't attach to the transceiver at '%s': %s\n",
+			path, strerror(-rc));
+		phy_shm_free(shm);
+		return NULL;
+	}
+
+	talloc_free(path);
+
+	if (osmo_fd_register(&shm->sock_ofd) != 0 ||
+	    osmo_fd_register(&shm->efd_ofd) != 0) {
+		phy_shm_free(shm);
+		return NULL;
+	}
+
+	return shm;
+}
+
+void phy_shm_close(struct phy_shm *shm)
+{
+	struct trxcon_phyif_cmd cmd = { .type = TRXCON_PHYIF_CMDT_POWEROFF };
+
+	if (shm == NULL)
+		return;
+
+	LOGPSHM(shm, DTRXC, LOGL_NOTICE, "Shutdown transceiver interface\n");
+
+	/* Power off if the transceiver is up */
+	if (shm->powered_up)
+		phy_shm_handle_phyif_cmd(shm, &cmd);
+
+	phy_shm_free(shm);
+}
@@ -0,0 +1,586 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * Loopback transceiver for the shared memory PHY interface
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/* A stand-in for a co-located transceiver, serving one 'trxcon --trx-shm'
+ * instance at a time.  It runs the TDMA clock from a timerfd and indicates
+ * NOPE.ind on all 8 timeslots of every frame.  Each Uplink burst is looped
+ * back and indicated as a Downlink burst in the frame it was sent for, so the
+ * scheduler gets real work to do.  Uplink bursts arriving after the start of
+ * their frame are counted as late; the slack of the others is reported.
+ *
+ * Power measurements report -110 dBm, except for the ARFCN given by '-a'.
+ *
+ * Usage: phy_shm_loopback [-v] [-s PATH] [-a ARFCN] */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/gsm0502.h>
+
+#include <osmocom/bb/trxcon/phy_shm.h>
+
+/* 120 ms / 26 frames */
+#define TDMA_FN_DURATION_NS	4615385
+
+#define DBM_NOISE		-110
+#define DBM_CARRIER		-60
+
+#define ARFCN_MASK		0x3ff
+
+/* Uplink bursts are kept for this many frames ahead (power of 2) */
+#define UL_FRAMES		16
+
+struct loopback_ul {
+	uint32_t fn;
+	bool valid;
+	uint16_t burst_len;
+	sbit_t burst[PHY_SHM_BURST_LEN_MAX];
+};
+
+static struct {
+	const char *sock_path;
+	int carrier_arfcn;
+	bool verbose;
+	volatile sig_atomic_t quit;
+
+	int listen_fd;
+	int timer_fd;
+
+	/* the client (one at a time) */
+	int conn_fd;
+	int efd_rx;
+	int efd_tx;
+	struct phy_shm_seg *seg;
+	bool powered;
+
+	/* TDMA clock */
+	uint32_t fn;
+	uint64_t fn_time_ns;
+
+	/* Uplink bursts to be looped back, indexed by TN and FN */
+	struct loopback_ul ul[8][UL_FRAMES];
+
+	/* Power measurement in progress */
+	struct {
+		uint16_t next;
+		uint16_t stop;
+		bool active;
+	} meas;
+	/* responses were queued, but not announced yet */
+	bool rsp_pending;
+
+	unsigned long num_dl;
+	unsigned long num_dl_drop;
+	unsigned long num_ul;
+	unsigned long num_ul_nope;
+	unsigned long num_ul_late;
+	unsigned long num_ul_early;
+	unsigned long num_cmd;
+	int64_t slack_min_ns;
+	int64_t slack_sum_ns;
+} g_lb = {
+	.sock_path = PHY_SHM_SOCK_PATH,
+	.carrier_arfcn = -1,
+	.conn_fd = -1,
+	.efd_rx = -1,
+	.efd_tx = -1,
+	.slack_min_ns = INT64_MAX,
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void wake(int efd)
+{
+	const uint64_t val = 1;
+
+	if (write(efd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		fprintf(stderr, "Failed to write eventfd: %s\n", strerror(errno));
+}
+
+static void print_stats(void)
+{
+	unsigned long on_time = g_lb.num_ul - g_lb.num_ul_nope
+				- g_lb.num_ul_late - g_lb.num_ul_early;
+
+	printf("DL: %lu bursts (%lu dropped), UL: %lu bursts (%lu NOPE.req, %lu late, "
+	       "%lu too early), %lu commands\n", g_lb.num_dl, g_lb.num_dl_drop, g_lb.num_ul,
+	       g_lb.num_ul_nope, g_lb.num_ul_late, g_lb.num_ul_early, g_lb.num_cmd);
+	if (on_time > 0) {
+		printf("UL slack: min %" PRId64 " us, avg %" PRId64 " us\n",
+		       g_lb.slack_min_ns / 1000,
+		       g_lb.slack_sum_ns / (int64_t)on_time / 1000);
+	}
+}
+
+static void client_close(void)
+{
+	if (g_lb.conn_fd < 0)
+		return;
+
+	printf("Client disconnected\n");
+	print_stats();
+
+	close(g_lb.conn_fd);
+	close(g_lb.efd_rx);
+	close(g_lb.efd_tx);
+	munmap(g_lb.seg, sizeof(*g_lb.seg));
+	g_lb.conn_fd = g_lb.efd_rx = g_lb.efd_tx = -1;
+	g_lb.seg = NULL;
+	g_lb.powered = false;
+	g_lb.meas.active = false;
+	g_lb.rsp_pending = false;
+	memset(&g_lb.ul[0], 0, sizeof(g_lb.ul));
+}
+
+static int client_accept(void)
+{
+	int fds[_PHY_SHM_FD_NUM] = { -1, -1, -1 };
+	union {
+		char buf[CMSG_SPACE(sizeof(fds))];
+		struct cmsghdr align;
+	} cbuf;
+	const struct phy_shm_hello hello = {
+		.magic = PHY_SHM_MAGIC,
+		.version = PHY_SHM_VERSION,
+		.seg_size = sizeof(struct phy_shm_seg),
+	};
+	struct iovec iov = {
+		.iov_base = (void *)&hello,
+		.iov_len = sizeof(hello),
+	};
+	struct msghdr msg = {
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+		.msg_control = cbuf.buf,
+		.msg_controllen = sizeof(cbuf.buf),
+	};
+	struct cmsghdr *cmsg;
+	unsigned int i;
+	int fd;
+
+	fd = accept4(g_lb.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	/* A transceiver serves one client at a time */
+	if (g_lb.conn_fd >= 0) {
+		fprintf(stderr, "Rejecting a connection, already serving a client\n");
+		close(fd);
+		return -EBUSY;
+	}
+
+	fds[PHY_SHM_FD_SEG] = memfd_create("phy_shm", MFD_CLOEXEC);
+	fds[PHY_SHM_FD_TO_TRXCON] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	fds[PHY_SHM_FD_TO_PHY] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (fds[PHY_SHM_FD_SEG] < 0 || fds[PHY_SHM_FD_TO_TRXCON] < 0 || fds[PHY_SHM_FD_TO_PHY] < 0)
+		goto error;
+
+	if (ftruncate(fds[PHY_SHM_FD_SEG], sizeof(struct phy_shm_seg)) != 0)
+		goto error;
+	g_lb.seg = mmap(NULL, sizeof(struct phy_shm_seg), PROT_READ | PROT_WRITE,
+			MAP_SHARED, fds[PHY_SHM_FD_SEG], 0);
+	if (g_lb.seg == MAP_FAILED) {
+		g_lb.seg = NULL;
+		goto error;
+	}
+
+	/* memfd is zero-filled, so are the rings */
+	g_lb.seg->magic = PHY_SHM_MAGIC;
+	g_lb.seg->version = PHY_SHM_VERSION;
+	g_lb.seg->size = sizeof(struct phy_shm_seg);
+
+	cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), &fds[0], sizeof(fds));
+
+	if (sendmsg(fd, &msg, 0) != sizeof(hello))
+		goto error;
+
+	close(fds[PHY_SHM_FD_SEG]);
+	g_lb.conn_fd = fd;
+	g_lb.efd_tx = fds[PHY_SHM_FD_TO_TRXCON];
+	g_lb.efd_rx = fds[PHY_SHM_FD_TO_PHY];
+
+	printf("Client connected\n");
+	return 0;
+
+error:
+	fprintf(stderr, "Failed to set up a client: %s\n", strerror(errno));
+	if (g_lb.seg != NULL)
+		munmap(g_lb.seg, sizeof(struct phy_shm_seg));
+	g_lb.seg = NULL;
+	for (i = 0; i < ARRAY_SIZE(fds); i++) {
+		if (fds[i] >= 0)
+			close(fds[i]);
+	}
+	close(fd);
+	return -EIO;
+}
+
+static bool send_rsp(const struct phy_shm_ctrl *rsp)
+{
+	int idx = phy_shm_ring_write_idx(&g_lb.seg->rsp, PHY_SHM_CTRL_RING_LEN);
+
+	if (idx < 0)
+		return false;
+
+	g_lb.seg->rsp_slots[idx] = *rsp;
+	phy_shm_ring_write_done(&g_lb.seg->rsp);
+	g_lb.rsp_pending = true;
+	return true;
+}
+
+/* Report the pending measurements, as many as the response ring takes */
+static void meas_continue(void)
+{
+	struct phy_shm_ctrl rsp;
+	unsigned int i;
+
+	while (g_lb.meas.active) {
+		const unsigned int left = g_lb.meas.stop - g_lb.meas.next + 1;
+
+		memset(&rsp, 0, sizeof(rsp));
+		rsp.type = TRXCON_PHYIF_CMDT_MEASURE;
+		rsp.param.measure_rsp.band_arfcn = g_lb.meas.next;
+		rsp.param.measure_rsp.num = OSMO_MIN(left, PHY_SHM_MEAS_MAX);
+
+		for (i = 0; i < rsp.param.measure_rsp.num; i++) {
+			const int arfcn = (g_lb.meas.next + i) & ARFCN_MASK;
+
+			rsp.param.measure_rsp.dbm[i] = arfcn == g_lb.carrier_arfcn ?
+						       DBM_CARRIER : DBM_NOISE;
+		}
+
+		if (!send_rsp(&rsp))
+			break;
+
+		g_lb.meas.next += rsp.param.measure_rsp.num;
+		if (rsp.param.measure_rsp.num == left)
+			g_lb.meas.active = false;
+	}
+}
+
+static void handle_cmd(const struct phy_shm_ctrl *cmd)
+{
+	struct phy_shm_ctrl rsp;
+
+	g_lb.num_cmd++;
+	if (g_lb.verbose)
+		printf("Command type=%u\n", cmd->type);
+
+	switch (cmd->type) {
+	case TRXCON_PHYIF_CMDT_RESET:
+	case TRXCON_PHYIF_CMDT_POWEROFF:
+		g_lb.powered = false;
+		g_lb.meas.active = false;
+		memset(&g_lb.ul[0], 0, sizeof(g_lb.ul));
+		break;
+	case TRXCON_PHYIF_CMDT_POWERON:
+		g_lb.powered = true;
+		break;
+	case TRXCON_PHYIF_CMDT_MEASURE:
+		/* Ranges longer than PHY_SHM_MEAS_MAX are reported in parts */
+		g_lb.meas.next = cmd->param.measure.band_arfcn;
+		g_lb.meas.stop = OSMO_MAX(cmd->param.measure.band_arfcn_stop,
+					  cmd->param.measure.band_arfcn);
+		g_lb.meas.active = true;
+		meas_continue();
+		break;
+	case TRXCON_PHYIF_CMDT_SETFREQ_H0:
+	case TRXCON_PHYIF_CMDT_SETFREQ_H1:
+	case TRXCON_PHYIF_CMDT_SETSLOT:
+	case TRXCON_PHYIF_CMDT_SETTA:
+		/* Nothing to tune, frequencies do not matter for a loopback */
+		break;
+	default:
+		memset(&rsp, 0, sizeof(rsp));
+		rsp.type = cmd->type;
+		rsp.status = -ENOTSUP;
+		send_rsp(&rsp);
+		break;
+	}
+}
+
+static void handle_ul_burst(const struct phy_shm_burst *b, uint64_t now)
+{
+	struct loopback_ul *ul;
+	int32_t frames;
+	int64_t slack;
+	unsigned int i;
+
+	g_lb.num_ul++;
+	if (b->burst_len == 0) {
+		g_lb.num_ul_nope++;
+		return;
+	}
+
+	/* Time left until the start of the frame (after the current one) */
+	frames = GSM_TDMA_FN_SUB(b->fn, g_lb.fn);
+	if (b->tn >= 8 || frames <= 0 || frames > GSM_TDMA_HYPERFRAME / 2) {
+		g_lb.num_ul_late++;
+		return;
+	}
+	if (frames >= UL_FRAMES) {
+		g_lb.num_ul_early++;
+		return;
+	}
+
+	slack = (int64_t)(g_lb.fn_time_ns + (uint64_t)frames * TDMA_FN_DURATION_NS) - (int64_t)now;
+	if (slack < g_lb.slack_min_ns)
+		g_lb.slack_min_ns = slack;
+	g_lb.slack_sum_ns += slack;
+
+	ul = &g_lb.ul[b->tn][b->fn % UL_FRAMES];
+	ul->fn = b->fn;
+	ul->valid = true;
+	ul->burst_len = OSMO_MIN(b->burst_len, PHY_SHM_BURST_LEN_MAX);
+	for (i = 0; i < ul->burst_len; i++)
+		ul->burst[i] = b->burst[i] ? -127 : 127;
+}
+
+static void handle_wakeup(void)
+{
+	struct phy_shm_seg *seg = g_lb.seg;
+	uint64_t now = now_ns();
+	uint64_t val;
+	int idx;
+
+	if (read(g_lb.efd_rx, &val, sizeof(val)) < 0 && errno != EAGAIN)
+		return;
+
+	while ((idx = phy_shm_ring_read_idx(&seg->cmd, PHY_SHM_CTRL_RING_LEN)) >= 0) {
+		handle_cmd(&seg->cmd_slots[idx]);
+		phy_shm_ring_read_done(&seg->cmd);
+	}
+
+	while ((idx = phy_shm_ring_read_idx(&seg->ul, PHY_SHM_BURST_RING_LEN)) >= 0) {
+		handle_ul_burst(&seg->ul_slots[idx], now);
+		phy_shm_ring_read_done(&seg->ul);
+	}
+
+	/* Measurement responses, if any */
+	if (g_lb.rsp_pending) {
+		g_lb.rsp_pending = false;
+		wake(g_lb.efd_tx);
+	}
+}
+
+/* Indicate all timeslots of the current frame */
+static void clock_tick(void)
+{
+	struct phy_shm_seg *seg = g_lb.seg;
+	struct phy_shm_burst *b;
+	unsigned int tn;
+	int idx;
+
+	for (tn = 0; tn < 8; tn++) {
+		struct loopback_ul *ul = &g_lb.ul[tn][g_lb.fn % UL_FRAMES];
+
+		idx = phy_shm_ring_write_idx(&seg->dl, PHY_SHM_BURST_RING_LEN);
+		if (idx < 0) {
+			g_lb.num_dl_drop++;
+			continue;
+		}
+
+		b = &seg->dl_slots[idx];
+		memset(b, 0, offsetof(struct phy_shm_burst, burst));
+		b->fn = g_lb.fn;
+		b->tn = tn;
+		b->rssi = DBM_CARRIER;
+
+		if (ul->valid && ul->fn == g_lb.fn) {
+			b->flags = TRXCON_PHYIF_BI_F_MTS;
+			b->mod = TRXCON_PHYIF_MOD_GMSK;
+			b->burst_len = ul->burst_len;
+			memcpy(&b->burst[0], &ul->burst[0], ul->burst_len);
+			ul->valid = false;
+		}
+
+		phy_shm_ring_write_done(&seg->dl);
+		g_lb.num_dl++;
+	}
+
+	g_lb.rsp_pending = false;
+	wake(g_lb.efd_tx);
+}
+
+static void handle_timer(void)
+{
+	uint64_t expirations;
+
+	if (read(g_lb.timer_fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+		return;
+
+	while (expirations-- > 0) {
+		g_lb.fn = GSM_TDMA_FN_INC(g_lb.fn);
+		g_lb.fn_time_ns = now_ns();
+		if (g_lb.seg == NULL)
+			continue;
+		/* The response ring may have been full */
+		meas_continue();
+		if (g_lb.powered)
+			clock_tick();
+		else if (g_lb.rsp_pending)
+			wake(g_lb.efd_tx);
+	}
+}
+
+static int listen_open(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int fd;
+
+	if (osmo_strlcpy(addr.sun_path, path, sizeof(addr.sun_path)) >= sizeof(addr.sun_path))
+		return -ENAMETOOLONG;
+
+	fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return -errno;
+
+	unlink(path);
+	if (bind(fd, (const struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+		close(fd);
+		return -errno;
+	}
+
+	return fd;
+}
+
+static void signal_handler(int signum)
+{
+	g_lb.quit = 1;
+}
+
+static void print_usage(const char *app)
+{
+	printf("Usage: %s [-v] [-s PATH] [-a ARFCN]\n", app);
+	printf("  -s  Listening socket (default %s)\n", PHY_SHM_SOCK_PATH);
+	printf("  -a  ARFCN to report a carrier on (-60 dBm)\n");
+	printf("  -v  Print the commands received\n");
+}
+
+int main(int argc, char **argv)
+{
+	const struct itimerspec its = {
+		.it_interval = { .tv_nsec = TDMA_FN_DURATION_NS },
+		.it_value = { .tv_nsec = TDMA_FN_DURATION_NS },
+	};
+	struct pollfd pfd[4];
+	int opt, rc;
+
+	while ((opt = getopt(argc, argv, "s:a:vh")) != -1) {
+		switch (opt) {
+		case 's':
+			g_lb.sock_path = optarg;
+			break;
+		case 'a':
+			g_lb.carrier_arfcn = atoi(optarg);
+			break;
+		case 'v':
+			g_lb.verbose = true;
+			break;
+		default:
+			print_usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	signal(SIGINT, &signal_handler);
+	signal(SIGTERM, &signal_handler);
+	signal(SIGPIPE, SIG_IGN);
+
+	g_lb.listen_fd = listen_open(g_lb.sock_path);
+	if (g_lb.listen_fd < 0) {
+		fprintf(stderr, "Failed to listen on '%s': %s\n",
+			g_lb.sock_path, strerror(-g_lb.listen_fd));
+		return 1;
+	}
+
+	g_lb.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (g_lb.timer_fd < 0 || timerfd_settime(g_lb.timer_fd, 0, &its, NULL) != 0) {
+		fprintf(stderr, "Failed to start the TDMA clock: %s\n", strerror(errno));
+		return 1;
+	}
+
+	printf("Listening on '%s'\n", g_lb.sock_path);
+
+	while (!g_lb.quit) {
+		nfds_t n = 0;
+
+		pfd[n++] = (struct pollfd) { .fd = g_lb.timer_fd, .events = POLLIN };
+		pfd[n++] = (struct pollfd) { .fd = g_lb.listen_fd, .events = POLLIN };
+		if (g_lb.conn_fd >= 0) {
+			pfd[n++] = (struct pollfd) { .fd = g_lb.efd_rx, .events = POLLIN };
+			pfd[n++] = (struct pollfd) { .fd = g_lb.conn_fd, .events = POLLIN };
+		}
+
+		rc = poll(pfd, n, -1);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (pfd[0].revents & POLLIN)
+			handle_timer();
+		if (pfd[1].revents & POLLIN)
+			client_accept();
+		if (n > 2) {
+			if (pfd[2].revents & POLLIN)
+				handle_wakeup();
+			/* The client does not send anything, so this is EOF */
+			if (pfd[3].revents & (POLLIN | POLLHUP | POLLERR))
+				client_close();
+		}
+	}
+
+	client_close();
+	close(g_lb.timer_fd);
+	close(g_lb.listen_fd);
+	unlink(g_lb.sock_path);
+
+	return 0;
+}
@@ -0,0 +1,558 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * Synthetic PHY: a built-in cell for testing and benchmarking
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <osmocom/core/logging.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/timer.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/core/bits.h>
+#include <osmocom/core/fsm.h>
+
+#include <osmocom/gsm/gsm_utils.h>
+#include <osmocom/gsm/gsm0502.h>
+#include <osmocom/gsm/protocol/gsm_04_08.h>
+#include <osmocom/coding/gsm0503_coding.h>
+
+#include <osmocom/bb/l1sched/l1sched.h>
+#include <osmocom/bb/trxcon/phy_synth.h>
+#include <osmocom/bb/trxcon/logging.h>
+
+#define LOGPSYN(syn, level, fmt, args...) \
+	LOGPFSMSL((syn)->parent_fi, DTRXD, level, fmt, ## args)
+
+/* 120 ms / 26 frames */
+#define FN_DURATION_NS		4615385ULL
+/* Max number of TDMA frames generated by one timer callback */
+#define FRAMES_PER_CB_MAX	51
+
+#define RSSI_CELL		-60
+#define RSSI_NOISE		-110
+
+/* Default System Information (MCC 001, MNC 01, LAC 1, CI 1), CCCH not
+ * combined.  The Cell Channel Description of SI1 is filled in at run-time. */
+static const uint8_t si1_default[GSM_MACBLOCK_LEN] = {
+	0x55, 0x06, 0x19,
+	/* Cell Channel Description (bit map 0) */
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	/* RACH Control Parameters */
+	0xe5, 0x00, 0x00,
+	0x2b,
+};
+
+static const uint8_t si2_default[GSM_MACBLOCK_LEN] = {
+	0x59, 0x06, 0x1a,
+	/* Neighbour Cell Description (empty) */
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	/* NCC Permitted, RACH Control Parameters */
+	0xff, 0xe5, 0x00, 0x00,
+};
+
+static const uint8_t si3_default[GSM_MACBLOCK_LEN] = {
+	0x49, 0x06, 0x1b,
+	/* Cell Identity, LAI */
+	0x00, 0x01, 0x00, 0xf1, 0x10, 0x00, 0x01,
+	/* Control Channel Description, Cell Options, Cell Selection Parameters */
+	0x48, 0x00, 0x00, 0x0f, 0x05, 0x00,
+	/* RACH Control Parameters */
+	0xe5, 0x00, 0x00,
+	0x2b, 0x2b, 0x2b, 0x2b,
+};
+
+static const uint8_t si4_default[GSM_MACBLOCK_LEN] = {
+	0x31, 0x06, 0x1c,
+	/* LAI, Cell Selection Parameters, RACH Control Parameters */
+	0x00, 0xf1, 0x10, 0x00, 0x01, 0x05, 0x00, 0xe5, 0x00, 0x00,
+	0x2b, 0x2b, 0x2b, 0x2b, 0x2b, 0x2b, 0x2b, 0x2b, 0x2b, 0x2b,
+};
+
+/* Paging Request Type 1 without any identities */
+static const uint8_t ccch_fill[GSM_MACBLOCK_LEN] = {
+	0x15, 0x06, 0x21, 0x00, 0x01, 0xf0, 0x2b, 0x2b,
+	0x2b, 0x2b, 0x2b, 0x2b, 0x2b, 0x2b, 0x2b, 0x2b,
+	0x2b, 0x2b, 0x2b, 0x2b, 0x2b, 0x2b, 0x2b,
+};
+
+/* The cell shared by all instances, built by the first phy_synth_open() */
+static struct {
+	pthread_mutex_t lock;
+	bool ready;
+
+	uint16_t band_arfcn;
+	uint8_t bsic;
+	bool echo;
+
+	/* CLOCK_MONOTONIC time of TDMA frame 0 */
+	uint64_t epoch_ns;
+
+	/* Timeslot 0 bursts (soft-bits), the SCH is encoded on demand */
+	sbit_t fcch[148];
+	sbit_t bcch[8][4][148]; /* by TC */
+	sbit_t ccch[4][148];
+} g_cell = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Map the 116 coded bits of a Normal Burst, convert to soft-bits */
+static void map_nb(sbit_t *burst, const ubit_t *payload, uint8_t tsc)
+{
+	ubit_t nb[148];
+
+	memset(&nb[0], 0, 3);
+	memcpy(&nb[3], &payload[0], 58);
+	memcpy(&nb[61], l1sched_nb_training_bits[tsc], 26);
+	memcpy(&nb[87], &payload[58], 58);
+	memset(&nb[145], 0, 3);
+
+	osmo_ubit2sbit(burst, &nb[0], 148);
+}
+
+static int encode_xcch(sbit_t (*bursts)[148], const uint8_t *l2, uint8_t tsc)
+{
+	ubit_t coded[4 * 116];
+	unsigned int i;
+
+	if (gsm0503_xcch_encode(&coded[0], l2) != 0)
+		return -EINVAL;
+
+	for (i = 0; i < 4; i++)
+		map_nb(bursts[i], &coded[i * 116], tsc);
+
+	return 0;
+}
+
+/* BCCH TC for each SI type (3GPP TS 45.002, section 6.3.1.3) */
+static int si_tc(uint8_t msg_type)
+{
+	switch (msg_type) {
+	case 0x19: /* SI1 */
+		return 0;
+	case 0x1a: /* SI2 */
+		return 1;
+	case 0x1b: /* SI3 */
+		return 2;
+	case 0x1c: /* SI4 */
+		return 3;
+	case 0x03: /* SI2ter */
+	case 0x07: /* SI2quater */
+		return 4;
+	case 0x02: /* SI2bis */
+		return 5;
+	default:
+		return -1;
+	}
+}
+
+/* Read hex-encoded SI messages, one per line; empty lines and '#' are skipped */
+static int read_si_file(uint8_t (*si)[GSM_MACBLOCK_LEN], bool *present, const char *path)
+{
+	char line[256], hex[256];
+	unsigned int i, n;
+	FILE *f;
+	int tc;
+
+	f = fopen(path, "r");
+	if (f == NULL)
+		return -errno;
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		uint8_t msg[GSM_MACBLOCK_LEN];
+
+		for (i = 0, n = 0; line[i] != '\0' && line[i] != '#'; i++) {
+			if (!isspace((unsigned char)line[i]))
+				hex[n++] = line[i];
+		}
+		hex[n] = '\0';
+		if (n == 0)
+			continue;
+
+		if (osmo_hexparse(hex, &msg[0], sizeof(msg)) != sizeof(msg)) {
+			LOGP(DTRXD, LOGL_ERROR, "Malformed SI message '%s' in '%s'\n", hex, path);
+			fclose(f);
+			return -EINVAL;
+		}
+
+		tc = si_tc(msg[2]);
+		if (tc < 0) {
+			LOGP(DTRXD, LOGL_ERROR, "Unsupported SI type 0x%02x in '%s'\n", msg[2], path);
+			fclose(f);
+			return -EINVAL;
+		}
+
+		memcpy(si[tc], &msg[0], sizeof(msg));
+		present[tc] = true;
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static int cell_build(const struct phy_synth_params *params)
+{
+	uint8_t si[8][GSM_MACBLOCK_LEN];
+	bool present[8] = { false };
+	const uint8_t tsc = params->bsic & 0x07;
+	const uint16_t arfcn = params->band_arfcn & ~ARFCN_FLAG_MASK;
+	unsigned int tc;
+	int rc;
+
+	memcpy(si[0], si1_default, GSM_MACBLOCK_LEN);
+	memcpy(si[1], si2_default, GSM_MACBLOCK_LEN);
+	memcpy(si[2], si3_default, GSM_MACBLOCK_LEN);
+	memcpy(si[3], si4_default, GSM_MACBLOCK_LEN);
+	present[0] = present[1] = present[2] = present[3] = true;
+
+	/* Cell Channel Description, bit map 0 covers ARFCN 1..124 only */
+	if (arfcn >= 1 && arfcn <= 124)
+		si[0][3 + 15 - (arfcn - 1) / 8] |= 1 << ((arfcn - 1) % 8);
+
+	if (params->si_path != NULL) {
+		rc = read_si_file(si, present, params->si_path);
+		if (rc != 0)
+			return rc;
+	}
+
+	/* TC 6 and 7 repeat SI3 and SI4, the others default to SI3 */
+	memcpy(si[6], si[2], GSM_MACBLOCK_LEN);
+	memcpy(si[7], si[3], GSM_MACBLOCK_LEN);
+	for (tc = 4; tc < 6; tc++) {
+		if (!present[tc])
+			memcpy(si[tc], si[2], GSM_MACBLOCK_LEN);
+	}
+
+	for (tc = 0; tc < 8; tc++) {
+		rc = encode_xcch(g_cell.bcch[tc], si[tc], tsc);
+		if (rc != 0)
+			return rc;
+	}
+
+	rc = encode_xcch(g_cell.ccch, ccch_fill, tsc);
+	if (rc != 0)
+		return rc;
+
+	/* FCCH is a burst of zeros */
+	memset(&g_cell.fcch[0], 127, sizeof(g_cell.fcch));
+
+	g_cell.band_arfcn = params->band_arfcn;
+	g_cell.bsic = params->bsic;
+	g_cell.echo = params->echo;
+	g_cell.epoch_ns = now_ns();
+	g_cell.ready = true;
+
+	return 0;
+}
+
+/* Timeslot 0 of the cell, CCCH not combined.  Returns NULL for the idle frame. */
+static const sbit_t *cell_tn0_burst(uint32_t fn, sbit_t *sch)
+{
+	const unsigned int fn51 = fn % 51;
+
+	if (fn51 == 50)
+		return NULL;
+
+	switch (fn51 % 10) {
+	case 0:
+		return g_cell.fcch;
+	case 1:
+		l1sched_sch_burst_encode(sch, fn, g_cell.bsic);
+		return sch;
+	}
+
+	if (fn51 >= 2 && fn51 <= 5)
+		return g_cell.bcch[(fn / 51) % 8][fn51 - 2];
+
+	/* Frames 6..9, 12..15, 16..19, ... carry CCCH blocks */
+	return g_cell.ccch[(fn51 % 10 - 2) % 4];
+}
+
+static void synth_frame(struct phy_synth *syn, uint32_t fn)
+{
+	struct trxcon_phyif_burst_ind bi = {
+		.fn = fn,
+		.rssi = RSSI_CELL,
+		.burst_len = 148,
+	};
+	sbit_t sch[148];
+	unsigned int tn;
+
+	for (tn = 0; tn < 8; tn++) {
+		bi.tn = tn;
+		bi.burst = NULL;
+
+		if (tn == 0) {
+			if (syn->tuned)
+				bi.burst = cell_tn0_burst(fn, &sch[0]);
+		} else if (syn->echo != NULL) {
+			struct phy_synth_echo *e = &syn->echo[tn][fn % PHY_SYNTH_ECHO_FRAMES];
+
+			if (e->valid && e->fn == fn) {
+				bi.burst = &e->burst[0];
+				e->valid = false;
+			}
+		}
+
+		/* No burst means NOPE.ind, which still drives the clock */
+		if (bi.burst != NULL)
+			trxcon_phyif_handle_burst_ind(syn->priv, &bi);
+
+		const struct trxcon_phyif_rts_ind rts = {
+			.fn = GSM_TDMA_FN_SUM(fn, syn->fn_advance),
+			.tn = tn,
+		};
+
+		trxcon_phyif_handle_rts_ind(syn->priv, &rts);
+	}
+
+	syn->num_frames++;
+}
+
+/* Number of TDMA frames elapsed since the epoch of the cell's clock */
+static uint64_t clock_frames(const struct phy_synth *syn)
+{
+	return (now_ns() - g_cell.epoch_ns) * syn->speed / FN_DURATION_NS;
+}
+
+static void phy_synth_clock_cb(void *data)
+{
+	struct phy_synth *syn = data;
+	uint64_t target, lag;
+
+	if (syn->speed == 0)
+		target = syn->frame + FRAMES_PER_CB_MAX;
+	else
+		target = clock_frames(syn) + 1;
+
+	/* Frames we failed to generate in time are skipped */
+	lag = target > syn->frame ? target - syn->frame : 0;
+	if (syn->speed > 0 && lag > syn->max_lag)
+		syn->max_lag = lag;
+	if (lag > FRAMES_PER_CB_MAX) {
+		syn->num_frames_skipped += lag - FRAMES_PER_CB_MAX;
+		syn->frame = target - FRAMES_PER_CB_MAX;
+	}
+
+	while (syn->frame < target && syn->powered_up)
+		synth_frame(syn, syn->frame++ % GSM_TDMA_HYPERFRAME);
+
+	if (!syn->powered_up)
+		return;
+
+	if (syn->speed == 0) {
+		osmo_timer_schedule(&syn->clock_timer, 0, 0);
+	} else {
+		/* Wake up at the start of the next frame */
+		uint64_t next_ns = g_cell.epoch_ns + syn->frame * FN_DURATION_NS / syn->speed;
+		uint64_t now = now_ns();
+		uint64_t delay_us = next_ns > now ? (next_ns - now) / 1000 : 0;
+
+		osmo_timer_schedule(&syn->clock_timer, delay_us / 1000000, delay_us % 1000000);
+	}
+}
+
+static void phy_synth_meas_cb(void *data)
+{
+	struct phy_synth *syn = data;
+	const uint16_t start = syn->meas.band_arfcn;
+	const unsigned int left = syn->meas.band_arfcn_stop - start + 1;
+	int dbm[PHY_SYNTH_MEAS_MAX];
+	unsigned int i, num;
+
+	num = OSMO_MIN(left, PHY_SYNTH_MEAS_MAX);
+	for (i = 0; i < num; i++)
+		dbm[i] = (uint16_t)(start + i) == g_cell.band_arfcn ? RSSI_CELL : RSSI_NOISE;
+
+	/* Ranges longer than PHY_SYNTH_MEAS_MAX are reported in parts */
+	syn->meas.band_arfcn += num;
+	if (num < left)
+		osmo_timer_schedule(&syn->meas.timer, 0, 0);
+
+	const struct trxcon_phyif_rsp rsp = {
+		.type = TRXCON_PHYIF_CMDT_MEASURE,
+		.param.measure = {
+			.band_arfcn = start,
+			.dbm = &dbm[0],
+			.num = num,
+		},
+	};
+
+	trxcon_phyif_handle_rsp(syn->priv, &rsp);
+}
+
+static void phy_synth_poweroff(struct phy_synth *syn)
+{
+	syn->powered_up = false;
+	osmo_timer_del(&syn->clock_timer);
+	if (syn->echo != NULL)
+		memset(syn->echo, 0, sizeof(*syn->echo) * 8);
+}
+
+int phy_synth_handle_phyif_cmd(struct phy_synth *syn, const struct trxcon_phyif_cmd *cmd)
+{
+	unsigned int i;
+
+	switch (cmd->type) {
+	case TRXCON_PHYIF_CMDT_RESET:
+	case TRXCON_PHYIF_CMDT_POWEROFF:
+		phy_synth_poweroff(syn);
+		osmo_timer_del(&syn->meas.timer);
+		break;
+	case TRXCON_PHYIF_CMDT_POWERON:
+		if (syn->powered_up)
+			break;
+		syn->powered_up = true;
+		/* Join the cell's clock, unless running as fast as possible */
+		if (syn->speed > 0)
+			syn->frame = clock_frames(syn);
+		osmo_timer_schedule(&syn->clock_timer, 0, 0);
+		break;
+	case TRXCON_PHYIF_CMDT_MEASURE:
+		/* Responses are sent asynchronously, like a real PHY would do */
+		syn->meas.band_arfcn = cmd->param.measure.band_arfcn;
+		syn->meas.band_arfcn_stop = OSMO_MAX(cmd->param.measure.band_arfcn_stop,
+						     cmd->param.measure.band_arfcn);
+		osmo_timer_schedule(&syn->meas.timer, 0, 0);
+		break;
+	case TRXCON_PHYIF_CMDT_SETFREQ_H0:
+		syn->tuned = cmd->param.setfreq_h0.band_arfcn == g_cell.band_arfcn;
+		break;
+	case TRXCON_PHYIF_CMDT_SETFREQ_H1:
+		/* The cell is single-carrier, timeslot 0 does not hop */
+		syn->tuned = false;
+		for (i = 0; i < cmd->param.setfreq_h1.ma_len; i++) {
+			if (cmd->param.setfreq_h1.ma[i] == g_cell.band_arfcn)
+				syn->tuned = true;
+		}
+		break;
+	case TRXCON_PHYIF_CMDT_SETSLOT:
+	case TRXCON_PHYIF_CMDT_SETTA:
+		/* Nothing to configure */
+		break;
+	default:
+		LOGPSYN(syn, LOGL_ERROR, "Unhandled PHYIF command type=0x%02x\n", cmd->type);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+int phy_synth_handle_phyif_burst_req(struct phy_synth *syn, const struct trxcon_phyif_burst_req *br)
+{
+	struct phy_synth_echo *e;
+	uint32_t ahead;
+
+	syn->num_ul_bursts++;
+
+	/* The frame has been generated already */
+	ahead = GSM_TDMA_FN_SUB(br->fn, syn->frame % GSM_TDMA_HYPERFRAME);
+	if (ahead > GSM_TDMA_HYPERFRAME / 2) {
+		syn->num_ul_late++;
+		return 0;
+	}
+
+	/* Timeslot 0 is the BCCH carrier, nothing to echo there */
+	if (syn->echo == NULL || br->tn == 0 || br->tn >= 8 || br->burst_len != 148)
+		return 0;
+	if (ahead >= PHY_SYNTH_ECHO_FRAMES)
+		return 0;
+
+	e = &syn->echo[br->tn][br->fn % PHY_SYNTH_ECHO_FRAMES];
+	e->fn = br->fn;
+	e->valid = true;
+	osmo_ubit2sbit(&e->burst[0], br->burst, 148);
+
+	return 0;
+}
+
+/* Init synthetic PHY (the cell is shared by all instances) */
+struct phy_synth *phy_synth_open(const struct phy_synth_params *params)
+{
+	struct phy_synth *syn;
+	int rc = 0;
+
+	pthread_mutex_lock(&g_cell.lock);
+	if (!g_cell.ready)
+		rc = cell_build(params);
+	pthread_mutex_unlock(&g_cell.lock);
+
+	if (rc != 0) {
+		LOGPFSML(params->parent_fi, LOGL_ERROR,
+			 "Failed to build the synthetic cell: %s\n", strerror(-rc));
+		return NULL;
+	}
+
+	syn = talloc_zero(params->parent_fi, struct phy_synth);
+	if (syn == NULL)
+		return NULL;
+
+	if (g_cell.echo) {
+		syn->echo = talloc_zero_size(syn, sizeof(*syn->echo) * 8);
+		if (syn->echo == NULL) {
+			talloc_free(syn);
+			return NULL;
+		}
+	}
+
+	osmo_timer_setup(&syn->clock_timer, &phy_synth_clock_cb, syn);
+	osmo_timer_setup(&syn->meas.timer, &phy_synth_meas_cb, syn);
+
+	syn->fn_advance = params->fn_advance;
+	syn->speed = params->speed;
+	syn->parent_fi = params->parent_fi;
+	syn->priv = params->priv;
+
+	LOGPSYN(syn, LOGL_NOTICE, "Init synthetic PHY (ARFCN %u, BSIC %u, speed %u%s)\n",
+		g_cell.band_arfcn & ~ARFCN_FLAG_MASK, g_cell.bsic, syn->speed,
+		syn->echo != NULL ? ", echo" : "");
+
+	return syn;
+}
+
+void phy_synth_close(struct phy_synth *syn)
+{
+	if (syn == NULL)
+		return;
+
+	LOGPSYN(syn, LOGL_NOTICE, "Shutdown synthetic PHY: %" PRIu64 " frames "
+		"(%" PRIu64 " skipped, max lag %u), %" PRIu64 " UL bursts (%" PRIu64 " late)\n",
+		syn->num_frames, syn->num_frames_skipped, syn->max_lag,
+		syn->num_ul_bursts, syn->num_ul_late);
+
+	osmo_timer_del(&syn->clock_timer);
+	osmo_timer_del(&syn->meas.timer);
+	talloc_free(syn);
+}
@@ -0,0 +1,313 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * TDMA scheduler: A5/x keystream generation and caching
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/* osmo_a5() generates 228 bits of keystream (114 for Downlink, 114 for
+ * Uplink) for a single TDMA frame, after 64 + 22 + 100 clock cycles of
+ * setup.  Running it once per burst wastes most of the work: the key load
+ * does not depend on the frame number at all, and only one half of the
+ * output is used each time.
+ *
+ * Here the state after key load is computed once per key, and keystreams
+ * for a batch of consecutive TDMA frames are generated at once, using
+ * bitslicing: bit i of all registers of 64 independent A5/1 (A5/2)
+ * instances is kept in a single 64-bit word, so that one word operation
+ * clocks all of them, each lane following its own majority rule.
+ *
+ * Both halves are kept in a cache indexed by TDMA frame number, which is
+ * shared by all lchans of a scheduler (the keystream depends on the key
+ * and on the TDMA frame number only), so that e.g. TCH/F and SACCH/TF, the
+ * Downlink and the Uplink, or several timeslots using the same Kc do not
+ * recompute it.  Other algorithms fall back to osmo_a5(), still cached. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/gsm/a5.h>
+#include <osmocom/gsm/gsm0502.h>
+
+#include <osmocom/bb/l1sched/l1sched.h>
+
+/* Number of bitsliced lanes, also the number of cached TDMA frames.
+ * Shall be a power of 2, so that the cache index (fn % A5_CACHE_LEN)
+ * stays continuous across the hyperframe boundary. */
+#define A5_CACHE_LEN		64
+/* On a cache miss, the batch starts that many frames before the missing
+ * one: Uplink bursts are requested fn_advance frames ahead of Downlink
+ * bursts, and both shall fit into the same batch. */
+#define A5_CACHE_BACK		8
+
+#define A5_R1_LEN		19
+#define A5_R2_LEN		22
+#define A5_R3_LEN		23
+#define A5_R4_LEN		17	/* A5/2 only */
+
+#define A5_R1_MASK		((1 << A5_R1_LEN) - 1)
+#define A5_R2_MASK		((1 << A5_R2_LEN) - 1)
+#define A5_R3_MASK		((1 << A5_R3_LEN) - 1)
+#define A5_R4_MASK		((1 << A5_R4_LEN) - 1)
+
+#define A5_R1_TAPS		0x072000 /* x^19 + x^18 + x^17 + x^14 + 1 */
+#define A5_R2_TAPS		0x300000 /* x^22 + x^21 + 1 */
+#define A5_R3_TAPS		0x700080 /* x^23 + x^22 + x^21 + x^8 + 1 */
+#define A5_R4_TAPS		0x010800 /* x^17 + x^12 + 1 */
+
+struct l1sched_a5_ks {
+	uint32_t fn;
+	bool valid;
+	ubit_t dl[114];
+	ubit_t ul[114];
+};
+
+struct l1sched_a5_cache {
+	/* the key the cache is valid for */
+	uint8_t algo;
+	uint8_t key[MAX_A5_KEY_LEN];
+	uint8_t key_len;
+	/* A5/1 and A5/2: register state after key load */
+	uint32_t key_state[4];
+	/* indexed by fn % A5_CACHE_LEN */
+	struct l1sched_a5_ks ks[A5_CACHE_LEN];
+};
+
+/* Bitsliced registers: bit N of word i is bit i of lane N's register */
+struct a5_bs_state {
+	uint64_t r1[A5_R1_LEN];
+	uint64_t r2[A5_R2_LEN];
+	uint64_t r3[A5_R3_LEN];
+	uint64_t r4[A5_R4_LEN];
+};
+
+static inline uint32_t a5_clock_reg(uint32_t r, uint32_t mask, uint32_t taps)
+{
+	return ((r << 1) & mask) | __builtin_parity(r & taps);
+}
+
+/* Forced clocking of all registers, followed by loading of a bit.
+ * R4 is used by A5/2 only, but it does not hurt A5/1. */
+static inline void a5_load_bit(uint32_t *r, uint32_t b)
+{
+	r[0] = a5_clock_reg(r[0], A5_R1_MASK, A5_R1_TAPS) ^ b;
+	r[1] = a5_clock_reg(r[1], A5_R2_MASK, A5_R2_TAPS) ^ b;
+	r[2] = a5_clock_reg(r[2], A5_R3_MASK, A5_R3_TAPS) ^ b;
+	r[3] = a5_clock_reg(r[3], A5_R4_MASK, A5_R4_TAPS) ^ b;
+}
+
+static inline uint64_t bs_maj(uint64_t a, uint64_t b, uint64_t c)
+{
+	return (a & b) | (a & c) | (b & c);
+}
+
+/* Clock a bitsliced register in lanes selected by the mask */
+static inline void bs_clock_reg(uint64_t *r, unsigned int len,
+				uint64_t fb, uint64_t mask)
+{
+	unsigned int i;
+
+	for (i = len - 1; i > 0; i--)
+		r[i] ^= (r[i] ^ r[i - 1]) & mask;
+	r[0] ^= (r[0] ^ fb) & mask;
+}
+
+static inline void a5_1_bs_clock(struct a5_bs_state *s)
+{
+	uint64_t maj = bs_maj(s->r1[8], s->r2[10], s->r3[10]);
+	uint64_t m1 = ~(s->r1[8] ^ maj);
+	uint64_t m2 = ~(s->r2[10] ^ maj);
+	uint64_t m3 = ~(s->r3[10] ^ maj);
+
+	bs_clock_reg(s->r1, A5_R1_LEN, s->r1[13] ^ s->r1[16] ^ s->r1[17] ^ s->r1[18], m1);
+	bs_clock_reg(s->r2, A5_R2_LEN, s->r2[20] ^ s->r2[21], m2);
+	bs_clock_reg(s->r3, A5_R3_LEN, s->r3[7] ^ s->r3[20] ^ s->r3[21] ^ s->r3[22], m3);
+}
+
+static inline uint64_t a5_1_bs_output(const struct a5_bs_state *s)
+{
+	return s->r1[A5_R1_LEN - 1] ^ s->r2[A5_R2_LEN - 1] ^ s->r3[A5_R3_LEN - 1];
+}
+
+static inline void a5_2_bs_clock(struct a5_bs_state *s)
+{
+	uint64_t maj = bs_maj(s->r4[10], s->r4[3], s->r4[7]);
+	uint64_t m1 = ~(s->r4[10] ^ maj);
+	uint64_t m2 = ~(s->r4[3] ^ maj);
+	uint64_t m3 = ~(s->r4[7] ^ maj);
+
+	bs_clock_reg(s->r1, A5_R1_LEN, s->r1[13] ^ s->r1[16] ^ s->r1[17] ^ s->r1[18], m1);
+	bs_clock_reg(s->r2, A5_R2_LEN, s->r2[20] ^ s->r2[21], m2);
+	bs_clock_reg(s->r3, A5_R3_LEN, s->r3[7] ^ s->r3[20] ^ s->r3[21] ^ s->r3[22], m3);
+	bs_clock_reg(s->r4, A5_R4_LEN, s->r4[11] ^ s->r4[16], ~0ULL);
+}
+
+static inline uint64_t a5_2_bs_output(const struct a5_bs_state *s)
+{
+	return s->r1[A5_R1_LEN - 1] ^ s->r2[A5_R2_LEN - 1] ^ s->r3[A5_R3_LEN - 1] ^
+	       bs_maj(s->r1[15], ~s->r1[14], s->r1[12]) ^
+	       bs_maj(~s->r2[16], s->r2[13], s->r2[9]) ^
+	       bs_maj(s->r3[18], s->r3[16], ~s->r3[13]);
+}
+
+/* Put the given register state into lane N of the bitsliced state */
+static void a5_bs_load_lane(struct a5_bs_state *s, unsigned int n, const uint32_t *r)
+{
+	unsigned int i;
+
+	for (i = 0; i < A5_R1_LEN; i++)
+		s->r1[i] |= (uint64_t)((r[0] >> i) & 1) << n;
+	for (i = 0; i < A5_R2_LEN; i++)
+		s->r2[i] |= (uint64_t)((r[1] >> i) & 1) << n;
+	for (i = 0; i < A5_R3_LEN; i++)
+		s->r3[i] |= (uint64_t)((r[2] >> i) & 1) << n;
+	for (i = 0; i < A5_R4_LEN; i++)
+		s->r4[i] |= (uint64_t)((r[3] >> i) & 1) << n;
+}
+
+static inline void a5_bs_store_output(struct l1sched_a5_ks **ks, unsigned int num,
+				      unsigned int i, bool ul, uint64_t out)
+{
+	unsigned int n;
+
+	for (n = 0; n < num; n++) {
+		if (ul)
+			ks[n]->ul[i] = (out >> n) & 1;
+		else
+			ks[n]->dl[i] = (out >> n) & 1;
+	}
+}
+
+/* Generate A5/1 or A5/2 keystreams for A5_CACHE_LEN frames starting at fn */
+static void a5_cache_fill_bs(struct l1sched_a5_cache *c, uint32_t fn)
+{
+	struct l1sched_a5_ks *ks[A5_CACHE_LEN];
+	struct a5_bs_state s = { 0 };
+	bool a5_2 = (c->algo == 2);
+	unsigned int n, i;
+
+	for (n = 0; n < A5_CACHE_LEN; n++) {
+		uint32_t fn_n = GSM_TDMA_FN_SUM(fn, n);
+		uint32_t count = osmo_a5_fn_count(fn_n);
+		uint32_t r[4];
+
+		memcpy(&r[0], &c->key_state[0], sizeof(r));
+		for (i = 0; i < 22; i++)
+			a5_load_bit(&r[0], (count >> i) & 1);
+
+		if (a5_2) {
+			r[0] |= 1 << 15;
+			r[1] |= 1 << 16;
+			r[2] |= 1 << 18;
+			r[3] |= 1 << 10;
+		}
+
+		a5_bs_load_lane(&s, n, &r[0]);
+
+		ks[n] = &c->ks[fn_n % A5_CACHE_LEN];
+		ks[n]->fn = fn_n;
+		ks[n]->valid = true;
+	}
+
+	if (a5_2) {
+		for (i = 0; i < 99; i++)
+			a5_2_bs_clock(&s);
+		for (i = 0; i < 114; i++) {
+			a5_2_bs_clock(&s);
+			a5_bs_store_output(ks, A5_CACHE_LEN, i, false, a5_2_bs_output(&s));
+		}
+		for (i = 0; i < 114; i++) {
+			a5_2_bs_clock(&s);
+			a5_bs_store_output(ks, A5_CACHE_LEN, i, true, a5_2_bs_output(&s));
+		}
+	} else {
+		for (i = 0; i < 100; i++)
+			a5_1_bs_clock(&s);
+		for (i = 0; i < 114; i++) {
+			a5_1_bs_clock(&s);
+			a5_bs_store_output(ks, A5_CACHE_LEN, i, false, a5_1_bs_output(&s));
+		}
+		for (i = 0; i < 114; i++) {
+			a5_1_bs_clock(&s);
+			a5_bs_store_output(ks, A5_CACHE_LEN, i, true, a5_1_bs_output(&s));
+		}
+	}
+}
+
+/* (Re)initialize the cache for the key of the given lchan */
+static void a5_cache_set_key(struct l1sched_a5_cache *c,
+			     const struct l1sched_lchan_state *lchan)
+{
+	unsigned int i;
+
+	memset(c, 0x00, sizeof(*c));
+	c->algo = lchan->a5.algo;
+	c->key_len = lchan->a5.key_len;
+	memcpy(&c->key[0], &lchan->a5.key[0], c->key_len);
+
+	if (c->algo != 1 && c->algo != 2)
+		return;
+
+	/* Key load (same for all TDMA frames) */
+	for (i = 0; i < 64; i++)
+		a5_load_bit(&c->key_state[0], (c->key[7 - (i >> 3)] >> (i & 7)) & 1);
+}
+
+/*! Get A5/x keystream of the given lchan for the given TDMA frame.
+ *  \param[in] lchan  logical channel (with ciphering enabled).
+ *  \param[in] fn     TDMA frame number.
+ *  \param[in] ul     Uplink (true) or Downlink (false) keystream.
+ *  \returns 114 bits of keystream; NULL on error. */
+const ubit_t *l1sched_a5_keystream(struct l1sched_lchan_state *lchan,
+				   uint32_t fn, bool ul)
+{
+	struct l1sched_state *sched = lchan->ts->sched;
+	struct l1sched_a5_cache *c = sched->a5_cache;
+	struct l1sched_a5_ks *ks;
+
+	if (c == NULL) {
+		c = talloc_zero(sched, struct l1sched_a5_cache);
+		if (c == NULL)
+			return NULL;
+		sched->a5_cache = c;
+		a5_cache_set_key(c, lchan);
+	} else if (c->algo != lchan->a5.algo || c->key_len != lchan->a5.key_len ||
+		   memcmp(&c->key[0], &lchan->a5.key[0], c->key_len) != 0) {
+		a5_cache_set_key(c, lchan);
+	}
+
+	ks = &c->ks[fn % A5_CACHE_LEN];
+	if (!ks->valid || ks->fn != fn) {
+		if (c->algo == 1 || c->algo == 2) {
+			a5_cache_fill_bs(c, GSM_TDMA_FN_SUB(fn, A5_CACHE_BACK));
+		} else {
+			osmo_a5(c->algo, &c->key[0], fn, &ks->dl[0], &ks->ul[0]);
+			ks->fn = fn;
+			ks->valid = true;
+		}
+	}
+
+	return ul ? &ks->ul[0] : &ks->dl[0];
+}
+
+/*! Forget all cached keystreams (e.g. on reset) */
+void l1sched_a5_cache_flush(struct l1sched_state *sched)
+{
+	TALLOC_FREE(sched->a5_cache);
+}
@@ -0,0 +1,331 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * TDMA scheduler: asynchronous channel decoding
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/* Complete sets of bursts are handed over to decoder threads, so that the
+ * thread doing I/O (reading TRXD, handling RTS) is not blocked by Viterbi
+ * decoding.  Each decoder thread has a ring of jobs, which is used as a
+ * lock-free SPSC queue in both directions:
+ *
+ *   jobs[]:   ... | reaped | decoded, not reaped | submitted, pending | ...
+ *                          ^ reap                ^ done               ^ submit
+ *
+ * The scheduler's thread fills a job and advances 'submit', the decoder
+ * thread decodes it in place and advances 'done', and then the scheduler's
+ * thread emits the result and advances 'reap'.  Jobs are numbered, and the
+ * results are emitted strictly in the order of submission (i.e. TDMA frame
+ * order), regardless of which decoder thread has finished first. */
+
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+
+#include <osmocom/core/utils.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/bits.h>
+#include <osmocom/coding/gsm0503_coding.h>
+
+#include <osmocom/bb/l1sched/l1sched.h>
+#include <osmocom/bb/l1sched/logging.h>
+
+/* Number of jobs per decoder thread (shall be a power of 2) */
+#define DEC_RING_LEN		32
+
+struct l1sched_dec_job {
+	/* sequence number (order of submission) */
+	uint32_t seq;
+	/* identifies the lchan (see l1sched_lchan_state.gen) */
+	uint32_t gen;
+	uint8_t tn;
+	enum l1sched_lchan_type type;
+	enum l1sched_dec_kind kind;
+	struct l1sched_meas_set meas;
+	sbit_t bursts[L1SCHED_DEC_BURSTS_MAX];
+
+	/* decoding result */
+	uint8_t l2[GPRS_L2_MAX_LEN];
+	int n_errors;
+	int n_bits_total;
+	int rc;
+};
+
+struct l1sched_dec_thread {
+	struct l1sched_decoder *dec;
+	pthread_t thread;
+	sem_t sem;
+	bool running;
+	/* see the comment above */
+	atomic_uint submit;
+	atomic_uint done;
+	unsigned int reap;
+	struct l1sched_dec_job jobs[DEC_RING_LEN];
+};
+
+struct l1sched_decoder {
+	struct l1sched_dec_thread *threads;
+	unsigned int num_threads;
+	/* sequence number of the next job to submit / to emit */
+	uint32_t seq_submit;
+	uint32_t seq_emit;
+	atomic_bool quit;
+};
+
+static void dec_job_run(struct l1sched_dec_job *job)
+{
+	switch (job->kind) {
+	case L1SCHED_DEC_XCCH:
+		job->rc = gsm0503_xcch_decode(&job->l2[0], &job->bursts[0],
+					      &job->n_errors, &job->n_bits_total);
+		break;
+	case L1SCHED_DEC_PDTCH:
+		job->rc = gsm0503_pdtch_decode(&job->l2[0], &job->bursts[0], NULL,
+					       &job->n_errors, &job->n_bits_total);
+		break;
+	default:
+		job->rc = -EINVAL;
+	}
+}
+
+static void *dec_thread_main(void *arg)
+{
+	struct l1sched_dec_thread *dt = arg;
+	struct l1sched_decoder *dec = dt->dec;
+	unsigned int done;
+
+	while (1) {
+		sem_wait(&dt->sem);
+		if (atomic_load(&dec->quit))
+			break;
+
+		done = atomic_load_explicit(&dt->done, memory_order_relaxed);
+		if (done == atomic_load_explicit(&dt->submit, memory_order_acquire))
+			continue;
+
+		dec_job_run(&dt->jobs[done % DEC_RING_LEN]);
+		atomic_store_explicit(&dt->done, done + 1, memory_order_release);
+	}
+
+	return NULL;
+}
+
+static void dec_emit_result(struct l1sched_state *sched,
+			    const struct l1sched_dec_job *job)
+{
+	struct l1sched_lchan_state *lchan;
+	struct l1sched_ts *ts;
+	size_t l2_len;
+
+	/* The lchan may have been deactivated in the meantime */
+	ts = sched->ts[job->tn];
+	if (ts == NULL)
+		return;
+	lchan = l1sched_find_lchan_by_type(ts, job->type);
+	if (lchan == NULL || !lchan->active || lchan->gen != job->gen)
+		return;
+
+	switch (job->kind) {
+	case L1SCHED_DEC_XCCH:
+		if (job->rc) {
+			LOGP_LCHAND(lchan, LOGL_ERROR,
+				    "Received bad frame (rc=%d, ber=%d/%d) at fn=%u\n",
+				    job->rc, job->n_errors, job->n_bits_total, job->meas.fn);
+			l1sched_ctr_inc(sched, L1SCHED_CTR_RX_DEC_FAIL + lchan->type);
+		}
+		l2_len = job->rc ? 0 : GSM_MACBLOCK_LEN;
+		l1sched_lchan_emit_data_ind_meas(lchan, &job->meas, &job->l2[0], l2_len,
+						 job->n_errors, job->n_bits_total, false);
+		break;
+	case L1SCHED_DEC_PDTCH:
+		if (job->rc < 0) {
+			LOGP_LCHAND(lchan, LOGL_ERROR,
+				    "Received bad frame (rc=%d, ber=%d/%d) at fn=%u\n",
+				    job->rc, job->n_errors, job->n_bits_total, job->meas.fn);
+			l1sched_ctr_inc(sched, L1SCHED_CTR_RX_DEC_FAIL + lchan->type);
+		}
+		l2_len = job->rc > 0 ? job->rc : 0;
+		l1sched_lchan_emit_data_ind_meas(lchan, &job->meas, &job->l2[0], l2_len,
+						 job->n_errors, job->n_bits_total, true);
+		break;
+	}
+}
+
+/*! Emit results of decoding, in the order of submission.
+ *  Shall be called periodically by the scheduler's thread. */
+void l1sched_decoder_poll(struct l1sched_state *sched)
+{
+	struct l1sched_decoder *dec = sched->decoder;
+	struct l1sched_dec_thread *dt;
+	struct l1sched_dec_job *job;
+
+	if (dec == NULL)
+		return;
+
+	while (dec->seq_emit != dec->seq_submit) {
+		/* Jobs are distributed round-robin, see l1sched_decoder_submit() */
+		dt = &dec->threads[dec->seq_emit % dec->num_threads];
+
+		/* Not decoded yet, try again later */
+		if (dt->reap == atomic_load_explicit(&dt->done, memory_order_acquire))
+			break;
+
+		job = &dt->jobs[dt->reap % DEC_RING_LEN];
+		dec_emit_result(sched, job);
+		dt->reap++;
+		dec->seq_emit++;
+	}
+}
+
+/*! Wait for all submitted jobs to be decoded, and emit their results */
+void l1sched_decoder_flush(struct l1sched_state *sched)
+{
+	struct l1sched_decoder *dec = sched->decoder;
+
+	if (dec == NULL)
+		return;
+
+	while (dec->seq_emit != dec->seq_submit) {
+		l1sched_decoder_poll(sched);
+		if (dec->seq_emit != dec->seq_submit)
+			sched_yield();
+	}
+}
+
+/*! Submit a complete set of bursts for decoding.
+ *  \param[in] lchan  logical channel the bursts belong to.
+ *  \param[in] kind   kind of decoding to perform.
+ *  \param[in] bursts soft-bits to decode (copied).
+ *  \param[in] len    number of soft-bits.
+ *  \returns 0 on success; -ENODEV if there are no decoder threads,
+ *           so that the caller shall decode in-place. */
+int l1sched_decoder_submit(struct l1sched_lchan_state *lchan,
+			   enum l1sched_dec_kind kind,
+			   const sbit_t *bursts, size_t len)
+{
+	struct l1sched_state *sched = lchan->ts->sched;
+	struct l1sched_decoder *dec = sched->decoder;
+	struct l1sched_dec_thread *dt;
+	struct l1sched_dec_job *job;
+	unsigned int submit;
+
+	if (dec == NULL)
+		return -ENODEV;
+	OSMO_ASSERT(len <= L1SCHED_DEC_BURSTS_MAX);
+
+	/* Round-robin distribution */
+	dt = &dec->threads[dec->seq_submit % dec->num_threads];
+	submit = atomic_load_explicit(&dt->submit, memory_order_relaxed);
+
+	/* The decoder is lagging behind, wait for it */
+	while (submit - dt->reap >= DEC_RING_LEN) {
+		l1sched_decoder_poll(sched);
+		if (submit - dt->reap >= DEC_RING_LEN)
+			sched_yield();
+	}
+
+	job = &dt->jobs[submit % DEC_RING_LEN];
+	job->seq = dec->seq_submit++;
+	job->gen = lchan->gen;
+	job->tn = lchan->ts->index;
+	job->type = lchan->type;
+	job->kind = kind;
+	job->meas = lchan->meas_avg;
+	memcpy(&job->bursts[0], bursts, len);
+
+	atomic_store_explicit(&dt->submit, submit + 1, memory_order_release);
+	sem_post(&dt->sem);
+
+	return 0;
+}
+
+/*! Start decoder threads for the given scheduler instance.
+ *  \param[in] sched  scheduler instance.
+ *  \param[in] num    number of decoder threads (0 means decode in-place).
+ *  \returns 0 on success; negative on error. */
+int l1sched_decoder_start(struct l1sched_state *sched, unsigned int num)
+{
+	struct l1sched_decoder *dec;
+	unsigned int i;
+	int rc;
+
+	if (num == 0 || sched->decoder != NULL)
+		return 0;
+
+	dec = talloc_zero(sched, struct l1sched_decoder);
+	if (dec == NULL)
+		return -ENOMEM;
+	dec->threads = talloc_zero_array(dec, struct l1sched_dec_thread, num);
+	if (dec->threads == NULL) {
+		talloc_free(dec);
+		return -ENOMEM;
+	}
+
+	dec->num_threads = num;
+	sched->decoder = dec;
+
+	for (i = 0; i < num; i++) {
+		struct l1sched_dec_thread *dt = &dec->threads[i];
+
+		dt->dec = dec;
+		sem_init(&dt->sem, 0, 0);
+		rc = pthread_create(&dt->thread, NULL, &dec_thread_main, dt);
+		if (rc != 0) {
+			LOGP_SCHEDC(sched, LOGL_ERROR,
+				    "Failed to start decoder thread: %s\n", strerror(rc));
+			sem_destroy(&dt->sem);
+			l1sched_decoder_stop(sched);
+			return -rc;
+		}
+		dt->running = true;
+	}
+
+	LOGP_SCHEDC(sched, LOGL_NOTICE, "Started %u decoder thread(s)\n", num);
+
+	return 0;
+}
+
+/*! Stop decoder threads, discarding pending results */
+void l1sched_decoder_stop(struct l1sched_state *sched)
+{
+	struct l1sched_decoder *dec = sched->decoder;
+	unsigned int i;
+
+	if (dec == NULL)
+		return;
+
+	atomic_store(&dec->quit, true);
+
+	for (i = 0; i < dec->num_threads; i++) {
+		struct l1sched_dec_thread *dt = &dec->threads[i];
+
+		if (!dt->running)
+			continue;
+		sem_post(&dt->sem);
+		pthread_join(dt->thread, NULL);
+		sem_destroy(&dt->sem);
+	}
+
+	sched->decoder = NULL;
+	talloc_free(dec);
+}
@@ -80,7 +80,7 @@ const uint8_t l1sched_nb_training_bits[8][26] = {
  *           "**.***.." (incomplete, 5/8 bursts) */
 const char *l1sched_burst_mask2str(const uint32_t *mask, int bits)
 {
-	static char buf[32 + 1];
+	static __thread char buf[32 + 1];
 	char *ptr = buf;
 
 	OSMO_ASSERT(bits <= 32 && bits > 0);
@@ -92,6 +92,52 @@ const char *l1sched_burst_mask2str(const uint32_t *mask, int bits)
 	return buf;
 }
 
+/* TCH/F and TCH/H keep the last L1SCHED_RX_RING_LEN Rx bursts in a ring buffer.
+ * Every burst is stored twice, L1SCHED_RX_RING_LEN positions apart, so that any
+ * window of up to L1SCHED_RX_RING_LEN consecutive bursts is contiguous in memory
+ * and can be passed to the deinterleaver in place.  Positions 'n' below are
+ * counted from the oldest burst: 0 is the oldest, RING_LEN - 1 is the newest. */
+#define RX_RING_POS(lchan, idx) \
+	&(lchan)->rx_bursts[(idx) * GSM_NBITS_NB_GMSK_PAYLOAD]
+
+/* Get a pointer to a window of bursts starting at position n */
+sbit_t *l1sched_lchan_rx_ring_pos(const struct l1sched_lchan_state *lchan,
+				  unsigned int n)
+{
+	OSMO_ASSERT(n < L1SCHED_RX_RING_LEN);
+	return RX_RING_POS(lchan, lchan->rx_bursts_head + n);
+}
+
+/* Drop n oldest bursts, so that the newest ones move towards the end */
+void l1sched_lchan_rx_ring_advance(struct l1sched_lchan_state *lchan,
+				   unsigned int n)
+{
+	lchan->rx_bursts_head = (lchan->rx_bursts_head + n) % L1SCHED_RX_RING_LEN;
+}
+
+/* Store payload bits of a Normal Burst at position n */
+void l1sched_lchan_rx_ring_store(struct l1sched_lchan_state *lchan,
+				 unsigned int n, const sbit_t *burst)
+{
+	unsigned int idx = (lchan->rx_bursts_head + n) % L1SCHED_RX_RING_LEN;
+	sbit_t *pos = RX_RING_POS(lchan, idx);
+
+	l1sched_nb_payload_copy(pos, burst);
+	memcpy(RX_RING_POS(lchan, idx + L1SCHED_RX_RING_LEN),
+	       pos, GSM_NBITS_NB_GMSK_PAYLOAD);
+}
+
+/* Erase (zero) a burst at position n */
+void l1sched_lchan_rx_ring_erase(struct l1sched_lchan_state *lchan,
+				 unsigned int n)
+{
+	unsigned int idx = (lchan->rx_bursts_head + n) % L1SCHED_RX_RING_LEN;
+
+	memset(RX_RING_POS(lchan, idx), 0, GSM_NBITS_NB_GMSK_PAYLOAD);
+	memset(RX_RING_POS(lchan, idx + L1SCHED_RX_RING_LEN),
+	       0, GSM_NBITS_NB_GMSK_PAYLOAD);
+}
+
 bool l1sched_lchan_amr_prim_is_valid(struct l1sched_lchan_state *lchan,
 				     struct msgb *msg, bool is_cmr)
 {
@@ -129,8 +129,11 @@ const struct l1sched_lchan_desc l1sched_lchan_desc[_L1SCHED_CHAN_MAX] = {
 		 *     interleaving is done in the same way.
 		 *
 		 * The MS shall continuously transmit bursts, even if there is nothing
-		 * to send, unless DTX (Discontinuous Transmission) is used. */
+		 * to send, unless DTX (Discontinuous Transmission) is used.
+		 *
+		 * Rx bursts are kept in a ring buffer (twice the size). */
 		.burst_buf_size = 24 * GSM_NBITS_NB_GMSK_PAYLOAD,
+		.flags = L1SCHED_CH_FLAG_RX_RING,
 		.rx_fn = rx_tchf_fn,
 		.tx_fn = tx_tchf_fn,
 	},
@@ -155,8 +158,11 @@ const struct l1sched_lchan_desc l1sched_lchan_desc[_L1SCHED_CHAN_MAX] = {
 		 *     the same as given for a TCH/FS.
 		 *
 		 * The MS shall continuously transmit bursts, even if there is nothing
-		 * to send, unless DTX (Discontinuous Transmission) is used. */
+		 * to send, unless DTX (Discontinuous Transmission) is used.
+		 *
+		 * Rx bursts are kept in a ring buffer (twice the size). */
 		.burst_buf_size = 24 * GSM_NBITS_NB_GMSK_PAYLOAD,
+		.flags = L1SCHED_CH_FLAG_RX_RING,
 		.rx_fn = rx_tchh_fn,
 		.tx_fn = tx_tchh_fn,
 	},
@@ -168,6 +174,7 @@ const struct l1sched_lchan_desc l1sched_lchan_desc[_L1SCHED_CHAN_MAX] = {
 
 		/* Same as for L1SCHED_TCHH_0, see above. */
 		.burst_buf_size = 24 * GSM_NBITS_NB_GMSK_PAYLOAD,
+		.flags = L1SCHED_CH_FLAG_RX_RING,
 		.rx_fn = rx_tchh_fn,
 		.tx_fn = tx_tchh_fn,
 	},
@@ -476,7 +483,10 @@ const struct l1sched_lchan_desc l1sched_lchan_desc[_L1SCHED_CHAN_MAX] = {
 		/* Rx and Tx, multiple coding schemes: CS-1..4 and MCS-1..9 (3GPP TS
 		 * 05.03, chapter 5), regular interleaving as specified for xCCH.
 		 * NOTE: the burst buffer is three times bigger because the
-		 * payload of EDGE bursts is three times longer. */
+		 * payload of EDGE bursts is three times longer.
+		 * NOTE: only CS-1..4 are implemented so far, libosmocoding
+		 * implements MCS-1..9 for the network side only (Uplink
+		 * decoding, Downlink encoding). */
 		.burst_buf_size = 4 * GSM_NBITS_NB_8PSK_PAYLOAD,
 		.flags = L1SCHED_CH_FLAG_PDCH,
 		.rx_fn = rx_pdtch_fn,
@@ -129,6 +129,9 @@ int tx_rach_fn(struct l1sched_lchan_state *lchan,
 		    prim->rach_req.is_11bit ? "11" : "8",
 		    get_value_string(rach_synch_seq_names, prim->rach_req.synch_seq), br->fn);
 
+	/* The response may be sent on any CCCH block */
+	l1sched_drx_hold(lchan->ts->sched, br->fn);
+
 	/* Confirm RACH request (pass ownership of the msgb/prim) */
 	l1sched_lchan_emit_data_cnf(lchan, msg, br->fn);
 
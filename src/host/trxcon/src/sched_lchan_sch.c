@@ -35,6 +35,14 @@
 #include <osmocom/bb/l1sched/l1sched.h>
 #include <osmocom/bb/l1sched/logging.h>
 
+/* GSM 05.02 Chapter 5.2.5 SCH training sequence */
+static const ubit_t sb_training_bits[64] = {
+	1, 0, 1, 1, 1, 0, 0, 1, 0, 1, 1, 0, 0, 0, 1, 0,
+	0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1,
+	0, 0, 1, 0, 1, 1, 0, 1, 0, 1, 0, 0, 0, 1, 0, 1,
+	0, 1, 1, 1, 0, 1, 1, 0, 0, 0, 0, 1, 1, 0, 1, 1,
+};
+
 static void decode_sb(struct gsm_time *time, uint8_t *bsic, uint8_t *sb_info)
 {
 	uint8_t t3p;
@@ -76,6 +84,38 @@ static int handle_sch_ind(struct l1sched_state *sched, uint32_t fn, uint8_t bsic
 	return l1sched_prim_to_user(sched, msg);
 }
 
+/*! Encode a Synchronization Burst, the reverse of rx_sch_fn().
+ *  \param[out] burst  148 soft-bits of the burst.
+ *  \param[in]  fn     TDMA frame number (TS 05.02 Chapter 3.3.2.2.1).
+ *  \param[in]  bsic   BSIC (NCC and BCC). */
+void l1sched_sch_burst_encode(sbit_t *burst, uint32_t fn, uint8_t bsic)
+{
+	ubit_t coded[78];
+	ubit_t sb[148];
+	struct gsm_time time;
+	uint8_t sb_info[4];
+	uint8_t t3p;
+
+	gsm_fn2gsmtime(&time, fn);
+	t3p = (time.t3 - 1) / 10;
+
+	/* See decode_sb() */
+	sb_info[0] = ((bsic & 0x3f) << 2) | ((time.t1 & 0x600) >> 9);
+	sb_info[1] = (time.t1 & 0x1fe) >> 1;
+	sb_info[2] = ((time.t1 & 0x001) << 7) | ((time.t2 & 0x1f) << 2) | ((t3p & 0x6) >> 1);
+	sb_info[3] = t3p & 0x1;
+
+	gsm0503_sch_encode(&coded[0], &sb_info[0]);
+
+	memset(&sb[0], 0, 3);
+	memcpy(&sb[3], &coded[0], 39);
+	memcpy(&sb[42], &sb_training_bits[0], 64);
+	memcpy(&sb[106], &coded[39], 39);
+	memset(&sb[145], 0, 3);
+
+	osmo_ubit2sbit(burst, &sb[0], 148);
+}
+
 int rx_sch_fn(struct l1sched_lchan_state *lchan,
 	      const struct l1sched_burst_ind *bi)
 {
@@ -94,6 +134,7 @@ int rx_sch_fn(struct l1sched_lchan_state *lchan,
 	if (rc) {
 		LOGP_LCHAND(lchan, LOGL_ERROR,
 			    "Received bad SCH burst at fn=%u\n", bi->fn);
+		l1sched_ctr_inc(lchan->ts->sched, L1SCHED_CTR_RX_DEC_FAIL + lchan->type);
 		return rc;
 	}
 
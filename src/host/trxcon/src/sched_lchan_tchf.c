@@ -47,6 +47,10 @@
 #define BUFPOS(buf, n) &buf[(n) * BPLEN]
 #define BUFTAIL8(buf) BUFPOS(buf, (BUFMAX - 8))
 
+/* Windows of the Rx ring buffer, see l1sched_lchan_rx_ring_pos() */
+#define RXPOS(lchan, n) l1sched_lchan_rx_ring_pos(lchan, n)
+#define RXTAIL8(lchan) RXPOS(lchan, (BUFMAX - 8))
+
 /* ------------------------------------------------------------------
  * 3GPP TS 45.009, table 3.2.1.3-1
  * "TDMA frames for Codec Mode Indication for TCH/AFS, TCH/WFS and O-TCH/WFS" */
@@ -71,7 +75,7 @@ static int decode_fr_facch(struct l1sched_lchan_state *lchan)
 	int n_errors, n_bits_total;
 	int rc;
 
-	rc = gsm0503_tch_fr_facch_decode(&data[0], BUFTAIL8(lchan->rx_bursts),
+	rc = gsm0503_tch_fr_facch_decode(&data[0], RXTAIL8(lchan),
 					 &n_errors, &n_bits_total);
 	if (rc != GSM_MACBLOCK_LEN)
 		return rc;
@@ -85,11 +89,26 @@ static int decode_fr_facch(struct l1sched_lchan_state *lchan)
 	return GSM_MACBLOCK_LEN;
 }
 
+/* The ring buffer is not cleared when advancing, so positions of lost (not
+ * substituted) bursts still contain stale bits from 24 bursts ago.  Erase
+ * them before the buffer is passed to the decoder. */
+static void rx_tchf_erase_missing(struct l1sched_lchan_state *lchan)
+{
+	unsigned int i;
+
+	if (OSMO_LIKELY((lchan->rx_burst_mask & 0x0f) == 0x0f))
+		return;
+
+	for (i = 0; i < 4; i++) {
+		if (~lchan->rx_burst_mask & (1 << i))
+			l1sched_lchan_rx_ring_erase(lchan, 20 + i);
+	}
+}
+
 int rx_tchf_fn(struct l1sched_lchan_state *lchan,
 	       const struct l1sched_burst_ind *bi)
 {
 	int n_errors = -1, n_bits_total = 0, rc;
-	sbit_t *bursts_p, *burst;
 	uint8_t tch_data[290];
 	size_t tch_data_len;
 	uint32_t *mask;
@@ -98,15 +117,15 @@ int rx_tchf_fn(struct l1sched_lchan_state *lchan,
 
 	/* Set up pointers */
 	mask = &lchan->rx_burst_mask;
-	bursts_p = lchan->rx_bursts;
 
 	LOGP_LCHAND(lchan, LOGL_DEBUG,
 		    "Traffic received: fn=%u bid=%u\n", bi->fn, bi->bid);
 
 	if (bi->bid == 0) {
-		/* Shift the burst buffer by 4 bursts leftwards */
-		memmove(BUFPOS(bursts_p, 0), BUFPOS(bursts_p, 4), 20 * BPLEN);
-		memset(BUFPOS(bursts_p, 20), 0, 4 * BPLEN);
+		/* Erase bursts missing in the previous block (if any) */
+		rx_tchf_erase_missing(lchan);
+		/* Drop 4 oldest bursts from the ring buffer */
+		l1sched_lchan_rx_ring_advance(lchan, 4);
 		*mask = *mask << 4;
 	} else {
 		/* Align to the first burst of a block */
@@ -121,14 +140,15 @@ int rx_tchf_fn(struct l1sched_lchan_state *lchan,
 	l1sched_lchan_meas_push(lchan, bi);
 
 	/* Copy burst to end of buffer of 24 bursts */
-	burst = BUFPOS(bursts_p, 20 + bi->bid);
-	memcpy(burst, bi->burst + 3, 58);
-	memcpy(burst + 58, bi->burst + 87, 58);
+	l1sched_lchan_rx_ring_store(lchan, 20 + bi->bid, bi->burst);
 
 	/* Wait until complete set of bursts */
 	if (bi->bid != 3)
 		return 0;
 
+	/* Erase bursts missing in the current block (if any) */
+	rx_tchf_erase_missing(lchan);
+
 	/* Calculate AVG of the measurements */
 	l1sched_lchan_meas_avg(lchan, 8); // XXX
 
@@ -149,11 +169,11 @@ int rx_tchf_fn(struct l1sched_lchan_state *lchan,
 	switch (lchan->tch_mode) {
 	case GSM48_CMODE_SIGN:
 	case GSM48_CMODE_SPEECH_V1: /* FR */
-		rc = gsm0503_tch_fr_decode(&tch_data[0], BUFTAIL8(bursts_p),
+		rc = gsm0503_tch_fr_decode(&tch_data[0], RXTAIL8(lchan),
 					   1, 0, &n_errors, &n_bits_total);
 		break;
 	case GSM48_CMODE_SPEECH_EFR: /* EFR */
-		rc = gsm0503_tch_fr_decode(&tch_data[0], BUFTAIL8(bursts_p),
+		rc = gsm0503_tch_fr_decode(&tch_data[0], RXTAIL8(lchan),
 					   1, 1, &n_errors, &n_bits_total);
 		break;
 	case GSM48_CMODE_SPEECH_AMR: /* AMR */
@@ -162,7 +182,7 @@ int rx_tchf_fn(struct l1sched_lchan_state *lchan,
 		 * receive an FACCH frame instead of a voice frame (we do not
 		 * know this before we actually decode the frame) */
 		amr = 2;
-		rc = gsm0503_tch_afs_decode_dtx(&tch_data[amr], BUFTAIL8(bursts_p),
+		rc = gsm0503_tch_afs_decode_dtx(&tch_data[amr], RXTAIL8(lchan),
 						!sched_tchf_dl_amr_cmi_h_map[bi->fn % 26],
 						lchan->amr.codec,
 						lchan->amr.codecs,
@@ -191,21 +211,21 @@ int rx_tchf_fn(struct l1sched_lchan_state *lchan,
 	case GSM48_CMODE_DATA_14k5:
 		/* FACCH/F does not steal TCH/F14.4 frames, but only disturbs some bits */
 		decode_fr_facch(lchan);
-		rc = gsm0503_tch_fr144_decode(&tch_data[0], BUFPOS(bursts_p, 0),
+		rc = gsm0503_tch_fr144_decode(&tch_data[0], RXPOS(lchan, 0),
 					      &n_errors, &n_bits_total);
 		break;
 	/* CSD (TCH/F9.6): 12.0 kbit/s radio interface rate */
 	case GSM48_CMODE_DATA_12k0:
 		/* FACCH/F does not steal TCH/F9.6 frames, but only disturbs some bits */
 		decode_fr_facch(lchan);
-		rc = gsm0503_tch_fr96_decode(&tch_data[0], BUFPOS(bursts_p, 0),
+		rc = gsm0503_tch_fr96_decode(&tch_data[0], RXPOS(lchan, 0),
 					     &n_errors, &n_bits_total);
 		break;
 	/* CSD (TCH/F4.8): 6.0 kbit/s radio interface rate */
 	case GSM48_CMODE_DATA_6k0:
 		/* FACCH/F does not steal TCH/F4.8 frames, but only disturbs some bits */
 		decode_fr_facch(lchan);
-		rc = gsm0503_tch_fr48_decode(&tch_data[0], BUFPOS(bursts_p, 0),
+		rc = gsm0503_tch_fr48_decode(&tch_data[0], RXPOS(lchan, 0),
 					     &n_errors, &n_bits_total);
 		break;
 	/* CSD (TCH/F2.4): 3.6 kbit/s radio interface rate */
@@ -214,7 +234,7 @@ int rx_tchf_fn(struct l1sched_lchan_state *lchan,
 		 * so FACCH/F *does* steal TCH/F2.4 frames completely. */
 		if (decode_fr_facch(lchan) == GSM_MACBLOCK_LEN)
 			return 0; /* TODO: emit BFI? */
-		rc = gsm0503_tch_fr24_decode(&tch_data[0], BUFTAIL8(bursts_p),
+		rc = gsm0503_tch_fr24_decode(&tch_data[0], RXTAIL8(lchan),
 					     &n_errors, &n_bits_total);
 		break;
 	default:
@@ -227,6 +247,7 @@ int rx_tchf_fn(struct l1sched_lchan_state *lchan,
 		LOGP_LCHAND(lchan, LOGL_ERROR,
 			    "Received bad frame (rc=%d, ber=%d/%d) at fn=%u\n",
 			    rc, n_errors, n_bits_total, lchan->meas_avg.fn);
+		l1sched_ctr_inc(lchan->ts->sched, L1SCHED_CTR_RX_DEC_FAIL + lchan->type);
 
 		/* Send BFI (DATA.ind without payload) */
 		tch_data_len = 0;
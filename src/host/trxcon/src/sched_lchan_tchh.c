@@ -50,6 +50,10 @@
 #define BUFPOS(buf, n) &buf[(n) * BPLEN]
 #define BUFTAIL8(buf) BUFPOS(buf, (BUFMAX - 8))
 
+/* Windows of the Rx ring buffer, see l1sched_lchan_rx_ring_pos() */
+#define RXPOS(lchan, n) l1sched_lchan_rx_ring_pos(lchan, n)
+#define RXTAIL8(lchan) RXPOS(lchan, (BUFMAX - 8))
+
 /* ------------------------------------------------------------------
  * 3GPP TS 45.009, table 3.2.1.3-2
  * "TDMA frames for Codec Mode Indication for TCH/AHS, O-TCH/AHS and O-TCH/WHS"
@@ -144,7 +148,7 @@ static int decode_hr_facch(struct l1sched_lchan_state *lchan)
 	int n_errors, n_bits_total;
 	int rc;
 
-	rc = gsm0503_tch_hr_facch_decode(&data[0], BUFTAIL8(lchan->rx_bursts),
+	rc = gsm0503_tch_hr_facch_decode(&data[0], RXTAIL8(lchan),
 					 &n_errors, &n_bits_total);
 	if (rc != GSM_MACBLOCK_LEN)
 		return rc;
@@ -162,7 +166,6 @@ int rx_tchh_fn(struct l1sched_lchan_state *lchan,
 	       const struct l1sched_burst_ind *bi)
 {
 	int n_errors = -1, n_bits_total = 0, rc;
-	sbit_t *bursts_p, *burst;
 	uint8_t tch_data[240];
 	size_t tch_data_len;
 	uint32_t *mask;
@@ -171,15 +174,17 @@ int rx_tchh_fn(struct l1sched_lchan_state *lchan,
 
 	/* Set up pointers */
 	mask = &lchan->rx_burst_mask;
-	bursts_p = lchan->rx_bursts;
 
 	LOGP_LCHAND(lchan, LOGL_DEBUG,
 		    "Traffic received: fn=%u bid=%u\n", bi->fn, bi->bid);
 
 	if (bi->bid == 0) {
-		/* Shift the burst buffer by 2 bursts leftwards */
-		memmove(BUFPOS(bursts_p, 0), BUFPOS(bursts_p, 2), 20 * BPLEN);
-		memset(BUFPOS(bursts_p, 20), 0, 2 * BPLEN);
+		/* Drop 2 oldest bursts from the ring buffer.  The last 2 positions
+		 * are always empty, so they become the new positions 20 and 21,
+		 * while the 2 dropped bursts need to be erased. */
+		l1sched_lchan_rx_ring_advance(lchan, 2);
+		l1sched_lchan_rx_ring_erase(lchan, 22);
+		l1sched_lchan_rx_ring_erase(lchan, 23);
 		*mask = *mask << 2;
 	}
 
@@ -202,9 +207,7 @@ int rx_tchh_fn(struct l1sched_lchan_state *lchan,
 	l1sched_lchan_meas_push(lchan, bi);
 
 	/* Copy burst to the end of buffer of 24 bursts */
-	burst = BUFPOS(bursts_p, 20 + bi->bid);
-	memcpy(burst, bi->burst + 3, 58);
-	memcpy(burst + 58, bi->burst + 87, 58);
+	l1sched_lchan_rx_ring_store(lchan, 20 + bi->bid, bi->burst);
 
 	/* Wait until the second burst */
 	if (bi->bid != 1)
@@ -246,14 +249,14 @@ int rx_tchh_fn(struct l1sched_lchan_state *lchan,
 	switch (lchan->tch_mode) {
 	case GSM48_CMODE_SIGN:
 	case GSM48_CMODE_SPEECH_V1: /* HR */
-		rc = gsm0503_tch_hr_decode(&tch_data[0], BUFTAIL8(bursts_p),
+		rc = gsm0503_tch_hr_decode(&tch_data[0], RXTAIL8(lchan),
 					   !sched_tchh_dl_facch_f_map[bi->fn % 26],
 					   &n_errors, &n_bits_total);
 		break;
 	case GSM48_CMODE_SPEECH_AMR: /* AMR */
 		/* See comment in function rx_tchf_fn() */
 		amr = 2;
-		rc = gsm0503_tch_ahs_decode_dtx(&tch_data[amr], BUFTAIL8(bursts_p),
+		rc = gsm0503_tch_ahs_decode_dtx(&tch_data[amr], RXTAIL8(lchan),
 						!sched_tchh_dl_facch_f_map[bi->fn % 26],
 						!sched_tchh_dl_amr_cmi_f_map[bi->fn % 26],
 						lchan->amr.codec,
@@ -286,7 +289,7 @@ int rx_tchh_fn(struct l1sched_lchan_state *lchan,
 			decode_hr_facch(lchan);
 		if (!sched_tchh_dl_csd_v_map[bi->fn % 26])
 			return 0;
-		rc = gsm0503_tch_hr48_decode(&tch_data[0], BUFPOS(bursts_p, 0),
+		rc = gsm0503_tch_hr48_decode(&tch_data[0], RXPOS(lchan, 0),
 					     &n_errors, &n_bits_total);
 		break;
 	/* CSD (TCH/H2.4): 3.6 kbit/s radio interface rate */
@@ -296,7 +299,7 @@ int rx_tchh_fn(struct l1sched_lchan_state *lchan,
 			decode_hr_facch(lchan);
 		if (!sched_tchh_dl_csd_v_map[bi->fn % 26])
 			return 0;
-		rc = gsm0503_tch_hr24_decode(&tch_data[0], BUFPOS(bursts_p, 0),
+		rc = gsm0503_tch_hr24_decode(&tch_data[0], RXPOS(lchan, 0),
 					     &n_errors, &n_bits_total);
 		break;
 	default:
@@ -309,6 +312,7 @@ int rx_tchh_fn(struct l1sched_lchan_state *lchan,
 		LOGP_LCHAND(lchan, LOGL_ERROR,
 			    "Received bad frame (rc=%d, ber=%d/%d) at fn=%u\n",
 			    rc, n_errors, n_bits_total, lchan->meas_avg.fn);
+		l1sched_ctr_inc(lchan->ts->sched, L1SCHED_CTR_RX_DEC_FAIL + lchan->type);
 
 		/* Send BFI (DATA.ind without payload) */
 		tch_data_len = 0;
@@ -38,7 +38,7 @@ int rx_data_fn(struct l1sched_lchan_state *lchan,
 {
 	uint8_t l2[GSM_MACBLOCK_LEN];
 	int n_errors, n_bits_total, rc;
-	sbit_t *bursts_p, *burst;
+	sbit_t *bursts_p;
 	uint32_t *mask;
 
 	/* Set up pointers */
@@ -59,9 +59,7 @@ int rx_data_fn(struct l1sched_lchan_state *lchan,
 	l1sched_lchan_meas_push(lchan, bi);
 
 	/* Copy burst to buffer of 4 bursts */
-	burst = bursts_p + bi->bid * 116;
-	memcpy(burst, bi->burst + 3, 58);
-	memcpy(burst + 58, bi->burst + 87, 58);
+	l1sched_nb_payload_copy(&bursts_p[bi->bid * 116], bi->burst);
 
 	/* Wait until complete set of bursts */
 	if (bi->bid != 3)
@@ -86,12 +84,17 @@ int rx_data_fn(struct l1sched_lchan_state *lchan,
 	/* Keep the mask updated */
 	*mask = *mask << 4;
 
+	/* Hand over to a decoder thread (if running) */
+	if (l1sched_decoder_submit(lchan, L1SCHED_DEC_XCCH, bursts_p, 4 * 116) == 0)
+		return 0;
+
 	/* Attempt to decode */
 	rc = gsm0503_xcch_decode(l2, bursts_p, &n_errors, &n_bits_total);
 	if (rc) {
 		LOGP_LCHAND(lchan, LOGL_ERROR,
 			    "Received bad frame (rc=%d, ber=%d/%d) at fn=%u\n",
 			    rc, n_errors, n_bits_total, lchan->meas_avg.fn);
+		l1sched_ctr_inc(lchan->ts->sched, L1SCHED_CTR_RX_DEC_FAIL + lchan->type);
 	}
 
 	/* Send a L2 frame to the higher layers */
@@ -39,6 +39,7 @@
 #define L1SCHED_PRIM_TAILROOM	512
 
 osmo_static_assert(sizeof(struct l1sched_prim) <= L1SCHED_PRIM_HEADROOM, l1sched_prim_size);
+osmo_static_assert(L1SCHED_PRIM_HEADROOM + L1SCHED_PRIM_TAILROOM <= L1SCHED_MSGB_SIZE, l1sched_msgb_size);
 
 const struct value_string l1sched_prim_type_names[] = {
 	{ L1SCHED_PRIM_T_DATA,			"DATA" },
@@ -61,13 +62,99 @@ void l1sched_prim_init(struct msgb *msg,
 	osmo_prim_init(&prim->oph, 0, type, op, msg);
 }
 
+/* Primitives and L1CTL messages are allocated and free()d for every
+ * block, so instead of going through malloc() each time, released buffers
+ * are kept on a per-thread free list and recycled.  All pooled buffers
+ * are of the same size (L1SCHED_MSGB_SIZE).  The buffers are returned to
+ * the pool by a talloc destructor, which refuses the actual free(), so
+ * that the users keep calling msgb_free() as usual.
+ *
+ * Pooled buffers are allocated from a per-thread talloc context rather
+ * than from the (shared, not thread-safe) msgb context, and they must be
+ * released by the thread which allocated them.  This holds for trxcon:
+ * a connection (and thus its primitives and L1CTL messages) is served by
+ * a single thread, decoder threads do not handle msgbs. */
+#define L1SCHED_MSGB_POOL_LEN	128
+
+static __thread void *msgb_pool_ctx;
+static __thread struct msgb *msgb_pool[L1SCHED_MSGB_POOL_LEN];
+static __thread unsigned int msgb_pool_len;
+
+static int l1sched_msgb_destructor(struct msgb *msg)
+{
+	/* Released by another thread, which must not touch our context */
+	OSMO_ASSERT(talloc_parent(msg) == msgb_pool_ctx);
+
+	/* The pool is full, let talloc free() the buffer */
+	if (msgb_pool_len >= ARRAY_SIZE(msgb_pool))
+		return 0;
+	msgb_pool[msgb_pool_len++] = msg;
+	return -1;
+}
+
+/*! Allocate a msgb, possibly recycling one from the pool.
+ *  \param[in] size     total size of the buffer (including headroom).
+ *  \param[in] headroom headroom to reserve.
+ *  \param[in] name     human-readable name of the buffer.
+ *  \returns a msgb (to be released with msgb_free()), or NULL. */
+struct msgb *l1sched_msgb_alloc(uint16_t size, uint16_t headroom, const char *name)
+{
+	struct msgb *msg;
+
+	/* Too big for the pool, allocate as usual */
+	if (size > L1SCHED_MSGB_SIZE)
+		return msgb_alloc_headroom(size, headroom, name);
+
+	if (msgb_pool_len > 0) {
+		msg = msgb_pool[--msgb_pool_len];
+		msgb_reset(msg);
+		msg->l1h = NULL;
+		/* msgb_alloc() hands out zeroed memory, so do we */
+		memset(msg->_data, 0x00, msg->data_len);
+		talloc_set_name_const(msg, name);
+	} else {
+		if (msgb_pool_ctx == NULL) {
+			msgb_pool_ctx = talloc_named_const(NULL, 0, "l1sched_msgb_pool");
+			if (msgb_pool_ctx == NULL)
+				return NULL;
+		}
+		msg = msgb_alloc_c(msgb_pool_ctx, L1SCHED_MSGB_SIZE, name);
+		if (msg == NULL)
+			return NULL;
+		talloc_set_destructor(msg, &l1sched_msgb_destructor);
+	}
+
+	msgb_reserve(msg, headroom);
+
+	return msg;
+}
+
+/*! Release all msgbs pooled by the calling thread.
+ *  To be called by every thread using l1sched_msgb_alloc() before it
+ *  exits (including the main thread). */
+void l1sched_msgb_pool_drain(void)
+{
+	while (msgb_pool_len > 0) {
+		struct msgb *msg = msgb_pool[--msgb_pool_len];
+
+		talloc_set_destructor(msg, NULL);
+		msgb_free(msg);
+	}
+
+	/* Keep the context if msgbs are still in use (shown as leaks) */
+	if (msgb_pool_ctx != NULL && talloc_total_blocks(msgb_pool_ctx) == 1) {
+		talloc_free(msgb_pool_ctx);
+		msgb_pool_ctx = NULL;
+	}
+}
+
 struct msgb *l1sched_prim_alloc(enum l1sched_prim_type type,
 				enum osmo_prim_operation op)
 {
 	struct msgb *msg;
 
-	msg = msgb_alloc_headroom(L1SCHED_PRIM_HEADROOM + L1SCHED_PRIM_TAILROOM,
-				  L1SCHED_PRIM_HEADROOM, "l1sched_prim");
+	msg = l1sched_msgb_alloc(L1SCHED_PRIM_HEADROOM + L1SCHED_PRIM_TAILROOM,
+				 L1SCHED_PRIM_HEADROOM, "l1sched_prim");
 	if (msg == NULL)
 		return NULL;
 
@@ -302,7 +389,18 @@ int l1sched_lchan_emit_data_ind(struct l1sched_lchan_state *lchan,
 				int n_errors, int n_bits_total,
 				bool traffic)
 {
-	const struct l1sched_meas_set *meas = &lchan->meas_avg;
+	return l1sched_lchan_emit_data_ind_meas(lchan, &lchan->meas_avg,
+						data, data_len,
+						n_errors, n_bits_total,
+						traffic);
+}
+
+int l1sched_lchan_emit_data_ind_meas(struct l1sched_lchan_state *lchan,
+				     const struct l1sched_meas_set *meas,
+				     const uint8_t *data, size_t data_len,
+				     int n_errors, int n_bits_total,
+				     bool traffic)
+{
 	const struct l1sched_lchan_desc *lchan_desc;
 	struct l1sched_prim *prim;
 	struct msgb *msg;
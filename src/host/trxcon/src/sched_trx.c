@@ -25,7 +25,6 @@
 #include <talloc.h>
 #include <stdbool.h>
 
-#include <osmocom/gsm/a5.h>
 #include <osmocom/gsm/protocol/gsm_08_58.h>
 #include <osmocom/core/bits.h>
 #include <osmocom/core/msgb.h>
@@ -93,32 +92,31 @@ static void l1sched_a5_burst_enc(struct l1sched_lchan_state *lchan,
 void l1sched_pull_burst(struct l1sched_state *sched, struct l1sched_burst_req *br)
 {
 	struct l1sched_ts *ts = sched->ts[br->tn];
-	const struct l1sched_tdma_frame *frame;
+	const struct l1sched_ts_frame *ft;
 	struct l1sched_lchan_state *lchan;
 	l1sched_lchan_tx_func *handler;
-	enum l1sched_lchan_type chan;
-	unsigned int offset;
+
+	/* Emit results of asynchronous decoding (if any) */
+	l1sched_decoder_poll(sched);
 
 	/* Check if the given timeslot is configured */
 	if (ts == NULL || ts->mf_layout == NULL)
 		return;
 
-	/* Get frame from multiframe */
-	offset = br->fn % ts->mf_layout->period;
-	frame = &ts->mf_layout->frames[offset];
+	/* Get frame from the dispatch table */
+	ft = &ts->ftab[br->fn % ts->mf_layout->period];
 
 	/* Get required info from frame */
-	br->bid = frame->ul_bid;
-	chan = frame->ul_chan;
-	handler = l1sched_lchan_desc[chan].tx_fn;
+	br->bid = ft->ul_bid;
+	handler = ft->ul_handler;
 
 	/* Omit lchans without handler */
 	if (handler == NULL)
 		return;
 
 	/* Make sure that lchan is allocated and active */
-	lchan = l1sched_find_lchan_by_type(ts, chan);
-	if (lchan == NULL || !lchan->active)
+	lchan = ft->ul_lchan;
+	if (lchan == NULL)
 		return;
 
 	/* Handover RACH needs to be handled regardless of the
@@ -141,6 +139,71 @@ void l1sched_logging_init(int log_cat_common, int log_cat_data)
 	l1sched_log_cat_data = log_cat_data;
 }
 
+#define CTR_DEC_FAIL(type, name) \
+	[L1SCHED_CTR_RX_DEC_FAIL + L1SCHED_##type] = \
+		{ "rx:dec_fail:" name, "Decoding failures on " name }
+
+static const struct rate_ctr_desc l1sched_ctr_desc[] = {
+	[L1SCHED_CTR_RX_BURST_LATE] = \
+		{ "rx:burst:late", "Rx bursts older than the last processed one (dropped)" },
+	[L1SCHED_CTR_RX_FRAME_GAP] = \
+		{ "rx:frame:gap", "Too many TDMA frames lost to substitute them" },
+	[L1SCHED_CTR_RX_FRAME_SUBST] = \
+		{ "rx:frame:subst", "Lost TDMA frames substituted by dummy bursts" },
+	[L1SCHED_CTR_RX_DRX_SKIP] = \
+		{ "rx:drx:skip", "CCCH blocks not received due to DRX" },
+	CTR_DEC_FAIL(IDLE, "idle"),
+	CTR_DEC_FAIL(FCCH, "fcch"),
+	CTR_DEC_FAIL(SCH, "sch"),
+	CTR_DEC_FAIL(BCCH, "bcch"),
+	CTR_DEC_FAIL(RACH, "rach"),
+	CTR_DEC_FAIL(CCCH, "ccch"),
+	CTR_DEC_FAIL(TCHF, "tchf"),
+	CTR_DEC_FAIL(TCHH_0, "tchh_0"),
+	CTR_DEC_FAIL(TCHH_1, "tchh_1"),
+	CTR_DEC_FAIL(SDCCH4_0, "sdcch4_0"),
+	CTR_DEC_FAIL(SDCCH4_1, "sdcch4_1"),
+	CTR_DEC_FAIL(SDCCH4_2, "sdcch4_2"),
+	CTR_DEC_FAIL(SDCCH4_3, "sdcch4_3"),
+	CTR_DEC_FAIL(SDCCH8_0, "sdcch8_0"),
+	CTR_DEC_FAIL(SDCCH8_1, "sdcch8_1"),
+	CTR_DEC_FAIL(SDCCH8_2, "sdcch8_2"),
+	CTR_DEC_FAIL(SDCCH8_3, "sdcch8_3"),
+	CTR_DEC_FAIL(SDCCH8_4, "sdcch8_4"),
+	CTR_DEC_FAIL(SDCCH8_5, "sdcch8_5"),
+	CTR_DEC_FAIL(SDCCH8_6, "sdcch8_6"),
+	CTR_DEC_FAIL(SDCCH8_7, "sdcch8_7"),
+	CTR_DEC_FAIL(SACCHTF, "sacchtf"),
+	CTR_DEC_FAIL(SACCHTH_0, "sacchth_0"),
+	CTR_DEC_FAIL(SACCHTH_1, "sacchth_1"),
+	CTR_DEC_FAIL(SACCH4_0, "sacch4_0"),
+	CTR_DEC_FAIL(SACCH4_1, "sacch4_1"),
+	CTR_DEC_FAIL(SACCH4_2, "sacch4_2"),
+	CTR_DEC_FAIL(SACCH4_3, "sacch4_3"),
+	CTR_DEC_FAIL(SACCH8_0, "sacch8_0"),
+	CTR_DEC_FAIL(SACCH8_1, "sacch8_1"),
+	CTR_DEC_FAIL(SACCH8_2, "sacch8_2"),
+	CTR_DEC_FAIL(SACCH8_3, "sacch8_3"),
+	CTR_DEC_FAIL(SACCH8_4, "sacch8_4"),
+	CTR_DEC_FAIL(SACCH8_5, "sacch8_5"),
+	CTR_DEC_FAIL(SACCH8_6, "sacch8_6"),
+	CTR_DEC_FAIL(SACCH8_7, "sacch8_7"),
+	CTR_DEC_FAIL(PDTCH, "pdtch"),
+	CTR_DEC_FAIL(PTCCH, "ptcch"),
+	CTR_DEC_FAIL(SDCCH4_CBCH, "sdcch4_cbch"),
+	CTR_DEC_FAIL(SDCCH8_CBCH, "sdcch8_cbch"),
+};
+
+#undef CTR_DEC_FAIL
+
+static const struct rate_ctr_group_desc l1sched_ctrg_desc = {
+	.group_name_prefix = "l1sched",
+	.group_description = "L1 scheduler",
+	.num_ctr = ARRAY_SIZE(l1sched_ctr_desc),
+	.ctr_desc = l1sched_ctr_desc,
+};
+osmo_static_assert(ARRAY_SIZE(l1sched_ctr_desc) == _L1SCHED_CTR_MAX, l1sched_ctr_desc_size);
+
 struct l1sched_state *l1sched_alloc(void *ctx, const struct l1sched_cfg *cfg, void *priv)
 {
 	struct l1sched_state *sched;
@@ -160,6 +223,9 @@ struct l1sched_state *l1sched_alloc(void *ctx, const struct l1sched_cfg *cfg, vo
 	else
 		sched->log_prefix = talloc_strdup(sched, cfg->log_prefix);
 
+	/* Rate counters are optional */
+	sched->ctrs = rate_ctr_group_alloc(sched, &l1sched_ctrg_desc, cfg->ctr_idx);
+
 	return sched;
 }
 
@@ -172,10 +238,14 @@ void l1sched_free(struct l1sched_state *sched)
 
 	LOGP_SCHEDC(sched, LOGL_NOTICE, "Shutdown scheduler\n");
 
+	/* Stop decoder threads (if any) */
+	l1sched_decoder_stop(sched);
+
 	/* Free all potentially allocated timeslots */
 	for (tn = 0; tn < ARRAY_SIZE(sched->ts); tn++)
 		l1sched_del_ts(sched, tn);
 
+	rate_ctr_group_free(sched->ctrs);
 	talloc_free(sched);
 }
 
@@ -194,6 +264,93 @@ void l1sched_reset(struct l1sched_state *sched, bool reset_clock)
 		l1sched_del_ts(sched, tn);
 
 	memcpy(&sched->sacch_cache[0], &meas_rep_dummy[0], sizeof(meas_rep_dummy));
+
+	/* Do not keep keystreams of the previous connection */
+	l1sched_a5_cache_flush(sched);
+
+	/* DRX parameters are specific to the cell */
+	sched->drx = (struct l1sched_drx) { 0 };
+}
+
+/* First TDMA frame of each CCCH block within a 51-multiframe on TS0
+ * (see 3GPP TS 45.002, section 7, table 5 of clause 7) */
+static const uint8_t ccch_blk_fn[] = { 6, 12, 16, 22, 26, 32, 36, 42, 46 };
+
+int l1sched_set_drx(struct l1sched_state *sched, uint8_t bs_pa_mfrms,
+		    uint8_t bs_ag_blks_res, uint8_t paging_group)
+{
+	const struct l1sched_ts *ts = sched->ts[0];
+	unsigned int n;
+
+	if (bs_pa_mfrms == 0) {
+		if (sched->drx.bs_pa_mfrms != 0)
+			LOGP_SCHEDC(sched, LOGL_NOTICE, "DRX disabled\n");
+		sched->drx = (struct l1sched_drx) { 0 };
+		return 0;
+	}
+
+	if (ts == NULL || ts->mf_layout == NULL)
+		return -EINVAL;
+
+	/* Number of CCCH blocks in a 51-multiframe (see 3GPP TS 45.002, table 5) */
+	switch (ts->mf_layout->chan_config) {
+	case GSM_PCHAN_CCCH:
+		n = 9;
+		break;
+	case GSM_PCHAN_CCCH_SDCCH4:
+	case GSM_PCHAN_CCCH_SDCCH4_CBCH:
+		n = 3;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (bs_pa_mfrms < 2 || bs_pa_mfrms > 9 || bs_ag_blks_res >= n)
+		return -EINVAL;
+	/* Number of paging blocks in a 51-multiframe */
+	n -= bs_ag_blks_res;
+	if (paging_group >= n * bs_pa_mfrms)
+		return -EINVAL;
+
+	/* See 3GPP TS 45.002, section 6.5.3 */
+	sched->drx = (struct l1sched_drx) {
+		.bs_pa_mfrms = bs_pa_mfrms,
+		.mf = paging_group / n,
+		.blk = paging_group % n + bs_ag_blks_res,
+	};
+
+	LOGP_SCHEDC(sched, LOGL_NOTICE, "DRX enabled: paging block %u of "
+		    "51-multiframe %u/%u\n", sched->drx.blk, sched->drx.mf, bs_pa_mfrms);
+	return 0;
+}
+
+void l1sched_drx_hold(struct l1sched_state *sched, uint32_t fn)
+{
+	/* The AGCH may use any CCCH block, so receive all of them
+	 * while waiting for an IMMEDIATE ASSIGNMENT */
+	if (sched->drx.bs_pa_mfrms == 0)
+		return;
+	sched->drx.hold = true;
+	sched->drx.hold_fn = GSM_TDMA_FN_SUM(fn, L1SCHED_DRX_HOLD_FNS);
+}
+
+/* Whether a CCCH block starting at the given TDMA frame shall be received */
+static bool drx_rx_ccch_blk(struct l1sched_state *sched, uint32_t fn)
+{
+	struct l1sched_drx *drx = &sched->drx;
+
+	if (drx->bs_pa_mfrms == 0)
+		return true;
+
+	if (drx->hold) {
+		if (GSM_TDMA_FN_SUB(drx->hold_fn, fn) <= L1SCHED_DRX_HOLD_FNS)
+			return true;
+		drx->hold = false;
+	}
+
+	if ((fn / 51) % drx->bs_pa_mfrms != drx->mf)
+		return false;
+	return fn % 51 == ccch_blk_fn[drx->blk];
 }
 
 struct l1sched_ts *l1sched_add_ts(struct l1sched_state *sched, int tn)
@@ -268,8 +425,18 @@ int l1sched_configure_ts(struct l1sched_state *sched, int tn,
 	ts->mf_layout = l1sched_mframe_layout(config, tn);
 	if (!ts->mf_layout)
 		return -EINVAL;
-	if (ts->mf_layout->chan_config != config)
+	if (ts->mf_layout->chan_config != config) {
+		ts->mf_layout = NULL;
 		return -EINVAL;
+	}
+
+	/* Allocate the frame dispatch table */
+	ts->ftab = talloc_zero_array(ts, struct l1sched_ts_frame,
+				     ts->mf_layout->period);
+	if (ts->ftab == NULL) {
+		ts->mf_layout = NULL;
+		return -ENOMEM;
+	}
 
 	LOGP_SCHEDC(sched, LOGL_NOTICE,
 		    "(Re)configure TDMA timeslot #%u as %s\n",
@@ -305,6 +472,9 @@ int l1sched_configure_ts(struct l1sched_state *sched, int tn,
 			l1sched_activate_lchan(ts, type);
 	}
 
+	/* Resolve handlers of lchans without L1SCHED_CH_FLAG_AUTO */
+	l1sched_ts_update_ftab(ts);
+
 	/* Notify transceiver about TS activation */
 	l1sched_cfg_pchan_comb_ind(sched, tn, config);
 
@@ -321,12 +491,13 @@ int l1sched_reset_ts(struct l1sched_state *sched, int tn)
 	if (ts == NULL)
 		return -EINVAL;
 
-	/* Undefine multiframe layout */
-	ts->mf_layout = NULL;
-
 	/* Deactivate all logical channels */
 	l1sched_deactivate_all_lchans(ts);
 
+	/* Undefine multiframe layout */
+	ts->mf_layout = NULL;
+	TALLOC_FREE(ts->ftab);
+
 	/* Free channel states */
 	llist_for_each_entry_safe(lchan, lchan_next, &ts->lchans, list) {
 		llist_del(&lchan->list);
@@ -370,6 +541,38 @@ int l1sched_start_ciphering(struct l1sched_ts *ts, uint8_t algo,
 	return 0;
 }
 
+/* (Re)build the frame dispatch table of the given timeslot, so that
+ * the burst handlers do not need to look up the lchan states. */
+void l1sched_ts_update_ftab(struct l1sched_ts *ts)
+{
+	struct l1sched_lchan_state *lchans[_L1SCHED_CHAN_MAX] = { NULL };
+	const struct l1sched_tdma_multiframe *mf = ts->mf_layout;
+	struct l1sched_lchan_state *lchan;
+	unsigned int i;
+
+	if (mf == NULL || ts->ftab == NULL)
+		return;
+
+	/* Only active lchans get resolved */
+	llist_for_each_entry(lchan, &ts->lchans, list) {
+		if (lchan->active)
+			lchans[lchan->type] = lchan;
+	}
+
+	for (i = 0; i < mf->period; i++) {
+		const struct l1sched_tdma_frame *frame = &mf->frames[i];
+
+		ts->ftab[i] = (struct l1sched_ts_frame) {
+			.dl_lchan = lchans[frame->dl_chan],
+			.dl_handler = l1sched_lchan_desc[frame->dl_chan].rx_fn,
+			.dl_bid = frame->dl_bid,
+			.ul_lchan = lchans[frame->ul_chan],
+			.ul_handler = l1sched_lchan_desc[frame->ul_chan].tx_fn,
+			.ul_bid = frame->ul_bid,
+		};
+	}
+}
+
 struct l1sched_lchan_state *l1sched_find_lchan_by_type(struct l1sched_ts *ts,
 						       enum l1sched_lchan_type type)
 {
@@ -477,10 +680,16 @@ int l1sched_activate_lchan(struct l1sched_ts *ts, enum l1sched_lchan_type chan)
 
 	/* Conditionally allocate memory for bursts */
 	if (lchan_desc->rx_fn && lchan_desc->burst_buf_size > 0) {
-		lchan->rx_bursts = talloc_zero_size(lchan,
-			lchan_desc->burst_buf_size);
+		size_t size = lchan_desc->burst_buf_size;
+
+		/* Ring buffer keeps a mirror copy of each burst */
+		if (lchan_desc->flags & L1SCHED_CH_FLAG_RX_RING)
+			size *= 2;
+
+		lchan->rx_bursts = talloc_zero_size(lchan, size);
 		if (lchan->rx_bursts == NULL)
 			return -ENOMEM;
+		lchan->rx_bursts_head = 0;
 	}
 
 	if (lchan_desc->tx_fn && lchan_desc->burst_buf_size > 0) {
@@ -490,8 +699,12 @@ int l1sched_activate_lchan(struct l1sched_ts *ts, enum l1sched_lchan_type chan)
 			return -ENOMEM;
 	}
 
+	/* Results of decoding for the previous activation are stale */
+	lchan->gen = ++ts->sched->lchan_gen;
+
 	/* Finally, update channel status */
 	lchan->active = 1;
+	l1sched_ts_update_ftab(ts);
 
 	return 0;
 }
@@ -575,6 +788,7 @@ int l1sched_deactivate_lchan(struct l1sched_ts *ts, enum l1sched_lchan_type chan
 
 	/* Update activation flag */
 	lchan->active = 0;
+	l1sched_ts_update_ftab(ts);
 
 	return 0;
 }
@@ -598,6 +812,8 @@ void l1sched_deactivate_all_lchans(struct l1sched_ts *ts)
 		/* Update activation flag */
 		lchan->active = 0;
 	}
+
+	l1sched_ts_update_ftab(ts);
 }
 
 enum gsm_phys_chan_config l1sched_chan_nr2pchan_config(uint8_t chan_nr)
@@ -625,11 +841,13 @@ enum gsm_phys_chan_config l1sched_chan_nr2pchan_config(uint8_t chan_nr)
 static void l1sched_a5_burst_dec(struct l1sched_lchan_state *lchan,
 				 struct l1sched_burst_ind *bi)
 {
-	ubit_t ks[114];
+	const ubit_t *ks;
 	int i;
 
-	/* Generate keystream for a DL burst */
-	osmo_a5(lchan->a5.algo, lchan->a5.key, bi->fn, ks, NULL);
+	/* Get keystream for a DL burst */
+	ks = l1sched_a5_keystream(lchan, bi->fn, false);
+	if (ks == NULL)
+		return;
 
 	/* Apply keystream over ciphertext */
 	for (i = 0; i < 57; i++) {
@@ -643,11 +861,13 @@ static void l1sched_a5_burst_dec(struct l1sched_lchan_state *lchan,
 static void l1sched_a5_burst_enc(struct l1sched_lchan_state *lchan,
 				 struct l1sched_burst_req *br)
 {
-	ubit_t ks[114];
+	const ubit_t *ks;
 	int i;
 
-	/* Generate keystream for an UL burst */
-	osmo_a5(lchan->a5.algo, lchan->a5.key, br->fn, NULL, ks);
+	/* Get keystream for an UL burst */
+	ks = l1sched_a5_keystream(lchan, br->fn, true);
+	if (ks == NULL)
+		return;
 
 	/* Apply keystream over plaintext */
 	for (i = 0; i < 57; i++) {
@@ -686,6 +906,7 @@ static int subst_frame_loss(struct l1sched_lchan_state *lchan,
 		LOGP_LCHAND(lchan, LOGL_ERROR, "Rx burst with fn=%u older than the last "
 			    "processed fn=%u (see OS#4658) => dropping\n",
 			    fn, lchan->tdma.last_proc);
+		l1sched_ctr_inc(lchan->ts->sched, L1SCHED_CTR_RX_BURST_LATE);
 		return -EALREADY;
 	}
 
@@ -695,6 +916,7 @@ static int subst_frame_loss(struct l1sched_lchan_state *lchan,
 			    "Too many (>%u) contiguous TDMA frames elapsed (%d) "
 			    "since the last processed fn=%u (current %u)\n",
 			    mf->period, elapsed, lchan->tdma.last_proc, fn);
+		l1sched_ctr_inc(lchan->ts->sched, L1SCHED_CTR_RX_FRAME_GAP);
 		return -EIO;
 	} else if (elapsed == 0) {
 		LOGP_LCHANC(lchan, LOGL_ERROR,
@@ -717,6 +939,10 @@ static int subst_frame_loss(struct l1sched_lchan_state *lchan,
 		fp = &mf->frames[GSM_TDMA_FN_INC(bi.fn) % mf->period];
 		if (fp->dl_chan != lchan->type)
 			continue;
+		/* Do not substitute CCCH blocks we would not receive anyway */
+		if (lchan->type == L1SCHED_CCCH &&
+		    !drx_rx_ccch_blk(lchan->ts->sched, GSM_TDMA_FN_SUB(bi.fn, fp->dl_bid)))
+			continue;
 
 		LOGP_LCHANC(lchan, LOGL_NOTICE,
 			    "Substituting lost TDMA frame fn=%u\n", bi.fn);
@@ -728,6 +954,7 @@ static int subst_frame_loss(struct l1sched_lchan_state *lchan,
 		lchan->tdma.last_proc = bi.fn;
 		lchan->tdma.num_proc++;
 		lchan->tdma.num_lost++;
+		l1sched_ctr_inc(lchan->ts->sched, L1SCHED_CTR_RX_FRAME_SUBST);
 	}
 
 	return 0;
@@ -737,12 +964,10 @@ int l1sched_handle_rx_burst(struct l1sched_state *sched,
 			    struct l1sched_burst_ind *bi)
 {
 	struct l1sched_lchan_state *lchan;
-	const struct l1sched_tdma_frame *frame;
+	const struct l1sched_ts_frame *ft;
 	struct l1sched_ts *ts = sched->ts[bi->tn];
 
 	l1sched_lchan_rx_func *handler;
-	enum l1sched_lchan_type chan;
-	uint8_t offset;
 	int rc;
 
 	/* Check whether required timeslot is allocated and configured */
@@ -752,28 +977,31 @@ int l1sched_handle_rx_burst(struct l1sched_state *sched,
 		return -EINVAL;
 	}
 
-	/* Get frame from multiframe */
-	offset = bi->fn % ts->mf_layout->period;
-	frame = ts->mf_layout->frames + offset;
+	/* Get frame from the dispatch table */
+	ft = &ts->ftab[bi->fn % ts->mf_layout->period];
 
 	/* Get required info from frame */
-	bi->bid = frame->dl_bid;
-	chan = frame->dl_chan;
-	handler = l1sched_lchan_desc[chan].rx_fn;
+	bi->bid = ft->dl_bid;
+	handler = ft->dl_handler;
 
 	/* Omit bursts which have no handler, like IDLE bursts.
 	 * TODO: handle noise indications during IDLE frames. */
 	if (!handler)
 		return -ENODEV;
 
-	/* Find required channel state */
-	lchan = l1sched_find_lchan_by_type(ts, chan);
+	/* Ensure that channel is active */
+	lchan = ft->dl_lchan;
 	if (lchan == NULL)
-		return -ENODEV;
+		return 0;
 
-	/* Ensure that channel is active */
-	if (!lchan->active)
+	/* DRX: skip CCCH blocks other than the own paging block */
+	if (lchan->type == L1SCHED_CCCH &&
+	    !drx_rx_ccch_blk(sched, GSM_TDMA_FN_SUB(bi->fn, bi->bid))) {
+		if (bi->bid == 0)
+			l1sched_ctr_inc(sched, L1SCHED_CTR_RX_DRX_SKIP);
+		lchan->tdma.last_proc = bi->fn;
 		return 0;
+	}
 
 	/* Compensate lost TDMA frames (if any) */
 	rc = subst_frame_loss(lchan, handler, bi->fn);
@@ -808,27 +1036,19 @@ int l1sched_handle_rx_probe(struct l1sched_state *sched,
 			    struct l1sched_probe *probe)
 {
 	struct l1sched_ts *ts = sched->ts[probe->tn];
-	const struct l1sched_tdma_frame *frame;
-	struct l1sched_lchan_state *lchan;
-	unsigned int offset;
+	const struct l1sched_ts_frame *ft;
 
 	/* Check whether required timeslot is allocated and configured */
 	if (ts == NULL || ts->mf_layout == NULL)
 		return -EINVAL;
 
-	/* Get frame from multiframe */
-	offset = probe->fn % ts->mf_layout->period;
-	frame = &ts->mf_layout->frames[offset];
+	/* Get frame from the dispatch table */
+	ft = &ts->ftab[probe->fn % ts->mf_layout->period];
 
-	if (l1sched_lchan_desc[frame->dl_chan].rx_fn == NULL)
-		return -ENODEV;
-
-	/* Find the appropriate logical channel */
-	lchan = l1sched_find_lchan_by_type(ts, frame->dl_chan);
-	if (lchan == NULL)
+	if (ft->dl_handler == NULL)
 		return -ENODEV;
 
-	if (lchan->active)
+	if (ft->dl_lchan != NULL)
 		probe->flags |= L1SCHED_PROBE_F_ACTIVE;
 
 	return 0;
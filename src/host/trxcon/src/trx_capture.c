@@ -0,0 +1,169 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * Transceiver interface: capturing of TRXC/TRXD messages
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/bits.h>
+
+#include <osmocom/bb/trxcon/trx_capture.h>
+
+#define TRX_CAPTURE_HDR_LEN	8
+#define TRX_CAPTURE_REC_HDR_LEN	8
+
+/* Captured messages are small, so let stdio do the batching */
+#define TRX_CAPTURE_IOBUF_SIZE	(256 * 1024)
+
+struct trx_capture {
+	FILE *file;
+	char *iobuf;
+	bool write;
+	/* time of the previous record (CLOCK_MONOTONIC, us) */
+	uint64_t last_us;
+	/* time elapsed since the beginning of capture (reading only) */
+	uint64_t time_us;
+};
+
+static uint64_t trx_capture_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int trx_capture_destructor(struct trx_capture *cap)
+{
+	if (cap->file != NULL)
+		fclose(cap->file);
+	return 0;
+}
+
+/*! Open a capture file for writing (truncating it) or for reading.
+ *  \returns capture handle, or NULL on error (errno is set). */
+struct trx_capture *trx_capture_open(void *ctx, const char *path, bool write)
+{
+	uint8_t hdr[TRX_CAPTURE_HDR_LEN] = TRX_CAPTURE_MAGIC;
+	struct trx_capture *cap;
+
+	cap = talloc_zero(ctx, struct trx_capture);
+	if (cap == NULL) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	cap->write = write;
+	cap->file = fopen(path, write ? "wb" : "rb");
+	if (cap->file == NULL)
+		goto error;
+	talloc_set_destructor(cap, &trx_capture_destructor);
+
+	cap->iobuf = talloc_size(cap, TRX_CAPTURE_IOBUF_SIZE);
+	if (cap->iobuf != NULL)
+		setvbuf(cap->file, cap->iobuf, _IOFBF, TRX_CAPTURE_IOBUF_SIZE);
+
+	if (write) {
+		hdr[6] = TRX_CAPTURE_VERSION;
+		if (fwrite(hdr, sizeof(hdr), 1, cap->file) != 1)
+			goto error;
+		cap->last_us = trx_capture_now_us();
+	} else {
+		if (fread(hdr, sizeof(hdr), 1, cap->file) != 1)
+			goto error;
+		if (memcmp(hdr, TRX_CAPTURE_MAGIC, 6) != 0 || hdr[6] != TRX_CAPTURE_VERSION) {
+			errno = EPROTO;
+			goto error;
+		}
+	}
+
+	return cap;
+
+error:
+	talloc_free(cap);
+	return NULL;
+}
+
+void trx_capture_close(struct trx_capture *cap)
+{
+	talloc_free(cap);
+}
+
+/*! Append a message to the capture file.
+ *  \returns 0 on success; -EIO on error (e.g. disk full), in which case
+ *           the last record may be truncated. */
+int trx_capture_write(struct trx_capture *cap, enum trx_capture_rec_type type,
+		      const uint8_t *buf, size_t len)
+{
+	uint8_t hdr[TRX_CAPTURE_REC_HDR_LEN];
+	uint64_t now_us, delta_us;
+
+	if (cap == NULL || !cap->write)
+		return 0;
+	if (len > TRX_CAPTURE_MSG_MAX)
+		len = TRX_CAPTURE_MSG_MAX;
+
+	now_us = trx_capture_now_us();
+	delta_us = now_us - cap->last_us;
+	cap->last_us = now_us;
+	if (delta_us > UINT32_MAX)
+		delta_us = UINT32_MAX;
+
+	hdr[0] = type;
+	hdr[1] = 0x00;
+	osmo_store16be(len, &hdr[2]);
+	osmo_store32be(delta_us, &hdr[4]);
+
+	if (fwrite(hdr, sizeof(hdr), 1, cap->file) != 1)
+		return -EIO;
+	if (len > 0 && fwrite(buf, len, 1, cap->file) != 1)
+		return -EIO;
+
+	return 0;
+}
+
+/*! Read the next message from the capture file.
+ *  \returns 1 if a record has been read; 0 at the end of file;
+ *           negative on error (e.g. truncated record). */
+int trx_capture_read(struct trx_capture *cap, struct trx_capture_rec *rec)
+{
+	uint8_t hdr[TRX_CAPTURE_REC_HDR_LEN];
+	size_t len;
+
+	if (fread(hdr, sizeof(hdr), 1, cap->file) != 1)
+		return feof(cap->file) ? 0 : -EIO;
+
+	len = osmo_load16be(&hdr[2]);
+	if (len > sizeof(rec->buf))
+		return -EPROTO;
+	if (len > 0 && fread(rec->buf, len, 1, cap->file) != 1)
+		return -EIO;
+
+	cap->time_us += osmo_load32be(&hdr[4]);
+
+	rec->type = hdr[0];
+	rec->time_us = cap->time_us;
+	rec->len = len;
+
+	return 1;
+}
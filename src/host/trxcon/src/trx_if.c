@@ -22,14 +22,18 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <errno.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <netinet/in.h>
+#include <sys/socket.h>
 
 #include <osmocom/core/logging.h>
 #include <osmocom/core/select.h>
@@ -37,17 +41,94 @@
 #include <osmocom/core/talloc.h>
 #include <osmocom/core/bits.h>
 #include <osmocom/core/fsm.h>
+#include <osmocom/core/rate_ctr.h>
 
 #include <osmocom/gsm/gsm_utils.h>
 #include <osmocom/gsm/gsm0502.h>
 
 #include <osmocom/bb/trxcon/trx_if.h>
+#include <osmocom/bb/trxcon/trx_capture.h>
 #include <osmocom/bb/trxcon/logging.h>
+#include <osmocom/bb/trxcon/trxcon_stats.h>
 
 #define TRXDv0_HDR_LEN		8
+#define TRXDv1_HDR_LEN		11
+#define TRXDv2_RX_HDR_LEN	8	/* + 4 bytes FN in the first PDU */
+#define TRXDv2_TX_HDR_LEN	8	/* + 4 bytes FN in the first PDU */
 
 #define S(x)	(1 << (x))
 
+/* State of batched TRXD I/O using recvmmsg() / sendmmsg() */
+struct trx_data_mmsg {
+	struct {
+		struct mmsghdr hdr[TRXD_MMSG_VLEN];
+		struct iovec iov[TRXD_MMSG_VLEN];
+		uint8_t buf[TRXD_MMSG_VLEN][TRXD_BUF_SIZE];
+		/* message indexes sorted by TDMA frame number */
+		unsigned int order[TRXD_MMSG_VLEN];
+	} rx;
+	struct {
+		struct mmsghdr hdr[TRXD_MMSG_VLEN];
+		struct iovec iov[TRXD_MMSG_VLEN];
+		uint8_t buf[TRXD_MMSG_VLEN][TRXD_BUF_SIZE];
+		/* number of pending messages */
+		unsigned int num;
+	} tx;
+};
+
+/* Latency histograms are represented by rate counters, one per bucket.
+ * Rx latency is the time between reception of a TRXD message and return
+ * from the scheduler's burst handler.  Tx latency is the time between
+ * reception of a TRXD message and the scheduler asking us to send the
+ * Uplink burst, relative to the budget of fn_advance TDMA frames. */
+enum trx_if_ctr {
+	TRX_IF_CTR_RX_LAT_LT_50US,
+	TRX_IF_CTR_RX_LAT_LT_100US,
+	TRX_IF_CTR_RX_LAT_LT_250US,
+	TRX_IF_CTR_RX_LAT_LT_500US,
+	TRX_IF_CTR_RX_LAT_LT_1MS,
+	TRX_IF_CTR_RX_LAT_LT_2MS,
+	TRX_IF_CTR_RX_LAT_GE_2MS,
+	TRX_IF_CTR_TX_LAT_LT_10PCT,
+	TRX_IF_CTR_TX_LAT_LT_25PCT,
+	TRX_IF_CTR_TX_LAT_LT_50PCT,
+	TRX_IF_CTR_TX_LAT_LT_100PCT,
+	TRX_IF_CTR_TX_LAT_LATE,
+	TRX_IF_CTR_RX_NOPE_IND,
+	TRX_IF_CTR_FN_ADV_INC,
+	TRX_IF_CTR_FN_ADV_DEC,
+};
+
+static const struct rate_ctr_desc trx_if_ctr_desc[] = {
+	[TRX_IF_CTR_RX_LAT_LT_50US]	= { "rx:latency:lt_50us", "Rx latency < 50us" },
+	[TRX_IF_CTR_RX_LAT_LT_100US]	= { "rx:latency:lt_100us", "Rx latency < 100us" },
+	[TRX_IF_CTR_RX_LAT_LT_250US]	= { "rx:latency:lt_250us", "Rx latency < 250us" },
+	[TRX_IF_CTR_RX_LAT_LT_500US]	= { "rx:latency:lt_500us", "Rx latency < 500us" },
+	[TRX_IF_CTR_RX_LAT_LT_1MS]	= { "rx:latency:lt_1ms", "Rx latency < 1ms" },
+	[TRX_IF_CTR_RX_LAT_LT_2MS]	= { "rx:latency:lt_2ms", "Rx latency < 2ms" },
+	[TRX_IF_CTR_RX_LAT_GE_2MS]	= { "rx:latency:ge_2ms", "Rx latency >= 2ms" },
+	[TRX_IF_CTR_TX_LAT_LT_10PCT]	= { "tx:latency:lt_10pct", "Tx latency < 10% of the budget" },
+	[TRX_IF_CTR_TX_LAT_LT_25PCT]	= { "tx:latency:lt_25pct", "Tx latency < 25% of the budget" },
+	[TRX_IF_CTR_TX_LAT_LT_50PCT]	= { "tx:latency:lt_50pct", "Tx latency < 50% of the budget" },
+	[TRX_IF_CTR_TX_LAT_LT_100PCT]	= { "tx:latency:lt_100pct", "Tx latency < 100% of the budget" },
+	[TRX_IF_CTR_TX_LAT_LATE]	= { "tx:latency:late", "Tx latency exceeds the budget" },
+	[TRX_IF_CTR_RX_NOPE_IND]	= { "rx:nope_ind", "Received NOPE.ind (no burst)" },
+	[TRX_IF_CTR_FN_ADV_INC]		= { "fn_advance:inc", "Adaptive fn_advance increased" },
+	[TRX_IF_CTR_FN_ADV_DEC]		= { "fn_advance:dec", "Adaptive fn_advance decreased" },
+};
+
+static const struct rate_ctr_group_desc trx_if_ctrg_desc = {
+	.group_name_prefix = "trx_if",
+	.group_description = "Transceiver interface",
+	.num_ctr = ARRAY_SIZE(trx_if_ctr_desc),
+	.ctr_desc = trx_if_ctr_desc,
+};
+
+/* Bucket bounds (exclusive) of the Rx latency histogram, in us */
+static const unsigned int trx_if_rx_lat_bounds[] = { 50, 100, 250, 500, 1000, 2000 };
+/* Bucket bounds (exclusive) of the Tx latency histogram, in % of the budget */
+static const unsigned int trx_if_tx_lat_bounds[] = { 10, 25, 50, 100 };
+
 static void trx_fsm_cleanup_cb(struct osmo_fsm_inst *fi,
 			       enum osmo_fsm_term_cause cause);
 
@@ -81,7 +162,8 @@ static struct osmo_fsm_state trx_fsm_states[] = {
 	},
 };
 
-static struct osmo_fsm trx_fsm = {
+/* Thread-local, see trxcon_fsm_def and trx_if_thread_init() */
+static __thread struct osmo_fsm trx_fsm = {
 	.name = "trx_interface",
 	.states = trx_fsm_states,
 	.num_states = ARRAY_SIZE(trx_fsm_states),
@@ -90,6 +172,19 @@ static struct osmo_fsm trx_fsm = {
 	.cleanup = &trx_fsm_cleanup_cb,
 };
 
+/* Append a message to the capture file, stop capturing on error */
+static void trx_if_capture(struct trx_instance *trx, enum trx_capture_rec_type type,
+			   const uint8_t *buf, size_t len)
+{
+	if (trx_capture_write(trx->capture, type, buf, len) == 0)
+		return;
+
+	LOGPFSML(trx->fi, LOGL_ERROR, "Failed to write capture file, "
+		 "capturing stopped (the last record may be truncated)\n");
+	trx_capture_close(trx->capture);
+	trx->capture = NULL;
+}
+
 static int trx_udp_open(void *priv, struct osmo_fd *ofd, const char *host_local,
 	uint16_t port_local, const char *host_remote, uint16_t port_remote,
 	int (*cb)(struct osmo_fd *fd, unsigned int what))
@@ -138,20 +233,26 @@ static void trx_udp_close(struct osmo_fd *ofd)
 /* Successful responses may include results, depending on the command type. */
 /* ------------------------------------------------------------------------ */
 
+/* Commands which are sent one by one, waiting for response to each of them.
+ * Any other commands may be pipelined (up to trx_ctrl_window of them), so
+ * that e.g. RXTUNE, TXTUNE, SETSLOT and SETTA do not cost a round-trip each.
+ * Responses are matched to the commands by their verb. */
+#define TRXC_F_CRITICAL		(1 << 0)	/* failure terminates the interface */
+#define TRXC_F_BARRIER		(1 << 1)	/* see trx_ctrl_msg.barrier */
+
 static void trx_ctrl_timer_cb(void *data);
 
-/* Send first CTRL message and start timer */
-static void trx_ctrl_send(struct trx_instance *trx)
+/* Send (or re-send) the given CTRL message and start its timer */
+static void trx_ctrl_send_msg(struct trx_instance *trx, struct trx_ctrl_msg *tcm)
 {
-	struct trx_ctrl_msg *tcm;
-
-	if (llist_empty(&trx->trx_ctrl_list))
-		return;
-	tcm = llist_entry(trx->trx_ctrl_list.next, struct trx_ctrl_msg, list);
-
 	/* Send command */
 	LOGPFSML(trx->fi, LOGL_DEBUG, "Sending control '%s'\n", tcm->cmd);
 	send(trx->trx_ofd_ctrl.fd, tcm->cmd, strlen(tcm->cmd) + 1, 0);
+	tcm->sent = true;
+
+	if (OSMO_UNLIKELY(trx->capture != NULL))
+		trx_if_capture(trx, TRX_CAPTURE_TRXC_TX,
+			       (const uint8_t *)tcm->cmd, strlen(tcm->cmd) + 1);
 
 	/* Trigger state machine */
 	if (trx->fi->state != TRX_STATE_RSP_WAIT) {
@@ -160,23 +261,63 @@ static void trx_ctrl_send(struct trx_instance *trx)
 	}
 
 	/* Start expire timer */
-	trx->trx_ctrl_timer.data = trx;
-	trx->trx_ctrl_timer.cb = trx_ctrl_timer_cb;
-	osmo_timer_schedule(&trx->trx_ctrl_timer, 2, 0);
+	tcm->timer.data = tcm;
+	tcm->timer.cb = trx_ctrl_timer_cb;
+	osmo_timer_schedule(&tcm->timer, 2, 0);
 }
 
-static void trx_ctrl_timer_cb(void *data)
+/* Send pending CTRL messages, as many as the window allows */
+static void trx_ctrl_send(struct trx_instance *trx)
 {
-	struct trx_instance *trx = (struct trx_instance *) data;
 	struct trx_ctrl_msg *tcm;
+	unsigned int num_sent = 0;
+
+	llist_for_each_entry(tcm, &trx->trx_ctrl_list, list) {
+		if (tcm->sent) {
+			/* Nothing else goes out until the barrier's RSP */
+			if (tcm->barrier)
+				return;
+			num_sent++;
+			continue;
+		}
 
-	/* Queue may be cleaned at this moment */
-	if (llist_empty(&trx->trx_ctrl_list))
-		return;
+		if (num_sent >= trx->trx_ctrl_window)
+			return;
+		/* A barrier waits for responses to all preceding commands */
+		if (tcm->barrier && num_sent > 0)
+			return;
 
-	LOGPFSML(trx->fi, LOGL_NOTICE, "No response from transceiver...\n");
+		trx_ctrl_send_msg(trx, tcm);
+		if (tcm->barrier)
+			return;
+		num_sent++;
+	}
+}
+
+/* Find a sent CTRL message matching the given response verb */
+static struct trx_ctrl_msg *trx_ctrl_find(struct trx_instance *trx,
+					  const char *verb, int verb_len)
+{
+	struct trx_ctrl_msg *tcm;
+
+	llist_for_each_entry(tcm, &trx->trx_ctrl_list, list) {
+		if (!tcm->sent)
+			break;
+		if (tcm->cmd_len == verb_len && !strncmp(tcm->cmd + 4, verb, verb_len))
+			return tcm;
+	}
+
+	return NULL;
+}
+
+static void trx_ctrl_timer_cb(void *data)
+{
+	struct trx_ctrl_msg *tcm = data;
+	struct trx_instance *trx = tcm->trx;
+
+	LOGPFSML(trx->fi, LOGL_NOTICE, "No response from transceiver "
+		 "for '%s'...\n", tcm->cmd);
 
-	tcm = llist_entry(trx->trx_ctrl_list.next, struct trx_ctrl_msg, list);
 	if (++tcm->retry_cnt > 3) {
 		LOGPFSML(trx->fi, LOGL_NOTICE, "Transceiver offline\n");
 		osmo_fsm_inst_state_chg(trx->fi, TRX_STATE_OFFLINE, 0, 0);
@@ -184,23 +325,20 @@ static void trx_ctrl_timer_cb(void *data)
 		return;
 	}
 
-	/* Attempt to send a command again */
-	trx_ctrl_send(trx);
+	/* Attempt to send this command again */
+	trx_ctrl_send_msg(trx, tcm);
 }
 
 /* Add a new CTRL command to the trx_ctrl_list */
-static int trx_ctrl_cmd(struct trx_instance *trx, int critical,
+static int trx_ctrl_cmd(struct trx_instance *trx, unsigned int flags,
 	const char *cmd, const char *fmt, ...)
 {
 	struct trx_ctrl_msg *tcm;
-	int len, pending = 0;
+	int len;
 	va_list ap;
 
 	/* TODO: make sure that transceiver online */
 
-	if (!llist_empty(&trx->trx_ctrl_list))
-		pending = 1;
-
 	/* Allocate a message */
 	tcm = talloc_zero(trx, struct trx_ctrl_msg);
 	if (!tcm)
@@ -216,14 +354,15 @@ static int trx_ctrl_cmd(struct trx_instance *trx, int critical,
 		snprintf(tcm->cmd, sizeof(tcm->cmd) - 1, "CMD %s", cmd);
 	}
 
+	tcm->trx = trx;
 	tcm->cmd_len = strlen(cmd);
-	tcm->critical = critical;
+	tcm->critical = !!(flags & TRXC_F_CRITICAL);
+	tcm->barrier = !!(flags & TRXC_F_BARRIER);
 	llist_add_tail(&tcm->list, &trx->trx_ctrl_list);
 	LOGPFSML(trx->fi, LOGL_INFO, "Adding new control '%s'\n", tcm->cmd);
 
-	/* Send message, if no pending messages */
-	if (!pending)
-		trx_ctrl_send(trx);
+	/* Send message, if the window allows */
+	trx_ctrl_send(trx);
 
 	return 0;
 }
@@ -251,12 +390,12 @@ static int trx_ctrl_cmd(struct trx_instance *trx, int critical,
 
 static int trx_if_cmd_echo(struct trx_instance *trx)
 {
-	return trx_ctrl_cmd(trx, 1, "ECHO", "");
+	return trx_ctrl_cmd(trx, TRXC_F_CRITICAL | TRXC_F_BARRIER, "ECHO", "");
 }
 
 static int trx_if_cmd_poweroff(struct trx_instance *trx)
 {
-	return trx_ctrl_cmd(trx, 1, "POWEROFF", "");
+	return trx_ctrl_cmd(trx, TRXC_F_CRITICAL | TRXC_F_BARRIER, "POWEROFF", "");
 }
 
 static int trx_if_cmd_poweron(struct trx_instance *trx)
@@ -265,7 +404,7 @@ static int trx_if_cmd_poweron(struct trx_instance *trx)
 	if (trx->powered_up)
 		return -EAGAIN;
 #endif
-	return trx_ctrl_cmd(trx, 1, "POWERON", "");
+	return trx_ctrl_cmd(trx, TRXC_F_CRITICAL | TRXC_F_BARRIER, "POWERON", "");
 }
 
 /*
@@ -296,7 +435,7 @@ static int trx_if_cmd_setslot(struct trx_instance *trx,
 		[GSM_PCHAN_PDCH]                = 13,
 	};
 
-	return trx_ctrl_cmd(trx, 1, "SETSLOT", "%u %u",
+	return trx_ctrl_cmd(trx, TRXC_F_CRITICAL, "SETSLOT", "%u %u",
 			    cmdp->tn, chan_types[cmdp->pchan]);
 }
 
@@ -324,7 +463,7 @@ static int trx_if_cmd_rxtune(struct trx_instance *trx,
 		return -ENOTSUP;
 	}
 
-	return trx_ctrl_cmd(trx, 1, "RXTUNE", "%u", freq10 * 100);
+	return trx_ctrl_cmd(trx, TRXC_F_CRITICAL, "RXTUNE", "%u", freq10 * 100);
 }
 
 static int trx_if_cmd_txtune(struct trx_instance *trx,
@@ -339,7 +478,7 @@ static int trx_if_cmd_txtune(struct trx_instance *trx,
 		return -ENOTSUP;
 	}
 
-	return trx_ctrl_cmd(trx, 1, "TXTUNE", "%u", freq10 * 100);
+	return trx_ctrl_cmd(trx, TRXC_F_CRITICAL, "TXTUNE", "%u", freq10 * 100);
 }
 
 /*
@@ -352,38 +491,72 @@ static int trx_if_cmd_txtune(struct trx_instance *trx,
  * previous frequency.
  * CMD MEASURE <kHz>
  * RSP MEASURE <status> <kHz> <dB>
+ *
+ * MEASRANGE does the same for <num> frequencies, starting
+ * from <kHz> and spaced by <step> kHz, so that a whole band
+ * can be scanned in a few round-trips.  Transceivers not
+ * supporting this command are detected by the response,
+ * in which case trxcon falls back to MEASURE.
+ * CMD MEASRANGE <kHz> <step> <num>
+ * RSP MEASRANGE <status> <kHz> <step> <num> <dB> [... <dB>]
  */
 
-static int trx_if_cmd_measure(struct trx_instance *trx,
-			      const struct trxcon_phyif_cmdp_measure *cmdp)
+/* Send MEASURE or MEASRANGE for the next ARFCN(s) of the range */
+static int trx_if_meas_next(struct trx_instance *trx)
 {
-	uint16_t freq10;
+	uint16_t band_arfcn = trx->meas.band_arfcn;
+	uint16_t freq10, freq10_last;
+	unsigned int num;
+
+	if (!trx->meas.active)
+		return 0;
+	if (band_arfcn > trx->meas.band_arfcn_stop) {
+		trx->meas.active = false;
+		return 0;
+	}
 
 	/* Calculate a frequency for current ARFCN (DL) */
-	freq10 = gsm_arfcn2freq10(cmdp->band_arfcn, 0);
+	freq10 = gsm_arfcn2freq10(band_arfcn, 0);
 	if (freq10 == 0xffff) {
 		LOGPFSML(trx->fi, LOGL_ERROR,
-			 "ARFCN %d not defined\n", cmdp->band_arfcn);
+			 "ARFCN %d not defined\n", band_arfcn);
+		trx->meas.active = false;
 		return -ENOTSUP;
 	}
 
-	return trx_ctrl_cmd(trx, 1, "MEASURE", "%u", freq10 * 100);
+	num = OSMO_MIN(trx->meas.band_arfcn_stop - band_arfcn + 1, TRXC_MEASRANGE_MAX);
+	if (num > 1 && !trx->meas.range_unsupported) {
+		/* Make sure the frequencies are equally spaced (200 kHz) */
+		freq10_last = gsm_arfcn2freq10(band_arfcn + num - 1, 0);
+		if (freq10_last == freq10 + 2 * (num - 1)) {
+			return trx_ctrl_cmd(trx, 0, "MEASRANGE", "%u %u %u",
+					    freq10 * 100, 200, num);
+		}
+	}
+
+	return trx_ctrl_cmd(trx, TRXC_F_CRITICAL, "MEASURE", "%u", freq10 * 100);
 }
 
-static void trx_if_measure_rsp_cb(struct trx_instance *trx, char *resp)
+static int trx_if_cmd_measure(struct trx_instance *trx,
+			      const struct trxcon_phyif_cmdp_measure *cmdp)
 {
-	unsigned int freq10;
-	uint16_t band_arfcn;
-	int dbm;
+	trx->meas.band_arfcn = cmdp->band_arfcn;
+	trx->meas.band_arfcn_stop = OSMO_MAX(cmdp->band_arfcn, cmdp->band_arfcn_stop);
+	trx->meas.active = true;
 
-	/* Parse freq. and power level */
-	sscanf(resp, "%u %d", &freq10, &dbm);
-	freq10 /= 100;
+	return trx_if_meas_next(trx);
+}
+
+/* Emit measurement results for num consecutive ARFCNs, measure the next ones */
+static void trx_if_meas_emit(struct trx_instance *trx, unsigned int freq10,
+			     const int *dbm, unsigned int num)
+{
+	uint16_t band_arfcn;
 
 	band_arfcn = gsm_freq102arfcn((uint16_t) freq10, 0);
 	if (band_arfcn == 0xffff) {
 		LOGPFSML(trx->fi, LOGL_ERROR,
-			 "Failed to parse ARFCN from RSP MEASURE: %s\n", resp);
+			 "Failed to parse ARFCN from RSP MEASURE\n");
 		return;
 	}
 
@@ -392,10 +565,58 @@ static void trx_if_measure_rsp_cb(struct trx_instance *trx, char *resp)
 		.param.measure = {
 			.band_arfcn = band_arfcn,
 			.dbm = dbm,
+			.num = num,
 		},
 	};
 
 	trxcon_phyif_handle_rsp(trx->priv, &rsp);
+
+	if (trx->meas.active && band_arfcn == trx->meas.band_arfcn) {
+		trx->meas.band_arfcn = band_arfcn + num;
+		trx_if_meas_next(trx);
+	}
+}
+
+static void trx_if_measure_rsp_cb(struct trx_instance *trx, char *resp)
+{
+	unsigned int freq10;
+	int dbm;
+
+	/* Parse freq. and power level */
+	if (sscanf(resp, "%u %d", &freq10, &dbm) != 2) {
+		LOGPFSML(trx->fi, LOGL_ERROR, "Malformed RSP MEASURE: %s\n", resp);
+		return;
+	}
+
+	trx_if_meas_emit(trx, freq10 / 100, &dbm, 1);
+}
+
+/* resp points to the status code, NULL if the command is not supported */
+static void trx_if_measrange_rsp_cb(struct trx_instance *trx, const char *resp)
+{
+	int dbm[TRXC_MEASRANGE_MAX];
+	unsigned int freq, step, num, i;
+	int status, n;
+
+	if (resp == NULL || sscanf(resp, "%d %u %u %u%n", &status, &freq, &step, &num, &n) != 4)
+		goto fallback;
+	if (status != 0 || step != 200 || num == 0 || num > ARRAY_SIZE(dbm))
+		goto fallback;
+
+	for (i = 0, resp += n; i < num; i++, resp += n) {
+		if (sscanf(resp, "%d%n", &dbm[i], &n) != 1)
+			goto fallback;
+	}
+
+	trx_if_meas_emit(trx, freq / 100, &dbm[0], num);
+	return;
+
+fallback:
+	/* Some transceivers reply to unknown commands with status 0 */
+	LOGPFSML(trx->fi, LOGL_NOTICE, "Transceiver does not support "
+		 "MEASRANGE, falling back to MEASURE\n");
+	trx->meas.range_unsupported = true;
+	trx_if_meas_next(trx);
 }
 
 /*
@@ -474,7 +695,56 @@ static int trx_if_cmd_setfh(struct trx_instance *trx,
 	/* Overwrite the last space */
 	*(ptr - 1) = '\0';
 
-	return trx_ctrl_cmd(trx, 1, "SETFH", "%u %u %s", cmdp->hsn, cmdp->maio, ma_buf);
+	return trx_ctrl_cmd(trx, TRXC_F_CRITICAL, "SETFH", "%u %u %s", cmdp->hsn, cmdp->maio, ma_buf);
+}
+
+/*
+ * TRXD PDU format negotiation
+ *
+ * SETFORMAT instructs the transceiver to use the given version of
+ * TRXD PDU format. If the requested version is not supported, the
+ * transceiver indicates a preferred one, and the negotiation shall
+ * be re-initiated using the suggested version.  Legacy transceivers
+ * not supporting this command respond with 'RSP ERR 1'.
+ * CMD SETFORMAT <VER_REQ>
+ * RSP SETFORMAT <VER_RSP> <VER_REQ>
+ */
+
+static int trx_if_cmd_setformat(struct trx_instance *trx, uint8_t ver)
+{
+	return trx_ctrl_cmd(trx, TRXC_F_BARRIER, "SETFORMAT", "%u", ver);
+}
+
+static void trx_if_setformat_rsp_cb(struct trx_instance *trx, const char *resp)
+{
+	int ver_rsp, ver_req;
+
+	if (resp == NULL || sscanf(resp, "%d %d", &ver_rsp, &ver_req) != 2) {
+		LOGPFSML(trx->fi, LOGL_ERROR,
+			 "Failed to parse RSP SETFORMAT, falling back to TRXDv0\n");
+		trx->trxd_pdu_ver_use = 0;
+		return;
+	}
+
+	if (ver_rsp < 0 || ver_rsp > ver_req || ver_req > trx->trxd_pdu_ver_req) {
+		LOGPFSML(trx->fi, LOGL_ERROR,
+			 "Transceiver indicated unexpected TRXD PDU version %d "
+			 "(requested %d), falling back to TRXDv0\n", ver_rsp, ver_req);
+		trx->trxd_pdu_ver_use = 0;
+		return;
+	}
+
+	if (ver_rsp != ver_req) {
+		/* Re-initiate the negotiation using the suggested version */
+		LOGPFSML(trx->fi, LOGL_NOTICE,
+			 "Transceiver suggests TRXD PDU version %d (requested %d)\n",
+			 ver_rsp, ver_req);
+		trx_if_cmd_setformat(trx, ver_rsp);
+		return;
+	}
+
+	LOGPFSML(trx->fi, LOGL_INFO, "Using TRXD PDU version %d\n", ver_rsp);
+	trx->trxd_pdu_ver_use = ver_rsp;
 }
 
 /* Get response from CTRL socket */
@@ -493,6 +763,9 @@ static int trx_ctrl_read_cb(struct osmo_fd *ofd, unsigned int what)
 	}
 	buf[read_len] = '\0';
 
+	if (OSMO_UNLIKELY(trx->capture != NULL))
+		trx_if_capture(trx, TRX_CAPTURE_TRXC_RX, (uint8_t *)buf, read_len);
+
 	if (!!strncmp(buf, "RSP ", 4)) {
 		LOGPFSML(trx->fi, LOGL_NOTICE, "Unknown message on CTRL port: %s\n", buf);
 		return 0;
@@ -504,17 +777,47 @@ static int trx_ctrl_read_cb(struct osmo_fd *ofd, unsigned int what)
 
 	LOGPFSML(trx->fi, LOGL_INFO, "Response message: '%s'\n", buf);
 
-	/* Abort expire timer */
-	osmo_timer_del(&trx->trx_ctrl_timer);
+	/* Get command for response message.  Legacy transceivers reply to
+	 * unknown commands with 'RSP ERR', which is then attributed to the
+	 * oldest one (the transceiver handles commands in order). */
+	if (rsp_len == 3 && !strncmp(buf + 4, "ERR", 3)) {
+		tcm = NULL;
+		if (!llist_empty(&trx->trx_ctrl_list)) {
+			tcm = llist_entry(trx->trx_ctrl_list.next,
+				struct trx_ctrl_msg, list);
+			if (!tcm->sent)
+				tcm = NULL;
+		}
+	} else {
+		tcm = trx_ctrl_find(trx, buf + 4, rsp_len);
+	}
 
-	/* Get command for response message */
-	if (llist_empty(&trx->trx_ctrl_list)) {
+	if (tcm == NULL) {
 		LOGPFSML(trx->fi, LOGL_NOTICE, "Response message without command\n");
 		return -EINVAL;
 	}
 
-	tcm = llist_entry(trx->trx_ctrl_list.next,
-		struct trx_ctrl_msg, list);
+	/* Abort expire timer */
+	osmo_timer_del(&tcm->timer);
+
+	/* Legacy transceivers do not support TRXD PDU version negotiation */
+	if (!strncmp(buf + 4, "ERR", 3) && !strncmp(tcm->cmd + 4, "SETFORMAT", 9)) {
+		LOGPFSML(trx->fi, LOGL_NOTICE, "Transceiver does not support "
+			 "TRXD PDU version negotiation, using TRXDv0\n");
+		trx->trxd_pdu_ver_use = 0;
+		osmo_fsm_inst_state_chg(trx->fi, trx->prev_state, 0, 0);
+		goto rsp_done;
+	}
+
+	/* Neither do they support batched power measurements */
+	if (!strncmp(tcm->cmd + 4, "MEASRANGE", 9)) {
+		osmo_fsm_inst_state_chg(trx->fi, trx->prev_state, 0, 0);
+		if (!strncmp(buf + 4, "MEASRANGE ", 10))
+			trx_if_measrange_rsp_cb(trx, buf + 14);
+		else
+			trx_if_measrange_rsp_cb(trx, NULL);
+		goto rsp_done;
+	}
 
 	/* Check if response matches command */
 	if (!!strncmp(buf + 4, tcm->cmd + 4, rsp_len)) {
@@ -524,6 +827,13 @@ static int trx_ctrl_read_cb(struct osmo_fd *ofd, unsigned int what)
 		goto rsp_error;
 	}
 
+	/* RSP SETFORMAT indicates a version instead of the status code */
+	if (!strncmp(tcm->cmd + 4, "SETFORMAT", 9)) {
+		osmo_fsm_inst_state_chg(trx->fi, trx->prev_state, 0, 0);
+		trx_if_setformat_rsp_cb(trx, p ? p + 1 : NULL);
+		goto rsp_done;
+	}
+
 	/* Check for response code */
 	sscanf(p + 1, "%d", &resp);
 	if (resp) {
@@ -551,11 +861,22 @@ static int trx_ctrl_read_cb(struct osmo_fd *ofd, unsigned int what)
 	else
 		osmo_fsm_inst_state_chg(trx->fi, trx->prev_state, 0, 0);
 
+rsp_done:
 	/* Remove command from list */
 	llist_del(&tcm->list);
 	talloc_free(tcm);
 
-	/* Send next message, if any */
+	/* Other commands may still be waiting for response */
+	if (!llist_empty(&trx->trx_ctrl_list)) {
+		tcm = llist_entry(trx->trx_ctrl_list.next,
+			struct trx_ctrl_msg, list);
+		if (tcm->sent && trx->fi->state != TRX_STATE_RSP_WAIT) {
+			trx->prev_state = trx->fi->state;
+			osmo_fsm_inst_state_chg(trx->fi, TRX_STATE_RSP_WAIT, 0, 0);
+		}
+	}
+
+	/* Send next message(s), if any */
 	trx_ctrl_send(trx);
 
 	return 0;
@@ -573,7 +894,14 @@ int trx_if_handle_phyif_cmd(struct trx_instance *trx, const struct trxcon_phyif_
 	case TRXCON_PHYIF_CMDT_RESET:
 		if ((rc = trx_if_cmd_poweroff(trx)) != 0)
 			return rc;
-		rc = trx_if_cmd_echo(trx);
+		if ((rc = trx_if_cmd_echo(trx)) != 0)
+			return rc;
+		/* Abort power measurement (if any) */
+		trx->meas.active = false;
+		/* (Re)negotiate TRXD PDU version, starting from TRXDv0 */
+		trx->trxd_pdu_ver_use = 0;
+		if (trx->trxd_pdu_ver_req > 0)
+			rc = trx_if_cmd_setformat(trx, trx->trxd_pdu_ver_req);
 		break;
 	case TRXCON_PHYIF_CMDT_POWERON:
 		rc = trx_if_cmd_poweron(trx);
@@ -613,30 +941,506 @@ int trx_if_handle_phyif_cmd(struct trx_instance *trx, const struct trxcon_phyif_
 /* ------------------------------------------------------------------------ */
 /* DATA interface                                                           */
 /*                                                                          */
-/* Messages on the data interface carry one radio burst per UDP message.    */
+/* TRXDv0 and TRXDv1 messages carry one radio burst per UDP message.        */
+/* TRXDv2 messages may carry several radio bursts (batched PDUs) belonging  */
+/* to the same TDMA frame, the frame number is present in the first one.    */
 /*                                                                          */
-/* Received Data Burst:                                                     */
-/* 1 byte timeslot index                                                    */
+/* Received Data Burst (TRXDv0):                                            */
+/* 1 byte version (4 bits), timeslot index (3 bits)                         */
 /* 4 bytes GSM frame number, BE                                             */
 /* 1 byte RSSI in -dBm                                                      */
 /* 2 bytes correlator timing offset in 1/256 symbol steps, 2's-comp, BE     */
 /* 148 bytes soft symbol estimates, 0 -> definite "0", 255 -> definite "1"  */
 /* 2 bytes are not used, but being sent by OsmoTRX                          */
 /*                                                                          */
-/* Transmit Data Burst:                                                     */
-/* 1 byte timeslot index                                                    */
+/* Received Data Burst (TRXDv1), same as TRXDv0 plus (after ToA):           */
+/* 1 byte MTS (NOPE.ind, modulation, TSC set, TSC)                          */
+/* 2 bytes C/I in centiBels, 2's-comp, BE                                   */
+/* 148 or 444 bytes soft symbol estimates (omitted in NOPE.ind)             */
+/*                                                                          */
+/* Received Data Burst (TRXDv2):                                            */
+/* 1 byte version (4 bits), timeslot index (3 bits)                         */
+/* 1 byte BATCH (1 bit), SHADOW (1 bit), TRX number (6 bits)                */
+/* 1 byte MTS, 1 byte RSSI, 2 bytes ToA256, 2 bytes C/I (as above)          */
+/* 4 bytes GSM frame number, BE (only in the first PDU)                     */
+/* 148 or 444 bytes soft symbol estimates (omitted in NOPE.ind)             */
+/* The BATCH flag indicates that another PDU follows.                       */
+/*                                                                          */
+/* Transmit Data Burst (TRXDv0 and TRXDv1):                                 */
+/* 1 byte version (4 bits), timeslot index (3 bits)                         */
 /* 4 bytes GSM frame number, BE                                             */
 /* 1 byte transmit level wrt ARFCN max, -dB (attenuation)                   */
 /* 148 bytes output symbol values, 0 & 1                                    */
+/*                                                                          */
+/* Transmit Data Burst (TRXDv2):                                            */
+/* 1 byte version (4 bits), timeslot index (3 bits)                         */
+/* 1 byte BATCH (1 bit), TRX number (6 bits)                                */
+/* 1 byte MTS, 1 byte transmit level, 1 byte SCPIR, 3 spare bytes           */
+/* 4 bytes GSM frame number, BE (only in the first PDU)                     */
+/* 148 or 444 bytes output symbol values (omitted in NOPE.req)              */
 /* ------------------------------------------------------------------------ */
 
+/* Parse MTS (Modulation and Training Sequence) octet of TRXDv1/v2 PDUs.
+ * Returns the burst length (0 for NOPE.ind) or a negative error code. */
+static int trx_data_parse_mts(struct trx_instance *trx,
+			      struct trxcon_phyif_burst_ind *bi,
+			      uint8_t mts)
+{
+	/* | 7 6 5 4 3 2 1 0 | Bitmask / description
+	 * | X . . . . . . . | IDLE / NOPE frame indication
+	 * | . X X X X . . . | Modulation, TSC set
+	 * | . . . . . X X X | Training Sequence Code */
+	if (mts & (1 << 7))
+		return 0;
+
+	bi->flags |= TRXCON_PHYIF_BI_F_MTS;
+	bi->tsc = mts & 0x07;
+
+	switch ((mts >> 3) & 0x0f) {
+	case 0x00 ... 0x03: /* 0b00XX: GMSK, 4 TSC sets (0..3) */
+		bi->mod = TRXCON_PHYIF_MOD_GMSK;
+		bi->tsc_set = (mts >> 3) & 0x03;
+		return GSM_NBITS_NB_GMSK_BURST;
+	case 0x04 ... 0x05: /* 0b010X: 8-PSK, 2 TSC sets (0..1) */
+		bi->mod = TRXCON_PHYIF_MOD_8PSK;
+		bi->tsc_set = (mts >> 3) & 0x01;
+		return GSM_NBITS_NB_8PSK_BURST;
+	case 0x06: /* 0b0110: GMSK, Access Burst */
+		bi->mod = TRXCON_PHYIF_MOD_GMSK_AB;
+		bi->tsc_set = 0;
+		return GSM_NBITS_NB_GMSK_BURST;
+	default: /* AQPSK, 16QAM, 32QAM or RFU */
+		LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
+			  "Got TRXD PDU with unsupported modulation (MTS=0x%02x)\n", mts);
+		return -ENOTSUP;
+	}
+}
+
+static inline uint64_t trx_if_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Increment the counter of the histogram bucket the given value falls into */
+static void trx_if_ctr_hist(struct trx_instance *trx, unsigned int base,
+			    const unsigned int *bounds, unsigned int num_bounds,
+			    uint64_t val)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_bounds; i++) {
+		if (val < bounds[i])
+			break;
+	}
+
+	rate_ctr_inc2(trx->ctrs, base + i);
+}
+
+/* Adaptive TDMA frame advance.  An Uplink burst has the budget of
+ * fn_advance TDMA frames, counted from the moment the transceiver has
+ * sent the Downlink burst driving its RTS.ind.  The budget is consumed by:
+ *
+ *   - the delivery delay of the Downlink burst, i.e. how much later it
+ *     arrives than the earliest delivery observed recently (the
+ *     transceiver's and the host's jitter),
+ *   - the time it takes for the scheduler to generate the Uplink burst.
+ *
+ * The advance is increased as soon as a burst consumes more than 3/4 of
+ * the budget (such a burst is about to be late), and decreased only after
+ * TRX_FN_ADV_CALM_WINDOWS windows in a row, in which all bursts would
+ * have fitted into 1/2 of the reduced budget. */
+#define TRX_FN_ADV_FN_NS		((int64_t)GSM_TDMA_FN_DURATION_uS * 1000)
+#define TRX_FN_ADV_WINDOW_NS		1000000000ULL
+#define TRX_FN_ADV_CALM_WINDOWS		10
+/* Delivery delay exceeding this many TDMA frames means a jump of the clock */
+#define TRX_FN_ADV_JUMP_FNS		26
+
+static void trx_fn_adv_reset(struct trx_instance *trx, uint32_t fn)
+{
+	trx->fn_adv.ref_fn = fn;
+	trx->fn_adv.ref_ns = trx->rx_time_ns;
+	trx->fn_adv.ref_valid = true;
+	trx->fn_adv.base_ns = INT64_MAX;
+	trx->fn_adv.win_min_ns = INT64_MAX;
+	trx->fn_adv.late_ns = 0;
+	trx->fn_adv.win_start_ns = trx->rx_time_ns;
+	trx->fn_adv.win_max_ns = 0;
+	trx->fn_adv.calm_windows = 0;
+	trx->fn_adv.rts_valid = 0x00;
+}
+
+static void trx_fn_adv_set(struct trx_instance *trx, uint32_t fn_advance)
+{
+	LOGPFSMSL(trx->fi, DTRXD, LOGL_NOTICE,
+		  "Adjusting fn_advance %u -> %u (max budget consumption %" PRIu64 "us)\n",
+		  trx->fn_advance, fn_advance, trx->fn_adv.win_max_ns / 1000);
+
+	if (trx->ctrs != NULL) {
+		rate_ctr_inc2(trx->ctrs, fn_advance > trx->fn_advance ?
+			      TRX_IF_CTR_FN_ADV_INC : TRX_IF_CTR_FN_ADV_DEC);
+	}
+
+	trx->fn_advance = fn_advance;
+	trx->fn_adv.win_max_ns = 0;
+	trx->fn_adv.calm_windows = 0;
+}
+
+static void trx_fn_adv_window_end(struct trx_instance *trx)
+{
+	uint64_t budget_ns;
+
+	/* Would all bursts of this window fit into 1/2 of a smaller budget? */
+	budget_ns = (trx->fn_advance - 1) * TRX_FN_ADV_FN_NS;
+	if (trx->fn_advance > trx->fn_adv.min && trx->fn_adv.win_max_ns < budget_ns / 2)
+		trx->fn_adv.calm_windows++;
+	else
+		trx->fn_adv.calm_windows = 0;
+
+	if (trx->fn_adv.calm_windows >= TRX_FN_ADV_CALM_WINDOWS)
+		trx_fn_adv_set(trx, trx->fn_advance - 1);
+
+	trx->fn_adv.base_ns = trx->fn_adv.win_min_ns;
+	trx->fn_adv.win_min_ns = INT64_MAX;
+	trx->fn_adv.win_start_ns = trx->rx_time_ns;
+	trx->fn_adv.win_max_ns = 0;
+}
+
+/* Estimate the delivery delay of a Downlink burst */
+static void trx_fn_adv_rx(struct trx_instance *trx,
+			  const struct trxcon_phyif_burst_ind *bi)
+{
+	int64_t offset_ns, base_ns;
+	uint32_t elapsed;
+
+	if (!trx->fn_adv.ref_valid)
+		trx_fn_adv_reset(trx, bi->fn);
+
+	/* The transceiver's clock went backwards (e.g. re-synchronization) */
+	elapsed = GSM_TDMA_FN_SUB(bi->fn, trx->fn_adv.ref_fn);
+	if (elapsed >= GSM_TDMA_HYPERFRAME / 2) {
+		trx_fn_adv_reset(trx, bi->fn);
+		elapsed = 0;
+	}
+
+	/* When this burst arrives, relative to when it would have arrived if
+	 * it had been delivered as fast as the burst at the reference point */
+	offset_ns = trx->rx_time_ns - trx->fn_adv.ref_ns;
+	offset_ns -= elapsed * TRX_FN_ADV_FN_NS + bi->tn * TRX_FN_ADV_FN_NS / 8;
+
+	if (offset_ns < trx->fn_adv.win_min_ns)
+		trx->fn_adv.win_min_ns = offset_ns;
+	base_ns = OSMO_MIN(trx->fn_adv.base_ns, trx->fn_adv.win_min_ns);
+
+	/* The transceiver's clock jumped forward (e.g. re-synchronization) */
+	if (offset_ns - base_ns > TRX_FN_ADV_JUMP_FNS * TRX_FN_ADV_FN_NS) {
+		trx_fn_adv_reset(trx, bi->fn);
+		return;
+	}
+
+	trx->fn_adv.late_ns = offset_ns - base_ns;
+
+	if (trx->rx_time_ns - trx->fn_adv.win_start_ns >= TRX_FN_ADV_WINDOW_NS) {
+		/* Keep the reference close, so that 'elapsed' never wraps */
+		trx->fn_adv.ref_fn = bi->fn;
+		trx->fn_adv.ref_ns += elapsed * TRX_FN_ADV_FN_NS;
+		trx_fn_adv_window_end(trx);
+	}
+}
+
+/* Account an Uplink burst being sent in response to an RTS.ind */
+static void trx_fn_adv_tx(struct trx_instance *trx, uint64_t now_ns)
+{
+	uint64_t budget_ns = trx->fn_advance * TRX_FN_ADV_FN_NS;
+	uint64_t used_ns = trx->fn_adv.late_ns + (now_ns - trx->rx_time_ns);
+
+	if (used_ns > trx->fn_adv.win_max_ns)
+		trx->fn_adv.win_max_ns = used_ns;
+
+	/* Give the previous increase a chance to take effect */
+	if (now_ns - trx->fn_adv.inc_ns < budget_ns)
+		return;
+
+	if (used_ns * 4 > budget_ns * 3 && trx->fn_advance < trx->fn_adv.max) {
+		trx->fn_adv.inc_ns = now_ns;
+		trx_fn_adv_set(trx, trx->fn_advance + 1);
+	}
+}
+
+/* When fn_advance gets decreased, RTS.ind would be sent twice for the
+ * same TDMA frame, so suppress it.  When increased, a TDMA frame is
+ * skipped (no Uplink burst is sent, like if the Downlink burst driving
+ * its RTS.ind was lost). */
+static bool trx_fn_adv_rts_check(struct trx_instance *trx,
+				 const struct trxcon_phyif_rts_ind *rts)
+{
+	uint8_t tn = rts->tn & 0x07;
+
+	if (trx->fn_adv.rts_valid & (1 << tn)) {
+		if (GSM_TDMA_FN_SUB(trx->fn_adv.rts_fn[tn], rts->fn) < trx->fn_adv.max)
+			return false;
+	}
+
+	trx->fn_adv.rts_fn[tn] = rts->fn;
+	trx->fn_adv.rts_valid |= (1 << tn);
+	return true;
+}
+
+static int trx_data_handle_burst_ind(struct trx_instance *trx,
+				     const struct trxcon_phyif_burst_ind *bi)
+{
+	if (bi->fn >= GSM_TDMA_HYPERFRAME) {
+		LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR, "Illegal FN %u\n", bi->fn);
+		return -EINVAL;
+	}
+
+	LOGPFSMSL(trx->fi, DTRXD, LOGL_DEBUG,
+		  "RX burst tn=%u fn=%u rssi=%d toa=%d%s\n",
+		  bi->tn, bi->fn, bi->rssi, bi->toa256,
+		  bi->burst_len == 0 ? " (NOPE.ind)" : "");
+
+	if (trx->fn_adv.enabled)
+		trx_fn_adv_rx(trx, bi);
+
+	/* NOPE.ind carries no burst, but still drives the clock */
+	if (bi->burst_len > 0) {
+		trxcon_phyif_handle_burst_ind(trx->priv, bi);
+		if (trx->ctrs != NULL) {
+			trx_if_ctr_hist(trx, TRX_IF_CTR_RX_LAT_LT_50US,
+					trx_if_rx_lat_bounds, ARRAY_SIZE(trx_if_rx_lat_bounds),
+					(trx_if_now_ns() - trx->rx_time_ns) / 1000);
+		}
+	} else if (trx->ctrs != NULL) {
+		rate_ctr_inc2(trx->ctrs, TRX_IF_CTR_RX_NOPE_IND);
+	}
+
+	struct trxcon_phyif_rts_ind rts = {
+		.fn = GSM_TDMA_FN_SUM(bi->fn, trx->fn_advance),
+		.tn = bi->tn,
+	};
+
+	if (trx->fn_adv.enabled && !trx_fn_adv_rts_check(trx, &rts))
+		return 0;
+
+	trx->rts_pending = true;
+	trxcon_phyif_handle_rts_ind(trx->priv, &rts);
+	trx->rts_pending = false;
+
+	return 0;
+}
+
+/* Handle a TRXDv0 or TRXDv1 PDU (one burst per message) */
+static int trx_data_handle_pdu_v0v1(struct trx_instance *trx,
+				    uint8_t *buf, size_t buf_len)
+{
+	struct trxcon_phyif_burst_ind bi;
+	uint8_t ver = buf[0] >> 4;
+	size_t hdr_len;
+	int burst_len;
+
+	hdr_len = (ver == 0) ? TRXDv0_HDR_LEN : TRXDv1_HDR_LEN;
+	if (buf_len < hdr_len) {
+		LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
+			  "Got malformed TRXDv%u PDU (short length=%zu)\n", ver, buf_len);
+		return -EINVAL;
+	}
+
+	bi = (struct trxcon_phyif_burst_ind) {
+		.tn = buf[0] & 0x07,
+		.fn = osmo_load32be(buf + 1),
+		.rssi = -(int8_t) buf[5],
+		.toa256 = (int16_t) (buf[6] << 8) | buf[7],
+	};
+
+	buf_len -= hdr_len;
+
+	if (ver == 0) {
+		switch (buf_len) {
+		/* TRXDv0 PDUs may have 2 dummy bytes at the end */
+		case GSM_NBITS_NB_GMSK_BURST + 2:
+		case GSM_NBITS_NB_8PSK_BURST + 2:
+			buf_len -= 2;
+			break;
+		case GSM_NBITS_NB_GMSK_BURST:
+		case GSM_NBITS_NB_8PSK_BURST:
+			break;
+		default:
+			LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
+				  "Got TRXD PDU unexpected burst length=%zu\n", buf_len);
+			return -EINVAL;
+		}
+		burst_len = buf_len;
+	} else {
+		bi.ci_cb = (int16_t) (buf[9] << 8) | buf[10];
+		bi.flags |= TRXCON_PHYIF_BI_F_CI_CB;
+
+		burst_len = trx_data_parse_mts(trx, &bi, buf[8]);
+		if (burst_len < 0)
+			return burst_len;
+		if (buf_len < burst_len) {
+			LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
+				  "Got TRXDv1 PDU with short burst (length=%zu, "
+				  "expected %d)\n", buf_len, burst_len);
+			return -EINVAL;
+		}
+	}
+
+	bi.burst = (sbit_t *)&buf[hdr_len];
+	bi.burst_len = burst_len;
+	/* Convert ubits {254..0} to sbits {-127..127} in-place */
+	trx_if_conv_soft_bits((sbit_t *)&buf[hdr_len], &buf[hdr_len], burst_len);
+
+	return trx_data_handle_burst_ind(trx, &bi);
+}
+
+/* Handle a TRXDv2 message (one or more batched PDUs) */
+static int trx_data_handle_pdu_v2(struct trx_instance *trx,
+				  uint8_t *buf, size_t buf_len)
+{
+	struct trxcon_phyif_burst_ind bi;
+	bool batch = true;
+	uint32_t fn = 0;
+	unsigned int i;
+	size_t hdr_len;
+	int burst_len, rc;
+
+	for (i = 0; batch; i++) {
+		/* The first PDU additionally contains the TDMA frame number */
+		hdr_len = TRXDv2_RX_HDR_LEN + (i == 0 ? 4 : 0);
+		if (buf_len < hdr_len) {
+			LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
+				  "Got malformed TRXDv2 PDU #%u (short length=%zu)\n",
+				  i, buf_len);
+			return -EINVAL;
+		}
+
+		if (i == 0)
+			fn = osmo_load32be(buf + TRXDv2_RX_HDR_LEN);
+
+		bi = (struct trxcon_phyif_burst_ind) {
+			.tn = buf[0] & 0x07,
+			.fn = fn,
+			.rssi = -(int8_t) buf[3],
+			.toa256 = (int16_t) (buf[4] << 8) | buf[5],
+			.ci_cb = (int16_t) (buf[6] << 8) | buf[7],
+			.flags = TRXCON_PHYIF_BI_F_CI_CB,
+		};
+
+		batch = !!(buf[1] & (1 << 7));
+
+		burst_len = trx_data_parse_mts(trx, &bi, buf[2]);
+		if (burst_len < 0)
+			return burst_len;
+
+		buf_len -= hdr_len;
+		buf += hdr_len;
+
+		if (buf_len < burst_len) {
+			LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
+				  "Got TRXDv2 PDU #%u with short burst (length=%zu, "
+				  "expected %d)\n", i, buf_len, burst_len);
+			return -EINVAL;
+		}
+
+		bi.burst = (sbit_t *)buf;
+		bi.burst_len = burst_len;
+		trx_if_conv_soft_bits((sbit_t *)buf, buf, burst_len);
+
+		buf_len -= burst_len;
+		buf += burst_len;
+
+		rc = trx_data_handle_burst_ind(trx, &bi);
+		if (rc != 0)
+			return rc;
+	}
+
+	return 0;
+}
+
+/* Send all queued TRXD messages using sendmmsg() */
+static void trx_data_tx_mmsg_flush(struct trx_instance *trx)
+{
+	struct trx_data_mmsg *mm = trx->mmsg;
+	unsigned int sent = 0;
+	int rc;
+
+	while (sent < mm->tx.num) {
+		rc = sendmmsg(trx->trx_ofd_data.fd, &mm->tx.hdr[sent], mm->tx.num - sent, 0);
+		if (rc <= 0) {
+			LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
+				  "sendmmsg() failed on TRXD with rc=%d (%s), "
+				  "dropping %u message(s)\n", rc, strerror(errno),
+				  mm->tx.num - sent);
+			break;
+		}
+		sent += rc;
+	}
+
+	mm->tx.num = 0;
+}
+
+/* Send a TRXD message, or queue it if batched I/O is in progress */
+static void trx_data_send(struct trx_instance *trx, const uint8_t *buf, size_t len)
+{
+	struct trx_data_mmsg *mm = trx->mmsg;
+
+	if (OSMO_UNLIKELY(trx->capture != NULL))
+		trx_if_capture(trx, TRX_CAPTURE_TRXD_TX, buf, len);
+
+	if (mm == NULL || !trx->tx_batch.active) {
+		send(trx->trx_ofd_data.fd, buf, len, 0);
+		return;
+	}
+
+	if (mm->tx.num == TRXD_MMSG_VLEN)
+		trx_data_tx_mmsg_flush(trx);
+
+	memcpy(&mm->tx.buf[mm->tx.num][0], buf, len);
+	mm->tx.iov[mm->tx.num].iov_len = len;
+	mm->tx.num++;
+}
+
+/* Send all pending TRXDv2 PDUs (if any) */
+static void trx_data_tx_batch_flush(struct trx_instance *trx)
+{
+	if (trx->tx_batch.len == 0)
+		return;
+
+	trx_data_send(trx, trx->tx_batch.buf, trx->tx_batch.len);
+	trx->tx_batch.len = 0;
+}
+
+/* Handle a TRXD message containing one or more PDUs */
+static int trx_data_handle_msg(struct trx_instance *trx,
+			       uint8_t *buf, size_t buf_len)
+{
+	if (buf_len < TRXDv0_HDR_LEN) {
+		LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
+			  "Got malformed TRXD PDU (short length=%zu)\n", buf_len);
+		return -EINVAL;
+	}
+
+	switch (buf[0] >> 4) {
+	case 0:
+	case 1:
+		return trx_data_handle_pdu_v0v1(trx, buf, buf_len);
+	case 2:
+		return trx_data_handle_pdu_v2(trx, buf, buf_len);
+	default:
+		LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
+			  "Got TRXD PDU with unexpected version %u\n", buf[0] >> 4);
+		return -ENOTSUP;
+	}
+}
+
 static int trx_data_rx_cb(struct osmo_fd *ofd, unsigned int what)
 {
 	struct trx_instance *trx = ofd->data;
-	struct trxcon_phyif_burst_ind bi;
 	uint8_t buf[TRXD_BUF_SIZE];
 	ssize_t read_len;
-	sbit_t *burst;
+	int rc;
 
 	read_len = read(ofd->fd, buf, sizeof(buf));
 	if (read_len <= 0) {
@@ -647,70 +1451,210 @@ static int trx_data_rx_cb(struct osmo_fd *ofd, unsigned int what)
 		return read_len;
 	}
 
-	if (read_len < TRXDv0_HDR_LEN) {
-		LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
-			  "Got malformed TRXD PDU (short length=%zd)\n", read_len);
-		return -EINVAL;
+	if (trx->ctrs != NULL || trx->fn_adv.enabled)
+		trx->rx_time_ns = trx_if_now_ns();
+
+	/* Soft-bits are converted in-place, so capture them right away */
+	if (OSMO_UNLIKELY(trx->capture != NULL))
+		trx_if_capture(trx, TRX_CAPTURE_TRXD_RX, buf, read_len);
+
+	/* Uplink bursts for the same TDMA frame are sent in one batch */
+	trx->tx_batch.active = true;
+	rc = trx_data_handle_msg(trx, buf, read_len);
+	trx_data_tx_batch_flush(trx);
+	trx->tx_batch.active = false;
+
+	return rc;
+}
+
+/* Get TDMA frame number of a TRXD message (for sorting only) */
+static uint32_t trx_data_msg_fn(const uint8_t *buf, size_t buf_len)
+{
+	if ((buf[0] >> 4) >= 2) {
+		if (buf_len < TRXDv2_RX_HDR_LEN + 4)
+			return 0;
+		return osmo_load32be(buf + TRXDv2_RX_HDR_LEN);
 	}
 
-	if ((buf[0] >> 4) != 0) {
-		LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
-			  "Got TRXD PDU with unexpected version\n");
-		return -ENOTSUP;
+	if (buf_len < TRXDv0_HDR_LEN)
+		return 0;
+	return osmo_load32be(buf + 1);
+}
+
+/* Sort received messages by TDMA frame number, keeping the order of
+ * messages with equal frame numbers.  The number of messages is small,
+ * so the insertion sort is good enough here. */
+static void trx_data_rx_mmsg_sort(struct trx_data_mmsg *mm, unsigned int num)
+{
+	uint32_t fn[TRXD_MMSG_VLEN];
+	unsigned int i, j, idx;
+	int delta;
+
+	for (i = 0; i < num; i++) {
+		fn[i] = trx_data_msg_fn(mm->rx.buf[i], mm->rx.hdr[i].msg_len);
+		mm->rx.order[i] = i;
+	}
+
+	for (i = 1; i < num; i++) {
+		idx = mm->rx.order[i];
+		for (j = i; j > 0; j--) {
+			/* See GSM::FNDelta() in osmo-trx */
+			delta = fn[mm->rx.order[j - 1]] - fn[idx];
+			if (delta >= GSM_TDMA_HYPERFRAME / 2)
+				delta -= GSM_TDMA_HYPERFRAME;
+			else if (delta < -GSM_TDMA_HYPERFRAME / 2)
+				delta += GSM_TDMA_HYPERFRAME;
+			if (delta <= 0)
+				break;
+			mm->rx.order[j] = mm->rx.order[j - 1];
+		}
+		mm->rx.order[j] = idx;
+	}
+}
+
+/* Drain all pending TRXD messages using recvmmsg(), handle them in TDMA
+ * frame number order, and send all Uplink bursts using sendmmsg(). */
+static int trx_data_rx_mmsg_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct trx_instance *trx = ofd->data;
+	struct trx_data_mmsg *mm = trx->mmsg;
+	unsigned int i, idx;
+	int rc;
+
+	do {
+		rc = recvmmsg(ofd->fd, &mm->rx.hdr[0], TRXD_MMSG_VLEN, MSG_DONTWAIT, NULL);
+		if (rc < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+			LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
+				  "recvmmsg() failed on TRXD with rc=%d (%s)\n",
+				  rc, strerror(errno));
+			return rc;
+		}
+
+		/* All messages of a batch are considered received at once */
+		if (trx->ctrs != NULL || trx->fn_adv.enabled)
+			trx->rx_time_ns = trx_if_now_ns();
+
+		trx_data_rx_mmsg_sort(mm, rc);
+
+		/* Soft-bits are converted in-place, so capture them right away */
+		if (OSMO_UNLIKELY(trx->capture != NULL)) {
+			for (i = 0; i < rc && trx->capture != NULL; i++) {
+				idx = mm->rx.order[i];
+				trx_if_capture(trx, TRX_CAPTURE_TRXD_RX,
+					       mm->rx.buf[idx], mm->rx.hdr[idx].msg_len);
+			}
+		}
+
+		trx->tx_batch.active = true;
+		for (i = 0; i < rc; i++) {
+			idx = mm->rx.order[i];
+			trx_data_handle_msg(trx, mm->rx.buf[idx], mm->rx.hdr[idx].msg_len);
+		}
+		trx_data_tx_batch_flush(trx);
+		trx->tx_batch.active = false;
+
+		trx_data_tx_mmsg_flush(trx);
+	} while (rc == TRXD_MMSG_VLEN);
+
+	return 0;
+}
+
+static struct trx_data_mmsg *trx_data_mmsg_alloc(struct trx_instance *trx)
+{
+	struct trx_data_mmsg *mm;
+	unsigned int i;
+
+	mm = talloc_zero(trx, struct trx_data_mmsg);
+	if (mm == NULL)
+		return NULL;
+
+	for (i = 0; i < TRXD_MMSG_VLEN; i++) {
+		mm->rx.iov[i] = (struct iovec) {
+			.iov_base = &mm->rx.buf[i][0],
+			.iov_len = sizeof(mm->rx.buf[i]),
+		};
+		mm->rx.hdr[i].msg_hdr.msg_iov = &mm->rx.iov[i];
+		mm->rx.hdr[i].msg_hdr.msg_iovlen = 1;
+
+		mm->tx.iov[i] = (struct iovec) {
+			.iov_base = &mm->tx.buf[i][0],
+			.iov_len = 0, /* set by trx_data_send() */
+		};
+		mm->tx.hdr[i].msg_hdr.msg_iov = &mm->tx.iov[i];
+		mm->tx.hdr[i].msg_hdr.msg_iovlen = 1;
 	}
 
-	read_len -= TRXDv0_HDR_LEN;
-	switch (read_len) {
-	/* TRXDv0 PDUs may have 2 dummy bytes at the end */
-	case GSM_NBITS_NB_GMSK_BURST + 2:
-	case GSM_NBITS_NB_8PSK_BURST + 2:
-		read_len -= 2;
+	return mm;
+}
+
+/* Append a TRXDv2 PDU to the batch, send it unless batching is active */
+static int trx_data_tx_pdu_v2(struct trx_instance *trx,
+			      const struct trxcon_phyif_burst_req *br)
+{
+	size_t length = TRXDv2_TX_HDR_LEN;
+	uint8_t *buf;
+	uint8_t mts;
+
+	switch (br->burst_len) {
+	case 0: /* NOPE.req */
+		mts = (1 << 7);
 		break;
 	case GSM_NBITS_NB_GMSK_BURST:
+		mts = (0x00 << 3);
+		break;
 	case GSM_NBITS_NB_8PSK_BURST:
+		mts = (0x04 << 3);
 		break;
 	default:
 		LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR,
-			  "Got TRXD PDU unexpected burst length=%zd\n", read_len);
+			  "Unexpected Tx burst length=%u\n", br->burst_len);
 		return -EINVAL;
 	}
 
-	burst = (sbit_t *)&buf[8];
+	/* A batch may only contain PDUs belonging to the same TDMA frame */
+	if (trx->tx_batch.len > 0) {
+		if (trx->tx_batch.fn != br->fn)
+			trx_data_tx_batch_flush(trx);
+		else if (trx->tx_batch.len + length + br->burst_len > sizeof(trx->tx_batch.buf))
+			trx_data_tx_batch_flush(trx);
+	}
 
-	bi = (struct trxcon_phyif_burst_ind) {
-		.tn = buf[0] & 0x07,
-		.fn = osmo_load32be(buf + 1),
-		.rssi = -(int8_t) buf[5],
-		.toa256 = (int16_t) (buf[6] << 8) | buf[7],
-		.burst = burst, /* at least GSM_NBITS_NB_GMSK_BURST */
-		.burst_len = read_len,
-	};
+	buf = &trx->tx_batch.buf[trx->tx_batch.len];
 
-	/* Convert ubits {254..0} to sbits {-127..127} in-place */
-	for (unsigned int i = 0; i < bi.burst_len; i++) {
-		if (buf[8 + i] == 255)
-			burst[i] = -127;
-		else
-			burst[i] = 127 - buf[8 + i];
+	if (trx->tx_batch.len > 0) {
+		/* Indicate that another PDU follows the last one */
+		trx->tx_batch.buf[trx->tx_batch.last_pdu + 1] |= (1 << 7);
+		buf[0] = br->tn; /* VER is only present in the first PDU */
+	} else {
+		buf[0] = (2 << 4) | br->tn;
 	}
 
-	if (bi.fn >= GSM_TDMA_HYPERFRAME) {
-		LOGPFSMSL(trx->fi, DTRXD, LOGL_ERROR, "Illegal FN %u\n", bi.fn);
-		return -EINVAL;
-	}
+	buf[1] = 0x00; /* BATCH=0, TRXN=0 */
+	buf[2] = mts;
+	buf[3] = br->pwr;
+	buf[4] = 0x00; /* SCPIR (only for AQPSK) */
+	memset(&buf[5], 0x00, 3); /* spare */
 
-	LOGPFSMSL(trx->fi, DTRXD, LOGL_DEBUG,
-		  "RX burst tn=%u fn=%u rssi=%d toa=%d\n",
-		  bi.tn, bi.fn, bi.rssi, bi.toa256);
+	/* The first PDU additionally contains the TDMA frame number */
+	if (trx->tx_batch.len == 0) {
+		osmo_store32be(br->fn, buf + length);
+		length += 4;
+	}
 
-	trxcon_phyif_handle_burst_ind(trx->priv, &bi);
+	/* Copy ubits {0,1} */
+	if (br->burst_len != 0) {
+		memcpy(buf + length, br->burst, br->burst_len);
+		length += br->burst_len;
+	}
 
-	struct trxcon_phyif_rts_ind rts = {
-		.fn = GSM_TDMA_FN_SUM(bi.fn, trx->fn_advance),
-		.tn = bi.tn,
-	};
+	trx->tx_batch.last_pdu = trx->tx_batch.len;
+	trx->tx_batch.len += length;
+	trx->tx_batch.fn = br->fn;
 
-	trxcon_phyif_handle_rts_ind(trx->priv, &rts);
+	if (!trx->tx_batch.active)
+		trx_data_tx_batch_flush(trx);
 
 	return 0;
 }
@@ -740,7 +1684,25 @@ int trx_if_handle_phyif_burst_req(struct trx_instance *trx,
 		  "TX burst tn=%u fn=%u pwr=%u\n",
 		  br->tn, br->fn, br->pwr);
 
-	buf[0] = br->tn;
+	if (trx->rts_pending && (trx->ctrs != NULL || trx->fn_adv.enabled)) {
+		uint64_t budget_ns = (uint64_t)trx->fn_advance * GSM_TDMA_FN_DURATION_uS * 1000;
+		uint64_t now_ns = trx_if_now_ns();
+		uint64_t lat_ns = now_ns - trx->rx_time_ns;
+
+		if (trx->ctrs != NULL) {
+			trx_if_ctr_hist(trx, TRX_IF_CTR_TX_LAT_LT_10PCT,
+					trx_if_tx_lat_bounds, ARRAY_SIZE(trx_if_tx_lat_bounds),
+					budget_ns ? lat_ns * 100 / budget_ns : 100);
+		}
+		if (trx->fn_adv.enabled)
+			trx_fn_adv_tx(trx, now_ns);
+	}
+
+	if (trx->trxd_pdu_ver_use >= 2)
+		return trx_data_tx_pdu_v2(trx, br);
+
+	/* TRXDv0 and TRXDv1 have the same Tx PDU format */
+	buf[0] = (trx->trxd_pdu_ver_use << 4) | br->tn;
 	osmo_store32be(br->fn, buf + 1);
 	buf[5] = br->pwr;
 	length = 6;
@@ -752,7 +1714,7 @@ int trx_if_handle_phyif_burst_req(struct trx_instance *trx,
 	}
 
 	/* Send data to transceiver */
-	send(trx->trx_ofd_data.fd, buf, length, 0);
+	trx_data_send(trx, buf, length);
 
 	return 0;
 }
@@ -789,6 +1751,14 @@ struct trx_instance *trx_if_open(const struct trx_if_params *params)
 
 	/* Initialize CTRL queue */
 	INIT_LLIST_HEAD(&trx->trx_ctrl_list);
+	trx->trx_ctrl_window = params->trxc_window ? : 1;
+
+	/* Optional batched TRXD I/O */
+	if (params->trxd_mmsg) {
+		trx->mmsg = trx_data_mmsg_alloc(trx);
+		if (trx->mmsg == NULL)
+			goto udp_error;
+	}
 
 	/* Open sockets */
 	rc = trx_udp_open(trx, &trx->trx_ofd_ctrl, /* TRXC */
@@ -801,20 +1771,61 @@ struct trx_instance *trx_if_open(const struct trx_if_params *params)
 	rc = trx_udp_open(trx, &trx->trx_ofd_data, /* TRXD */
 			  params->local_host, params->base_port + 102 + offset,
 			  params->remote_host, params->base_port + 2 + offset,
-			  trx_data_rx_cb);
+			  trx->mmsg ? trx_data_rx_mmsg_cb : trx_data_rx_cb);
 	if (rc < 0)
 		goto udp_error;
 
+	/* Optional capturing of TRXC/TRXD messages (see trx_replay) */
+	if (params->capture_path != NULL) {
+		char *path = talloc_strdup(trx, params->capture_path);
+
+		/* Each transceiver instance gets its own file */
+		if (params->instance > 0)
+			path = talloc_asprintf_append(path, ".%u", params->instance);
+		trx->capture = trx_capture_open(trx, path, true);
+		if (trx->capture == NULL) {
+			LOGPFSML(params->parent_fi, LOGL_ERROR,
+				 "Failed to open capture file '%s': %s\n",
+				 path, strerror(errno));
+			talloc_free(path);
+			goto capture_error;
+		}
+		LOGPFSML(params->parent_fi, LOGL_NOTICE,
+			 "Capturing TRXC/TRXD messages to '%s'\n", path);
+		talloc_free(path);
+	}
+
 	trx->fn_advance = params->fn_advance;
+	if (params->fn_advance_max > params->fn_advance_min) {
+		trx->fn_adv.enabled = true;
+		trx->fn_adv.min = OSMO_MAX(params->fn_advance_min, 1);
+		trx->fn_adv.max = params->fn_advance_max;
+		trx->fn_advance = OSMO_MIN(OSMO_MAX(trx->fn_advance, trx->fn_adv.min),
+					   trx->fn_adv.max);
+	}
+	trx->trxd_pdu_ver_req = params->trxd_pdu_ver;
 	trx->priv = params->priv;
 	fi->priv = trx;
 	trx->fi = fi;
 
+	/* Rate counters are optional, latency is not measured without them */
+	trxcon_stats_lock();
+	trx->ctrs = rate_ctr_group_alloc(trx, &trx_if_ctrg_desc, params->instance);
+	trxcon_stats_unlock();
+	if (trx->ctrs == NULL)
+		LOGPFSML(fi, LOGL_NOTICE, "Failed to allocate rate counters\n");
+
 	return trx;
 
+capture_error:
+	trx_udp_close(&trx->trx_ofd_ctrl);
+	trx_udp_close(&trx->trx_ofd_data);
+	osmo_fsm_inst_free(fi);
+	return NULL;
+
 udp_error:
 	LOGPFSML(params->parent_fi, LOGL_ERROR, "Couldn't establish UDP connection\n");
-	osmo_fsm_inst_free(trx->fi);
+	osmo_fsm_inst_free(fi);
 	return NULL;
 }
 
@@ -826,10 +1837,11 @@ static void trx_if_flush_ctrl(struct trx_instance *trx)
 	/* Reset state machine */
 	osmo_fsm_inst_state_chg(trx->fi, TRX_STATE_IDLE, 0, 0);
 
-	/* Clear command queue */
+	/* Clear command queue, aborting response timers */
 	while (!llist_empty(&trx->trx_ctrl_list)) {
 		tcm = llist_entry(trx->trx_ctrl_list.next,
 			struct trx_ctrl_msg, list);
+		osmo_timer_del(&tcm->timer);
 		llist_del(&tcm->list);
 		talloc_free(tcm);
 	}
@@ -854,10 +1866,7 @@ static void trx_fsm_cleanup_cb(struct osmo_fsm_inst *fi,
 
 	LOGPFSML(fi, LOGL_NOTICE, "Shutdown transceiver interface\n");
 
-	/* Abort TRXC response timer (if pending) */
-	osmo_timer_del(&trx->trx_ctrl_timer);
-
-	/* Flush CTRL message list */
+	/* Flush CTRL message list (aborting response timers) */
 	trx_if_flush_ctrl(trx);
 
 	/* Power off if the transceiver is up */
@@ -868,11 +1877,24 @@ static void trx_fsm_cleanup_cb(struct osmo_fsm_inst *fi,
 	trx_udp_close(&trx->trx_ofd_ctrl);
 	trx_udp_close(&trx->trx_ofd_data);
 
+	/* Flush and close the capture file (if any) */
+	trx_capture_close(trx->capture);
+
+	trxcon_stats_lock();
+	rate_ctr_group_free(trx->ctrs);
+	trxcon_stats_unlock();
+
 	/* Free memory */
 	trx->fi->priv = NULL;
 	talloc_free(trx);
 }
 
+/*! Initialize the thread-local copy of trx_fsm in a worker thread */
+void trx_if_thread_init(void)
+{
+	INIT_LLIST_HEAD(&trx_fsm.instances);
+}
+
 static __attribute__((constructor)) void on_dso_load(void)
 {
 	OSMO_ASSERT(osmo_fsm_register(&trx_fsm) == 0);
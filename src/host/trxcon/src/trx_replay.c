@@ -0,0 +1,448 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * Faster-than-real-time replay of captured TRXC/TRXD messages
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/* Feeds a capture file written by 'trxcon --capture' through the scheduler
+ * (l1sched_handle_rx_burst() and l1sched_pull_burst()) as fast as possible,
+ * without any sockets or clock.  Timeslots are (re)configured according to
+ * the captured 'CMD SETSLOT' commands.  Dedicated channels are normally
+ * activated by L1CTL, which is not captured, so '-a' can be used to activate
+ * all logical channels of the configured timeslots.
+ *
+ * Usage: trx_replay [-a] [-v] [-f FN_ADVANCE] [-j DECODERS] FILE */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/application.h>
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/bits.h>
+#include <osmocom/core/msgb.h>
+#include <osmocom/gsm/gsm0502.h>
+#include <osmocom/gsm/gsm_utils.h>
+
+#include <osmocom/bb/l1sched/l1sched.h>
+#include <osmocom/bb/l1sched/prim.h>
+#include <osmocom/bb/trxcon/trx_if.h>
+#include <osmocom/bb/trxcon/trx_capture.h>
+
+#define TRXDv0_HDR_LEN		8
+#define TRXDv1_HDR_LEN		11
+#define TRXDv2_RX_HDR_LEN	8	/* + 4 bytes FN in the first PDU */
+
+struct replay_lchan_stats {
+	unsigned long blocks;
+	unsigned long blocks_bad;
+	uint64_t n_errors;
+	uint64_t n_bits_total;
+};
+
+static struct {
+	struct l1sched_state *sched;
+	uint32_t fn_advance;
+	bool activate_all;
+
+	unsigned long num_trxc;
+	unsigned long num_trxd_tx;
+	unsigned long num_rx_bursts;
+	unsigned long num_rx_nope;
+	unsigned long num_rx_bad;
+	unsigned long num_tx_bursts;
+	unsigned long num_sch;
+	struct replay_lchan_stats lchan[_L1SCHED_CHAN_MAX];
+} g_replay = {
+	.fn_advance = 2,
+};
+
+/* External L1 API for the scheduler: Uplink bursts are only counted */
+int l1sched_handle_burst_req(struct l1sched_state *sched,
+			     const struct l1sched_burst_req *br)
+{
+	if (br->burst_len > 0)
+		g_replay.num_tx_bursts++;
+	return 0;
+}
+
+/* External L2 API for the scheduler */
+int l1sched_prim_to_user(struct l1sched_state *sched, struct msgb *msg)
+{
+	const struct l1sched_prim *prim = l1sched_prim_from_msgb(msg);
+	const struct l1sched_prim_data_ind *ind = &prim->data_ind;
+	struct l1sched_lchan_state *lchan;
+	struct replay_lchan_stats *st;
+
+	switch (OSMO_PRIM_HDR(&prim->oph)) {
+	case OSMO_PRIM(L1SCHED_PRIM_T_DATA, PRIM_OP_INDICATION):
+		lchan = l1sched_find_lchan_by_chan_nr(sched, ind->chdr.chan_nr,
+						      ind->chdr.link_id);
+		if (lchan == NULL)
+			break;
+		st = &g_replay.lchan[lchan->type];
+		st->blocks++;
+		if (msgb_l2len(msg) == 0)
+			st->blocks_bad++;
+		if (ind->n_bits_total > 0) {
+			st->n_errors += ind->n_errors;
+			st->n_bits_total += ind->n_bits_total;
+		}
+		break;
+	case OSMO_PRIM(L1SCHED_PRIM_T_SCH, PRIM_OP_INDICATION):
+		g_replay.num_sch++;
+		break;
+	default:
+		break;
+	}
+
+	msgb_free(msg);
+	return 0;
+}
+
+/* TRX slot types, see 'enum ChannelCombination' in osmo-trx.git */
+static enum gsm_phys_chan_config replay_slot_type2pchan(unsigned int type)
+{
+	switch (type) {
+	case 1: return GSM_PCHAN_TCH_F;
+	case 3: return GSM_PCHAN_TCH_H;
+	case 4: return GSM_PCHAN_CCCH;
+	case 5: return GSM_PCHAN_CCCH_SDCCH4;
+	case 7: return GSM_PCHAN_SDCCH8_SACCH8C;
+	case 13: return GSM_PCHAN_PDCH;
+	default: return GSM_PCHAN_NONE;
+	}
+}
+
+static void replay_configure_ts(unsigned int tn, enum gsm_phys_chan_config pchan)
+{
+	struct l1sched_state *sched = g_replay.sched;
+	struct l1sched_lchan_state *lchan;
+	struct l1sched_ts *ts = sched->ts[tn];
+
+	if (pchan == GSM_PCHAN_NONE) {
+		l1sched_del_ts(sched, tn);
+		return;
+	}
+
+	/* trxcon (re)configures the scheduler first, then the transceiver */
+	if (ts != NULL && ts->mf_layout != NULL && ts->mf_layout->chan_config == pchan)
+		return;
+	if (l1sched_configure_ts(sched, tn, pchan) != 0) {
+		fprintf(stderr, "Failed to configure TS%u\n", tn);
+		return;
+	}
+
+	if (!g_replay.activate_all)
+		return;
+
+	ts = sched->ts[tn];
+	llist_for_each_entry(lchan, &ts->lchans, list) {
+		if (lchan->active || l1sched_lchan_desc[lchan->type].rx_fn == NULL)
+			continue;
+		l1sched_activate_lchan(ts, lchan->type);
+	}
+}
+
+static void replay_trxc_cmd(const struct trx_capture_rec *rec)
+{
+	char buf[TRXC_BUF_SIZE];
+	unsigned int tn, type;
+
+	g_replay.num_trxc++;
+
+	if (rec->len == 0 || rec->len >= sizeof(buf))
+		return;
+	memcpy(buf, rec->buf, rec->len);
+	buf[rec->len] = '\0';
+
+	if (sscanf(buf, "CMD SETSLOT %u %u", &tn, &type) == 2 && tn < 8)
+		replay_configure_ts(tn, replay_slot_type2pchan(type));
+}
+
+static void replay_burst(struct l1sched_burst_ind *bi)
+{
+	struct l1sched_burst_req br = {
+		.fn = GSM_TDMA_FN_SUM(bi->fn, g_replay.fn_advance),
+		.tn = bi->tn,
+	};
+
+	/* NOPE.ind carries no burst, but still drives the clock */
+	if (bi->burst_len > 0) {
+		g_replay.num_rx_bursts++;
+		l1sched_handle_rx_burst(g_replay.sched, bi);
+	} else {
+		g_replay.num_rx_nope++;
+	}
+
+	l1sched_pull_burst(g_replay.sched, &br);
+	l1sched_handle_burst_req(g_replay.sched, &br);
+}
+
+/* Burst length for the given MTS octet, 0 for NOPE.ind, -1 if unsupported */
+static int replay_mts_burst_len(uint8_t mts)
+{
+	if (mts & (1 << 7))
+		return 0;
+
+	switch ((mts >> 3) & 0x0f) {
+	case 0x00 ... 0x03: /* GMSK */
+	case 0x06: /* GMSK, Access Burst */
+		return GSM_NBITS_NB_GMSK_BURST;
+	case 0x04 ... 0x05: /* 8-PSK */
+		return GSM_NBITS_NB_8PSK_BURST;
+	default:
+		return -1;
+	}
+}
+
+/* See the TRXD PDU format description in trx_if.c */
+static int replay_trxd_msg(const uint8_t *buf, size_t buf_len)
+{
+	struct l1sched_burst_ind bi;
+	uint8_t ver = buf[0] >> 4;
+	bool batch = true;
+	size_t hdr_len;
+	uint32_t fn = 0;
+	unsigned int i;
+	int burst_len;
+
+	if (buf_len < TRXDv0_HDR_LEN)
+		return -EINVAL;
+
+	if (ver < 2) {
+		hdr_len = (ver == 0) ? TRXDv0_HDR_LEN : TRXDv1_HDR_LEN;
+		if (buf_len < hdr_len)
+			return -EINVAL;
+
+		bi = (struct l1sched_burst_ind) {
+			.tn = buf[0] & 0x07,
+			.fn = osmo_load32be(buf + 1),
+			.rssi = -(int8_t) buf[5],
+			.toa256 = (int16_t) (buf[6] << 8) | buf[7],
+		};
+
+		if (ver == 0) {
+			burst_len = buf_len - hdr_len;
+			/* TRXDv0 PDUs may have 2 dummy bytes at the end */
+			if (burst_len == GSM_NBITS_NB_GMSK_BURST + 2 ||
+			    burst_len == GSM_NBITS_NB_8PSK_BURST + 2)
+				burst_len -= 2;
+			else if (burst_len != GSM_NBITS_NB_GMSK_BURST &&
+				 burst_len != GSM_NBITS_NB_8PSK_BURST)
+				return -EINVAL;
+		} else {
+			burst_len = replay_mts_burst_len(buf[8]);
+			if (burst_len < 0 || buf_len - hdr_len < burst_len)
+				return -EINVAL;
+		}
+
+		trx_if_conv_soft_bits(&bi.burst[0], &buf[hdr_len], burst_len);
+		bi.burst_len = burst_len;
+		replay_burst(&bi);
+		return 0;
+	}
+
+	if (ver > 2)
+		return -ENOTSUP;
+
+	for (i = 0; batch; i++) {
+		/* The first PDU additionally contains the TDMA frame number */
+		hdr_len = TRXDv2_RX_HDR_LEN + (i == 0 ? 4 : 0);
+		if (buf_len < hdr_len)
+			return -EINVAL;
+		if (i == 0)
+			fn = osmo_load32be(buf + TRXDv2_RX_HDR_LEN);
+
+		bi = (struct l1sched_burst_ind) {
+			.tn = buf[0] & 0x07,
+			.fn = fn,
+			.rssi = -(int8_t) buf[3],
+			.toa256 = (int16_t) (buf[4] << 8) | buf[5],
+		};
+
+		batch = !!(buf[1] & (1 << 7));
+
+		burst_len = replay_mts_burst_len(buf[2]);
+		if (burst_len < 0)
+			return -EINVAL;
+
+		buf_len -= hdr_len;
+		buf += hdr_len;
+		if (buf_len < burst_len)
+			return -EINVAL;
+
+		trx_if_conv_soft_bits(&bi.burst[0], buf, burst_len);
+		bi.burst_len = burst_len;
+		replay_burst(&bi);
+
+		buf_len -= burst_len;
+		buf += burst_len;
+	}
+
+	return 0;
+}
+
+static double timespec_diff(const struct timespec *a, const struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+static int print_ctr_cb(struct rate_ctr_group *ctrg, struct rate_ctr *ctr,
+			const struct rate_ctr_desc *desc, void *data)
+{
+	if (ctr->current > 0)
+		printf("  %-28s %" PRIu64 "\n", desc->name, ctr->current);
+	return 0;
+}
+
+static void print_report(double elapsed, uint64_t capture_us)
+{
+	unsigned int i;
+
+	printf("Replayed %.3f s of capture in %.3f s (x%.1f real-time)\n",
+	       capture_us / 1e6, elapsed, capture_us / 1e6 / elapsed);
+	printf("Rx bursts: %lu (%.0f bursts/s), NOPE.ind: %lu, malformed: %lu\n",
+	       g_replay.num_rx_bursts, g_replay.num_rx_bursts / elapsed,
+	       g_replay.num_rx_nope, g_replay.num_rx_bad);
+	printf("Tx bursts: %lu (captured: %lu TRXD messages)\n",
+	       g_replay.num_tx_bursts, g_replay.num_trxd_tx);
+	printf("TRXC commands: %lu, SCH indications: %lu\n",
+	       g_replay.num_trxc, g_replay.num_sch);
+
+	printf("\n%-12s %10s %12s %10s %8s %8s\n",
+	       "lchan", "blocks", "blocks/s", "bad", "bad%", "BER%");
+	for (i = 0; i < _L1SCHED_CHAN_MAX; i++) {
+		const struct replay_lchan_stats *st = &g_replay.lchan[i];
+
+		if (st->blocks == 0)
+			continue;
+		printf("%-12s %10lu %12.0f %10lu %8.2f %8.2f\n",
+		       l1sched_lchan_desc[i].name, st->blocks, st->blocks / elapsed,
+		       st->blocks_bad, 100.0 * st->blocks_bad / st->blocks,
+		       st->n_bits_total ? 100.0 * st->n_errors / st->n_bits_total : 0.0);
+	}
+
+	if (g_replay.sched->ctrs != NULL) {
+		printf("\nScheduler counters:\n");
+		rate_ctr_for_each_counter(g_replay.sched->ctrs, &print_ctr_cb, NULL);
+	}
+}
+
+static void print_usage(const char *app)
+{
+	printf("Usage: %s [-a] [-v] [-f FN_ADVANCE] [-j DECODERS] FILE\n", app);
+	printf("  -a  Activate all logical channels of configured timeslots\n");
+	printf("  -v  Enable scheduler logging\n");
+	printf("  -f  Uplink burst scheduling advance (default %u)\n", g_replay.fn_advance);
+	printf("  -j  Decode xCCH/PDTCH in N threads (default 0)\n");
+}
+
+static const struct log_info replay_log_info = { };
+
+int main(int argc, char **argv)
+{
+	const struct l1sched_cfg sched_cfg = { .log_prefix = "" };
+	struct trx_capture_rec *rec;
+	struct trx_capture *cap;
+	struct timespec start, end;
+	unsigned int num_decoders = 0;
+	bool verbose = false;
+	void *ctx;
+	int rc, opt;
+
+	while ((opt = getopt(argc, argv, "avf:j:h")) != -1) {
+		switch (opt) {
+		case 'a':
+			g_replay.activate_all = true;
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		case 'f':
+			g_replay.fn_advance = strtoul(optarg, NULL, 10);
+			break;
+		case 'j':
+			num_decoders = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			print_usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (optind >= argc) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	ctx = talloc_named_const(NULL, 0, "trx_replay");
+	osmo_init_logging2(ctx, &replay_log_info);
+	log_set_log_level(osmo_stderr_target, verbose ? LOGL_DEBUG : LOGL_FATAL);
+
+	cap = trx_capture_open(ctx, argv[optind], false);
+	if (cap == NULL) {
+		fprintf(stderr, "Failed to open '%s': %s\n", argv[optind], strerror(errno));
+		return 1;
+	}
+
+	rec = talloc_zero(ctx, struct trx_capture_rec);
+	g_replay.sched = l1sched_alloc(ctx, &sched_cfg, NULL);
+	if (rec == NULL || g_replay.sched == NULL)
+		return 1;
+	if (num_decoders > 0 && l1sched_decoder_start(g_replay.sched, num_decoders) != 0)
+		return 1;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	while ((rc = trx_capture_read(cap, rec)) > 0) {
+		switch (rec->type) {
+		case TRX_CAPTURE_TRXC_TX:
+			replay_trxc_cmd(rec);
+			break;
+		case TRX_CAPTURE_TRXD_RX:
+			if (replay_trxd_msg(rec->buf, rec->len) != 0)
+				g_replay.num_rx_bad++;
+			break;
+		case TRX_CAPTURE_TRXD_TX:
+			g_replay.num_trxd_tx++;
+			break;
+		default:
+			break;
+		}
+	}
+
+	l1sched_decoder_flush(g_replay.sched);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (rc < 0)
+		fprintf(stderr, "Capture file is truncated or corrupted (rc=%d)\n", rc);
+
+	print_report(timespec_diff(&start, &end), rec->time_us);
+
+	l1sched_free(g_replay.sched);
+	talloc_free(ctx);
+
+	return rc < 0 ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * Transceiver interface: soft-bit conversion
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <osmocom/core/bits.h>
+
+#include <osmocom/bb/trxcon/trx_if.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+/* The transceiver sends soft-bits as unsigned bytes, where 0 is the most
+ * certain '0' and 254..255 is the most certain '1'.  The scheduler expects
+ * sbit_t values in range -127..127, with positive values standing for '0'.
+ *
+ * The mapping 127 - x is equivalent to x ^ 0x7f (modulo 256), which yields
+ * -128 for x = 255, so the only correction needed is -128 -> -127.  All the
+ * paths below are branch-free and produce identical results. */
+
+static inline void conv_scalar(sbit_t *out, const uint8_t *in, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		int8_t v = (int8_t)(in[i] ^ 0x7f);
+		out[i] = (v == -128) ? -127 : v;
+	}
+}
+
+#if defined(__SSE2__)
+static size_t conv_sse2(sbit_t *out, const uint8_t *in, size_t len)
+{
+	const __m128i mask = _mm_set1_epi8(0x7f);
+	const __m128i min = _mm_set1_epi8(-128);
+	size_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)&in[i]);
+		v = _mm_xor_si128(v, mask);
+		/* cmpeq yields -1 for -128, subtracting it yields -127 */
+		v = _mm_sub_epi8(v, _mm_cmpeq_epi8(v, min));
+		_mm_storeu_si128((__m128i *)&out[i], v);
+	}
+
+	return i;
+}
+
+#if defined(__GNUC__)
+__attribute__((target("avx2")))
+static size_t conv_avx2(sbit_t *out, const uint8_t *in, size_t len)
+{
+	const __m256i mask = _mm256_set1_epi8(0x7f);
+	const __m256i min = _mm256_set1_epi8(-128);
+	size_t i;
+
+	for (i = 0; i + 32 <= len; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)&in[i]);
+		v = _mm256_xor_si256(v, mask);
+		v = _mm256_sub_epi8(v, _mm256_cmpeq_epi8(v, min));
+		_mm256_storeu_si256((__m256i *)&out[i], v);
+	}
+
+	return i;
+}
+#endif
+#endif /* __SSE2__ */
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+static size_t conv_neon(sbit_t *out, const uint8_t *in, size_t len)
+{
+	const uint8x16_t mask = vdupq_n_u8(0x7f);
+	const int8x16_t min = vdupq_n_s8(-127);
+	size_t i;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		int8x16_t v = vreinterpretq_s8_u8(veorq_u8(vld1q_u8(&in[i]), mask));
+		vst1q_s8(&out[i], vmaxq_s8(v, min));
+	}
+
+	return i;
+}
+#endif
+
+/*! Convert TRXD soft-bits (0..255) to sbit_t (127..-127).
+ *  \param[out] out  output buffer (may be the same as in).
+ *  \param[in]  in   input buffer.
+ *  \param[in]  len  number of soft-bits to convert. */
+void trx_if_conv_soft_bits(sbit_t *out, const uint8_t *in, size_t len)
+{
+	size_t i = 0;
+
+#if defined(__SSE2__)
+#if defined(__GNUC__)
+	if (__builtin_cpu_supports("avx2"))
+		i = conv_avx2(out, in, len);
+#endif
+	i += conv_sse2(&out[i], &in[i], len - i);
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	i = conv_neon(out, in, len);
+#endif
+
+	conv_scalar(&out[i], &in[i], len - i);
+}
@@ -0,0 +1,124 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * Microbenchmark for the TRXD burst ingest path
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/* Measures the time needed to ingest a received burst: conversion of TRXD
+ * soft-bits to sbit_t, followed by extraction of 116 payload bits into a
+ * burst buffer (as done by the lchan handlers).  The legacy per-byte
+ * branchy conversion is compared against trx_if_conv_soft_bits().
+ *
+ * Usage: trx_sbit_bench [ITERATIONS] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <osmocom/core/bits.h>
+
+#include <osmocom/bb/l1sched/l1sched.h>
+#include <osmocom/bb/trxcon/trx_if.h>
+
+#define NUM_BURSTS	64
+
+/* The conversion loop trxcon used to have in trx_if.c */
+static void conv_legacy(uint8_t *buf, size_t len)
+{
+	sbit_t *burst = (sbit_t *)buf;
+
+	for (unsigned int i = 0; i < len; i++) {
+		if (buf[i] == 255)
+			burst[i] = -127;
+		else
+			burst[i] = 127 - buf[i];
+	}
+}
+
+static uint8_t src[NUM_BURSTS][GSM_NBITS_NB_8PSK_BURST];
+static uint8_t buf[NUM_BURSTS][GSM_NBITS_NB_8PSK_BURST];
+static sbit_t out[4 * GSM_NBITS_NB_GMSK_PAYLOAD];
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double bench(unsigned long iters, size_t len, int legacy)
+{
+	double start = now();
+
+	for (unsigned long n = 0; n < iters; n++) {
+		for (unsigned int i = 0; i < NUM_BURSTS; i++) {
+			/* TRXD messages are converted in-place */
+			memcpy(buf[i], src[i], len);
+			if (legacy)
+				conv_legacy(buf[i], len);
+			else
+				trx_if_conv_soft_bits((sbit_t *)buf[i], buf[i], len);
+			l1sched_nb_payload_copy(&out[(i % 4) * GSM_NBITS_NB_GMSK_PAYLOAD],
+						(const sbit_t *)buf[i]);
+		}
+	}
+
+	return (now() - start) / ((double)iters * NUM_BURSTS);
+}
+
+int main(int argc, char **argv)
+{
+	static const size_t lens[] = { GSM_NBITS_NB_GMSK_BURST, GSM_NBITS_NB_8PSK_BURST };
+	unsigned long iters = 100000;
+	unsigned int i, j;
+
+	if (argc > 1)
+		iters = strtoul(argv[1], NULL, 10);
+
+	srand(0);
+	for (i = 0; i < NUM_BURSTS; i++) {
+		for (j = 0; j < sizeof(src[i]); j++)
+			src[i][j] = rand() & 0xff;
+	}
+
+	/* Make sure both conversions produce identical results */
+	for (i = 0; i < NUM_BURSTS; i++) {
+		sbit_t ref[sizeof(src[i])];
+
+		memcpy(ref, src[i], sizeof(ref));
+		conv_legacy((uint8_t *)ref, sizeof(ref));
+		trx_if_conv_soft_bits((sbit_t *)buf[i], src[i], sizeof(src[i]));
+		if (memcmp(ref, buf[i], sizeof(ref)) != 0) {
+			fprintf(stderr, "Conversion mismatch for burst #%u\n", i);
+			return 1;
+		}
+	}
+
+	for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+		double t_legacy = bench(iters, lens[i], 1);
+		double t_new = bench(iters, lens[i], 0);
+
+		printf("%zu soft-bits: legacy %.1f ns/burst, "
+		       "vectorized %.1f ns/burst (x%.2f)\n",
+		       lens[i], t_legacy, t_new, t_legacy / t_new);
+	}
+
+	return 0;
+}
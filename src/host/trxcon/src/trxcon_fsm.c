@@ -33,6 +33,7 @@
 
 #include <osmocom/bb/trxcon/trxcon.h>
 #include <osmocom/bb/trxcon/trxcon_fsm.h>
+#include <osmocom/bb/trxcon/trxcon_stats.h>
 #include <osmocom/bb/trxcon/phyif.h>
 #include <osmocom/bb/trxcon/l1ctl.h>
 #include <osmocom/bb/l1sched/l1sched.h>
@@ -152,7 +153,7 @@ static void handle_full_power_scan_req(struct osmo_fsm_inst *fi,
 	trxcon->fi_data = talloc_memdup(fi, req, sizeof(*req));
 	OSMO_ASSERT(trxcon->fi_data != NULL);
 
-	/* trxcon_st_full_power_scan_onenter() sends the initial TRXCON_PHYIF_CMDT_MEASURE */
+	/* trxcon_st_full_power_scan_onenter() sends TRXCON_PHYIF_CMDT_MEASURE */
 	osmo_fsm_inst_state_chg(fi, TRXCON_ST_FULL_POWER_SCAN, 0, 0); /* TODO: timeout */
 }
 
@@ -208,11 +209,12 @@ static void trxcon_st_full_power_scan_onenter(struct osmo_fsm_inst *fi,
 	const struct trxcon_inst *trxcon = fi->priv;
 	const struct trxcon_param_full_power_scan_req *req = trxcon->fi_data;
 
-	/* req->band_arfcn_start holds the current ARFCN */
+	/* The whole range is requested at once, results are streamed back */
 	const struct trxcon_phyif_cmd phycmd = {
 		.type = TRXCON_PHYIF_CMDT_MEASURE,
 		.param.measure = {
 			.band_arfcn = req->band_arfcn_start,
+			.band_arfcn_stop = req->band_arfcn_stop,
 		},
 	};
 
@@ -229,6 +231,7 @@ static void trxcon_st_full_power_scan_action(struct osmo_fsm_inst *fi,
 	{
 		struct trxcon_param_full_power_scan_req *req = trxcon->fi_data;
 		const struct trxcon_param_full_power_scan_res *res = data;
+		unsigned int num;
 
 		if (req == NULL) {
 			LOGPFSML(fi, LOGL_ERROR, "Rx unexpected power scan result\n");
@@ -244,13 +247,18 @@ static void trxcon_st_full_power_scan_action(struct osmo_fsm_inst *fi,
 			break;
 		}
 
-		if (res->band_arfcn < req->band_arfcn_stop) {
-			l1ctl_tx_pm_conf(trxcon, res->band_arfcn, res->dbm, false);
-			/* trxcon_st_full_power_scan_onenter() sends the next TRXCON_PHYIF_CMDT_MEASURE */
-			req->band_arfcn_start = res->band_arfcn + 1;
-			osmo_fsm_inst_state_chg(fi, TRXCON_ST_FULL_POWER_SCAN, 0, 0); /* TODO: timeout */
+		/* Ignore results beyond the requested range (if any) */
+		num = OSMO_MIN(res->num, req->band_arfcn_stop - res->band_arfcn + 1);
+		if (num == 0)
+			break;
+
+		/* req->band_arfcn_start holds the next expected ARFCN */
+		req->band_arfcn_start = res->band_arfcn + num;
+
+		if (req->band_arfcn_start <= req->band_arfcn_stop) {
+			l1ctl_tx_pm_conf(trxcon, res->band_arfcn, res->dbm, num, false);
 		} else {
-			l1ctl_tx_pm_conf(trxcon, res->band_arfcn, res->dbm, true);
+			l1ctl_tx_pm_conf(trxcon, res->band_arfcn, res->dbm, num, true);
 			LOGPFSML(fi, LOGL_INFO, "Full power scan completed\n");
 			TALLOC_FREE(trxcon->fi_data);
 		}
@@ -405,6 +413,12 @@ static void trxcon_st_bcch_ccch_action(struct osmo_fsm_inst *fi,
 		/* Do nothing if the current mode matches required */
 		if (ts->mf_layout->chan_config != chan_config)
 			l1sched_configure_ts(trxcon->sched, 0, chan_config);
+
+		if (l1sched_set_drx(trxcon->sched, req->drx.bs_pa_mfrms,
+				    req->drx.bs_ag_blks_res, req->drx.paging_group) != 0) {
+			LOGPFSML(fi, LOGL_ERROR, "Invalid DRX parameters, receiving all CCCH blocks\n");
+			l1sched_set_drx(trxcon->sched, 0, 0, 0);
+		}
 		req->applied = true;
 		break;
 	}
@@ -412,7 +426,7 @@ static void trxcon_st_bcch_ccch_action(struct osmo_fsm_inst *fi,
 		handle_dch_est_req(fi, (const struct trxcon_param_dch_est_req *)data);
 		break;
 	case TRXCON_EV_RX_DATA_IND:
-		l1ctl_tx_dt_ind(trxcon, (const struct trxcon_param_rx_data_ind *)data);
+		l1ctl_tx_dt_ind(trxcon, (struct trxcon_param_rx_data_ind *)data);
 		break;
 	default:
 		OSMO_ASSERT(0);
@@ -513,7 +527,7 @@ static void trxcon_st_dedicated_action(struct osmo_fsm_inst *fi,
 		l1ctl_tx_dt_conf(trxcon, (const struct trxcon_param_tx_data_cnf *)data);
 		break;
 	case TRXCON_EV_RX_DATA_IND:
-		l1ctl_tx_dt_ind(trxcon, (const struct trxcon_param_rx_data_ind *)data);
+		l1ctl_tx_dt_ind(trxcon, (struct trxcon_param_rx_data_ind *)data);
 		break;
 	default:
 		OSMO_ASSERT(0);
@@ -681,8 +695,11 @@ static void trxcon_fsm_pre_term_cb(struct osmo_fsm_inst *fi,
 		return;
 
 	/* Shutdown the scheduler */
-	if (trxcon->sched != NULL)
+	if (trxcon->sched != NULL) {
+		trxcon_stats_lock();
 		l1sched_free(trxcon->sched);
+		trxcon_stats_unlock();
+	}
 	/* Clean up GPRS L1 state */
 	l1gprs_state_free(trxcon->gprs);
 
@@ -799,7 +816,9 @@ static const struct value_string trxcon_fsm_event_names[] = {
 	{ 0, NULL }
 };
 
-struct osmo_fsm trxcon_fsm_def = {
+/* libosmocore keeps a list of instances in each struct osmo_fsm, which is not
+ * thread-safe.  Each worker thread gets its own copy, see trxcon_fsm_thread_init(). */
+__thread struct osmo_fsm trxcon_fsm_def = {
 	.name = "trxcon",
 	.states = trxcon_fsm_states,
 	.num_states = ARRAY_SIZE(trxcon_fsm_states),
@@ -816,7 +835,21 @@ struct osmo_fsm trxcon_fsm_def = {
 	.pre_term = &trxcon_fsm_pre_term_cb,
 };
 
+/* Copy registered by the main thread */
+static struct osmo_fsm *trxcon_fsm_main;
+
+/*! Initialize the thread-local copy of trxcon_fsm_def in a worker thread.
+ *  Shall be called after trxcon_set_log_cfg(), before allocating instances. */
+void trxcon_fsm_thread_init(void)
+{
+	if (&trxcon_fsm_def == trxcon_fsm_main)
+		return;
+	trxcon_fsm_def.log_subsys = trxcon_fsm_main->log_subsys;
+	INIT_LLIST_HEAD(&trxcon_fsm_def.instances);
+}
+
 static __attribute__((constructor)) void on_dso_load(void)
 {
 	OSMO_ASSERT(osmo_fsm_register(&trxcon_fsm_def) == 0);
+	trxcon_fsm_main = &trxcon_fsm_def;
 }
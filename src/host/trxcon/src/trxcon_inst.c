@@ -25,6 +25,7 @@
 
 #include <osmocom/bb/trxcon/trxcon.h>
 #include <osmocom/bb/trxcon/trxcon_fsm.h>
+#include <osmocom/bb/trxcon/trxcon_stats.h>
 #include <osmocom/bb/l1sched/l1sched.h>
 #include <osmocom/bb/l1sched/logging.h>
 #include <osmocom/bb/l1gprs.h>
@@ -86,9 +87,12 @@ struct trxcon_inst *trxcon_inst_alloc(void *ctx, unsigned int id)
 	/* Init scheduler */
 	const struct l1sched_cfg sched_cfg = {
 		.log_prefix = trxcon->log_prefix,
+		.ctr_idx = id,
 	};
 
+	trxcon_stats_lock();
 	trxcon->sched = l1sched_alloc(trxcon, &sched_cfg, trxcon);
+	trxcon_stats_unlock();
 	if (trxcon->sched == NULL) {
 		trxcon_inst_free(trxcon);
 		return NULL;
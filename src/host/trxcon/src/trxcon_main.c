@@ -36,13 +36,20 @@
 #include <osmocom/core/application.h>
 #include <osmocom/core/gsmtap_util.h>
 #include <osmocom/core/gsmtap.h>
+#include <osmocom/core/rate_ctr.h>
 
 #include <osmocom/bb/trxcon/trxcon.h>
 #include <osmocom/bb/trxcon/trxcon_fsm.h>
 #include <osmocom/bb/trxcon/phyif.h>
 #include <osmocom/bb/trxcon/trx_if.h>
+#include <osmocom/bb/trxcon/phy_shm.h>
+#include <osmocom/bb/trxcon/phy_synth.h>
 #include <osmocom/bb/trxcon/logging.h>
 #include <osmocom/bb/trxcon/l1ctl_server.h>
+#include <osmocom/bb/trxcon/trxcon_worker.h>
+#include <osmocom/bb/trxcon/trxcon_stats.h>
+#include <osmocom/bb/trxcon/gsmtap_export.h>
+#include <osmocom/bb/l1sched/l1sched.h>
 
 #define COPYRIGHT \
 	"Copyright (C) 2016-2022 by Vadim Yanitskiy <axilirator@gmail.com>\n" \
@@ -52,27 +59,59 @@
 	"This is free software: you are free to change and redistribute it.\n" \
 	"There is NO WARRANTY, to the extent permitted by law.\n\n"
 
+enum trxcon_phyif_backend {
+	TRXCON_PHYIF_TRX,	/* TRXC/TRXD over UDP (see trx_if.c) */
+	TRXCON_PHYIF_SHM,	/* shared memory (see phy_shm.c) */
+	TRXCON_PHYIF_SYNTH,	/* synthetic cell (see phy_synth.c) */
+};
+
 static struct {
 	const char *debug_mask;
 	int daemonize;
 	int quit;
+	/* dump counters on the next iteration of the main loop (SIGUSR2) */
+	volatile sig_atomic_t dump_stats;
 
 	/* L1CTL specific */
 	unsigned int max_clients;
 	const char *bind_socket;
+	/* number of worker threads (0 means serve everything in main thread) */
+	unsigned int num_workers;
+	/* number of decoder threads per connection (0 means decode in-place) */
+	unsigned int num_decoders;
 
 	/* TRX specific */
 	const char *trx_bind_ip;
 	const char *trx_remote_ip;
 	uint16_t trx_base_port;
 	uint32_t trx_fn_advance;
+	/* adaptive fn_advance within these bounds (disabled if equal) */
+	uint32_t trx_fn_advance_min;
+	uint32_t trx_fn_advance_max;
+	uint8_t trxd_pdu_ver;
+	/* capture TRXC/TRXD messages to this file (optional) */
+	const char *trx_capture_path;
+	bool trxd_mmsg;
+	unsigned int trxc_window;
+	/* shared memory interface instead of TRXC/TRXD (optional) */
+	const char *trx_shm_path;
+	enum trxcon_phyif_backend phyif_backend;
+
+	/* Synthetic PHY specific */
+	unsigned int synth_arfcn;
+	unsigned int synth_bsic;
+	unsigned int synth_speed;
+	bool synth_echo;
+	const char *synth_si_path;
 
 	/* PHY quirk: FBSB timeout extension (in TDMA FNs) */
 	unsigned int phyq_fbsb_extend_fns;
 
 	/* GSMTAP specific */
 	struct gsmtap_inst *gsmtap;
+	struct gsmtap_export *gsmtap_exp;
 	const char *gsmtap_ip;
+	const char *gsmtap_pcap;
 } app_data = {
 	.max_clients = 1, /* only one L1CTL client by default */
 	.bind_socket = "/tmp/osmocom_l2",
@@ -80,24 +119,107 @@ static struct {
 	.trx_bind_ip = "0.0.0.0",
 	.trx_base_port = 6700,
 	.trx_fn_advance = 2,
+	.trxc_window = TRXC_WINDOW_DEFAULT,
+	.trxd_pdu_ver = TRXD_PDU_VER_MAX,
 	.phyq_fbsb_extend_fns = 0,
+	.phyif_backend = TRXCON_PHYIF_TRX,
+	.synth_bsic = 63,
+	.synth_speed = 1,
 };
 
 static void *tall_trxcon_ctx = NULL;
 
 int trxcon_phyif_handle_burst_req(void *phyif, const struct trxcon_phyif_burst_req *br)
 {
-	return trx_if_handle_phyif_burst_req(phyif, br);
+	switch (app_data.phyif_backend) {
+	case TRXCON_PHYIF_SHM:
+		return phy_shm_handle_phyif_burst_req(phyif, br);
+	case TRXCON_PHYIF_SYNTH:
+		return phy_synth_handle_phyif_burst_req(phyif, br);
+	default:
+		return trx_if_handle_phyif_burst_req(phyif, br);
+	}
 }
 
 int trxcon_phyif_handle_cmd(void *phyif, const struct trxcon_phyif_cmd *cmd)
 {
-	return trx_if_handle_phyif_cmd(phyif, cmd);
+	switch (app_data.phyif_backend) {
+	case TRXCON_PHYIF_SHM:
+		return phy_shm_handle_phyif_cmd(phyif, cmd);
+	case TRXCON_PHYIF_SYNTH:
+		return phy_synth_handle_phyif_cmd(phyif, cmd);
+	default:
+		return trx_if_handle_phyif_cmd(phyif, cmd);
+	}
 }
 
 void trxcon_phyif_close(void *phyif)
 {
-	trx_if_close(phyif);
+	switch (app_data.phyif_backend) {
+	case TRXCON_PHYIF_SHM:
+		phy_shm_close(phyif);
+		break;
+	case TRXCON_PHYIF_SYNTH:
+		phy_synth_close(phyif);
+		break;
+	default:
+		trx_if_close(phyif);
+		break;
+	}
+}
+
+static void *trxcon_phyif_open(struct trxcon_inst *trxcon)
+{
+	if (app_data.phyif_backend == TRXCON_PHYIF_SYNTH) {
+		const struct phy_synth_params params = {
+			.band_arfcn = app_data.synth_arfcn,
+			.bsic = app_data.synth_bsic,
+			.speed = app_data.synth_speed,
+			.echo = app_data.synth_echo,
+			.si_path = app_data.synth_si_path,
+			.fn_advance = app_data.trx_fn_advance,
+			.instance = trxcon->id,
+
+			.parent_fi = trxcon->fi,
+			.priv = trxcon,
+		};
+
+		return phy_synth_open(&params);
+	}
+
+	if (app_data.phyif_backend == TRXCON_PHYIF_SHM) {
+		const struct phy_shm_params params = {
+			.sock_path = app_data.trx_shm_path,
+			.fn_advance = app_data.trx_fn_advance,
+			.instance = trxcon->id,
+
+			.parent_fi = trxcon->fi,
+			.parent_term_event = TRXCON_EV_PHYIF_FAILURE,
+			.priv = trxcon,
+		};
+
+		return phy_shm_open(&params);
+	}
+
+	const struct trx_if_params params = {
+		.local_host = app_data.trx_bind_ip,
+		.remote_host = app_data.trx_remote_ip,
+		.base_port = app_data.trx_base_port,
+		.fn_advance = app_data.trx_fn_advance,
+		.fn_advance_min = app_data.trx_fn_advance_min,
+		.fn_advance_max = app_data.trx_fn_advance_max,
+		.trxd_pdu_ver = app_data.trxd_pdu_ver,
+		.trxd_mmsg = app_data.trxd_mmsg,
+		.trxc_window = app_data.trxc_window,
+		.capture_path = app_data.trx_capture_path,
+		.instance = trxcon->id,
+
+		.parent_fi = trxcon->fi,
+		.parent_term_event = TRXCON_EV_PHYIF_FAILURE,
+		.priv = trxcon,
+	};
+
+	return trx_if_open(&params);
 }
 
 void trxcon_l1ctl_close(struct trxcon_inst *trxcon)
@@ -137,27 +259,22 @@ static void l1ctl_conn_accept_cb(struct l1ctl_client *l1c)
 	l1c->priv = trxcon;
 	trxcon->l2if = l1c;
 
-	const struct trx_if_params trxcon_phyif_params = {
-		.local_host = app_data.trx_bind_ip,
-		.remote_host = app_data.trx_remote_ip,
-		.base_port = app_data.trx_base_port,
-		.fn_advance = app_data.trx_fn_advance,
-		.instance = trxcon->id,
-
-		.parent_fi = trxcon->fi,
-		.parent_term_event = TRXCON_EV_PHYIF_FAILURE,
-		.priv = trxcon,
-	};
+	/* Optional asynchronous channel decoding */
+	if (l1sched_decoder_start(trxcon->sched, app_data.num_decoders) != 0) {
+		l1ctl_client_conn_close(l1c);
+		return;
+	}
 
 	/* Init transceiver interface */
-	trxcon->phyif = trx_if_open(&trxcon_phyif_params);
+	trxcon->phyif = trxcon_phyif_open(trxcon);
 	if (trxcon->phyif == NULL) {
 		/* TRXCON_EV_PHYIF_FAILURE triggers l1ctl_client_conn_close() */
 		osmo_fsm_inst_dispatch(trxcon->fi, TRXCON_EV_PHYIF_FAILURE, NULL);
 		return;
 	}
 
-	trxcon->gsmtap = app_data.gsmtap;
+	/* GSMTAP export is shared by all threads */
+	trxcon->gsmtap = app_data.gsmtap_exp;
 	trxcon->phy_quirks.fbsb_extend_fns = app_data.phyq_fbsb_extend_fns;
 }
 
@@ -185,10 +302,27 @@ static void print_help(void)
 	printf("  -i --trx-remote   TRX remote IP address (default 127.0.0.1)\n");
 	printf("  -p --trx-port     Base port of TRX instance (default 6700)\n");
 	printf("  -f --trx-advance  Uplink burst scheduling advance (default 2)\n");
+	printf("  -A --trx-advance-auto MIN:MAX  Adjust the advance to the host load\n");
+	printf("  -T --trxd-version Highest TRXD PDU version to negotiate (default %u)\n",
+	       TRXD_PDU_VER_MAX);
+	printf("  -M --trxd-mmsg    Use batched TRXD I/O (recvmmsg/sendmmsg)\n");
+	printf("  -W --trxc-window  Max number of TRXC commands in flight (default %u)\n",
+	       TRXC_WINDOW_DEFAULT);
+	printf("  -c --capture      Capture TRXC/TRXD messages to a file (see trx_replay)\n");
+	printf("  -S --trx-shm      Attach to a co-located transceiver via shared memory\n");
+	printf("                    (socket path, e.g. %s)\n", PHY_SHM_SOCK_PATH);
+	printf("  -y --synth        Use a built-in synthetic cell, ARFCN[:BSIC] (default BSIC 63)\n");
+	printf("  -Y --synth-speed  Clock of the synthetic cell: 1 is real-time (default),\n");
+	printf("                    N is N times faster, 0 is as fast as possible\n");
+	printf("  -E --synth-echo   Loop Uplink bursts on TS1-7 back to the synthetic cell's Downlink\n");
+	printf("  -I --synth-si     System Information for the synthetic cell, one hex message per line\n");
 	printf("  -F --fbsb-extend  FBSB timeout extension (in TDMA FNs, default 0)\n");
 	printf("  -s --socket       Listening socket for layer23 (default /tmp/osmocom_l2)\n");
 	printf("  -g --gsmtap-ip    The destination IP used for GSMTAP (disabled by default)\n");
+	printf("  -G --gsmtap-pcap  Write GSMTAP Um messages to a pcap file instead\n");
 	printf("  -C --max-clients  Maximum number of L1CTL connections (default 1)\n");
+	printf("  -w --workers      Serve L1CTL connections in N worker threads (default 0)\n");
+	printf("  -j --decoders     Decode xCCH/PDTCH in N threads per connection (default 0)\n");
 	printf("  -D --daemonize    Run as daemon\n");
 }
 
@@ -208,14 +342,27 @@ static void handle_options(int argc, char **argv)
 			{"trx-remote", 1, 0, 'i'},
 			{"trx-port", 1, 0, 'p'},
 			{"trx-advance", 1, 0, 'f'},
+			{"trx-advance-auto", 1, 0, 'A'},
 			{"fbsb-extend", 1, 0, 'F'},
+			{"trxd-version", 1, 0, 'T'},
+			{"trxd-mmsg", 0, 0, 'M'},
+			{"trxc-window", 1, 0, 'W'},
+			{"capture", 1, 0, 'c'},
+			{"trx-shm", 1, 0, 'S'},
+			{"synth", 1, 0, 'y'},
+			{"synth-speed", 1, 0, 'Y'},
+			{"synth-echo", 0, 0, 'E'},
+			{"synth-si", 1, 0, 'I'},
 			{"gsmtap-ip", 1, 0, 'g'},
+			{"gsmtap-pcap", 1, 0, 'G'},
 			{"max-clients", 1, 0, 'C'},
+			{"workers", 1, 0, 'w'},
+			{"decoders", 1, 0, 'j'},
 			{"daemonize", 0, 0, 'D'},
 			{0, 0, 0, 0}
 		};
 
-		c = getopt_long(argc, argv, "d:b:i:p:f:F:s:g:C:Dh",
+		c = getopt_long(argc, argv, "d:b:i:p:f:A:F:T:MW:c:S:y:Y:EI:s:g:G:C:w:j:Dh",
 				long_options, &option_index);
 		if (c == -1)
 			break;
@@ -251,6 +398,15 @@ static void handle_options(int argc, char **argv)
 				exit(EXIT_FAILURE);
 			}
 			break;
+		case 'A':
+			if (sscanf(optarg, "%u:%u", &app_data.trx_fn_advance_min,
+				   &app_data.trx_fn_advance_max) != 2 ||
+			    app_data.trx_fn_advance_min == 0 ||
+			    app_data.trx_fn_advance_min >= app_data.trx_fn_advance_max) {
+				fprintf(stderr, "Failed to parse -A/--trx-advance-auto=%s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
 		case 'F':
 			app_data.phyq_fbsb_extend_fns = strtoul(optarg, &endptr, 10);
 			if (errno || *endptr != '\0') {
@@ -258,12 +414,60 @@ static void handle_options(int argc, char **argv)
 				exit(EXIT_FAILURE);
 			}
 			break;
+		case 'T':
+			app_data.trxd_pdu_ver = strtoul(optarg, &endptr, 10);
+			if (errno || *endptr != '\0' || app_data.trxd_pdu_ver > TRXD_PDU_VER_MAX) {
+				fprintf(stderr, "Failed to parse -T/--trxd-version=%s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'M':
+			app_data.trxd_mmsg = true;
+			break;
+		case 'W':
+			app_data.trxc_window = strtoul(optarg, &endptr, 10);
+			if (errno || *endptr != '\0' || app_data.trxc_window == 0) {
+				fprintf(stderr, "Failed to parse -W/--trxc-window=%s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'c':
+			app_data.trx_capture_path = optarg;
+			break;
+		case 'S':
+			app_data.trx_shm_path = optarg;
+			app_data.phyif_backend = TRXCON_PHYIF_SHM;
+			break;
+		case 'y':
+			if (sscanf(optarg, "%u:%u", &app_data.synth_arfcn, &app_data.synth_bsic) < 1 ||
+			    app_data.synth_arfcn > 1023 || app_data.synth_bsic > 63) {
+				fprintf(stderr, "Failed to parse -y/--synth=%s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			app_data.phyif_backend = TRXCON_PHYIF_SYNTH;
+			break;
+		case 'Y':
+			app_data.synth_speed = strtoul(optarg, &endptr, 10);
+			if (errno || *endptr != '\0') {
+				fprintf(stderr, "Failed to parse -Y/--synth-speed=%s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'E':
+			app_data.synth_echo = true;
+			break;
+		case 'I':
+			app_data.synth_si_path = optarg;
+			break;
 		case 's':
 			app_data.bind_socket = optarg;
 			break;
 		case 'g':
 			app_data.gsmtap_ip = optarg;
 			break;
+		case 'G':
+			app_data.gsmtap_pcap = optarg;
+			break;
 		case 'C':
 			app_data.max_clients = strtoul(optarg, &endptr, 10);
 			if (errno || *endptr != '\0') {
@@ -271,6 +475,20 @@ static void handle_options(int argc, char **argv)
 				exit(EXIT_FAILURE);
 			}
 			break;
+		case 'w':
+			app_data.num_workers = strtoul(optarg, &endptr, 10);
+			if (errno || *endptr != '\0') {
+				fprintf(stderr, "Failed to parse -w/--workers=%s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'j':
+			app_data.num_decoders = strtoul(optarg, &endptr, 10);
+			if (errno || *endptr != '\0') {
+				fprintf(stderr, "Failed to parse -j/--decoders=%s\n", optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
 		case 'D':
 			app_data.daemonize = 1;
 			break;
@@ -301,9 +519,11 @@ static void signal_handler(int signum)
 		raise(SIGABRT);
 		break;
 	case SIGUSR1:
-	case SIGUSR2:
 		talloc_report_full(tall_trxcon_ctx, stderr);
 		break;
+	case SIGUSR2:
+		app_data.dump_stats = 1;
+		break;
 	default:
 		break;
 	}
@@ -313,17 +533,23 @@ int main(int argc, char **argv)
 {
 	struct l1ctl_server_cfg server_cfg;
 	struct l1ctl_server *server = NULL;
+	struct trxcon_worker_cfg worker_cfg;
+	bool workers_started = false;
 	int rc = 0;
 
 	printf("%s", COPYRIGHT);
 	handle_options(argc, argv);
 
-	/* Track the use of talloc NULL memory contexts */
-	talloc_enable_null_tracking();
+	/* Track the use of talloc NULL memory contexts.  Not possible in worker
+	 * mode: talloc is not thread-safe, so msgb and other allocations from
+	 * different threads must not share a common parent context. */
+	if (app_data.num_workers == 0)
+		talloc_enable_null_tracking();
 
 	/* Init talloc memory management system */
 	tall_trxcon_ctx = talloc_init("trxcon context");
-	msgb_talloc_ctx_init(tall_trxcon_ctx, 0);
+	if (app_data.num_workers == 0)
+		msgb_talloc_ctx_init(tall_trxcon_ctx, 0);
 
 	/* Setup signal handlers */
 	signal(SIGINT, &signal_handler);
@@ -335,6 +561,8 @@ int main(int argc, char **argv)
 
 	/* Init logging system */
 	trxcon_logging_init(tall_trxcon_ctx, app_data.debug_mask);
+	if (app_data.num_workers > 0)
+		log_enable_multithread();
 
 	/* Configure pretty logging */
 	log_set_print_extended_timestamp(osmo_stderr_target, 1);
@@ -347,6 +575,11 @@ int main(int argc, char **argv)
 
 	osmo_fsm_log_timeouts(true);
 
+	/* Rate counter intervals are updated by a timer iterating over all
+	 * counter groups, which cannot be done safely in worker mode. */
+	if (app_data.num_workers == 0)
+		rate_ctr_init(tall_trxcon_ctx);
+
 	/* Optional GSMTAP  */
 	if (app_data.gsmtap_ip != NULL) {
 		struct log_target *lt;
@@ -370,6 +603,20 @@ int main(int argc, char **argv)
 		gsmtap_source_add_sink(app_data.gsmtap);
 	}
 
+	/* Um messages are sent (or written) by a separate thread */
+	if (app_data.gsmtap != NULL || app_data.gsmtap_pcap != NULL) {
+		const struct gsmtap_export_cfg exp_cfg = {
+			.fd = app_data.gsmtap != NULL ? gsmtap_inst_fd2(app_data.gsmtap) : -1,
+			.pcap_path = app_data.gsmtap_pcap,
+		};
+
+		app_data.gsmtap_exp = gsmtap_export_alloc(tall_trxcon_ctx, &exp_cfg);
+		if (app_data.gsmtap_exp == NULL) {
+			LOGP(DAPP, LOGL_ERROR, "Failed to init GSMTAP export\n");
+			goto exit;
+		}
+	}
+
 	/* Start the L1CTL server */
 	server_cfg = (struct l1ctl_server_cfg) {
 		.sock_path = app_data.bind_socket,
@@ -377,6 +624,8 @@ int main(int argc, char **argv)
 		.conn_read_cb = &l1ctl_rx_cb,
 		.conn_accept_cb = &l1ctl_conn_accept_cb,
 		.conn_close_cb = &l1ctl_conn_close_cb,
+		.conn_dispatch_cb = app_data.num_workers > 0 ?
+				    &trxcon_workers_dispatch : NULL,
 	};
 
 	server = l1ctl_server_alloc(tall_trxcon_ctx, &server_cfg);
@@ -385,6 +634,20 @@ int main(int argc, char **argv)
 		goto exit;
 	}
 
+	/* Start worker threads (optional) */
+	if (app_data.num_workers > 0) {
+		worker_cfg = (struct trxcon_worker_cfg) {
+			.num_workers = app_data.num_workers,
+			.server = server,
+		};
+
+		if (trxcon_workers_start(tall_trxcon_ctx, &worker_cfg) != 0) {
+			rc = EXIT_FAILURE;
+			goto exit;
+		}
+		workers_started = true;
+	}
+
 	LOGP(DAPP, LOGL_NOTICE, "Init complete\n");
 
 	if (app_data.daemonize) {
@@ -398,12 +661,24 @@ int main(int argc, char **argv)
 	/* Initialize pseudo-random generator */
 	srand(time(NULL));
 
-	while (!app_data.quit)
+	while (!app_data.quit) {
 		osmo_select_main(0);
+		if (app_data.dump_stats) {
+			app_data.dump_stats = 0;
+			trxcon_stats_dump(stderr);
+			if (app_data.gsmtap_exp != NULL)
+				gsmtap_export_dump(app_data.gsmtap_exp, stderr);
+		}
+	}
 
 exit:
+	/* Workers close their own connections */
+	if (workers_started)
+		trxcon_workers_stop();
 	if (server != NULL)
 		l1ctl_server_free(server);
+	gsmtap_export_free(app_data.gsmtap_exp);
+	l1sched_msgb_pool_drain();
 
 	/* Deinitialize logging */
 	log_fini();
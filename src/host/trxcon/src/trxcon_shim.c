@@ -27,6 +27,7 @@
 #include <osmocom/gsm/rsl.h>
 
 #include <osmocom/bb/trxcon/trxcon.h>
+#include <osmocom/bb/trxcon/gsmtap_export.h>
 #include <osmocom/bb/trxcon/trxcon_fsm.h>
 #include <osmocom/bb/trxcon/phyif.h>
 #include <osmocom/bb/l1sched/l1sched.h>
@@ -45,9 +46,9 @@ static void trxcon_gsmtap_send(struct trxcon_inst *trxcon,
 		return;
 	chan_type = chantype_rsl2gsmtap2(chan_type, chdr->link_id, chdr->traffic);
 
-	gsmtap_send(trxcon->gsmtap, band_arfcn, tn, chan_type, ss,
-		    chdr->frame_nr, signal_dbm, snr,
-		    data, data_len);
+	gsmtap_export_send(trxcon->gsmtap, band_arfcn, tn, chan_type, ss,
+			   chdr->frame_nr, signal_dbm, snr,
+			   data, data_len);
 }
 
 /* External L1 API for the scheduler */
@@ -82,7 +83,9 @@ static int handle_prim_data_ind(struct trxcon_inst *trxcon, struct msgb *msg)
 		.n_bits_total = prim->data_ind.n_bits_total,
 		.data_len = msgb_l2len(msg),
 		.data = msgb_l2(msg),
+		.msg = msg,
 	};
+	int rc;
 
 	if (trxcon->gsmtap != NULL && ind.data_len > 0) {
 		trxcon_gsmtap_send(trxcon, &prim->data_ind.chdr,
@@ -90,7 +93,13 @@ static int handle_prim_data_ind(struct trxcon_inst *trxcon, struct msgb *msg)
 				   ind.rssi, 0, false);
 	}
 
-	return osmo_fsm_inst_dispatch(trxcon->fi, TRXCON_EV_RX_DATA_IND, &ind);
+	rc = osmo_fsm_inst_dispatch(trxcon->fi, TRXCON_EV_RX_DATA_IND, &ind);
+
+	/* The msgb may have been reused for the L1CTL message */
+	if (ind.msg != NULL)
+		msgb_free(ind.msg);
+
+	return rc;
 }
 
 static int handle_prim_data_cnf(struct trxcon_inst *trxcon, struct msgb *msg)
@@ -151,8 +160,8 @@ int l1sched_prim_to_user(struct l1sched_state *sched, struct msgb *msg)
 
 	switch (OSMO_PRIM_HDR(&prim->oph)) {
 	case OSMO_PRIM(L1SCHED_PRIM_T_DATA, PRIM_OP_INDICATION):
-		rc = handle_prim_data_ind(trxcon, msg);
-		break;
+		/* takes ownership of msg */
+		return handle_prim_data_ind(trxcon, msg);
 	case OSMO_PRIM(L1SCHED_PRIM_T_DATA, PRIM_OP_CONFIRM):
 		rc = handle_prim_data_cnf(trxcon, msg);
 		break;
@@ -250,6 +259,7 @@ int trxcon_phyif_handle_rsp(void *priv, const struct trxcon_phyif_rsp *rsp)
 		struct trxcon_param_full_power_scan_res res = {
 			.band_arfcn = meas->band_arfcn,
 			.dbm = meas->dbm,
+			.num = meas->num,
 		};
 
 		return osmo_fsm_inst_dispatch(trxcon->fi, TRXCON_EV_FULL_POWER_SCAN_RES, &res);
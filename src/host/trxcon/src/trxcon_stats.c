@@ -0,0 +1,90 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * Rate counters and stat items
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include <osmocom/core/rate_ctr.h>
+#include <osmocom/core/stat_item.h>
+
+#include <osmocom/bb/trxcon/trxcon_stats.h>
+
+static pthread_mutex_t g_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void trxcon_stats_lock(void)
+{
+	pthread_mutex_lock(&g_stats_lock);
+}
+
+void trxcon_stats_unlock(void)
+{
+	pthread_mutex_unlock(&g_stats_lock);
+}
+
+static int dump_ctr_cb(struct rate_ctr_group *ctrg, struct rate_ctr *ctr,
+		       const struct rate_ctr_desc *desc, void *data)
+{
+	FILE *out = data;
+
+	/* Skip zero counters to keep the output short */
+	if (ctr->current == 0)
+		return 0;
+
+	fprintf(out, "  %s.%u.%s: %" PRIu64 "\n",
+		ctrg->desc->group_name_prefix, ctrg->idx,
+		desc->name, ctr->current);
+	return 0;
+}
+
+static int dump_ctrg_cb(struct rate_ctr_group *ctrg, void *data)
+{
+	return rate_ctr_for_each_counter(ctrg, &dump_ctr_cb, data);
+}
+
+static int dump_item_cb(struct osmo_stat_item_group *statg,
+			struct osmo_stat_item *item, void *data)
+{
+	FILE *out = data;
+
+	fprintf(out, "  %s.%u.%s: %d\n",
+		statg->desc->group_name_prefix, statg->idx,
+		osmo_stat_item_get_desc(item)->name,
+		osmo_stat_item_get_last(item));
+	return 0;
+}
+
+static int dump_statg_cb(struct osmo_stat_item_group *statg, void *data)
+{
+	return osmo_stat_item_for_each_item(statg, &dump_item_cb, data);
+}
+
+/*! Dump all (non-zero) rate counters and all stat items */
+void trxcon_stats_dump(FILE *out)
+{
+	trxcon_stats_lock();
+
+	fprintf(out, "Rate counters:\n");
+	rate_ctr_for_each_group(&dump_ctrg_cb, out);
+	fprintf(out, "Stat items:\n");
+	osmo_stat_item_for_each_group(&dump_statg_cb, out);
+
+	trxcon_stats_unlock();
+}
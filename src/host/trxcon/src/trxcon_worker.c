@@ -0,0 +1,319 @@
+/*
+ * OsmocomBB <-> SDR connection bridge
+ * Worker threads serving L1CTL connections
+ *
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+/* In worker mode, the main thread only accepts L1CTL connections and hands
+ * them over to one of N worker threads (the least loaded one).  Each worker
+ * runs its own osmo_select_main() loop, and everything belonging to an L1CTL
+ * connection (trxcon_inst, l1sched, l1gprs, trx_if and the L1CTL client fd)
+ * is allocated, served and freed by that worker only.
+ *
+ * This relies on osmo_fd and osmo_timer lists being thread-local in
+ * libosmocore, and on thread-local copies of our FSM definitions.  Logging
+ * is serialized by libosmocore (see log_enable_multithread()). */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/select.h>
+#include <osmocom/core/logging.h>
+#include <osmocom/core/context.h>
+
+#include <osmocom/bb/l1sched/l1sched.h>
+#include <osmocom/bb/trxcon/trxcon_fsm.h>
+#include <osmocom/bb/trxcon/trxcon_worker.h>
+#include <osmocom/bb/trxcon/l1ctl_server.h>
+#include <osmocom/bb/trxcon/trx_if.h>
+#include <osmocom/bb/trxcon/logging.h>
+
+/* Max number of accepted connections waiting for a worker */
+#define WORKER_FDQ_LEN		16
+
+struct trxcon_worker {
+	unsigned int id;
+	pthread_t thread;
+	/* talloc context owned by this worker */
+	void *ctx;
+
+	/* eventfd for waking up the worker */
+	struct osmo_fd wake_ofd;
+
+	/* everything below is protected by the lock */
+	pthread_mutex_t lock;
+	int fdq[WORKER_FDQ_LEN];
+	unsigned int fdq_len;
+	bool quit;
+};
+
+static struct {
+	struct trxcon_worker *workers;
+	unsigned int num_workers;
+	const struct trxcon_worker_cfg *cfg;
+} g_pool;
+
+/* Worker serving the current thread (NULL for the main thread) */
+static __thread struct trxcon_worker *g_worker;
+
+/* Number of clients being served by (or dispatched to) the given worker */
+static unsigned int worker_load(struct trxcon_worker *w)
+{
+	struct l1ctl_server *server = g_pool.cfg->server;
+	struct l1ctl_client *client;
+	unsigned int load;
+
+	pthread_mutex_lock(&w->lock);
+	load = w->fdq_len;
+	pthread_mutex_unlock(&w->lock);
+
+	pthread_mutex_lock(&server->lock);
+	llist_for_each_entry(client, &server->clients, list) {
+		if (pthread_equal(client->thread, w->thread))
+			load++;
+	}
+	pthread_mutex_unlock(&server->lock);
+
+	return load;
+}
+
+static void worker_wake(struct trxcon_worker *w)
+{
+	uint64_t val = 1;
+
+	if (write(w->wake_ofd.fd, &val, sizeof(val)) != sizeof(val))
+		LOGP(DAPP, LOGL_ERROR, "Failed to wake up worker #%u\n", w->id);
+}
+
+/*! Hand over an accepted L1CTL connection to the least loaded worker.
+ *  To be used as l1ctl_server_cfg.conn_dispatch_cb (main thread). */
+int trxcon_workers_dispatch(struct l1ctl_server *server, int fd)
+{
+	struct trxcon_worker *w = NULL;
+	unsigned int i, load, min_load = ~0;
+
+	for (i = 0; i < g_pool.num_workers; i++) {
+		load = worker_load(&g_pool.workers[i]);
+		if (load < min_load) {
+			w = &g_pool.workers[i];
+			min_load = load;
+		}
+	}
+
+	if (w == NULL)
+		return -ENODEV;
+
+	pthread_mutex_lock(&w->lock);
+	if (w->fdq_len >= WORKER_FDQ_LEN) {
+		pthread_mutex_unlock(&w->lock);
+		return -ENOBUFS;
+	}
+	w->fdq[w->fdq_len++] = fd;
+	pthread_mutex_unlock(&w->lock);
+
+	LOGP(DAPP, LOGL_INFO, "Dispatching L1CTL connection to worker #%u\n", w->id);
+	worker_wake(w);
+
+	return 0;
+}
+
+static int worker_wake_cb(struct osmo_fd *ofd, unsigned int what)
+{
+	struct trxcon_worker *w = ofd->data;
+	int fdq[WORKER_FDQ_LEN];
+	unsigned int i, fdq_len;
+	uint64_t val;
+
+	if (read(ofd->fd, &val, sizeof(val)) != sizeof(val))
+		return 0;
+
+	pthread_mutex_lock(&w->lock);
+	memcpy(&fdq[0], &w->fdq[0], w->fdq_len * sizeof(fdq[0]));
+	fdq_len = w->fdq_len;
+	w->fdq_len = 0;
+	pthread_mutex_unlock(&w->lock);
+
+	for (i = 0; i < fdq_len; i++)
+		l1ctl_server_conn_open(g_pool.cfg->server, w->ctx, fdq[i]);
+
+	return 0;
+}
+
+/* Close all L1CTL connections served by the calling worker */
+static void worker_close_clients(void)
+{
+	struct l1ctl_server *server = g_pool.cfg->server;
+	struct l1ctl_client *client, *found;
+
+	while (1) {
+		found = NULL;
+
+		pthread_mutex_lock(&server->lock);
+		llist_for_each_entry(client, &server->clients, list) {
+			if (pthread_equal(client->thread, pthread_self())) {
+				found = client;
+				break;
+			}
+		}
+		pthread_mutex_unlock(&server->lock);
+
+		if (found == NULL)
+			break;
+		l1ctl_client_conn_close(found);
+	}
+}
+
+static void *worker_main(void *arg)
+{
+	struct trxcon_worker *w = arg;
+	bool quit = false;
+	sigset_t sigset;
+
+	/* Signals are handled by the main thread */
+	sigemptyset(&sigset);
+	sigaddset(&sigset, SIGINT);
+	sigaddset(&sigset, SIGTERM);
+	sigaddset(&sigset, SIGUSR1);
+	sigaddset(&sigset, SIGUSR2);
+	pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+	g_worker = w;
+	osmo_ctx_init("trxcon-worker");
+
+	/* Thread-local copies of the FSM definitions */
+	trxcon_fsm_thread_init();
+	trx_if_thread_init();
+
+	osmo_fd_register(&w->wake_ofd);
+
+	LOGP(DAPP, LOGL_NOTICE, "Worker #%u started\n", w->id);
+
+	while (!quit) {
+		osmo_select_main_ctx(0);
+
+		pthread_mutex_lock(&w->lock);
+		quit = w->quit;
+		pthread_mutex_unlock(&w->lock);
+	}
+
+	worker_close_clients();
+	osmo_fd_unregister(&w->wake_ofd);
+	l1sched_msgb_pool_drain();
+
+	LOGP(DAPP, LOGL_NOTICE, "Worker #%u stopped\n", w->id);
+
+	return NULL;
+}
+
+/*! Start the given number of worker threads.
+ *  \param[in] ctx  talloc context (used by the main thread only).
+ *  \param[in] cfg  configuration, shall outlive the workers.
+ *  \returns 0 on success; negative on error. */
+int trxcon_workers_start(void *ctx, const struct trxcon_worker_cfg *cfg)
+{
+	unsigned int i;
+	int fd, rc;
+
+	g_pool.cfg = cfg;
+	g_pool.workers = talloc_zero_array(ctx, struct trxcon_worker, cfg->num_workers);
+	if (g_pool.workers == NULL)
+		return -ENOMEM;
+
+	/* Allocate per-worker talloc contexts before any thread is running */
+	for (i = 0; i < cfg->num_workers; i++) {
+		struct trxcon_worker *w = &g_pool.workers[i];
+
+		w->id = i;
+		w->ctx = talloc_named_const(g_pool.workers, 0, "trxcon_worker");
+		if (w->ctx == NULL) {
+			TALLOC_FREE(g_pool.workers);
+			return -ENOMEM;
+		}
+	}
+
+	for (i = 0; i < cfg->num_workers; i++) {
+		struct trxcon_worker *w = &g_pool.workers[i];
+
+		fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (fd < 0) {
+			rc = -errno;
+			goto error;
+		}
+
+		pthread_mutex_init(&w->lock, NULL);
+		osmo_fd_setup(&w->wake_ofd, fd, OSMO_FD_READ, &worker_wake_cb, w, 0);
+
+		rc = pthread_create(&w->thread, NULL, &worker_main, w);
+		if (rc != 0) {
+			close(fd);
+			pthread_mutex_destroy(&w->lock);
+			rc = -rc;
+			goto error;
+		}
+
+		g_pool.num_workers++;
+	}
+
+	return 0;
+
+error:
+	LOGP(DAPP, LOGL_ERROR, "Failed to start worker #%u: %s\n", i, strerror(-rc));
+	trxcon_workers_stop();
+	return rc;
+}
+
+/*! Stop all worker threads, closing connections served by them */
+void trxcon_workers_stop(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < g_pool.num_workers; i++) {
+		struct trxcon_worker *w = &g_pool.workers[i];
+
+		pthread_mutex_lock(&w->lock);
+		w->quit = true;
+		pthread_mutex_unlock(&w->lock);
+		worker_wake(w);
+	}
+
+	for (i = 0; i < g_pool.num_workers; i++) {
+		struct trxcon_worker *w = &g_pool.workers[i];
+
+		pthread_join(w->thread, NULL);
+
+		/* Connections which were dispatched, but not yet served */
+		while (w->fdq_len > 0) {
+			close(w->fdq[--w->fdq_len]);
+			pthread_mutex_lock(&g_pool.cfg->server->lock);
+			g_pool.cfg->server->num_clients--;
+			pthread_mutex_unlock(&g_pool.cfg->server->lock);
+		}
+
+		close(w->wake_ofd.fd);
+		pthread_mutex_destroy(&w->lock);
+	}
+
+	TALLOC_FREE(g_pool.workers);
+	g_pool.num_workers = 0;
+}
@@ -0,0 +1,213 @@
+/*
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/utils.h>
+
+#include <osmocom/bb/trxcon/l1ctl_framing.h>
+
+#define MAX_LEN		1024
+
+static struct l1ctl_framing_rx rx;
+static int fds[2];
+
+/* Prefix a message of the given length (filled with a pattern) */
+static unsigned int frame(uint8_t *buf, uint16_t len, uint8_t seed)
+{
+	unsigned int i;
+
+	osmo_store16be(len, &buf[0]);
+	for (i = 0; i < len; i++)
+		buf[L1CTL_FRAMING_LEN_FIELD + i] = seed + i;
+
+	return L1CTL_FRAMING_LEN_FIELD + len;
+}
+
+static void tx(const uint8_t *buf, unsigned int len)
+{
+	OSMO_ASSERT(write(fds[1], buf, len) == len);
+}
+
+static void fill(void)
+{
+	int rc = l1ctl_framing_rx_fill(&rx, fds[0]);
+
+	printf("  fill: rc=%d\n", rc);
+}
+
+/* Pop all complete messages, check their content */
+static unsigned int pop_all(void)
+{
+	const uint8_t *data;
+	unsigned int num = 0;
+	int rc, i;
+
+	while ((rc = l1ctl_framing_rx_pop(&rx, &data)) >= 0) {
+		for (i = 1; i < rc; i++) {
+			if (data[i] != (uint8_t)(data[0] + i))
+				break;
+		}
+		printf("  pop: len=%d seed=0x%02x %s\n", rc, rc > 0 ? data[0] : 0,
+		       i < rc ? "CORRUPTED" : "OK");
+		num++;
+	}
+
+	printf("  pop: rc=%s\n", rc == -EAGAIN ? "-EAGAIN" :
+	       rc == -EMSGSIZE ? "-EMSGSIZE" : "?");
+	return num;
+}
+
+static void reset(void)
+{
+	if (fds[0] >= 0) {
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	OSMO_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	l1ctl_framing_rx_init(&rx, MAX_LEN);
+}
+
+/* Several messages received with a single read() */
+static void test_multiple(void)
+{
+	uint8_t buf[256];
+	unsigned int len = 0;
+
+	printf("Running %s()\n", __func__);
+	reset();
+
+	len += frame(&buf[len], 23, 0x10);
+	len += frame(&buf[len], 0, 0x20);
+	len += frame(&buf[len], 64, 0x30);
+	tx(&buf[0], len);
+
+	fill();
+	pop_all();
+}
+
+/* A message received octet by octet */
+static void test_partial(void)
+{
+	uint8_t buf[64];
+	unsigned int len, i;
+	const uint8_t *data;
+
+	printf("Running %s()\n", __func__);
+	reset();
+
+	len = frame(&buf[0], 5, 0x40);
+	for (i = 0; i < len; i++) {
+		tx(&buf[i], 1);
+		OSMO_ASSERT(l1ctl_framing_rx_fill(&rx, fds[0]) == 1);
+		if (i < len - 1)
+			OSMO_ASSERT(l1ctl_framing_rx_pop(&rx, &data) == -EAGAIN);
+	}
+
+	pop_all();
+}
+
+/* Messages split across several reads, at arbitrary offsets */
+static void test_split(void)
+{
+	uint8_t buf[256];
+	unsigned int len = 0;
+
+	printf("Running %s()\n", __func__);
+	reset();
+
+	len += frame(&buf[len], 16, 0x50);
+	len += frame(&buf[len], 32, 0x60);
+	len += frame(&buf[len], 8, 0x70);
+
+	/* First message and the first octet of the length of the second one */
+	tx(&buf[0], 2 + 16 + 1);
+	fill();
+	pop_all();
+
+	/* Rest of the second message and a part of the third one */
+	tx(&buf[2 + 16 + 1], 1 + 32 + 2 + 4);
+	fill();
+	pop_all();
+
+	/* Rest of the third message */
+	tx(&buf[2 + 16 + 2 + 32 + 2 + 4], 4);
+	fill();
+	pop_all();
+}
+
+/* More data than fits into the receive buffer */
+static void test_overflow(void)
+{
+	uint8_t buf[6 * (L1CTL_FRAMING_LEN_FIELD + MAX_LEN)];
+	unsigned int len = 0, num = 0, i;
+
+	printf("Running %s()\n", __func__);
+	reset();
+
+	for (i = 0; i < 6; i++)
+		len += frame(&buf[len], MAX_LEN, 0x80 + i);
+	tx(&buf[0], len);
+
+	/* Each read() is limited by the free space in the buffer,
+	 * the remainder of a partial message is moved to its beginning */
+	while (num < 6) {
+		fill();
+		num += pop_all();
+	}
+}
+
+/* A message longer than max_len, then EOF */
+static void test_too_long(void)
+{
+	uint8_t buf[8];
+
+	printf("Running %s()\n", __func__);
+	reset();
+
+	osmo_store16be(MAX_LEN + 1, &buf[0]);
+	tx(&buf[0], 2);
+	fill();
+	pop_all();
+
+	close(fds[1]);
+	fds[1] = -1;
+	fill();
+}
+
+int main(int argc, char **argv)
+{
+	fds[0] = -1;
+
+	test_multiple();
+	test_partial();
+	test_split();
+	test_overflow();
+	test_too_long();
+
+	close(fds[0]);
+
+	return EXIT_SUCCESS;
+}
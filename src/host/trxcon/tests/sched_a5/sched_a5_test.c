@@ -0,0 +1,125 @@
+/*
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <osmocom/core/bits.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/gsm/a5.h>
+#include <osmocom/gsm/gsm0502.h>
+
+#include <osmocom/bb/l1sched/l1sched.h>
+
+#define NUM_KEYS	8
+
+static struct l1sched_state *sched;
+static struct l1sched_lchan_state *lchan;
+
+/* Compare the cached keystream of a TDMA frame against osmo_a5() */
+static bool check_fn(uint32_t fn)
+{
+	ubit_t dl[114], ul[114];
+	const ubit_t *ks;
+
+	osmo_a5(lchan->a5.algo, &lchan->a5.key[0], fn, &dl[0], &ul[0]);
+
+	ks = l1sched_a5_keystream(lchan, fn, false);
+	if (ks == NULL || memcmp(ks, &dl[0], sizeof(dl)) != 0) {
+		printf("  fn=%u: Downlink keystream mismatch\n", fn);
+		return false;
+	}
+
+	ks = l1sched_a5_keystream(lchan, fn, true);
+	if (ks == NULL || memcmp(ks, &ul[0], sizeof(ul)) != 0) {
+		printf("  fn=%u: Uplink keystream mismatch\n", fn);
+		return false;
+	}
+
+	return true;
+}
+
+/* Walk num consecutive TDMA frames starting at fn, the way the scheduler
+ * does: Downlink for the current frame, Uplink a few frames ahead */
+static unsigned int check_range(uint32_t fn, unsigned int num)
+{
+	unsigned int i, failed = 0;
+
+	for (i = 0; i < num; i++) {
+		uint32_t fn_dl = GSM_TDMA_FN_SUM(fn, i);
+		uint32_t fn_ul = GSM_TDMA_FN_SUM(fn_dl, 3);
+
+		if (!check_fn(fn_dl))
+			failed++;
+		if (!check_fn(fn_ul))
+			failed++;
+	}
+
+	return failed;
+}
+
+static void test_a5(uint8_t algo)
+{
+	unsigned int n, i;
+
+	for (n = 0; n < NUM_KEYS; n++) {
+		unsigned int failed = 0;
+
+		lchan->a5.algo = algo;
+		lchan->a5.key_len = 8;
+		for (i = 0; i < lchan->a5.key_len; i++)
+			lchan->a5.key[i] = rand() & 0xff;
+
+		/* Sequential frames, more than the cache can hold */
+		failed += check_range(0, 300);
+		/* Across the hyperframe boundary */
+		failed += check_range(GSM_TDMA_HYPERFRAME - 100, 200);
+		/* Random jumps */
+		for (i = 0; i < 32; i++)
+			failed += check_range(rand() % GSM_TDMA_HYPERFRAME, 4);
+		/* Same frames again, after the cache has been flushed */
+		l1sched_a5_cache_flush(sched);
+		failed += check_range(GSM_TDMA_HYPERFRAME - 100, 200);
+
+		printf("A5/%u: key #%u: %s\n", algo, n, failed ? "FAILED" : "OK");
+	}
+
+	l1sched_a5_cache_flush(sched);
+}
+
+int main(int argc, char **argv)
+{
+	struct l1sched_ts *ts;
+
+	srand(0xa5a5);
+
+	sched = talloc_zero(NULL, struct l1sched_state);
+	ts = talloc_zero(sched, struct l1sched_ts);
+	lchan = talloc_zero(ts, struct l1sched_lchan_state);
+	ts->sched = sched;
+	lchan->ts = ts;
+
+	test_a5(1);
+	test_a5(2);
+
+	talloc_free(sched);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,181 @@
+/*
+ * (C) 2026 by agent <agent@local>
+ *
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <osmocom/core/logging.h>
+#include <osmocom/core/msgb.h>
+#include <osmocom/core/talloc.h>
+#include <osmocom/core/utils.h>
+#include <osmocom/gsm/gsm0502.h>
+
+#include <osmocom/bb/l1sched/l1sched.h>
+#include <osmocom/bb/l1sched/prim.h>
+
+static struct l1sched_state *sched;
+/* TDMA frame number of the last burst given to the scheduler */
+static uint32_t last_fn;
+
+/* The last SCH indication from the scheduler */
+static struct {
+	bool valid;
+	uint32_t fn;
+	uint8_t bsic;
+} sch_ind;
+
+/* External L1 API for the scheduler: nothing is transmitted */
+int l1sched_handle_burst_req(struct l1sched_state *sched,
+			     const struct l1sched_burst_req *br)
+{
+	return 0;
+}
+
+/* External L2 API for the scheduler */
+int l1sched_prim_to_user(struct l1sched_state *sched, struct msgb *msg)
+{
+	const struct l1sched_prim *prim = l1sched_prim_from_msgb(msg);
+
+	if (OSMO_PRIM_HDR(&prim->oph) == OSMO_PRIM(L1SCHED_PRIM_T_SCH, PRIM_OP_INDICATION)) {
+		sch_ind.valid = true;
+		sch_ind.fn = prim->sch_ind.frame_nr;
+		sch_ind.bsic = prim->sch_ind.bsic;
+	}
+
+	msgb_free(msg);
+	return 0;
+}
+
+/* The next TDMA frame carrying the SCH on TS0, at or after fn */
+static uint32_t sch_fn_next(uint32_t fn)
+{
+	while (fn % 51 % 10 != 1)
+		fn = GSM_TDMA_FN_SUM(fn, 1);
+	return fn;
+}
+
+/* Encode a SCH burst for fn_enc, deliver it to the scheduler at fn_rx */
+static bool rx_sch(uint32_t fn_enc, uint32_t fn_rx, uint8_t bsic, bool noise)
+{
+	unsigned int i;
+
+	struct l1sched_burst_ind bi = {
+		.fn = fn_rx,
+		.tn = 0,
+		.rssi = -60,
+		.burst_len = 148,
+	};
+
+	l1sched_sch_burst_encode(&bi.burst[0], fn_enc, bsic);
+	if (noise) {
+		for (i = 0; i < 39; i++) {
+			bi.burst[3 + i] = rand() % 255 - 127;
+			bi.burst[106 + i] = rand() % 255 - 127;
+		}
+	}
+
+	sch_ind.valid = false;
+	l1sched_handle_rx_burst(sched, &bi);
+	last_fn = fn_rx;
+
+	return sch_ind.valid;
+}
+
+/* Round-trip of consecutive SCH bursts across the hyperframe boundary */
+static void test_sch_hyperframe_wrap(void)
+{
+	uint32_t fn = sch_fn_next(GSM_TDMA_HYPERFRAME - 51 * 4);
+	unsigned int i, ok = 0;
+
+	for (i = 0; i < 40; i++) {
+		uint8_t bsic = i % 64;
+
+		if (rx_sch(fn, fn, bsic, false) && sch_ind.fn == fn &&
+		    sch_ind.bsic == bsic && sched->bsic == bsic)
+			ok++;
+		else
+			printf("  fn=%u bsic=%u: round-trip failed\n", fn, bsic);
+		fn = sch_fn_next(GSM_TDMA_FN_SUM(fn, 1));
+	}
+
+	printf("%s(): %u/%u SCH bursts OK\n", __func__, ok, i);
+}
+
+/* Round-trip of SCH bursts with random frame numbers and BSIC */
+static void test_sch_random(void)
+{
+	uint32_t fn = sch_fn_next(GSM_TDMA_FN_SUM(last_fn, 1));
+	unsigned int i, ok = 0;
+
+	for (i = 0; i < 256; i++) {
+		uint8_t bsic = rand() % 64;
+
+		if (rx_sch(fn, fn, bsic, false) && sch_ind.fn == fn &&
+		    sch_ind.bsic == bsic)
+			ok++;
+		else
+			printf("  fn=%u bsic=%u: round-trip failed\n", fn, bsic);
+		fn = sch_fn_next(GSM_TDMA_FN_SUM(fn, 1 + rand() % 100000));
+	}
+
+	printf("%s(): %u/%u SCH bursts OK\n", __func__, ok, i);
+}
+
+/* Bursts which shall not result in a SCH indication */
+static void test_sch_reject(void)
+{
+	uint32_t fn = sch_fn_next(GSM_TDMA_FN_SUM(last_fn, 1));
+	uint32_t fn_next = sch_fn_next(GSM_TDMA_FN_SUM(fn, 1));
+
+	printf("%s(): valid burst: %s\n", __func__,
+	       rx_sch(fn, fn, 42, false) ? "accepted" : "rejected");
+	printf("%s(): burst of another frame: %s\n", __func__,
+	       rx_sch(fn, fn_next, 42, false) ? "accepted" : "rejected");
+	fn_next = sch_fn_next(GSM_TDMA_FN_SUM(fn_next, 1));
+	printf("%s(): noise: %s\n", __func__,
+	       rx_sch(fn_next, fn_next, 42, true) ? "accepted" : "rejected");
+}
+
+static const struct log_info test_log_info = { };
+
+int main(int argc, char **argv)
+{
+	const struct l1sched_cfg sched_cfg = { .log_prefix = "" };
+	void *ctx;
+
+	srand(0x5c4);
+
+	ctx = talloc_named_const(NULL, 0, "sched_sch_test");
+	osmo_init_logging2(ctx, &test_log_info);
+	log_set_log_level(osmo_stderr_target, LOGL_FATAL);
+
+	sched = l1sched_alloc(ctx, &sched_cfg, NULL);
+	OSMO_ASSERT(sched != NULL);
+	OSMO_ASSERT(l1sched_configure_ts(sched, 0, GSM_PCHAN_CCCH) == 0);
+
+	test_sch_hyperframe_wrap();
+	test_sch_random();
+	test_sch_reject();
+
+	l1sched_free(sched);
+	talloc_free(ctx);
+
+	return EXIT_SUCCESS;
+}
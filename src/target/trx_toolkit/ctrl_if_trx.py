@@ -32,8 +32,12 @@ class CTRLInterfaceTRX(CTRLInterface):
 	  - RXTUNE / TXTUNE - RX / TX frequency management,
 	  - SETSLOT - timeslot management.
 
-	Additionally, there is an optional MEASURE command, which is used
-	by OsmocomBB to perform power measurement on a given frequency.
+	Additionally, there are optional MEASURE and MEASRANGE commands,
+	which are used by OsmocomBB to perform power measurement on a given
+	frequency or on a range of equally spaced frequencies:
+
+	  L1 -> TRX: CMD MEASRANGE FREQ STEP NUM
+	  L1 <- TRX: RSP MEASRANGE 0 FREQ STEP NUM DBM_1 ... DBM_NUM
 
 	A given transceiver may also define its own command handler,
 	that is prioritized, i.e. it can overwrite any commands mentioned
@@ -151,6 +155,29 @@ class CTRLInterfaceTRX(CTRLInterface):
 
 			return (0, [str(meas_dbm)])
 
+		# Power measurement of a range of frequencies
+		if self.verify_cmd(request, "MEASRANGE", 3):
+			log.debug("(%s) Recv MEASRANGE cmd" % self.trx)
+
+			if self.trx.pwr_meas is None:
+				log.error("(%s) Power Measurement interface is not "
+					"initialized => rejecting command" % self.trx)
+				return -1
+
+			meas_freq = int(request[1]) * 1000
+			meas_step = int(request[2]) * 1000
+			meas_num = int(request[3])
+
+			if meas_num < 1 or meas_num > 64:
+				log.error("(%s) Incorrect number of frequencies %d"
+					% (self.trx, meas_num))
+				return -1
+
+			meas_dbm = [self.trx.pwr_meas.measure(meas_freq + i * meas_step)
+				for i in range(meas_num)]
+
+			return (0, [str(dbm) for dbm in meas_dbm])
+
 		# Frequency hopping configuration (variable length list):
 		#
 		#   CMD SETFH <HSN> <MAIO> <RXF1> <TXF1> [... <RXFN> <TXFN>]